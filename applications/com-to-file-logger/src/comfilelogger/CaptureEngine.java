@@ -0,0 +1,276 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package comfilelogger;
+
+import java.io.BufferedInputStream;
+import java.io.Closeable;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.lang.management.ManagementFactory;
+import java.lang.management.ThreadMXBean;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.TimeUnit;
+import java.util.zip.GZIPOutputStream;
+
+import com.serialpundit.core.SerialComException;
+import com.serialpundit.serial.SerialComManager;
+
+/*
+ * Headless capture of many ports at once. Every port gets a PortCapture registered as data listener,
+ * so no thread polls idle ports. One sync thread flushes buffers of all ports and fsyncs them every
+ * sync interval, which bounds data lost on power failure. Closed segments are optionally gzipped by
+ * a single low priority background thread so that compression never delays capture.
+ */
+public final class CaptureEngine {
+
+	private final File directory;
+	private final long segmentSize;
+	private final long segmentAge;
+	private final long syncInterval;
+	private final int bufferSize;
+	private final boolean compress;
+
+	private final ArrayList<PortCapture> captures = new ArrayList<PortCapture>();
+	private final ExecutorService compressor;
+	private final ThreadMXBean threadBean = ManagementFactory.getThreadMXBean();
+	private SerialComManager scm;
+	private Thread syncThread;
+	private volatile boolean exit;
+	private volatile long compressCpuNanos;
+	private volatile long compressedSegments;
+
+	private long lastReportTime;
+	private long[] lastBytes = new long[0];
+	private long[] lastCpu = new long[0];
+
+	private final class Syncer implements Runnable {
+		@Override
+		public void run() {
+			while(exit == false) {
+				try {
+					Thread.sleep(syncInterval);
+				} catch (InterruptedException e) {
+					if(exit == true) {
+						break;
+					}
+				}
+				long now = System.currentTimeMillis();
+				for(PortCapture capture : getCaptures()) {
+					capture.sync(now);
+				}
+			}
+		}
+	}
+
+	private final class Compressor implements Runnable {
+		private final File segment;
+
+		Compressor(File segment) {
+			this.segment = segment;
+		}
+
+		@Override
+		public void run() {
+			long cpuStart = threadBean.getCurrentThreadCpuTime();
+			File gz = new File(segment.getPath() + ".gz");
+			File part = new File(gz.getPath() + ".part");
+			InputStream in = null;
+			OutputStream out = null;
+			try {
+				in = new BufferedInputStream(new FileInputStream(segment), 256 * 1024);
+				FileOutputStream fos = new FileOutputStream(part);
+				out = new GZIPOutputStream(fos, 256 * 1024);
+				byte[] data = new byte[256 * 1024];
+				int n;
+				while((n = in.read(data)) > 0) {
+					out.write(data, 0, n);
+				}
+				((GZIPOutputStream) out).finish();
+				fos.getFD().sync();
+				out.close();
+				out = null;
+				if(part.renameTo(gz) == true) {
+					segment.delete();
+					compressedSegments++;
+				}
+			} catch (IOException e) {
+				/* uncompressed segment is kept, nothing is lost */
+				System.err.println("compression of " + segment + " failed : " + e.getMessage());
+			} finally {
+				closeQuietly(in);
+				closeQuietly(out);
+			}
+			compressCpuNanos += threadBean.getCurrentThreadCpuTime() - cpuStart;
+		}
+	}
+
+	public CaptureEngine(File directory, long segmentSize, long segmentAge, long syncInterval, int bufferSize,
+			boolean compress) throws IOException {
+		if((directory.isDirectory() == false) && (directory.mkdirs() == false)) {
+			throw new IOException("Could not create directory " + directory);
+		}
+		this.directory = directory;
+		this.segmentSize = segmentSize;
+		this.segmentAge = segmentAge;
+		this.syncInterval = syncInterval;
+		this.bufferSize = bufferSize;
+		this.compress = compress;
+
+		if(compress == true) {
+			compressor = Executors.newSingleThreadExecutor(new ThreadFactory() {
+				@Override
+				public Thread newThread(Runnable r) {
+					Thread t = new Thread(r, "segment compressor");
+					t.setPriority(Thread.MIN_PRIORITY);
+					t.setDaemon(true);
+					return t;
+				}
+			});
+		}else {
+			compressor = null;
+		}
+	}
+
+	/* Port must be opened and configured by caller; capture starts as soon as listener is registered. */
+	public synchronized void addPort(SerialComManager scm, String portName, long handle) throws IOException, SerialComException {
+		this.scm = scm;
+		PortCapture capture = new PortCapture(this, portName, handle);
+		boolean registered = false;
+		try {
+			scm.registerDataListener(handle, capture);
+			registered = true;
+		} finally {
+			if(registered == false) {
+				capture.discard();
+			}
+		}
+		captures.add(capture);
+	}
+
+	public synchronized void start() {
+		lastReportTime = System.currentTimeMillis();
+		syncThread = new Thread(new Syncer(), "segment sync");
+		syncThread.start();
+	}
+
+	public void stop() {
+		exit = true;
+		if(syncThread != null) {
+			syncThread.interrupt();
+			try {
+				syncThread.join();
+			} catch (InterruptedException e) {
+				Thread.currentThread().interrupt();
+			}
+		}
+		for(PortCapture capture : getCaptures()) {
+			try {
+				scm.unregisterDataListener(capture.getHandle(), capture);
+			} catch (Exception e) {
+				System.err.println("unregister " + capture.getPortName() + " : " + e.getMessage());
+			}
+			try {
+				capture.close();
+			} catch (IOException e) {
+				System.err.println("close " + capture.getPortName() + " : " + e.getMessage());
+			}
+		}
+		if(compressor != null) {
+			compressor.shutdown();
+			try {
+				compressor.awaitTermination(1, TimeUnit.MINUTES);
+			} catch (InterruptedException e) {
+				Thread.currentThread().interrupt();
+			}
+		}
+	}
+
+	/* One line per port with throughput and CPU since last report. */
+	public synchronized String report() {
+		StringBuilder sb = new StringBuilder();
+		long now = System.currentTimeMillis();
+		long elapsed = (now - lastReportTime) > 0 ? (now - lastReportTime) : 1;
+		if(lastBytes.length != captures.size()) {
+			lastBytes = Arrays.copyOf(lastBytes, captures.size());
+			lastCpu = Arrays.copyOf(lastCpu, captures.size());
+		}
+
+		for(int x=0; x<captures.size(); x++) {
+			PortCapture capture = captures.get(x);
+			long bytes = capture.getBytesCaptured();
+			long cpu = capture.getCpuNanos() + capture.getSyncNanos();
+			double mbps = (bytes - lastBytes[x]) / 1048576.0 / (elapsed / 1000.0);
+			double cpuPercent = (cpu - lastCpu[x]) / 10000.0 / elapsed;
+			sb.append(String.format("%-16s %8.3f MB/s  cpu %5.2f%%  total %d bytes  %d records  %d segments",
+					capture.getPortName(), mbps, cpuPercent, bytes, capture.getRecords(), capture.getSegmentCount()));
+			if(capture.getErrors() > 0) {
+				sb.append("  errors " + capture.getErrors() + " (" + capture.getLastError().getMessage() + ")");
+			}
+			if(capture.getListenerError() != 0) {
+				sb.append("  listener error " + capture.getListenerError());
+			}
+			sb.append('\n');
+			lastBytes[x] = bytes;
+			lastCpu[x] = cpu;
+		}
+		if(compress == true) {
+			sb.append(String.format("compressor: %d segments, cpu %d ms total\n", compressedSegments, compressCpuNanos / 1000000));
+		}
+		lastReportTime = now;
+		return sb.toString();
+	}
+
+	void segmentClosed(File segment) {
+		if((compressor != null) && (compressor.isShutdown() == false)) {
+			compressor.execute(new Compressor(segment));
+		}
+	}
+
+	File getDirectory() {
+		return directory;
+	}
+
+	long getSegmentSize() {
+		return segmentSize;
+	}
+
+	long getSegmentAge() {
+		return segmentAge;
+	}
+
+	int getBufferSize() {
+		return bufferSize;
+	}
+
+	private synchronized PortCapture[] getCaptures() {
+		return captures.toArray(new PortCapture[captures.size()]);
+	}
+
+	private static void closeQuietly(Closeable c) {
+		if(c != null) {
+			try {
+				c.close();
+			} catch (IOException e) {
+			}
+		}
+	}
+}
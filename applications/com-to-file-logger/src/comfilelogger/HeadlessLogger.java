@@ -0,0 +1,137 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package comfilelogger;
+
+import java.io.File;
+import java.util.ArrayList;
+
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComPortConfig;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.FLOWCONTROL;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+
+/*
+ * Always-on logger without GUI, for example :
+ * java -cp ... comfilelogger.HeadlessLogger -d /var/log/serial -b 115200 -z /dev/ttyUSB0 /dev/ttyUSB1
+ * Runs until killed; shutdown hook flushes and closes all segments.
+ */
+public final class HeadlessLogger {
+
+	private static void usage() {
+		System.out.println("usage: HeadlessLogger [options] port1 [port2 ...]");
+		System.out.println("  -d dir     directory for segment files (default ./logs)");
+		System.out.println("  -b baud    baud rate for all ports (default 115200)");
+		System.out.println("  -s MB      rotate segment when it reaches this size (default 64)");
+		System.out.println("  -t min     rotate segment when it gets this old, 0 disables (default 60)");
+		System.out.println("  -f ms      flush and fsync interval (default 1000)");
+		System.out.println("  -k KB      write buffer per port (default 1024)");
+		System.out.println("  -r sec     statistics report interval, 0 disables (default 10)");
+		System.out.println("  -z         gzip closed segments in background");
+		System.exit(1);
+	}
+
+	public static void main(String[] args) throws Exception {
+
+		File dir = new File("logs");
+		String baud = "115200";
+		long segmentMB = 64;
+		long segmentMinutes = 60;
+		long syncMs = 1000;
+		int bufferKB = 1024;
+		long reportSec = 10;
+		boolean compress = false;
+		ArrayList<String> ports = new ArrayList<String>();
+
+		for(int x=0; x<args.length; x++) {
+			if(args[x].equals("-z")) {
+				compress = true;
+			}else if(args[x].startsWith("-")) {
+				if(x + 1 >= args.length) {
+					usage();
+				}
+				String val = args[++x];
+				switch(args[x - 1]) {
+				case "-d": dir = new File(val); break;
+				case "-b": baud = val; break;
+				case "-s": segmentMB = Long.parseLong(val); break;
+				case "-t": segmentMinutes = Long.parseLong(val); break;
+				case "-f": syncMs = Long.parseLong(val); break;
+				case "-k": bufferKB = Integer.parseInt(val); break;
+				case "-r": reportSec = Long.parseLong(val); break;
+				default: usage();
+				}
+			}else {
+				ports.add(args[x]);
+			}
+		}
+		if(ports.size() == 0) {
+			usage();
+		}
+
+		SerialComPortConfig config = new SerialComPortConfig();
+		config.setDataFormat(DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_NONE, BAUDRATE.valueOf("B" + baud), 0);
+		config.setFlowControl(FLOWCONTROL.NONE, 'x', 'x', false, false);
+
+		final SerialComManager scm = new SerialComManager();
+		final CaptureEngine engine = new CaptureEngine(dir, segmentMB * 1024 * 1024, segmentMinutes * 60 * 1000,
+				syncMs, bufferKB * 1024, compress);
+		final ArrayList<Long> handles = new ArrayList<Long>();
+
+		/* Hook is in place before first port is opened so that a partial start is also undone. */
+		final Thread shutdown = new Thread() {
+			@Override
+			public void run() {
+				engine.stop();
+				System.out.print(engine.report());
+				synchronized(handles) {
+					for(Long handle : handles) {
+						try {
+							scm.closeComPort(handle);
+						} catch (Exception e) {
+						}
+					}
+				}
+			}
+		};
+		Runtime.getRuntime().addShutdownHook(shutdown);
+
+		try {
+			for(String port : ports) {
+				long handle = scm.openComPort(port, true, false, true, config);
+				synchronized(handles) {
+					handles.add(handle);
+				}
+				engine.addPort(scm, port, handle);
+			}
+			engine.start();
+		} catch (Exception e) {
+			/* stop listeners already writing segments and close every port opened so far */
+			Runtime.getRuntime().removeShutdownHook(shutdown);
+			shutdown.run();
+			throw e;
+		}
+
+		while(true) {
+			if(reportSec > 0) {
+				Thread.sleep(reportSec * 1000);
+				System.out.print(engine.report());
+			}else {
+				Thread.sleep(Long.MAX_VALUE);
+			}
+		}
+	}
+}
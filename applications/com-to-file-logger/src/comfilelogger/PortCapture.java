@@ -0,0 +1,246 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package comfilelogger;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.lang.management.ManagementFactory;
+import java.lang.management.ThreadMXBean;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.text.SimpleDateFormat;
+import java.util.Date;
+
+import com.serialpundit.serial.ISerialComDataListener;
+
+/*
+ * Captures data of one port into segment files. Called from the looper thread of the port, appends
+ * a record (8 bytes time stamp in ms, 4 bytes length, data) into a large direct buffer which is
+ * written to the file channel only when it becomes full or when CaptureEngine syncs it. Segment is
+ * written as "<name>.part" and renamed when it is closed, so after power loss every file without
+ * .part is complete and a .part file is valid up to the last synced record.
+ */
+public final class PortCapture implements ISerialComDataListener {
+
+	public static final byte[] SEGMENT_MAGIC = "SPLOG001".getBytes();
+	public static final int RECORD_HEADER_SIZE = 12;
+
+	private static final ThreadMXBean threadBean = ManagementFactory.getThreadMXBean();
+	private static final boolean cpuTimeSupported = threadBean.isCurrentThreadCpuTimeSupported();
+
+	private final CaptureEngine engine;
+	private final String portName;
+	private final String fileBase;
+	private final long handle;
+	private final ByteBuffer buffer;
+	private final SimpleDateFormat nameFormat = new SimpleDateFormat("yyyyMMdd-HHmmss");
+
+	private FileChannel channel;
+	private File segmentFile;
+	private long segmentBytes;
+	private long segmentStart;
+	private int segmentCount;
+	private boolean closed;
+
+	/* statistics, read by reporting thread */
+	private volatile long bytesCaptured;
+	private volatile long records;
+	private volatile long cpuNanos;
+	private volatile long syncNanos;
+	private volatile long errors;
+	private volatile IOException lastError;
+	private volatile int listenerErrors;
+
+	public PortCapture(CaptureEngine engine, String portName, long handle) throws IOException {
+		this.engine = engine;
+		this.portName = portName;
+		this.handle = handle;
+		this.fileBase = new File(portName).getName();
+		buffer = ByteBuffer.allocateDirect(engine.getBufferSize());
+		openSegment(System.currentTimeMillis());
+	}
+
+	@Override
+	public void onNewSerialDataAvailable(byte[] data) {
+		long cpuStart = cpuTimeSupported ? threadBean.getCurrentThreadCpuTime() : 0;
+		long now = System.currentTimeMillis();
+
+		synchronized(this) {
+			if(closed == true) {
+				return;
+			}
+			try {
+				if(buffer.remaining() < (RECORD_HEADER_SIZE + data.length)) {
+					writeBuffer();
+				}
+				if(buffer.remaining() < (RECORD_HEADER_SIZE + data.length)) {
+					/* larger than whole buffer, goes directly to file */
+					ByteBuffer record = ByteBuffer.allocate(RECORD_HEADER_SIZE + data.length);
+					record.putLong(now).putInt(data.length).put(data);
+					record.flip();
+					write(record);
+				}else {
+					buffer.putLong(now).putInt(data.length).put(data);
+				}
+				bytesCaptured += data.length;
+				records++;
+			} catch (IOException e) {
+				errors++;
+				lastError = e;
+			}
+		}
+
+		if(cpuTimeSupported) {
+			cpuNanos += threadBean.getCurrentThreadCpuTime() - cpuStart;
+		}
+	}
+
+	@Override
+	public void onDataListenerError(int errorNum) {
+		listenerErrors = errorNum;
+	}
+
+	/* Called periodically by sync thread; moves buffered records to disk and rotates segment if it is too old. */
+	public void sync(long now) {
+		long cpuStart = cpuTimeSupported ? threadBean.getCurrentThreadCpuTime() : 0;
+		synchronized(this) {
+			if(closed == true) {
+				return;
+			}
+			try {
+				writeBuffer();
+				channel.force(false);
+				if((engine.getSegmentAge() > 0) && ((now - segmentStart) >= engine.getSegmentAge()) && (segmentBytes > SEGMENT_MAGIC.length)) {
+					rotate(now);
+				}
+			} catch (IOException e) {
+				errors++;
+				lastError = e;
+			}
+		}
+		/* sync thread does disk I/O on behalf of this port, account it separately */
+		if(cpuTimeSupported) {
+			syncNanos += threadBean.getCurrentThreadCpuTime() - cpuStart;
+		}
+	}
+
+	public synchronized void close() throws IOException {
+		if(closed == true) {
+			return;
+		}
+		closed = true;
+		writeBuffer();
+		closeSegment();
+	}
+
+	/* Closes segment opened by constructor and deletes it, used when capture could not be started. */
+	public synchronized void discard() {
+		if(closed == true) {
+			return;
+		}
+		closed = true;
+		try {
+			channel.close();
+		} catch (IOException e) {
+			// nothing was captured, file is deleted anyway
+		}
+		new File(engine.getDirectory(), segmentFile.getName() + ".part").delete();
+	}
+
+	public String getPortName() {
+		return portName;
+	}
+
+	public long getHandle() {
+		return handle;
+	}
+
+	public long getBytesCaptured() {
+		return bytesCaptured;
+	}
+
+	public long getRecords() {
+		return records;
+	}
+
+	public long getCpuNanos() {
+		return cpuNanos;
+	}
+
+	public long getSyncNanos() {
+		return syncNanos;
+	}
+
+	public long getErrors() {
+		return errors;
+	}
+
+	public IOException getLastError() {
+		return lastError;
+	}
+
+	public int getListenerError() {
+		return listenerErrors;
+	}
+
+	public synchronized int getSegmentCount() {
+		return segmentCount;
+	}
+
+	private void writeBuffer() throws IOException {
+		if(buffer.position() == 0) {
+			return;
+		}
+		buffer.flip();
+		write(buffer);
+		buffer.clear();
+	}
+
+	private void write(ByteBuffer data) throws IOException {
+		while(data.hasRemaining()) {
+			segmentBytes += channel.write(data);
+		}
+		if(segmentBytes >= engine.getSegmentSize()) {
+			rotate(System.currentTimeMillis());
+		}
+	}
+
+	private void rotate(long now) throws IOException {
+		closeSegment();
+		openSegment(now);
+	}
+
+	private void openSegment(long now) throws IOException {
+		String name = fileBase + "-" + nameFormat.format(new Date(now)) + "-" + segmentCount + ".splog";
+		segmentFile = new File(engine.getDirectory(), name);
+		RandomAccessFile raf = new RandomAccessFile(new File(engine.getDirectory(), name + ".part"), "rw");
+		raf.setLength(0);
+		channel = raf.getChannel();
+		segmentBytes = 0;
+		segmentStart = now;
+		segmentCount++;
+		write(ByteBuffer.wrap(SEGMENT_MAGIC));
+	}
+
+	private void closeSegment() throws IOException {
+		channel.force(true);
+		channel.close();
+		File part = new File(engine.getDirectory(), segmentFile.getName() + ".part");
+		if(part.renameTo(segmentFile) == false) {
+			throw new IOException("Could not rename " + part + " to " + segmentFile);
+		}
+		engine.segmentClosed(segmentFile);
+	}
+}
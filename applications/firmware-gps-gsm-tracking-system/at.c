@@ -0,0 +1,193 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+#include "hal.h"
+#include "ring.h"
+#include "at.h"
+
+#define CR     0X0D
+#define CTRLZ  0X1A
+#define ESC    0X1B
+
+/* engine states */
+#define AT_ST_READY     0    // next queued command can be sent
+#define AT_ST_WAIT      1    // command sent, waiting for result
+#define AT_ST_BACKOFF   2    // command failed, waiting before it is sent again
+
+static at_cmd_t queue[AT_QUEUE_LEN];
+static unsigned char q_head;
+static unsigned char q_count;
+static unsigned char state;
+static unsigned char tries;
+static unsigned long sent_at;
+static unsigned long last_now;
+static unsigned char line_buf[AT_LINE_LEN];
+static line_t line;
+static at_line_cb_t line_cb;
+static at_done_cb_t done_cb;
+
+void at_init(at_line_cb_t on_line, at_done_cb_t on_done) {
+	line_cb = on_line;
+	done_cb = on_done;
+	line_init(&line, line_buf, sizeof(line_buf));
+	at_flush();
+}
+
+/* Add command at end of queue. Returns 1 on success, 0 if queue is full. */
+unsigned char at_queue(unsigned char id, const rom unsigned char *text, unsigned char *arg, 
+		unsigned char flags, unsigned int timeout, unsigned char retries) {
+	at_cmd_t *cmd;
+	if(q_count == AT_QUEUE_LEN)
+		return 0;
+	cmd = &queue[(q_head + q_count) % AT_QUEUE_LEN];
+	cmd->id = id;
+	cmd->text = text;
+	cmd->arg = arg;
+	cmd->flags = flags;
+	cmd->timeout = timeout;
+	cmd->retries = retries;
+	q_count++;
+	return 1;
+}
+
+/* Drop all queued commands. Result of a command already sent is ignored. */
+void at_flush(void) {
+	q_head = 0;
+	q_count = 0;
+	tries = 0;
+	state = AT_ST_READY;
+}
+
+/* 1 if nothing is queued or outstanding; multiplexer may then be switched away from modem. */
+unsigned char at_idle(void) {
+	return (q_count == 0) ? 1 : 0;
+}
+
+static void send(at_cmd_t *cmd) {
+	const rom unsigned char *t;
+	unsigned char *a;
+
+	t = cmd->text;
+	if(t != 0) {
+		while(*t != 0) {
+			HAL_UART_PUTC(*t);
+			t++;
+		}
+	}
+	a = cmd->arg;
+	if(a != 0) {
+		if(cmd->flags & AT_F_QUOTE)
+			HAL_UART_PUTC('"');
+		while(*a != 0) {
+			HAL_UART_PUTC(*a);
+			a++;
+		}
+		if(cmd->flags & AT_F_QUOTE)
+			HAL_UART_PUTC('"');
+	}
+	if(cmd->flags & AT_F_CTRLZ)
+		HAL_UART_PUTC(CTRLZ);
+	else
+		HAL_UART_PUTC(CR);
+}
+
+/* Finish command at head of queue; send it again if retries are left. */
+static void complete(unsigned char result) {
+	at_cmd_t *cmd;
+	unsigned char id;
+
+	cmd = &queue[q_head];
+	if(result != AT_OK && tries < cmd->retries) {
+		tries++;
+		sent_at = last_now;
+		state = AT_ST_BACKOFF;
+		return;
+	}
+
+	id = cmd->id;
+	q_head = (q_head + 1) % AT_QUEUE_LEN;
+	q_count--;
+	tries = 0;
+	state = AT_ST_READY;
+	if(done_cb != 0)
+		done_cb(id, result);
+}
+
+static unsigned char is_final_error(unsigned char *l) {
+	if(l[0]=='E' && l[1]=='R' && l[2]=='R' && l[3]=='O' && l[4]=='R' && l[5]==0)
+		return 1;
+	/* +CMS ERROR: n and +CME ERROR: n */
+	if(l[0]=='+' && l[1]=='C' && l[2]=='M' && (l[3]=='S' || l[3]=='E') && l[4]==' ' 
+			&& l[5]=='E' && l[6]=='R' && l[7]=='R')
+		return 1;
+	return 0;
+}
+
+/* Feed one byte received from modem. */
+void at_rx(unsigned char c) {
+	unsigned char *l;
+
+	/* '>' prompt is not followed by line end */
+	if(c == '>' && state == AT_ST_WAIT && (queue[q_head].flags & AT_F_PROMPT) 
+			&& (line.len == 0 || line.done == 1)) {
+		complete(AT_OK);
+		return;
+	}
+
+	if(line_put(&line, c) == 0)
+		return;
+
+	l = line.buf;
+	if(state == AT_ST_WAIT) {
+		if(l[0]=='O' && l[1]=='K' && l[2]==0) {
+			complete(AT_OK);
+			return;
+		}
+		if(is_final_error(l) == 1) {
+			complete(AT_ERROR);
+			return;
+		}
+	}
+	if(line_cb != 0)
+		line_cb(l);
+}
+
+/* Send next command when previous one is done and check for time out. */
+void at_poll(unsigned long now) {
+	at_cmd_t *cmd;
+
+	last_now = now;
+	if(q_count == 0)
+		return;
+	cmd = &queue[q_head];
+
+	if(state == AT_ST_BACKOFF) {
+		if((now - sent_at) < AT_RETRY_DELAY)
+			return;
+		state = AT_ST_READY;
+	}
+
+	if(state == AT_ST_READY) {
+		send(cmd);
+		sent_at = now;
+		state = AT_ST_WAIT;
+		return;
+	}
+
+	if((now - sent_at) >= cmd->timeout) {
+		/* modem may still be waiting for SMS text, ESC cancels it */
+		if(cmd->flags & (AT_F_PROMPT | AT_F_CTRLZ))
+			HAL_UART_PUTC(ESC);
+		complete(AT_TIMEOUT);
+	}
+}
@@ -0,0 +1,61 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * Non-blocking AT command engine. Commands are queued and sent one after other; each one is 
+ * finished as soon as modem sends final result (OK, ERROR, +CMS ERROR, +CME ERROR) or the '>' 
+ * prompt, instead of after a fixed delay. Failed or timed out command is sent again up to given 
+ * number of retries. Lines which are not final results (intermediate responses and unsolicited 
+ * result codes like +CMTI) are passed to application.
+ * 
+ * Main loop passes every byte received from modem to at_rx() and calls at_poll() regularly.
+ */
+
+#ifndef AT_H_
+#define AT_H_
+
+#define AT_QUEUE_LEN    8
+#define AT_LINE_LEN     96
+#define AT_RETRY_DELAY  250UL
+
+/* flags */
+#define AT_F_PROMPT     0x01    // command is complete when modem sends '>' prompt
+#define AT_F_QUOTE      0x02    // send argument enclosed in double quotes
+#define AT_F_CTRLZ      0x04    // terminate with CTRL-Z instead of CR (SMS text)
+
+/* results */
+#define AT_OK           0
+#define AT_ERROR        1
+#define AT_TIMEOUT      2
+
+typedef void (*at_line_cb_t)(unsigned char *line);
+typedef void (*at_done_cb_t)(unsigned char id, unsigned char result);
+
+typedef struct {
+	const rom unsigned char *text;   // command, may be 0 if only argument is sent
+	unsigned char *arg;              // appended to text, may be 0
+	unsigned char flags;
+	unsigned char retries;
+	unsigned int timeout;            // milliseconds
+	unsigned char id;                // given back to application in done callback
+} at_cmd_t;
+
+void at_init(at_line_cb_t on_line, at_done_cb_t on_done);
+unsigned char at_queue(unsigned char id, const rom unsigned char *text, unsigned char *arg, 
+		unsigned char flags, unsigned int timeout, unsigned char retries);
+void at_flush(void);
+unsigned char at_idle(void);
+void at_rx(unsigned char c);
+void at_poll(unsigned long now);
+
+#endif /* AT_H_ */
@@ -16,12 +16,21 @@
  * 2. GSM modem    --> BENQ MOD 9001 GSM/GPRS MODEM
  * 3. GPS receiver --> ALTINA SIRF III G-mouse GGM 309 GPS receiver
  *
- * Data at UART is received using interrupts. When communicating with GPS receiver, we use ISR to 
- * save data bytes in array. When a required number of bytes (747) have been received we disable 
- * the generation of UART RX interrupt.
+ * Data at UART is received using interrupts. The ISR puts every byte in a ring buffer of its 
+ * source (GPS receiver or GSM modem) and posts an event; GSM, GPS and LED tasks are run by the 
+ * scheduler (sched.c) for their events or period and CPU idles in between. Commands are sent to 
+ * modem through AT engine (at.c) which moves to next command as soon as modem answers, so no 
+ * task ever waits for a fixed time.
+ * Registers are accessed through hal.h so that this file can also be built on Linux host (see 
+ * host/Makefile).
  */
-#include <p18f4550.h>   
+#include "hal.h"
+#include "ring.h"
+#include "nmea.h"
+#include "at.h"
+#include "sched.h"
 
+#ifndef HOST_BUILD
 /* Turn off features not needed to save power */
 #pragma config WDT=OFF, FOSC=ECPLLIO_EC, PLLDIV=1, CPUDIV=OSC1_PLL2
 #pragma config MCLRE=ON, CCP2MX=OFF,VREGEN=OFF, IESO=ON,DEBUG=OFF 
@@ -29,6 +38,7 @@
 #pragma config STVREN=ON, XINST=OFF,EBTR0=OFF,EBTR1=OFF,EBTR2=OFF,EBTR3=OFF
 #pragma config CP0=OFF, CP1=OFF, CP2=OFF, CP3=OFF, CPB=OFF, CPD=OFF,EBTRB=OFF
 #pragma config WRT0=OFF, WRT1=OFF, WRT2=OFF,WRT3=OFF, WRTB=OFF, WRTC=OFF, WRTD=OFF
+#endif
 
 #define  CR         0X0D
 #define  LF         0X0A   
@@ -45,58 +55,137 @@
 #define  LED_ON     0x01
 #define  LED_OFF    0x00
 
-unsigned int k, loc;
-volatile unsigned int x;
-signed char a;
-unsigned char msg_index, success, gsm;
-
-/* Command to be sent to the GSM modem */
-const rom unsigned char at_cmd_1[] = "ATE0\r";
-const rom unsigned char at_cmd_2[] = "AT\r";
-const rom unsigned char at_cmd_3[] = "AT+CMGF=1\r"; 
-const rom unsigned char at_cmd_4[] = "AT+CSMP=17,168,0,0\r";
-const rom unsigned char at_cmd_5[] = "AT+CPMS=";
-const rom unsigned char at_cmd_6[] = "AT+CNMI=1,1,0,0,1\r";
-const rom unsigned char at_cmd_7[] = "AT+CMGD=1,4\r";
+/* Ring sizes must be power of 2 (see ring.h) */
+#define  GSM_RING_SIZE  128
+#define  GPS_RING_SIZE  64
+
+/* Timer0 in 16 bit mode without prescaler counts at Fosc/4 = 12 MHz; 12000 counts = 1 ms */
+#define  TMR0_RELOAD_H  0xD1
+#define  TMR0_RELOAD_L  0x20
+
+/* Location request is answered from cached fix if it is younger than this, otherwise GPS 
+ * receiver is connected for at most GPS_WAIT_MS to get a new one. */
+#define  FIX_MAX_AGE    30000UL
+#define  GPS_WAIT_MS    10000UL
+
+/* Let modem finish its own power on before first command */
+#define  START_UP_MS    2000UL
+
+/* AT command ids, tell which command has completed */
+#define  ID_ECHO_OFF     1
+#define  ID_PING         2
+#define  ID_TEXT_MODE    3
+#define  ID_SMS_PARAM    4
+#define  ID_STORAGE      5
+#define  ID_NEW_MSG_IND  6
+#define  ID_LIST_MSG     7
+#define  ID_READ_MSG     8
+#define  ID_SEND_CMD     9
+#define  ID_SEND_TEXT    10
+#define  ID_DELETE_MSG   11
+
+/* Application states */
+#define  APP_MODEM_INIT  0
+#define  APP_RECOVER     1
+#define  APP_IDLE        2
+#define  APP_READ_MSG    3
+#define  APP_GPS         4
+#define  APP_SEND        5
+#define  APP_START       6
+#define  APP_DELETE      7
+
+/* Received SMS are served in batches; every +CMTI adds a request, all of them are read, one GPS 
+ * fix is taken for whole batch, replies are sent back-to-back and then served messages are 
+ * deleted one by one. Messages which arrive meanwhile are never deleted without being served. */
+#define  REQ_MAX         6
+#define  NO_REQ          0xFF
+#define  REQ_FREE        0
+#define  REQ_NEW         1       // +CMTI seen, message not read yet
+#define  REQ_LOC         2       // LOC? from a known number, reply pending
+#define  REQ_DONE        3       // served (or not a location request), to be deleted
+#define  SEND_TRIES      3       // whole CMGS + text sequence attempts before reply is given up
+
+typedef struct {
+	unsigned char state;
+	unsigned char tries;         // reply attempts made so far
+	unsigned char index[4];      // SIM index of SMS (decimal text)
+	unsigned char mob_no[20];    // sender number as given by modem, for ex; +919876543210
+} req_t;
+
+volatile unsigned long ticks;    // milliseconds since power on
+unsigned char gsm, app_state;
+unsigned char cur_req;           // request being read, replied or deleted
+unsigned char text_req;          // request whose text line comes next from modem, NO_REQ if none
+unsigned char req_missed;        // a +CMTI could not be queued or read; list SIM to recover it
+unsigned char fix_ready;         // msg_buf has location for current batch
+unsigned long gps_started;
+
+/* Command to be sent to the GSM modem (AT engine appends CR) */
+const rom unsigned char at_cmd_1[] = "ATE0";
+const rom unsigned char at_cmd_2[] = "AT";
+const rom unsigned char at_cmd_3[] = "AT+CMGF=1"; 
+const rom unsigned char at_cmd_4[] = "AT+CSMP=17,168,0,0";
+const rom unsigned char at_cmd_5[] = "AT+CPMS=\"SM\",\"SM\",\"SM\"";
+const rom unsigned char at_cmd_6[] = "AT+CNMI=1,1,0,0,1";
+const rom unsigned char at_cmd_7[] = "AT+CMGL=\"ALL\"";
 const rom unsigned char at_cmd_8[] = "AT+CMGR=";
 const rom unsigned char at_cmd_9[] = "AT+CMGS=";
+const rom unsigned char at_cmd_10[] = "AT+CMGD=";
 
 /* Buffers to hold data to be processed */
-unsigned char gsm_buf[150];
-unsigned char mob_no_buf[12];
-unsigned char gps_buf[750];
+req_t reqs[REQ_MAX];
 unsigned char msg_buf[45]; 
 
+/* Receive rings filled by ISR, one per source so that switching multiplexer never mixes data */
+unsigned char gsm_ring_buf[GSM_RING_SIZE];
+unsigned char gps_ring_buf[GPS_RING_SIZE];
+ring_t gsm_ring;
+ring_t gps_ring;
+nmea_t gps;
+
+void gsm_task(unsigned long);
+void gps_task(unsigned long);
+void led_task(unsigned long);
+
+/* Tasks and what wakes them; GSM and GPS tasks also run periodically for time outs */
+task_t tasks[3] = {
+	{ gsm_task, EV_GSM_RX, 50,  0, 0 },
+	{ gps_task, EV_GPS_RX, 100, 0, 0 },
+	{ led_task, 0,         500, 0, 0 },
+};
+
 /* Function prototypes */
-void start_up_delay(void);
 void safe_op(void);
 void gsm_uart_init(void);
 void high_isr(void); 
+void timer0_init(void);
+unsigned long clock_ms(void);
 void gpio_port(void); 
 void modem_init(void);
-void tx_char(unsigned char);
-void cmd_1(void);
-void cmd_2(void);
-void cmd_3(void);
-void cmd_4(void);
-void cmd_5(void);
-void cmd_6(void);
-void long_delay(void);
-void clr_buf(void);
-void clean_sim(void);
-void wait_4_msg(void);  
-void get_index(void);
+void modem_line(unsigned char *);
+void modem_done(unsigned char, unsigned char);
+void recover_msgs(void);
+void serve_requests(void);
+unsigned char req_add(unsigned char *);
+unsigned char req_find(unsigned char);
+unsigned char req_find_index(unsigned char *);
+void get_index(unsigned char *, unsigned char *);
 void read_msg(void);
-void check_msg(void);
-void get_mob_no(void);
+unsigned char is_loc_msg(unsigned char *);
+void get_mob_no(unsigned char *, unsigned char *);
 void send_msg_cmd(void);
+void delete_msg(void);
 void gps_handler(void);
+void gps_step(unsigned long);
 void gps_uart_init(void);
-void save_nmea_data(void);
-unsigned int search_gpgga(unsigned int);
-unsigned int ext_req_field(unsigned int);
-void send_loc(void); 
-
+unsigned char gps_poll(void);
+void build_loc_msg(void);
+void get_fix(void);
+void leds_off(void);
+void app_init(void);
+void app_loop(void);
+
+#ifndef HOST_BUILD
 /* Install/Define critical interrupt handler */
 #pragma code high_vector = 0x08
 void interrupt_at_high_vector(void) {
@@ -105,43 +194,56 @@ void interrupt_at_high_vector(void) {
 	_endasm
 }
 #pragma code
+#pragma interrupt high_isr 
+#endif
 
 /* Based on with whom data should be read; GPS receiver or GSM modem, the data read is placed 
- * in appropriate buffer. Then other function process data in these buffers whenever required. */
-#pragma interrupt high_isr 
+ * in ring buffer of that source and the task of that source is woken. If the ring is full the 
+ * byte is dropped and counted, it never overwrites memory. Overrun error stops EUSART receiver, 
+ * so it is restarted here. Timer0 overflow advances millisecond clock. */
 void high_isr(void) {
-	if(gsm == ON) {
-		INTCONbits.GIEH = 0;
-		gsm_buf[x] = RCREG;              
-		x++;             
-		PIR1bits.RCIF = 0;
-		INTCONbits.GIEH = 1;          
-	}else {
-		INTCONbits.GIEH = 0;
-		gps_buf[x] = RCREG;              
-		x++;             
-		PIR1bits.RCIF = 0;
-		INTCONbits.GIEH = 1;          
-	} 
+	unsigned char c;
+	if(INTCONbits.TMR0IF == 1) {
+		TMR0H = TMR0_RELOAD_H;   // high byte is latched and written with low byte
+		TMR0L = TMR0_RELOAD_L;
+		INTCONbits.TMR0IF = 0;
+		ticks++;
+		SCHED_POST_ISR(EV_TICK);
+	}
+	if(PIR1bits.RCIF == 1) {
+		if(RCSTAbits.OERR == 1) {
+			RCSTAbits.CREN = 0;
+			RCSTAbits.CREN = 1;
+		}
+		c = HAL_UART_GETC();
+		if(gsm == ON) {
+			RING_PUT_ISR(gsm_ring, c);
+			SCHED_POST_ISR(EV_GSM_RX);
+		}else {
+			RING_PUT_ISR(gps_ring, c);
+			SCHED_POST_ISR(EV_GPS_RX);
+		}
+	}
 }
 
-/* When the system is powered on, let it settle. */
-void start_up_delay(void) {
-	unsigned int count_s;
-	count_s = 0;
-	while(count_s != 305) {       
-		for(k=65000; k>5; k--);   
-		count_s++;
-	}  
+/* Millisecond clock used for AT command time outs and to age cached GPS fix */
+void timer0_init(void) {
+	T0CON = 0B00001000;       // 16 bit, internal clock, no prescaler, stopped
+	TMR0H = TMR0_RELOAD_H;
+	TMR0L = TMR0_RELOAD_L;
+	INTCON2bits.TMR0IP = 1;   // high priority
+	INTCONbits.TMR0IF = 0;
+	INTCONbits.TMR0IE = 1;
+	T0CONbits.TMR0ON = 1;
 }
 
-void long_delay(void) {
-	unsigned char count_a;
-	count_a = 0;
-	while(count_a != 25) {       
-		for(k=65000; k>5; k--);   
-		count_a++;
-	}  
+/* 32 bit counter is updated by ISR so read it with interrupts disabled */
+unsigned long clock_ms(void) {
+	unsigned long t;
+	HAL_IRQ_OFF();
+	t = ticks;
+	HAL_IRQ_ON();
+	return t;
 }
 
 /* Set appropriate bits for proper operation */
@@ -218,445 +320,463 @@ void gpio_port(void) {
 	PORTCbits.RC2 = BIT_CLR ;            
 }
 
-/* Prepare the GSM Modem for english character based SMS send/recieve from SIM */
+/* Prepare the GSM Modem for english character based SMS send/recieve from SIM. Commands are 
+ * queued; each one is sent as soon as previous one is answered. If any of them fails even after 
+ * retries, whole sequence is started again. */
 void modem_init(void) {
-	cmd_1();
-	if(gsm_buf[7]=='O' && gsm_buf[8]=='K')
-		success = 1; 
-	else
-		success = 0; 
-	if (success == 1)
-	{;}
-	else
-		modem_init();
-
-	cmd_2(); 
-	if(gsm_buf[2]=='O' && gsm_buf[3]=='K')
-		success = 1; 
-	else
-		success = 0; 
-	if (success == 1)
-	{;}
-	else
-		modem_init();
-
-	cmd_3();
-	if(gsm_buf[2]=='O' && gsm_buf[3]=='K')
-		success = 1; 
-	else
-		success = 0; 
-	if (success == 1)
-	{;}
-	else
-		modem_init();
-
-	cmd_4();
-	if(gsm_buf[2]=='O' && gsm_buf[3]=='K')
-		success = 1; 
-	else
-		success = 0; 
-	if (success == 1)
-	{;}
-	else
-		modem_init();
+	at_flush();
+	at_queue(ID_ECHO_OFF, at_cmd_1, 0, 0, 1000, 3);         // Turn Echo off
+	at_queue(ID_PING, at_cmd_2, 0, 0, 1000, 3);             // Just ping modem
+	at_queue(ID_TEXT_MODE, at_cmd_3, 0, 0, 1000, 3);        // Put in SMS text mode
+	at_queue(ID_SMS_PARAM, at_cmd_4, 0, 0, 1000, 3);        // English character SMS
+	at_queue(ID_STORAGE, at_cmd_5, 0, 0, 5000, 3);          // SIM storage for every purpose
+	at_queue(ID_NEW_MSG_IND, at_cmd_6, 0, 0, 1000, 3);      // New message indication (+CMTI)
+	app_state = APP_MODEM_INIT;
+}
 
-	cmd_5();
-	if(gsm_buf[6]=='S' && gsm_buf[7]==':')
-		success = 1; 
-	else
-		success = 0; 
-	if (success == 1)
-	{;}
-	else
-		modem_init();
+/* List every SMS on SIM. Requests whose +CMTI was lost (multiplexer was on GPS, queue was full) 
+ * or which arrived before power on are picked up from this list. */
+void recover_msgs(void) {
+	req_missed = 0;
+	text_req = NO_REQ;
+	at_queue(ID_LIST_MSG, at_cmd_7, 0, 0, 10000, 1);
+	app_state = APP_RECOVER;
+}
 
-	cmd_6(); 
-	if(gsm_buf[2]=='O' && gsm_buf[3]=='K')
-		success = 1; 
-	else
-		success = 0; 
-	if (success == 1)
-	{;}
-	else
-		modem_init();        
-}
-
-/* Turn Echo off ("ATE0\r") */
-void cmd_1(void) { 
-	x = 0;
-	while(x != 0) 
-		x=0;
-	for(a=0; a<5; a++)             
-		tx_char(at_cmd_1[a]);                            
-	long_delay();   
-}
-
-/* Just ping modem for basic AT command ("AT\r") */
-void cmd_2(void) { 
-	x = 0;
-	while (x != 0) 
-		x=0;
-	for(a=0; a<3; a++)             
-		tx_char(at_cmd_2[a]);                       
-	long_delay();            
-}
-
-/* Put in SMS text mode ("AT+CMGF=1\r") */
-void cmd_3(void) { 
-	x = 0;
-	while( x!= 0) 
-		x=0;
-	for(a=0; a<10; a++)             
-		tx_char(at_cmd_3[a]);                         
-	long_delay();            
-}
-
-/* Configure to send English character SMS and some more parameters 
- * ("AT+CSMP=17,168,0,0\r") */
-void cmd_4(void) {
-	x = 0;
-	while(x!= 0) 
-		x=0;  
-	for(a=0; a<19; a++)             
-		tx_char(at_cmd_4[a]);                          
-	long_delay();                           
-}
-
-/* Set SMS message storage area as SIM for every purpose ("AT+CPMS=") */
-void cmd_5(void) { 
-	x = 0;
-	while(x != 0) 
-		x=0;
-	for(a=0; a<8; a++)             
-		tx_char(at_cmd_5[a]);              
-	tx_char('"');
-	tx_char('S');
-	tx_char('M');
-	tx_char('"');
-	tx_char(',');
-	tx_char('"');
-	tx_char('S'); 
-	tx_char('M');
-	tx_char('"');
-	tx_char(',');
-	tx_char('"'); 
-	tx_char('S');
-	tx_char('M');
-	tx_char('"'); 
-	tx_char(CR);              
-	long_delay();                                                    
-}
-
-/* Set the new message indicators ("AT+CNMI=1,1,0,0,1\r") */
-void cmd_6(void) { 
-	x = 0;
-	while(x != 0) 
-		x=0;
-	for(a=0; a<18; a++)             
-		tx_char(at_cmd_6[a]);                
-	long_delay();                                          
-}
-
-/* Transmits a single character out of UART port */
-void tx_char(unsigned char temp) {
-	TXREG = temp; 
-	while(PIR1bits.TXIF != 1);
-	for(k=4000; k>5; k--);
-	PIR1bits.TXIF=0;          
-}
-
-/* Clear the buffer */
-void clr_buf(void) {
-	for(a=149; a>0; a--)
-		gsm_buf[a] = CLR;
-}
-
-/* Delete all SMS from SIM */
-void clean_sim(void) {
-	x = 0;
-	while(x!= 0) 
-		x=0;
-	for(a=0; a<12; a++)             
-		tx_char(at_cmd_7[a]);                
-	long_delay();  
-	long_delay();
-	cmd_2();                  
-	if(gsm_buf[13]=='3' && gsm_buf[13]=='1' && gsm_buf[13]=='4' )                            
-		long_delay();                                                       
-}
-
-/* Wait until a SMS arrives */
-void wait_4_msg(void) {
-	unsigned char dummy;
-	x = 0;
-	while(x != 0) 
-		x=0;
-	dummy = RCREG;
-	PIR1bits.RCIF = 0;
-	while(PIR1bits.RCIF != 1);
-	long_delay();                 
-}
-
-/* Get the index of SMS received */
-void get_index(void) {
-	x = 0;
-	while(x!= 0) 
-		x=0;
-	while(gsm_buf[x] != 'S')             
-		x++;             
-	msg_index = gsm_buf[x+4];           
-}
-
-/* Once a SMS message has arrived and its index has been found, read it from 
- * SIM to local buffer ("AT+CMGR="). */
+/* Once a SMS message has arrived and its index is known, read it from SIM. Header and text 
+ * lines of response are handled in modem_line(). */
 void read_msg(void) { 
-	x = 0;
-	while( x!= 0) 
-		x=0;
-	for(a=0;a<8;a++)             
-		tx_char(at_cmd_8[a]);                    
-	tx_char(msg_index);        
-	tx_char(CR);               
-	long_delay();          
-	long_delay();
-	long_delay(); 
+	PORTAbits.RA6 = LED_ON;
+	reqs[cur_req].mob_no[0] = NULL;
+	text_req = NO_REQ;
+	at_queue(ID_READ_MSG, at_cmd_8, reqs[cur_req].index, 0, 5000, 2);
+	app_state = APP_READ_MSG;
 }
 
-/* Once a SMS message is received, validate it to contain LOC? string to authenticate sender */
-void check_msg(void) {
-	signed char b;
-	unsigned char count_c;
-	b = 0;
-	count_c = 0;     
-	while(count_c != 8) {       
-		if(gsm_buf[b] == '"') {
-			count_c++;
-			b++;
-		}else{
-			b++;
-		}
-	}
-	while(gsm_buf[b]!= LF)          
-		b++;          
-	if(gsm_buf[b+1]=='L' && gsm_buf[b+2]=='O' && gsm_buf[b+3]=='C' && gsm_buf[b+4]=='?')
-		success = 1;          
-	else          
-		success = 0;                     
-}
-
-/* Extract mobile number of device who wish to receive location info */
-void get_mob_no(void) {
-	unsigned char temp;                
-	temp = 25; // buf[28]=3                                   
-	a = 0;                                            
-	while(a != 10) {                      
-		mob_no_buf[a] = gsm_buf[temp];
-		a++;
-		temp++;
-	}                     
-}
-
-/* Instruct GSM modem that we need to send an SMS */
+/* Instruct GSM modem that we need to send an SMS and give text once it prompts for it */
 void send_msg_cmd(void) {
-	for(a=0; a<8; a++)             
-		tx_char(at_cmd_9[a]);                   
-	tx_char('"');
-	tx_char('+');
-	tx_char('9');
-	tx_char('1'); 
-	for(a=0; a<10; a++)             
-		tx_char(mob_no_buf[a]);                    
-	tx_char('"');
-	tx_char(CR);
-	long_delay();               
-} 
-
-/* Configure the UART for communication with GPS receiver, toggle the multiplxer GPIO,
- * save data from GPS receiver, search for GPGGA string and extract latitude, longitude 
- * and altitude from this string. */
-void gps_handler(void) {                    
-	gps_uart_init();        
-	PORTBbits.RB0 = 0;           // A/B // gps gets connected to UART port.    
-	save_nmea_data();                            
-	loc = search_gpgga(0);  
-	ext_req_field(loc);             
+	at_queue(ID_SEND_CMD, at_cmd_9, reqs[cur_req].mob_no, AT_F_QUOTE | AT_F_PROMPT, 5000, 1);
+	at_queue(ID_SEND_TEXT, 0, msg_buf, AT_F_CTRLZ, 30000, 0);
+	app_state = APP_SEND;
 }
 
-/* Keep clearing interrupt bit until handful of data characters have been received 
- * from GPS receiver that can be parsed to look for GPGGA string */
-void save_nmea_data(void) {      
-	x = 0;
-	while(x!= 0) 
-		x=0;
-	while(x != 747);
-	INTCONbits.GIEH = 0;        
+/* Delete only the served message, others may have arrived meanwhile */
+void delete_msg(void) {
+	at_queue(ID_DELETE_MSG, at_cmd_10, reqs[cur_req].index, 0, 5000, 1);
+	app_state = APP_DELETE;
 }
 
-/* From the data received try to figure out starting position of GPGGA string */
-unsigned int search_gpgga(unsigned int y) {
+/* Pick next thing to do for queued requests: read new ones, get location once, reply, delete. 
+ * Called whenever previous step has completed. */
+void serve_requests(void) {
+	cur_req = req_find(REQ_NEW);
+	if(cur_req != NO_REQ) {
+		read_msg();
+		return;
+	}
+	cur_req = req_find(REQ_LOC);
+	if(cur_req != NO_REQ) {
+		PORTCbits.RC0 = LED_ON; 
+		if(fix_ready == 0)
+			get_fix();
+		else
+			send_msg_cmd();
+		return;
+	}
+	cur_req = req_find(REQ_DONE);
+	if(cur_req != NO_REQ) {
+		delete_msg();
+		return;
+	}
+	if(req_missed == 1) {
+		recover_msgs();
+		return;
+	}
+	fix_ready = 0;
+	leds_off();
+	app_state = APP_IDLE;         // led_task blinks RA0 while waiting for SMS
+}
 
-	/* The y has starting address from where it should start searching '$' character */
-	while(gps_buf[y] != '$') {
-		y++;
+/* Queue request for given SIM index; modem may report same index again, it is queued once. */
+unsigned char req_add(unsigned char *index) {
+	unsigned char n, i;
+	n = req_find_index(index);
+	if(n != NO_REQ)
+		return n;
+	n = req_find(REQ_FREE);
+	if(n == NO_REQ) {
+		req_missed = 1;
+		return NO_REQ;
 	}
+	for(i=0; i<sizeof(reqs[n].index); i++)
+		reqs[n].index[i] = index[i];
+	reqs[n].mob_no[0] = NULL;
+	reqs[n].tries = 0;
+	reqs[n].state = REQ_NEW;
+	return n;
+}
 
-	/* check for gpgga string */
-	if(gps_buf[y+1]=='G' && gps_buf[y+2]=='P' && gps_buf[y+3]=='G'
-			&& gps_buf[y+4]=='G' && gps_buf[y+5]=='A') {
-		return(y+5); // return address of 'A'
-	}else {
-		search_gpgga(y+10); // start search from new location in buffer
+unsigned char req_find(unsigned char state) {
+	unsigned char n;
+	for(n=0; n<REQ_MAX; n++) {
+		if(reqs[n].state == state)
+			return n;
 	}
+	return NO_REQ;
 }
 
-/* Send location info to given mobile number using SMS */
-void send_loc(void) {
-	unsigned char c;
-	c = 0;
-	/* We have appended null character already at the end so send data 
-	 * until it is found */
-	while(msg_buf[c] != NULL) {
-		tx_char(msg_buf[c]);
-		c++;                                      
+unsigned char req_find_index(unsigned char *index) {
+	unsigned char n, i;
+	for(n=0; n<REQ_MAX; n++) {
+		if(reqs[n].state == REQ_FREE)
+			continue;
+		for(i=0; reqs[n].index[i] == index[i] && index[i] != NULL; i++);
+		if(reqs[n].index[i] == index[i])
+			return n;
 	}
+	return NO_REQ;
+}
 
-	tx_char(CTRLZ); 
-	long_delay();    
+static unsigned char starts_with(unsigned char *line, const rom char *prefix) {
+	while(*prefix != 0) {
+		if(*line != *prefix)
+			return 0;
+		line++;
+		prefix++;
+	}
+	return 1;
 }
 
-/* Parse the data received from GPS receiver and extract required fields */
-unsigned int ext_req_field(unsigned int p) { 
-	unsigned char comma_count;  // variable to hold count of commas.
-	unsigned char z;
+/* Copy decimal SMS index starting at given position, leading spaces are skipped */
+void get_index(unsigned char *src, unsigned char *index) {
+	unsigned char i;
+	while(*src == SPACE)
+		src++;
+	i = 0;
+	while(*src >= '0' && *src <= '9' && i < 3) {
+		index[i] = *src;
+		i++;
+		src++;
+	}
+	index[i] = NULL;
+}
 
-	// cross check returned value also.
-	if( gps_buf[p] == 'A')  {
-		p=p+2;
-		while(gps_buf[p] != COMMA){
-			p++;                           
+/* Extract mobile number of device who wish to receive location info; it is second quoted 
+ * field of +CMGR: "REC UNREAD","+919876543210",,"20/05/09,10:15:02+22" and of 
+ * +CMGL: 3,"REC UNREAD","+919876543210",,"20/05/09,10:15:02+22" */
+void get_mob_no(unsigned char *line, unsigned char *mob_no) {
+	unsigned char i, quotes, z;
+	i = 0;
+	quotes = 0;
+	z = 0;
+	while(line[i] != NULL) {
+		if(line[i] == '"') {
+			quotes++;
+			if(quotes == 4)
+				break;
+		}else if(quotes == 3 && z < 19) {
+			mob_no[z] = line[i];
+			z++;
 		}
+		i++;
+	}
+	mob_no[z] = NULL;
+}
 
-		p++;                // p now have address of 1st digit of
-		z=0;                // latitude coordinate.
-		msg_buf[z]='L';     // append 'LA' to msg_buf to indicate
-		z++;                // that following value is latitude.
-		msg_buf[z]='A';
-		z++;
-		msg_buf[z]=SPACE;
-		z++;
-
-		/* Save latitude coordinates */
-		while(gps_buf[p] != COMMA) {
-			msg_buf[z]=gps_buf[p]; 
-			z++;
-			p++;
+/* Once a SMS message is received, validate it to contain LOC? string to authenticate sender */
+unsigned char is_loc_msg(unsigned char *line) {
+	if(line[0]=='L' && line[1]=='O' && line[2]=='C' && line[3]=='?')
+		return 1;
+	return 0;
+}
+
+/* Lines from modem which are not final result of a command */
+void modem_line(unsigned char *line) {
+	unsigned char index[4];
+	unsigned char i, n;
+
+	if(starts_with(line, "+CMTI:")) {
+		/* +CMTI: "SM",<index> */
+		n = 0;
+		for(i=0; line[i] != NULL; i++) {
+			if(line[i] == COMMA)
+				n = i + 1;
 		}
+		get_index(&line[n], index);
+		if(index[0] != NULL)
+			req_add(index);
+		return;
+	}
+	if(starts_with(line, "+CMGR:")) {
+		if(app_state == APP_READ_MSG) {
+			get_mob_no(line, reqs[cur_req].mob_no);
+			text_req = cur_req;
+		}
+		return;
+	}
+	if(starts_with(line, "+CMGL:")) {
+		/* previous message had empty text, there is nothing to serve */
+		if(text_req != NO_REQ)
+			reqs[text_req].state = REQ_DONE;
+		/* messages already read or served are listed too, take only new ones */
+		text_req = NO_REQ;
+		get_index(&line[6], index);
+		n = req_add(index);
+		if(n != NO_REQ && reqs[n].state == REQ_NEW) {
+			get_mob_no(line, reqs[n].mob_no);
+			text_req = n;
+		}
+		return;
+	}
+	if(text_req != NO_REQ) {
+		if(is_loc_msg(line) == 1 && reqs[text_req].mob_no[0] != NULL)
+			reqs[text_req].state = REQ_LOC;
+		else
+			reqs[text_req].state = REQ_DONE;
+		text_req = NO_REQ;
+	}
+}
 
-		p=p+3;               // p now have address of 1st digit of
-		msg_buf[z]=COMMA;
-		z++;
-		msg_buf[z]=CR;
-		z++;
-		msg_buf[z]=LF;
-		z++;
-		msg_buf[z]='L';      // longitude coordinate.
-		z++;
-		msg_buf[z]='O';      // append 'LO' to msg_buf to indicate
-		z++;                 // that following value is longitude.
-		msg_buf[z]=SPACE;
-		z++;
-
-		/* Save longitude coordinate */
-		while(gps_buf[p] != COMMA) {
-			msg_buf[z]=gps_buf[p];
-			z++;
-			p++;
+/* A queued command completed; move application to its next step */
+void modem_done(unsigned char id, unsigned char result) {
+	switch(app_state) {
+	case APP_MODEM_INIT:
+		if(result != AT_OK) {
+			modem_init();
+		}else if(id == ID_NEW_MSG_IND) {
+			PORTAbits.RA1 = LED_ON;
+			recover_msgs();
+		}
+		break;
+
+	case APP_RECOVER:
+		/* last listed message had empty text */
+		if(result == AT_OK && text_req != NO_REQ)
+			reqs[text_req].state = REQ_DONE;
+		text_req = NO_REQ;
+		serve_requests();
+		break;
+
+	case APP_READ_MSG:
+		if(result == AT_OK && text_req == cur_req) {
+			/* header came but no text; empty message is deleted, otherwise it is read for ever */
+			reqs[cur_req].state = REQ_DONE;
+		}else if(reqs[cur_req].state == REQ_NEW) {
+			/* not read, leave it on SIM and find it again by listing */
+			reqs[cur_req].state = REQ_FREE;
+			req_missed = 1;
+		}
+		text_req = NO_REQ;
+		serve_requests();
+		break;
+
+	case APP_SEND:
+		if(result != AT_OK) {
+			at_flush();               // do not send text if there was no prompt
+			/* request stays pending and is replied again, unless attempts are used up */
+			reqs[cur_req].tries++;
+			if(reqs[cur_req].tries >= SEND_TRIES)
+				reqs[cur_req].state = REQ_DONE;
+			serve_requests();
+		}else if(id == ID_SEND_TEXT) {
+			PORTCbits.RC2 = LED_ON;
+			reqs[cur_req].state = REQ_DONE;
+			serve_requests();
 		}
+		break;
 
-		p++;
-		comma_count = 0;
-
-		/* After this loop ends the p will contain  address of first digit of altitude coordinates */ 
-		while(comma_count != 4) {
-			if(gps_buf[p] == COMMA ) {
-				comma_count++;
-				p++;
-			}else {
-				p++;
-			}
-		} 
-		msg_buf[z]=COMMA;
-		z++;
-		msg_buf[z]=CR;
-		z++; 
-		msg_buf[z]=LF;
-		z++;          
-		msg_buf[z]='A';        // append 'AL' to msg_buf to indicate
-		z++;                   // that following value is altitude.
-		msg_buf[z]='L'; 
-		z++;
-		msg_buf[z]=SPACE;
-		z++;
-
-		/* Save altitude coordinate */
-		while(gps_buf[p] != COMMA ) {
-			msg_buf[z] = gps_buf[p];
-			z++;
-			p++;
-		} 
-		msg_buf[z]=COMMA;
-		z++; 
-		msg_buf[z]= NULL;// append null character to mark end
-
-	}else {
-		/* Something went wrong, start searching $gpgga again */
-		search_gpgga(p+10);
+	case APP_DELETE:
+		reqs[cur_req].state = REQ_FREE;
+		serve_requests();
+		break;
 	}
 }
 
-/* Entry point */
-void main(void) {
-	start_up_delay();      
+/* Location for the batch: from cached fix if it is fresh, otherwise get a new one from GPS 
+ * receiver first. */
+void get_fix(void) {
+	if(nmea_fix_age(&gps, clock_ms()) > FIX_MAX_AGE) {
+		gps_handler();
+		return;
+	}
+	PORTCbits.RC1 = LED_ON; 
+	build_loc_msg();
+	fix_ready = 1;
+	send_msg_cmd();
+}
+
+/* Configure the UART for communication with GPS receiver and toggle the multiplxer GPIO. 
+ * Sentences are then parsed in gps_step() as they arrive. */
+void gps_handler(void) {                    
+	gsm = OFF;
+	ring_flush(&gps_ring);
+	nmea_sync(&gps);
+	gps_uart_init();        
+	HAL_MUX_GPS();               // A/B // gps gets connected to UART port.    
+	gps_started = clock_ms();
+	app_state = APP_GPS;
+}
+
+/* Stay with GPS receiver until a new valid fix is received; if receiver has no fix within 
+ * GPS_WAIT_MS, last known fix (if any) is used. Then connect modem again and send replies. 
+ * Reply carries altitude which only GGA gives, so fix from RMC alone is not enough. */
+void gps_step(unsigned long now) {
+	if((gps_poll() == 0 || gps.fix.alt[0] == NULL) && (now - gps_started) < GPS_WAIT_MS)
+		return;
+	gsm = ON;
+	gsm_uart_init();  
+	ring_flush(&gsm_ring);
+	HAL_MUX_GSM();               // A/B ---> gsm modem connected  
+	PORTCbits.RC1 = LED_ON; 
+	build_loc_msg();
+	fix_ready = 1;
+	recover_msgs();              // +CMTI sent while on GPS were lost
+	at_poll(now);                // send now rather than at next run of gsm_task
+}
+
+/* Pass bytes received so far from GPS receiver to NMEA parser. Returns 1 if a new valid fix 
+ * has been received, 0 if more data is needed. Never waits for a byte. */
+unsigned char gps_poll(void) {
+	unsigned char c;
+	unsigned char updated;
+	updated = 0;
+	while(ring_get(&gps_ring, &c) == 1) {
+		if(nmea_put(&gps, c, clock_ms()) == 1)
+			updated = 1;
+	}
+	return updated;
+}
+
+static void msg_put(unsigned char *z, unsigned char c) {
+	if(*z < (sizeof(msg_buf) - 1)) {
+		msg_buf[*z] = c;
+		(*z)++;
+	}
+}
+
+static void msg_put_str(unsigned char *z, unsigned char *str) {
+	while(*str != NULL) {
+		msg_put(z, *str);
+		str++;
+	}
+}
+
+/* Prepare SMS text with latitude, longitude and altitude of last known fix, or NO FIX if GPS 
+ * receiver never reported a valid position. */
+void build_loc_msg(void) {
+	unsigned char z;
+	z = 0;
+	if(gps.valid == 0) {
+		msg_put(&z, 'N');
+		msg_put(&z, 'O');
+		msg_put(&z, SPACE);
+		msg_put(&z, 'F');
+		msg_put(&z, 'I');
+		msg_put(&z, 'X');
+		msg_buf[z] = NULL;
+		return;
+	}
+	msg_put(&z, 'L');             // append 'LA' to msg_buf to indicate
+	msg_put(&z, 'A');             // that following value is latitude.
+	msg_put(&z, SPACE);
+	msg_put_str(&z, gps.fix.lat);
+	msg_put(&z, COMMA);
+	msg_put(&z, CR);
+	msg_put(&z, LF);
+	msg_put(&z, 'L');             // longitude
+	msg_put(&z, 'O');
+	msg_put(&z, SPACE);
+	msg_put_str(&z, gps.fix.lon);
+	msg_put(&z, COMMA);
+	msg_put(&z, CR);
+	msg_put(&z, LF);
+	msg_put(&z, 'A');             // altitude
+	msg_put(&z, 'L');
+	msg_put(&z, SPACE);
+	msg_put_str(&z, gps.fix.alt);
+	msg_put(&z, COMMA);
+	msg_buf[z] = NULL;            // append null character to mark end
+}
+
+void leds_off(void) {
+	PORTAbits.RA0 = LED_OFF;
+	PORTAbits.RA6 = LED_OFF;
+	PORTCbits.RC0 = LED_OFF;
+	PORTCbits.RC1 = LED_OFF;
+	PORTCbits.RC2 = LED_OFF;  
+}
+
+void app_init(void) {
+	unsigned char c;
+
+	ring_init(&gsm_ring, gsm_ring_buf, GSM_RING_SIZE);
+	ring_init(&gps_ring, gps_ring_buf, GPS_RING_SIZE);
+	nmea_init(&gps);
 	safe_op();
+	timer0_init();
 	gsm_uart_init();    
 	gpio_port(); 
-	PORTBbits.RB0 = 1; // A/B // gsm modem connected      
+	HAL_MUX_GSM(); // A/B // gsm modem connected      
 	gsm = ON;  
-	modem_init();
-	PORTAbits.RA1 = LED_ON;
+	for(c=0; c<REQ_MAX; c++)
+		reqs[c].state = REQ_FREE;
+	cur_req = NO_REQ;
+	text_req = NO_REQ;
+	req_missed = 0;
+	fix_ready = 0;
+	at_init(modem_line, modem_done);
+	sched_init(tasks, sizeof(tasks) / sizeof(tasks[0]));
+	app_state = APP_START;       // modem_init() once system has settled
+}
+
+/* Modem responses and AT command time outs */
+void gsm_task(unsigned long now) {
+	unsigned char c;
+
+	if(app_state == APP_GPS)
+		return;
+	if(app_state == APP_START) {
+		if(now < START_UP_MS)
+			return;
+		modem_init();
+	}
+
+	while(ring_get(&gsm_ring, &c) == 1)
+		at_rx(c);
+
+	if(app_state == APP_IDLE && req_find(REQ_NEW) != NO_REQ)
+		serve_requests();
+
+	/* commands queued above are sent in this same run */
+	at_poll(now);
+}
+
+/* NMEA parsing while GPS receiver is connected */
+void gps_task(unsigned long now) {
+	if(app_state == APP_GPS)
+		gps_step(now);
+}
+
+/* Blink instead of keeping LED on while waiting for SMS; also shows that scheduler is alive. Phase 
+ * is taken from clock so that a late run does not stretch the blink. */
+void led_task(unsigned long now) {
+	if(app_state == APP_IDLE)
+		PORTAbits.RA0 = ((now / 500) & 1) ? LED_ON : LED_OFF;
+}
+
+/* One scheduler pass; CPU idles at end of it if nothing more is to be done */
+void app_loop(void) {
+	sched_run(clock_ms());
+}
+
+#ifndef HOST_BUILD
+/* Entry point */
+void main(void) {
+	app_init();
 
 	/* Keep looping until powered off */
 	while(1) {
-		clr_buf(); 
-		clean_sim();
-		PORTAbits.RA0 = LED_ON;
-		wait_4_msg();       
-		get_index();  
-		read_msg();
-		check_msg();
-		PORTAbits.RA6 = LED_ON;
-		if(success == 1) {  
-			get_mob_no();      
-			send_msg_cmd();           
-			gsm = OFF;
-			PORTCbits.RC0 = LED_ON; 
-			gps_handler();
-			PORTCbits.RC1 = LED_ON; 
-			gsm = ON;
-			gsm_uart_init();  
-			PORTBbits.RB0 = 1;        // A/B ---> gsm modem connected  
-			INTCONbits.GIEH = 1;      // Enable all unmasked interrupt           
-			send_loc(); 
-			PORTCbits.RC2 = LED_ON;
-			for(k=60000; k>5; k--); 
-			PORTAbits.RA0 = LED_OFF;
-			PORTAbits.RA6 = LED_OFF;
-			PORTCbits.RC0 = LED_OFF;
-			PORTCbits.RC1 = LED_OFF;
-			PORTCbits.RC2 = LED_OFF;  
-		}else {
-			PORTAbits.RA0 = LED_OFF;
-			PORTAbits.RA6 = LED_OFF;
-		} 
+		app_loop();
 	}            	                 
 }
+#endif
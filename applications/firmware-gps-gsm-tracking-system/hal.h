@@ -0,0 +1,51 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * Thin hardware abstraction for the tracking firmware. On target it maps to PIC18F4550 registers 
+ * (C18 compiler). When HOST_BUILD is defined, registers are replaced by plain variables and UART 
+ * data register by functions of the host stub, so that ISR and parsers can be run on Linux 
+ * (see host/Makefile).
+ */
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#ifdef HOST_BUILD
+#include "host/pic18_stub.h"
+#else
+#include <p18f4550.h>
+#endif
+
+/* High priority interrupts (Timer0 tick and EUSART receive) */
+#define HAL_IRQ_OFF()     INTCONbits.GIEH = 0
+#define HAL_IRQ_ON()      INTCONbits.GIEH = 1
+
+/* 2x1 multiplexer on RB0 connects either GSM modem or GPS receiver to RX pin of EUSART */
+#define HAL_MUX_GSM()     PORTBbits.RB0 = 1
+#define HAL_MUX_GPS()     PORTBbits.RB0 = 0
+
+#ifdef HOST_BUILD
+#define HAL_UART_GETC()   stub_uart_getc()
+#define HAL_UART_PUTC(c)  stub_uart_putc(c)
+#define HAL_IDLE()        do { OSCCONbits.IDLEN = 1; stub_idle(); } while(0)
+#else
+/* Reading RCREG pops receive FIFO and clears RCIF. TXIF is set while TXREG is empty. */
+#define HAL_UART_GETC()   RCREG
+#define HAL_UART_PUTC(c)  do { while(PIR1bits.TXIF == 0); TXREG = (c); } while(0)
+/* IDLEN = 1 makes SLEEP instruction stop CPU clock only; Timer0 and EUSART keep running and 
+ * their interrupts wake CPU even if GIEH is 0. */
+#define HAL_IDLE()        do { OSCCONbits.IDLEN = 1; Sleep(); } while(0)
+#endif
+
+#endif /* HAL_H_ */
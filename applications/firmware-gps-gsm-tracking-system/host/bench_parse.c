@@ -0,0 +1,139 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * Cost of getting one location from GPS receiver output, from the same start positions in the 
+ * same stream: GPGGA search of earlier firmware (legacy_gps.c) which worked on a captured window of 
+ * 747 bytes, versus NMEA parser which is fed every byte from start position until a fix with 
+ * altitude has been decoded. Cost of storing received bytes (ISR) is same for both and is not 
+ * counted. Counts host CPU instructions with perf_event_open(); if that is not permitted, 
+ * nanoseconds are measured instead. Numbers are for host CPU and only their ratio carries over 
+ * to PIC18.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "../nmea.h"
+
+#define WINDOW      747            // bytes captured by earlier firmware
+#define STREAM_LEN  (64 * 1024)
+#define STEP        37             // capture may start anywhere in a sentence
+
+extern unsigned char legacy_gps_buf[1024];
+unsigned int search_gpgga(unsigned int);
+unsigned int ext_req_field(unsigned int);
+
+static unsigned char stream[STREAM_LEN];
+static int perf_fd = -1;
+static struct timespec t_start;
+
+static void counter_open(void) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	perf_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void counter_start(void) {
+	if(perf_fd >= 0) {
+		ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+	}else {
+		clock_gettime(CLOCK_MONOTONIC, &t_start);
+	}
+}
+
+static unsigned long long counter_stop(void) {
+	unsigned long long count = 0;
+	struct timespec t;
+	if(perf_fd >= 0) {
+		ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+		if(read(perf_fd, &count, sizeof(count)) != sizeof(count))
+			count = 0;
+		return count;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (t.tv_sec - t_start.tv_sec) * 1000000000ULL + t.tv_nsec - t_start.tv_nsec;
+}
+
+static int load_stream(const char *path) {
+	FILE *fp;
+	long len, n;
+	fp = fopen(path, "rb");
+	if(fp == NULL)
+		return -1;
+	len = fread(stream, 1, STREAM_LEN, fp);
+	fclose(fp);
+	if(len <= 0)
+		return -1;
+	/* receiver repeats same sentences every second */
+	for(n=len; n<STREAM_LEN; n++)
+		stream[n] = stream[n % len];
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	const char *path = (argc > 1) ? argv[1] : "data/nmea-sirf3.log";
+	const char *unit;
+	unsigned long long legacy = 0, parser = 0;
+	unsigned long windows = 0, wait_bytes = 0;
+	unsigned long w, i;
+	nmea_t n;
+
+	if(load_stream(path) != 0) {
+		printf("bench_parse : can not read %s\n", path);
+		return 1;
+	}
+	counter_open();
+	unit = (perf_fd >= 0) ? "instructions" : "ns";
+
+	for(w=0; w + WINDOW <= STREAM_LEN; w += STEP) {
+		/* earlier firmware: one search and extraction of captured window, nothing beyond it */
+		memcpy(legacy_gps_buf, &stream[w], WINDOW);
+		memset(&legacy_gps_buf[WINDOW], 0, sizeof(legacy_gps_buf) - WINDOW);
+		counter_start();
+		ext_req_field(search_gpgga(0));
+		legacy += counter_stop();
+
+		/* parser: every byte until location (with altitude) is known */
+		nmea_init(&n);
+		counter_start();
+		for(i=w; i<STREAM_LEN; i++) {
+			if(nmea_put(&n, stream[i], 0) == 1 && n.fix.alt[0] != 0)
+				break;
+		}
+		parser += counter_stop();
+		wait_bytes += i + 1 - w;
+		windows++;
+	}
+
+	printf("bench_parse : counting %s on host CPU, %lu start positions\n", unit, windows);
+	printf("bench_parse : search_gpgga/ext_req_field %8llu %s per location, after %d bytes\n", 
+			legacy / windows, unit, WINDOW);
+	printf("bench_parse : nmea_put                   %8llu %s per location, after %lu bytes (%lu ms at 4800 baud)\n", 
+			parser / windows, unit, wait_bytes / windows, (wait_bytes / windows) * 1000 / 480);
+	if(perf_fd >= 0)
+		close(perf_fd);
+	return 0;
+}
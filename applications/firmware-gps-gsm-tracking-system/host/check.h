@@ -0,0 +1,35 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* Minimal checks for host tests; each test program returns number of failed checks. */
+
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                                      \
+		if(!(cond)) {                                                         \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);            \
+			failures++;                                                       \
+		}                                                                     \
+	} while(0)
+
+#define CHECK_DONE(name) do {                                                 \
+		printf("%s : %s\n", (name), (failures == 0) ? "PASS" : "FAIL");       \
+		return failures;                                                      \
+	} while(0)
+
+#endif /* CHECK_H_ */
@@ -0,0 +1,138 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * GPGGA search and field extraction of earlier firmware, kept only to compare its cost with 
+ * NMEA parser (bench_parse.c). Code is as it was except that result of recursive call is 
+ * returned; original relied on C18 leaving it in return register.
+ */
+
+#define  CR         0X0D
+#define  LF         0X0A   
+#define  SPACE      0X20
+#define  COMMA      0X2C
+#define  NULL       0X00
+
+unsigned char legacy_gps_buf[1024];
+unsigned char legacy_msg_buf[45];
+
+#define gps_buf legacy_gps_buf
+#define msg_buf legacy_msg_buf
+
+/* From the data received try to figure out starting position of GPGGA string */
+unsigned int search_gpgga(unsigned int y) {
+
+	/* The y has starting address from where it should start searching '$' character */
+	while(gps_buf[y] != '$') {
+		y++;
+	}
+
+	/* check for gpgga string */
+	if(gps_buf[y+1]=='G' && gps_buf[y+2]=='P' && gps_buf[y+3]=='G'
+			&& gps_buf[y+4]=='G' && gps_buf[y+5]=='A') {
+		return(y+5); // return address of 'A'
+	}else {
+		return search_gpgga(y+10); // start search from new location in buffer
+	}
+}
+
+/* Parse the data received from GPS receiver and extract required fields */
+unsigned int ext_req_field(unsigned int p) { 
+	unsigned char comma_count;  // variable to hold count of commas.
+	unsigned char z;
+
+	// cross check returned value also.
+	if( gps_buf[p] == 'A')  {
+		p=p+2;
+		while(gps_buf[p] != COMMA){
+			p++;                           
+		}
+
+		p++;                // p now have address of 1st digit of
+		z=0;                // latitude coordinate.
+		msg_buf[z]='L';     // append 'LA' to msg_buf to indicate
+		z++;                // that following value is latitude.
+		msg_buf[z]='A';
+		z++;
+		msg_buf[z]=SPACE;
+		z++;
+
+		/* Save latitude coordinates */
+		while(gps_buf[p] != COMMA) {
+			msg_buf[z]=gps_buf[p]; 
+			z++;
+			p++;
+		}
+
+		p=p+3;               // p now have address of 1st digit of
+		msg_buf[z]=COMMA;
+		z++;
+		msg_buf[z]=CR;
+		z++;
+		msg_buf[z]=LF;
+		z++;
+		msg_buf[z]='L';      // longitude coordinate.
+		z++;
+		msg_buf[z]='O';      // append 'LO' to msg_buf to indicate
+		z++;                 // that following value is longitude.
+		msg_buf[z]=SPACE;
+		z++;
+
+		/* Save longitude coordinate */
+		while(gps_buf[p] != COMMA) {
+			msg_buf[z]=gps_buf[p];
+			z++;
+			p++;
+		}
+
+		p++;
+		comma_count = 0;
+
+		/* After this loop ends the p will contain  address of first digit of altitude coordinates */ 
+		while(comma_count != 4) {
+			if(gps_buf[p] == COMMA ) {
+				comma_count++;
+				p++;
+			}else {
+				p++;
+			}
+		} 
+		msg_buf[z]=COMMA;
+		z++;
+		msg_buf[z]=CR;
+		z++; 
+		msg_buf[z]=LF;
+		z++;          
+		msg_buf[z]='A';        // append 'AL' to msg_buf to indicate
+		z++;                   // that following value is altitude.
+		msg_buf[z]='L'; 
+		z++;
+		msg_buf[z]=SPACE;
+		z++;
+
+		/* Save altitude coordinate */
+		while(gps_buf[p] != COMMA ) {
+			msg_buf[z] = gps_buf[p];
+			z++;
+			p++;
+		} 
+		msg_buf[z]=COMMA;
+		z++; 
+		msg_buf[z]= NULL;// append null character to mark end
+
+	}else {
+		/* Something went wrong, start searching $gpgga again */
+		return search_gpgga(p+10);
+	}
+	return p;
+}
@@ -0,0 +1,76 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+#include "pic18_stub.h"
+
+volatile stub_intcon_t INTCONbits;
+volatile stub_pir1_t PIR1bits;
+volatile stub_pie1_t PIE1bits;
+volatile stub_ipr1_t IPR1bits;
+volatile stub_rcon_t RCONbits;
+volatile stub_rcsta_t RCSTAbits;
+volatile stub_txsta_t TXSTAbits;
+volatile stub_trisa_t TRISAbits;
+volatile stub_trisb_t TRISBbits;
+volatile stub_trisc_t TRISCbits;
+volatile stub_porta_t PORTAbits;
+volatile stub_portb_t PORTBbits;
+volatile stub_portc_t PORTCbits;
+volatile stub_ucon_t UCONbits;
+volatile stub_ucfg_t UCFGbits;
+volatile stub_sppcon_t SPPCONbits;
+volatile stub_adcon0_t ADCON0bits;
+volatile stub_sspcon1_t SSPCON1bits;
+volatile stub_t0con_t T0CONbits;
+volatile stub_intcon2_t INTCON2bits;
+volatile stub_osccon_t OSCCONbits;
+
+volatile unsigned char RCSTA, TXSTA, BAUDCON, SPBRG, CCP1CON, CCP2CON, ADCON1;
+volatile unsigned char T0CON, TMR0H, TMR0L;
+
+void (*stub_tx_hook)(unsigned char c) = 0;
+unsigned long stub_idle_count = 0;
+
+static unsigned char rcreg;
+
+extern void high_isr(void);
+
+unsigned char stub_uart_getc(void) {
+	PIR1bits.RCIF = 0;
+	return rcreg;
+}
+
+void stub_uart_putc(unsigned char c) {
+	if(stub_tx_hook != 0)
+		stub_tx_hook(c);
+}
+
+void stub_uart_rx(unsigned char c) {
+	rcreg = c;
+	PIR1bits.RCIF = 1;
+	if((PIE1bits.RCIE == 1) && (INTCONbits.GIEH == 1))
+		high_isr();
+}
+
+void stub_idle(void) {
+	stub_idle_count++;
+}
+
+void stub_tick(unsigned long count) {
+	while(count > 0) {
+		INTCONbits.TMR0IF = 1;
+		if((INTCONbits.TMR0IE == 1) && (INTCONbits.GIEH == 1))
+			high_isr();
+		count--;
+	}
+}
@@ -0,0 +1,89 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * Register stubs of PIC18F4550 used when firmware is built on Linux host (HOST_BUILD). Special 
+ * function registers are plain variables so that firmware code which writes them compiles and 
+ * runs unchanged. UART data registers are replaced by functions so that tests can feed received 
+ * bytes into ISR and capture transmitted bytes.
+ */
+
+#ifndef PIC18_STUB_H_
+#define PIC18_STUB_H_
+
+#define rom
+
+typedef struct { unsigned GIEH:1; unsigned PEIE:1; unsigned TMR0IE:1; unsigned TMR0IF:1; } stub_intcon_t;
+typedef struct { unsigned RCIF:1; unsigned TXIF:1; } stub_pir1_t;
+typedef struct { unsigned RCIE:1; unsigned TXIE:1; } stub_pie1_t;
+typedef struct { unsigned RCIP:1; unsigned TXIP:1; } stub_ipr1_t;
+typedef struct { unsigned IPEN:1; } stub_rcon_t;
+typedef struct { unsigned SPEN:1; unsigned CREN:1; unsigned FERR:1; unsigned OERR:1; } stub_rcsta_t;
+typedef struct { unsigned TRMT:1; } stub_txsta_t;
+typedef struct { unsigned TRISA0:1; unsigned TRISA1:1; unsigned TRISA6:1; } stub_trisa_t;
+typedef struct { unsigned TRISB0:1; unsigned TRISB1:1; } stub_trisb_t;
+typedef struct { unsigned TRISC0:1; unsigned TRISC1:1; unsigned TRISC2:1; unsigned TRISC6:1; unsigned TRISC7:1; } stub_trisc_t;
+typedef struct { unsigned RA0:1; unsigned RA1:1; unsigned RA6:1; } stub_porta_t;
+typedef struct { unsigned RB0:1; unsigned RB1:1; } stub_portb_t;
+typedef struct { unsigned RC0:1; unsigned RC1:1; unsigned RC2:1; } stub_portc_t;
+typedef struct { unsigned USBEN:1; } stub_ucon_t;
+typedef struct { unsigned UTRDIS:1; } stub_ucfg_t;
+typedef struct { unsigned SPPEN:1; } stub_sppcon_t;
+typedef struct { unsigned ADON:1; } stub_adcon0_t;
+typedef struct { unsigned SSPEN:1; } stub_sspcon1_t;
+typedef struct { unsigned TMR0ON:1; } stub_t0con_t;
+typedef struct { unsigned TMR0IP:1; } stub_intcon2_t;
+typedef struct { unsigned IDLEN:1; } stub_osccon_t;
+
+extern volatile stub_intcon_t INTCONbits;
+extern volatile stub_pir1_t PIR1bits;
+extern volatile stub_pie1_t PIE1bits;
+extern volatile stub_ipr1_t IPR1bits;
+extern volatile stub_rcon_t RCONbits;
+extern volatile stub_rcsta_t RCSTAbits;
+extern volatile stub_txsta_t TXSTAbits;
+extern volatile stub_trisa_t TRISAbits;
+extern volatile stub_trisb_t TRISBbits;
+extern volatile stub_trisc_t TRISCbits;
+extern volatile stub_porta_t PORTAbits;
+extern volatile stub_portb_t PORTBbits;
+extern volatile stub_portc_t PORTCbits;
+extern volatile stub_ucon_t UCONbits;
+extern volatile stub_ucfg_t UCFGbits;
+extern volatile stub_sppcon_t SPPCONbits;
+extern volatile stub_adcon0_t ADCON0bits;
+extern volatile stub_sspcon1_t SSPCON1bits;
+extern volatile stub_t0con_t T0CONbits;
+extern volatile stub_intcon2_t INTCON2bits;
+extern volatile stub_osccon_t OSCCONbits;
+
+extern volatile unsigned char RCSTA, TXSTA, BAUDCON, SPBRG, CCP1CON, CCP2CON, ADCON1;
+extern volatile unsigned char T0CON, TMR0H, TMR0L;
+
+/* UART data register replacements used by HAL */
+unsigned char stub_uart_getc(void);
+void stub_uart_putc(unsigned char c);
+
+/* Test side: deliver one received byte to firmware (raises RCIF and runs high_isr() if receive 
+ * interrupt is enabled) and optionally observe every transmitted byte. */
+void stub_uart_rx(unsigned char c);
+extern void (*stub_tx_hook)(unsigned char c);
+
+/* SLEEP instruction replacement; returns at once, tests count how often CPU would have idled */
+void stub_idle(void);
+extern unsigned long stub_idle_count;
+
+/* Test side: let given number of Timer0 periods elapse (raises TMR0IF and runs high_isr()). */
+void stub_tick(unsigned long count);
+
+#endif /* PIC18_STUB_H_ */
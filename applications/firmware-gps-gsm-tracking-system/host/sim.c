@@ -0,0 +1,240 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pic18_stub.h"
+#include "sim.h"
+
+#define MAX_STEPS     256
+#define MAX_TEXT      512
+#define MODEM_BYTES_PER_MS  11     // 115200 baud
+#define GPS_CHARS_PER_S     480    // 4800 baud
+
+typedef struct {
+	char dir;
+	unsigned long delay;
+	char text[MAX_TEXT];
+	int len;
+	unsigned long at;      // time at which step completed
+} step_t;
+
+static step_t steps[MAX_STEPS];
+static int num_steps;
+static int out;      // next step modem sends
+static int cmd;      // next step firmware must send
+static int sent;
+static unsigned long last_event;
+static char tx[MAX_TEXT];
+static int tx_len;
+static int errors;
+static unsigned long sim_now;
+
+static unsigned char *gps_data;
+static long gps_len;
+static long gps_pos;
+static unsigned long gps_chars;
+static unsigned long gps_start;
+static int gps_connected;
+
+static int unescape(const char *in, char *out) {
+	int n = 0;
+	while(*in != 0 && *in != '\n' && n < MAX_TEXT - 1) {
+		if(in[0] == '\\' && in[1] != 0) {
+			switch(in[1]) {
+			case 'r': out[n++] = '\r'; break;
+			case 'n': out[n++] = '\n'; break;
+			default: out[n++] = in[1]; break;
+			}
+			in += 2;
+		}else if(in[0] == '^' && in[1] == 'Z') {
+			out[n++] = 0x1A;
+			in += 2;
+		}else {
+			out[n++] = *in++;
+		}
+	}
+	out[n] = 0;
+	return n;
+}
+
+static int next_step(int i, char dir) {
+	while(i < num_steps && steps[i].dir != dir)
+		i++;
+	return i;
+}
+
+/* Firmware may send next command while modem is still sending output which precedes it in script 
+ * (for ex; a burst of +CMTI lines), but not before that output has started. */
+static int cmd_allowed(int j) {
+	if(out > j)
+		return 1;
+	return (sent > 0 && next_step(out + 1, '<') > j) ? 1 : 0;
+}
+
+static void on_tx(unsigned char c) {
+	step_t *s;
+	if(cmd >= num_steps) {
+		/* firmware talks when no command is expected */
+		if(c == '\r' || c == 0x1A) {
+			printf("modem_sim: unexpected command '%.*s' at %lu ms\n", tx_len, tx, sim_now);
+			errors++;
+			tx_len = 0;
+		}else if(tx_len < MAX_TEXT - 1) {
+			tx[tx_len++] = c;
+		}
+		return;
+	}
+	s = &steps[cmd];
+	if(tx_len < MAX_TEXT - 1)
+		tx[tx_len++] = c;
+	if(tx_len < s->len)
+		return;
+	if(tx_len > s->len || memcmp(tx, s->text, s->len) != 0) {
+		printf("modem_sim: expected '%s' got '%.*s' at %lu ms\n", s->text, tx_len, tx, sim_now);
+		errors++;
+	}else if(cmd_allowed(cmd) == 0) {
+		printf("modem_sim: '%s' sent before modem output at %lu ms\n", s->text, sim_now);
+		errors++;
+	}
+	tx_len = 0;
+	s->at = sim_now;
+	last_event = sim_now;
+	cmd = next_step(cmd + 1, '>');
+}
+
+int modem_sim_load(const char *path) {
+	FILE *fp;
+	char line[1024];
+	char *p;
+	step_t *s;
+
+	fp = fopen(path, "r");
+	if(fp == NULL)
+		return -1;
+	num_steps = 0;
+	while(fgets(line, sizeof(line), fp) != NULL && num_steps < MAX_STEPS) {
+		if(line[0] != '>' && line[0] != '<')
+			continue;
+		s = &steps[num_steps];
+		memset(s, 0, sizeof(*s));
+		s->dir = line[0];
+		p = line + 2;
+		if(s->dir == '<') {
+			s->delay = strtoul(p, &p, 10);
+			p++;
+		}
+		s->len = unescape(p, s->text);
+		if(s->dir == '>' && (s->len == 0 || s->text[s->len - 1] != 0x1A)) {
+			s->text[s->len++] = '\r';
+			s->text[s->len] = 0;
+		}
+		num_steps++;
+	}
+	fclose(fp);
+	out = next_step(0, '<');
+	cmd = next_step(0, '>');
+	sent = 0;
+	last_event = 0;
+	tx_len = 0;
+	errors = 0;
+	stub_tx_hook = on_tx;
+	return num_steps;
+}
+
+void modem_sim_step(unsigned long now) {
+	step_t *s;
+	int budget = MODEM_BYTES_PER_MS;
+
+	sim_now = now;
+	/* output is answer to commands which precede it in script */
+	while(out < num_steps && cmd > out && budget > 0) {
+		s = &steps[out];
+		if(sent == 0 && now < last_event + s->delay)
+			return;
+		while(sent < s->len && budget > 0) {
+			/* bytes are lost while multiplexer connects GPS receiver */
+			if(PORTBbits.RB0 == 1)
+				stub_uart_rx((unsigned char) s->text[sent]);
+			sent++;
+			budget--;
+		}
+		if(sent == s->len) {
+			sent = 0;
+			s->at = now;
+			last_event = now;
+			out = next_step(out + 1, '<');
+		}
+	}
+}
+
+int modem_sim_done(void) {
+	return (out >= num_steps && cmd >= num_steps) ? 1 : 0;
+}
+
+int modem_sim_errors(void) {
+	return errors;
+}
+
+/* Time at which last step starting with given text completed, 0 if it did not. */
+unsigned long modem_sim_time_of(const char *text) {
+	int i;
+	char t[MAX_TEXT];
+	int n = unescape(text, t);
+	for(i=num_steps-1; i>=0; i--) {
+		if(steps[i].at != 0 && strncmp(steps[i].text, t, n) == 0)
+			return steps[i].at;
+	}
+	return 0;
+}
+
+int gps_sim_load(const char *path) {
+	FILE *fp;
+	fp = fopen(path, "rb");
+	if(fp == NULL)
+		return -1;
+	fseek(fp, 0, SEEK_END);
+	gps_len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	free(gps_data);
+	gps_data = malloc(gps_len);
+	if(fread(gps_data, 1, gps_len, fp) != (size_t) gps_len)
+		gps_len = 0;
+	fclose(fp);
+	gps_pos = 0;
+	gps_connected = 0;
+	return 0;
+}
+
+/* Receiver sends continuously (log is repeated); firmware sees it only while connected. */
+void gps_sim_step(unsigned long now) {
+	unsigned long due;
+	if(gps_len == 0)
+		return;
+	if(PORTBbits.RB0 == 1) {
+		gps_connected = 0;
+		return;
+	}
+	if(gps_connected == 0) {
+		gps_connected = 1;
+		gps_start = now;
+		gps_chars = 0;
+	}
+	due = ((now - gps_start) * GPS_CHARS_PER_S) / 1000;
+	while(gps_chars < due) {
+		stub_uart_rx(gps_data[gps_pos]);
+		gps_pos = (gps_pos + 1) % gps_len;
+		gps_chars++;
+	}
+}
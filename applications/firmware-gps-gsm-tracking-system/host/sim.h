@@ -0,0 +1,39 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * Scripted GSM modem and GPS receiver for host tests. Both deliver bytes through stub_uart_rx() 
+ * only while multiplexer (RB0) connects them, at the rate of their baud rate, just like hardware.
+ * 
+ * Modem script is a text file processed top to bottom:
+ *   # comment
+ *   > TEXT          firmware must transmit TEXT followed by CR (or ending with ^Z for SMS text)
+ *   < DELAY TEXT    DELAY milliseconds after previous step, modem sends TEXT
+ * Modem output waits for every command before it in script. A command may be sent as soon as 
+ * modem output before it has started, so firmware can react to first line of a longer output.
+ * TEXT may contain \r \n \" \\ and ^Z escapes.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+int modem_sim_load(const char *path);
+void modem_sim_step(unsigned long now);
+int modem_sim_done(void);
+int modem_sim_errors(void);
+unsigned long modem_sim_time_of(const char *text);
+
+int gps_sim_load(const char *path);
+void gps_sim_step(unsigned long now);
+
+#endif /* SIM_H_ */
@@ -0,0 +1,120 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * Whole firmware against scripted modem and recorded GPS receiver output. Time advances in 1 ms 
+ * steps through Timer0 interrupt, so the AT engine time outs, retries and GPS wait are exercised 
+ * exactly as on hardware, and latency of a reply can be measured in milliseconds.
+ */
+
+#include <string.h>
+#include "check.h"
+#include "../hal.h"
+#include "sim.h"
+
+extern volatile unsigned long ticks;
+extern unsigned char app_state;
+void app_init(void);
+void app_loop(void);
+
+#define APP_IDLE  2
+
+/* Run until script is done and firmware went back to waiting for SMS, or limit is reached. */
+static void run(unsigned long limit) {
+	while(ticks < limit) {
+		stub_tick(1);
+		modem_sim_step(ticks);
+		gps_sim_step(ticks);
+		app_loop();
+		if(modem_sim_done() && app_state == APP_IDLE)
+			break;
+	}
+}
+
+static void test_location_request(void) {
+	unsigned long cmti, sent;
+	CHECK(modem_sim_load("data/modem-loc.txt") > 0);
+	CHECK(gps_sim_load("data/nmea-sirf3.log") == 0);
+	ticks = 0;
+	app_init();
+	run(60000);
+	CHECK(modem_sim_done());
+	CHECK(modem_sim_errors() == 0);
+	cmti = modem_sim_time_of("\\r\\n+CMTI");
+	sent = modem_sim_time_of("LA ");
+	CHECK(cmti != 0 && sent > cmti);
+	printf("test_at : SMS received to reply sent %lu ms (GPS fix included)\n", sent - cmti);
+}
+
+static void test_retry(void) {
+	CHECK(modem_sim_load("data/modem-retry.txt") > 0);
+	CHECK(gps_sim_load("data/nmea-sirf3.log") == 0);
+	ticks = 0;
+	app_init();
+	run(60000);
+	CHECK(modem_sim_done());
+	CHECK(modem_sim_errors() == 0);
+	/* after 2000 ms start up, unanswered AT waits for 1000 ms time out; 3 retries wait 
+	 * AT_RETRY_DELAY more each */
+	CHECK(modem_sim_time_of("AT+CMGF") >= 2000 + 1000 + 3 * 250);
+	CHECK(ticks < 7000);
+}
+
+/* Reply rejected once by network; script fails unless whole send is done again before deletion */
+static void test_send_retry(void) {
+	CHECK(modem_sim_load("data/modem-send-retry.txt") > 0);
+	CHECK(gps_sim_load("data/nmea-sirf3.log") == 0);
+	ticks = 0;
+	app_init();
+	run(60000);
+	CHECK(modem_sim_done());
+	CHECK(modem_sim_errors() == 0);
+	CHECK(modem_sim_time_of("AT+CMGD=3") > modem_sim_time_of("\\r\\n+CMS ERROR: 500"));
+}
+
+/* Messages without text are deleted; before they were listed and read again without end */
+static void test_empty_sms(void) {
+	CHECK(modem_sim_load("data/modem-empty-sms.txt") > 0);
+	CHECK(gps_sim_load("data/nmea-sirf3.log") == 0);
+	ticks = 0;
+	app_init();
+	run(60000);
+	CHECK(modem_sim_done());
+	CHECK(modem_sim_errors() == 0);
+	CHECK(modem_sim_time_of("AT+CMGD=3") != 0);
+}
+
+/* 4 requests, 1 of them not for location: 1 GPS fix, 3 replies back-to-back, 4 deletions */
+static void test_burst(void) {
+	unsigned long first, last;
+	CHECK(modem_sim_load("data/modem-burst.txt") > 0);
+	CHECK(gps_sim_load("data/nmea-sirf3.log") == 0);
+	ticks = 0;
+	app_init();
+	run(60000);
+	CHECK(modem_sim_done());
+	CHECK(modem_sim_errors() == 0);
+	first = modem_sim_time_of("\\r\\n+CMTI: \"SM\",1");
+	last = modem_sim_time_of("AT+CMGD=1");
+	CHECK(first != 0 && last > first);
+	printf("test_at : 3 LOC? requests answered and 4 SMS deleted in %lu ms\n", last - first);
+}
+
+int main(void) {
+	test_location_request();
+	test_retry();
+	test_send_retry();
+	test_empty_sms();
+	test_burst();
+	CHECK_DONE("test_at");
+}
@@ -0,0 +1,136 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * NMEA parser against recorded receiver output: fix is taken only from checksum-valid GGA/RMC 
+ * sentences reporting a position, garbage and truncated sentences are skipped, and the cached fix 
+ * ages with the millisecond clock so location requests can be answered from it.
+ */
+
+#include <string.h>
+#include "check.h"
+#include "../hal.h"
+#include "../ring.h"
+#include "../nmea.h"
+
+extern ring_t gps_ring;
+extern unsigned char gps_ring_buf[], msg_buf[];
+extern unsigned char gsm;
+extern nmea_t gps;
+extern volatile unsigned long ticks;
+unsigned char gps_poll(void);
+void build_loc_msg(void);
+
+static int feed_file(nmea_t *n, const char *path, unsigned long now) {
+	FILE *fp;
+	int ch, fixes = 0;
+	fp = fopen(path, "rb");
+	CHECK(fp != NULL);
+	if(fp == NULL)
+		return 0;
+	while((ch = fgetc(fp)) != EOF)
+		fixes += nmea_put(n, (unsigned char) ch, now);
+	fclose(fp);
+	return fixes;
+}
+
+static void test_recorded_fix(void) {
+	nmea_t n;
+	nmea_init(&n);
+	CHECK(nmea_fix_age(&n, 0) == NMEA_NO_FIX);
+	/* 2 GGA + 2 RMC with position */
+	CHECK(feed_file(&n, "data/nmea-sirf3.log", 1000) == 4);
+	CHECK(n.sentences == 16);
+	CHECK(n.bad_checksum == 0);
+	CHECK(strcmp((char *) n.fix.lat, "4717.115") == 0 && n.fix.ns == 'N');
+	CHECK(strcmp((char *) n.fix.lon, "00833.912") == 0 && n.fix.ew == 'E');
+	CHECK(strcmp((char *) n.fix.alt, "00499") == 0);
+	CHECK(strcmp((char *) n.fix.utc, "130305.0") == 0);
+	CHECK(nmea_fix_age(&n, 4000) == 3000);
+}
+
+static void test_no_fix(void) {
+	nmea_t n;
+	nmea_init(&n);
+	CHECK(feed_file(&n, "data/nmea-nofix.log", 0) == 0);
+	CHECK(n.valid == 0);
+	CHECK(n.sentences == 6);
+}
+
+static void test_noisy(void) {
+	nmea_t n;
+	nmea_init(&n);
+	CHECK(feed_file(&n, "data/nmea-noisy.log", 0) == 2);
+	CHECK(n.bad_checksum == 1);
+	/* RMC updated position and kept GGA altitude */
+	CHECK(strcmp((char *) n.fix.lat, "5321.6810") == 0 && n.fix.ew == 'W');
+	CHECK(strcmp((char *) n.fix.alt, "61.7") == 0);
+	CHECK(n.fix.quality == 'A');
+}
+
+static void test_overlong_fields(void) {
+	nmea_t n;
+	int i;
+	const char *s = "$GPGGA,1,123456789012345678901234567890,N";
+	nmea_init(&n);
+	for(i=0; s[i] != 0; i++)
+		nmea_put(&n, s[i], 0);
+	CHECK(strlen((char *) n.work.lat) == NMEA_LAT_LEN - 1);
+	for(i=0; i<200; i++)
+		nmea_put(&n, 'x', 0);
+	CHECK(n.state == 0);
+}
+
+/* Bytes arrive through ISR while firmware polls; location message is built from cache. */
+static void test_firmware_path(void) {
+	FILE *fp;
+	int ch;
+	ring_init(&gps_ring, gps_ring_buf, 64);
+	nmea_init(&gps);
+	PIE1bits.RCIE = 1;
+	INTCONbits.TMR0IE = 1;
+	INTCONbits.GIEH = 1;
+	gsm = 0;
+	ticks = 0;
+
+	build_loc_msg();
+	CHECK(strcmp((char *) msg_buf, "NO FIX") == 0);
+
+	fp = fopen("data/nmea-sirf3.log", "rb");
+	CHECK(fp != NULL);
+	if(fp == NULL)
+		return;
+	while((ch = fgetc(fp)) != EOF) {
+		stub_uart_rx((unsigned char) ch);
+		stub_tick(2);            // 4800 baud is about 2 ms per character
+		if((ticks % 16) == 0)
+			gps_poll();
+	}
+	fclose(fp);
+	gps_poll();
+	CHECK(gps_ring.overflow == 0);
+	CHECK(gps.valid == 1);
+	CHECK(nmea_fix_age(&gps, ticks) < 1000);
+
+	build_loc_msg();
+	CHECK(strcmp((char *) msg_buf, "LA 4717.115,\r\nLO 00833.912,\r\nAL 00499,") == 0);
+}
+
+int main(void) {
+	test_recorded_fix();
+	test_no_fix();
+	test_noisy();
+	test_overlong_fields();
+	test_firmware_path();
+	CHECK_DONE("test_nmea");
+}
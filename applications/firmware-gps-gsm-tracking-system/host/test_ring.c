@@ -0,0 +1,91 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * Receive path of firmware: ISR fills GSM and GPS rings independently, full ring drops and counts 
+ * bytes instead of overwriting memory, and lines are assembled while data is still arriving.
+ */
+
+#include <string.h>
+#include "check.h"
+#include "../hal.h"
+#include "../ring.h"
+
+extern ring_t gsm_ring, gps_ring;
+extern unsigned char gsm_ring_buf[], gps_ring_buf[];
+extern unsigned char gsm;
+
+static void setup(void) {
+	ring_init(&gsm_ring, gsm_ring_buf, 128);
+	ring_init(&gps_ring, gps_ring_buf, 64);
+	PIE1bits.RCIE = 1;
+	INTCONbits.GIEH = 1;
+}
+
+static void test_overflow_is_bounded(void) {
+	int i;
+	unsigned char c;
+	setup();
+	gsm = 1;
+	for(i=0; i<300; i++)
+		stub_uart_rx((unsigned char) i);
+	CHECK(ring_count(&gsm_ring) == 127);
+	CHECK(gsm_ring.overflow == 300 - 127);
+	CHECK(ring_count(&gps_ring) == 0);
+	/* oldest bytes are kept, newest dropped */
+	CHECK(ring_get(&gsm_ring, &c) == 1 && c == 0);
+
+	for(i=0; i<1000; i++)
+		stub_uart_rx('x');
+	CHECK(gsm_ring.overflow == 255);
+}
+
+static void test_sources_are_separate(void) {
+	unsigned char c;
+	setup();
+	gsm = 1;
+	stub_uart_rx('O');
+	stub_uart_rx('K');
+	gsm = 0;
+	stub_uart_rx('$');
+	CHECK(ring_count(&gsm_ring) == 2);
+	CHECK(ring_count(&gps_ring) == 1);
+	CHECK(ring_get(&gps_ring, &c) == 1 && c == '$');
+	ring_flush(&gsm_ring);
+	CHECK(ring_count(&gsm_ring) == 0);
+}
+
+static void test_line_assembly(void) {
+	unsigned char storage[8];
+	line_t l;
+	const char *s = "\r\nOK\r\nTOOLONGLINE\r\n";
+	int i, lines = 0;
+	line_init(&l, storage, sizeof(storage));
+	for(i=0; s[i] != 0; i++) {
+		if(line_put(&l, s[i]) == 1) {
+			lines++;
+			if(lines == 1)
+				CHECK(strcmp((char *) storage, "OK") == 0);
+			if(lines == 2)
+				CHECK(strcmp((char *) storage, "TOOLONG") == 0 && l.truncated == 1);
+		}
+	}
+	CHECK(lines == 2);
+}
+
+int main(void) {
+	test_overflow_is_bounded();
+	test_sources_are_separate();
+	test_line_assembly();
+	CHECK_DONE("test_ring");
+}
@@ -0,0 +1,73 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * CPU load of scheduled firmware per scenario. Every simulated millisecond Timer0 interrupt wakes 
+ * CPU for one scheduler pass; a pass in which some task ran is counted busy. This is an upper 
+ * bound: a busy pass normally takes tens of microseconds, not whole millisecond. Firmware which 
+ * waited in busy loops was 100% busy in every scenario.
+ */
+
+#include "check.h"
+#include "../hal.h"
+#include "../sched.h"
+#include "sim.h"
+
+extern volatile unsigned long ticks;
+extern task_t tasks[];
+void app_init(void);
+void app_loop(void);
+
+static const char *task_names[] = { "gsm", "gps", "led" };
+
+static unsigned long scenario(const char *name, const char *script, unsigned long duration) {
+	unsigned long busy_pct;
+	int i;
+
+	CHECK(modem_sim_load(script) > 0);
+	CHECK(gps_sim_load("data/nmea-sirf3.log") == 0);
+	ticks = 0;
+	stub_idle_count = 0;
+	app_init();
+	while(ticks < duration) {
+		stub_tick(1);
+		modem_sim_step(ticks);
+		gps_sim_step(ticks);
+		app_loop();
+	}
+	CHECK(modem_sim_done());
+	CHECK(modem_sim_errors() == 0);
+
+	busy_pct = (sched_busy * 100) / ticks;
+	printf("test_sched : %-16s %6lu ms  busy %3lu%%  idle entries %lu  runs", name, ticks, 
+			busy_pct, stub_idle_count);
+	for(i=0; i<3; i++)
+		printf(" %s=%lu", task_names[i], tasks[i].runs);
+	printf("\n");
+	return busy_pct;
+}
+
+int main(void) {
+	unsigned long busy;
+
+	/* modem initialized, then nothing happens for a minute */
+	busy = scenario("waiting for SMS", "data/modem-retry.txt", 60000);
+	CHECK(busy <= 5);
+	CHECK(stub_idle_count >= 59000);
+
+	/* one LOC? request which needs GPS fix */
+	busy = scenario("LOC? with GPS", "data/modem-loc.txt", 15000);
+	CHECK(busy <= 15);
+
+	CHECK_DONE("test_sched");
+}
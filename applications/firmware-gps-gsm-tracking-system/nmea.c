@@ -0,0 +1,244 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+#include "nmea.h"
+
+#define NMEA_MAX_LEN   82
+
+/* parser states */
+#define ST_IDLE        0
+#define ST_BODY        1
+#define ST_CS_HI       2
+#define ST_CS_LO       3
+
+/* sentence types */
+#define T_OTHER        0
+#define T_GGA          1
+#define T_RMC          2
+
+static void clear_fix(nmea_fix_t *f) {
+	f->lat[0] = 0;
+	f->ns = 0;
+	f->lon[0] = 0;
+	f->ew = 0;
+	f->alt[0] = 0;
+	f->utc[0] = 0;
+	f->quality = 0;
+}
+
+static void copy_str(unsigned char *dst, unsigned char *src) {
+	while(*src != 0) {
+		*dst = *src;
+		dst++;
+		src++;
+	}
+	*dst = 0;
+}
+
+static unsigned char hex_val(unsigned char c) {
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return 0xFF;
+}
+
+void nmea_init(nmea_t *n) {
+	nmea_sync(n);
+	clear_fix(&n->fix);
+	n->valid = 0;
+	n->stamp = 0;
+	n->sentences = 0;
+	n->bad_checksum = 0;
+}
+
+/* Forget partially received sentence, for example after GPS receiver has been reconnected. */
+void nmea_sync(nmea_t *n) {
+	n->state = ST_IDLE;
+}
+
+/* Text field of current sentence which is kept, or 0 if field is not needed. */
+static unsigned char *field_dest(nmea_t *n, unsigned char *size) {
+	if(n->type == T_GGA) {
+		switch(n->field) {
+		case 1: *size = NMEA_TIME_LEN; return n->work.utc;
+		case 2: *size = NMEA_LAT_LEN; return n->work.lat;
+		case 4: *size = NMEA_LON_LEN; return n->work.lon;
+		case 9: *size = NMEA_ALT_LEN; return n->work.alt;
+		}
+	}else if(n->type == T_RMC) {
+		switch(n->field) {
+		case 1: *size = NMEA_TIME_LEN; return n->work.utc;
+		case 3: *size = NMEA_LAT_LEN; return n->work.lat;
+		case 5: *size = NMEA_LON_LEN; return n->work.lon;
+		}
+	}
+	return 0;
+}
+
+/* One character fields */
+static void field_char(nmea_t *n, unsigned char c) {
+	if(n->type == T_GGA) {
+		if(n->field == 3) n->work.ns = c;
+		else if(n->field == 5) n->work.ew = c;
+		else if(n->field == 6) n->work.quality = c;
+	}else if(n->type == T_RMC) {
+		if(n->field == 2) n->work.quality = c;
+		else if(n->field == 4) n->work.ns = c;
+		else if(n->field == 6) n->work.ew = c;
+	}
+}
+
+static void start_field(nmea_t *n) {
+	unsigned char size;
+	unsigned char *dst;
+	dst = field_dest(n, &size);
+	if(dst != 0)
+		dst[0] = 0;
+}
+
+static void end_field(nmea_t *n) {
+	if(n->field == 0) {
+		/* address field; talker (2 characters) followed by sentence formatter */
+		n->type = T_OTHER;
+		if(n->pos == 5) {
+			if(n->id[2] == 'G' && n->id[3] == 'G' && n->id[4] == 'A')
+				n->type = T_GGA;
+			else if(n->id[2] == 'R' && n->id[3] == 'M' && n->id[4] == 'C')
+				n->type = T_RMC;
+		}
+	}
+	n->field++;
+	n->pos = 0;
+	start_field(n);
+}
+
+static void add_char(nmea_t *n, unsigned char c) {
+	unsigned char size;
+	unsigned char *dst;
+
+	if(n->field == 0) {
+		if(n->pos < 5)
+			n->id[n->pos] = c;
+		n->pos++;
+		return;
+	}
+	if(n->pos == 0)
+		field_char(n, c);
+	dst = field_dest(n, &size);
+	if(dst != 0 && n->pos < (size - 1)) {
+		dst[n->pos] = c;
+		dst[n->pos + 1] = 0;
+	}
+	n->pos++;
+}
+
+/* Sentence passed checksum; keep position if receiver reports a valid fix. */
+static unsigned char commit(nmea_t *n, unsigned long now) {
+	nmea_fix_t *w;
+	w = &n->work;
+
+	if(n->sentences != 0xFFFF)
+		n->sentences++;
+
+	if(n->type == T_GGA) {
+		if(w->quality == 0 || w->quality == '0' || w->lat[0] == 0 || w->lon[0] == 0)
+			return 0;
+	}else if(n->type == T_RMC) {
+		if(w->quality != 'A' || w->lat[0] == 0 || w->lon[0] == 0)
+			return 0;
+		/* RMC carries no altitude, keep the one from last GGA */
+		copy_str(w->alt, n->fix.alt);
+	}else {
+		return 0;
+	}
+
+	copy_str(n->fix.lat, w->lat);
+	copy_str(n->fix.lon, w->lon);
+	copy_str(n->fix.alt, w->alt);
+	copy_str(n->fix.utc, w->utc);
+	n->fix.ns = w->ns;
+	n->fix.ew = w->ew;
+	n->fix.quality = w->quality;
+	n->valid = 1;
+	n->stamp = now;
+	return 1;
+}
+
+/* Feed one received character. Returns 1 when it completed a valid GGA/RMC sentence with a fix, 
+ * which is then available in n->fix. */
+unsigned char nmea_put(nmea_t *n, unsigned char c, unsigned long now) {
+	unsigned char v;
+
+	if(c == '$') {
+		/* start of sentence; also resynchronizes after garbage */
+		n->state = ST_BODY;
+		n->sum = 0;
+		n->field = 0;
+		n->pos = 0;
+		n->len = 0;
+		n->type = T_OTHER;
+		clear_fix(&n->work);
+		return 0;
+	}
+
+	switch(n->state) {
+	case ST_BODY:
+		n->len++;
+		if(n->len > NMEA_MAX_LEN || c == 0x0D || c == 0x0A) {
+			n->state = ST_IDLE;      // too long or no checksum
+			return 0;
+		}
+		if(c == '*') {
+			n->state = ST_CS_HI;
+			return 0;
+		}
+		n->sum ^= c;
+		if(c == ',')
+			end_field(n);
+		else
+			add_char(n, c);
+		return 0;
+
+	case ST_CS_HI:
+		v = hex_val(c);
+		if(v == 0xFF) {
+			n->state = ST_IDLE;
+			return 0;
+		}
+		n->rx_sum = v << 4;
+		n->state = ST_CS_LO;
+		return 0;
+
+	case ST_CS_LO:
+		n->state = ST_IDLE;
+		v = hex_val(c);
+		if(v == 0xFF || (n->rx_sum | v) != n->sum) {
+			if(n->bad_checksum != 0xFFFF)
+				n->bad_checksum++;
+			return 0;
+		}
+		return commit(n, now);
+	}
+
+	return 0;
+}
+
+/* Milliseconds since last valid fix was received, NMEA_NO_FIX if there has been none. */
+unsigned long nmea_fix_age(nmea_t *n, unsigned long now) {
+	if(n->valid == 0)
+		return NMEA_NO_FIX;
+	return now - n->stamp;
+}
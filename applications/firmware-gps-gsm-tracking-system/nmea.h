@@ -0,0 +1,73 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * Streaming NMEA 0183 parser. Every byte received from GPS receiver is passed to nmea_put() as soon 
+ * as it is taken out of receive ring; no sentence is buffered and nothing is scanned twice. Only 
+ * GGA and RMC sentences (any talker, e.g. GP or GN) are decoded, and only if their checksum is 
+ * correct. The last valid position is kept with the time it was received so that a location 
+ * request can be answered immediately while it is fresh.
+ * 
+ * Coordinates are kept as text exactly as sent by receiver (ddmm.mmmm) since they are only ever 
+ * forwarded in SMS; no floating point is needed on PIC18.
+ */
+
+#ifndef NMEA_H_
+#define NMEA_H_
+
+#define NMEA_LAT_LEN   12
+#define NMEA_LON_LEN   13
+#define NMEA_ALT_LEN   9
+#define NMEA_TIME_LEN  11
+
+/* No valid fix yet */
+#define NMEA_NO_FIX    0xFFFFFFFFUL
+
+typedef struct {
+	unsigned char lat[NMEA_LAT_LEN];
+	unsigned char ns;
+	unsigned char lon[NMEA_LON_LEN];
+	unsigned char ew;
+	unsigned char alt[NMEA_ALT_LEN];       // meters above MSL, empty if only RMC was received
+	unsigned char utc[NMEA_TIME_LEN];
+	unsigned char quality;                 // GGA fix indicator ('1', '2', ...) or 'A' from RMC
+} nmea_fix_t;
+
+typedef struct {
+	/* parser state */
+	unsigned char state;
+	unsigned char type;
+	unsigned char field;
+	unsigned char pos;
+	unsigned char len;
+	unsigned char sum;
+	unsigned char rx_sum;
+	unsigned char id[5];
+	nmea_fix_t work;
+
+	/* last valid fix and time (milliseconds) when it was received */
+	nmea_fix_t fix;
+	unsigned char valid;
+	unsigned long stamp;
+
+	/* statistics, saturating */
+	unsigned int sentences;
+	unsigned int bad_checksum;
+} nmea_t;
+
+void nmea_init(nmea_t *n);
+void nmea_sync(nmea_t *n);
+unsigned char nmea_put(nmea_t *n, unsigned char c, unsigned long now);
+unsigned long nmea_fix_age(nmea_t *n, unsigned long now);
+
+#endif /* NMEA_H_ */
@@ -0,0 +1,81 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+#include "ring.h"
+
+#define CR  0X0D
+#define LF  0X0A
+
+void ring_init(ring_t *r, unsigned char *storage, unsigned char size) {
+	r->buf = storage;
+	r->mask = size - 1;
+	r->head = 0;
+	r->tail = 0;
+	r->overflow = 0;
+}
+
+/* Gives next received byte. Returns 1 if a byte was available, 0 if ring is empty. */
+unsigned char ring_get(ring_t *r, unsigned char *c) {
+	unsigned char tail;
+	tail = r->tail;
+	if(tail == r->head)
+		return 0;
+	*c = r->buf[tail];
+	r->tail = (tail + 1) & r->mask;
+	return 1;
+}
+
+/* Number of bytes waiting to be consumed. */
+unsigned char ring_count(ring_t *r) {
+	return (r->head - r->tail) & r->mask;
+}
+
+/* Discard everything received so far. Only consumer calls this, so only tail is moved. */
+void ring_flush(ring_t *r) {
+	r->tail = r->head;
+}
+
+void line_init(line_t *l, unsigned char *storage, unsigned char size) {
+	l->buf = storage;
+	l->size = size;
+	l->len = 0;
+	l->done = 0;
+	l->truncated = 0;
+	l->buf[0] = 0;
+}
+
+/* Add one byte to line being assembled. Returns 1 when LF completes the line; line stays in 
+ * buffer until next byte is added. Empty lines are not reported. */
+unsigned char line_put(line_t *l, unsigned char c) {
+	if(l->done == 1) {
+		l->len = 0;
+		l->done = 0;
+		l->truncated = 0;
+	}
+	if(c == LF) {
+		if(l->len == 0)
+			return 0;
+		l->buf[l->len] = 0;
+		l->done = 1;
+		return 1;
+	}
+	if(c == CR)
+		return 0;
+	if(l->len < (l->size - 1)) {
+		l->buf[l->len] = c;
+		l->len++;
+	}else {
+		l->truncated = 1;
+	}
+	return 0;
+}
@@ -0,0 +1,62 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * Single producer single consumer byte ring buffers. The producer is UART receive ISR and the 
+ * consumer is main loop. Head is written only by ISR and tail only by main loop; both are 8 bit 
+ * so reads/writes are atomic on PIC18 and no interrupt masking is needed. Size must be a power 
+ * of 2 not larger than 128. One slot is kept free to tell full from empty.
+ * 
+ * When ring is full, newly received byte is dropped and counted in overflow (saturates at 255).
+ */
+
+#ifndef RING_H_
+#define RING_H_
+
+typedef struct {
+	unsigned char *buf;
+	unsigned char mask;
+	volatile unsigned char head;
+	volatile unsigned char tail;
+	volatile unsigned char overflow;
+} ring_t;
+
+/* Assemble bytes into CR/LF terminated lines incrementally. Completed line is nul terminated 
+ * with CR and LF stripped; characters beyond storage size are dropped and truncated is set. */
+typedef struct {
+	unsigned char *buf;
+	unsigned char size;
+	unsigned char len;
+	unsigned char done;
+	unsigned char truncated;
+} line_t;
+
+/* Used from ISR; macro so that no function is called from interrupt context (C18 would then 
+ * need to save .tmpdata section). */
+#define RING_PUT_ISR(r, c)                                        \
+	if((((r).head + 1) & (r).mask) != (r).tail) {                 \
+		(r).buf[(r).head] = (c);                                  \
+		(r).head = ((r).head + 1) & (r).mask;                     \
+	}else if((r).overflow != 0xFF) {                              \
+		(r).overflow++;                                           \
+	}
+
+void ring_init(ring_t *r, unsigned char *storage, unsigned char size);
+unsigned char ring_get(ring_t *r, unsigned char *c);
+unsigned char ring_count(ring_t *r);
+void ring_flush(ring_t *r);
+
+void line_init(line_t *l, unsigned char *storage, unsigned char size);
+unsigned char line_put(line_t *l, unsigned char c);
+
+#endif /* RING_H_ */
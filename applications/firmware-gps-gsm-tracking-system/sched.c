@@ -0,0 +1,70 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+#include "hal.h"
+#include "sched.h"
+
+volatile unsigned char sched_events;
+unsigned long sched_busy;
+unsigned long sched_idle;
+
+static task_t *task_list;
+static unsigned char task_count;
+
+void sched_init(task_t *tasks, unsigned char count) {
+	unsigned char i;
+	task_list = tasks;
+	task_count = count;
+	for(i=0; i<count; i++) {
+		tasks[i].due = tasks[i].period;
+		tasks[i].runs = 0;
+	}
+	sched_events = 0;
+	sched_busy = 0;
+	sched_idle = 0;
+}
+
+/* One pass: run every task whose event was posted or whose period elapsed, then sleep if no new 
+ * event was posted meanwhile. Events are checked with interrupts disabled; a pending interrupt 
+ * still wakes CPU from IDLE and is serviced as soon as interrupts are enabled again, so no event 
+ * is missed. */
+void sched_run(unsigned long now) {
+	unsigned char ev, i, ran;
+	task_t *t;
+
+	HAL_IRQ_OFF();
+	ev = sched_events;
+	sched_events = 0;
+	HAL_IRQ_ON();
+
+	ran = 0;
+	for(i=0; i<task_count; i++) {
+		t = &task_list[i];
+		if((t->events & ev) != 0 || (t->period != 0 && (long)(now - t->due) >= 0)) {
+			if(t->period != 0)
+				t->due = now + t->period;
+			t->run(now);
+			t->runs++;
+			ran = 1;
+		}
+	}
+	if(ran == 1)
+		sched_busy++;
+
+	HAL_IRQ_OFF();
+	if(sched_events == 0) {
+		sched_idle++;
+		HAL_IDLE();
+	}
+	HAL_IRQ_ON();
+}
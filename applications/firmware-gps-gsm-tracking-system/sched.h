@@ -0,0 +1,50 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* 
+ * Run-to-completion cooperative scheduler. ISR only posts event flags; every task is a function 
+ * which does its work for the events/time it was woken for and returns without waiting. When no 
+ * task is ready, CPU is put in IDLE mode until next interrupt (Timer0 tick or UART byte).
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+/* Event flags posted from ISR */
+#define EV_TICK      0x01    // Timer0 millisecond tick
+#define EV_GSM_RX    0x02    // byte put in GSM ring
+#define EV_GPS_RX    0x04    // byte put in GPS ring
+
+typedef void (*task_fn_t)(unsigned long now);
+
+typedef struct {
+	task_fn_t run;
+	unsigned char events;    // run when any of these events is posted
+	unsigned int period;     // and/or every period ms, 0 if not periodic
+	unsigned long due;
+	unsigned long runs;
+} task_t;
+
+extern volatile unsigned char sched_events;
+
+/* Called from ISR only; sched_events is cleared by scheduler with interrupts disabled */
+#define SCHED_POST_ISR(ev)  sched_events |= (ev)
+
+/* passes in which at least one task ran / passes which ended in IDLE */
+extern unsigned long sched_busy;
+extern unsigned long sched_idle;
+
+void sched_init(task_t *tasks, unsigned char count);
+void sched_run(unsigned long now);
+
+#endif /* SCHED_H_ */
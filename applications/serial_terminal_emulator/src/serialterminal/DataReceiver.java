@@ -0,0 +1,51 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package serialterminal;
+
+import javax.swing.JTextField;
+import javax.swing.SwingUtilities;
+
+import com.serialpundit.serial.ISerialComDataListener;
+
+/*
+ * Called from looper thread of serial port with every chunk read by native layer. Only stores data in 
+ * scrollback buffer, formatting and display is done by DisplayUpdater so that this thread keeps up 
+ * with line rate.
+ */
+public final class DataReceiver implements ISerialComDataListener {
+
+    private final ScrollbackBuffer scrollback;
+    private final JTextField status;
+
+    public DataReceiver(ScrollbackBuffer scrollback, JTextField status) {
+        this.scrollback = scrollback;
+        this.status = status;
+    }
+
+    @Override
+    public void onNewSerialDataAvailable(byte[] data) {
+        scrollback.write(data);
+    }
+
+    @Override
+    public void onDataListenerError(final int errorNum) {
+        SwingUtilities.invokeLater(new Runnable() {
+            @Override
+            public void run() {
+                status.setText("");
+                status.setText("Data listener error : " + errorNum);
+            }
+        });
+    }
+}
@@ -0,0 +1,179 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package serialterminal;
+
+import javax.swing.JTextArea;
+import javax.swing.JTextField;
+import javax.swing.SwingUtilities;
+import javax.swing.text.BadLocationException;
+import javax.swing.text.Document;
+
+import com.serialpundit.core.util.SerialComUtil;
+
+/*
+ * Takes new data from scrollback buffer at about display refresh rate, formats it (text or hex) in 
+ * this thread and hands the result to event dispatch thread. At most one update is pending on event 
+ * dispatch thread at a time; data arriving meanwhile is appended to it, so a busy GUI never builds 
+ * up a backlog. Text shown is bounded, oldest characters are removed from the text area.
+ */
+public final class DisplayUpdater implements Runnable {
+
+    private static final long REFRESH_INTERVAL = 16;
+    private static final long STATUS_INTERVAL = 1000;
+    private static final int MAX_DISPLAY_CHARS = 64 * 1024;
+
+    private final ScrollbackBuffer scrollback;
+    private final JTextArea text;
+    private final JTextField status;
+    private final SignalExit exitTrigger;
+    private volatile boolean displayInHex;
+    private volatile boolean redraw;
+
+    // guarded by lock
+    private final Object lock = new Object();
+    private final StringBuilder pending = new StringBuilder();
+    private boolean replace;
+    private boolean queued;
+
+    private final Runnable flush = new Runnable() {
+        @Override
+        public void run() {
+            String str;
+            boolean replaceText;
+            synchronized(lock) {
+                str = pending.toString();
+                replaceText = replace;
+                pending.setLength(0);
+                replace = false;
+                queued = false;
+            }
+            if(replaceText == true) {
+                text.setText(str);
+            }else {
+                text.append(str);
+            }
+            Document doc = text.getDocument();
+            int excess = doc.getLength() - MAX_DISPLAY_CHARS;
+            if(excess > 0) {
+                try {
+                    doc.remove(0, excess);
+                } catch (BadLocationException e) {
+                }
+            }
+            text.setCaretPosition(doc.getLength());
+        }
+    };
+
+    public DisplayUpdater(ScrollbackBuffer scrollback, JTextArea text, JTextField status, 
+            boolean displayInHex, SignalExit exitTrigger) {
+        this.scrollback = scrollback;
+        this.text = text;
+        this.status = status;
+        this.displayInHex = displayInHex;
+        this.exitTrigger = exitTrigger;
+    }
+
+    /* Shows whole scrollback again in new format */
+    public void setDisplayInHex(boolean enabled) {
+        displayInHex = enabled;
+        redraw = true;
+    }
+
+    public void clear() {
+        scrollback.clear();
+        synchronized(lock) {
+            pending.setLength(0);
+            replace = true;
+            if(queued == false) {
+                queued = true;
+                SwingUtilities.invokeLater(flush);
+            }
+        }
+    }
+
+    @Override
+    public void run() {
+        long lastStatusTime = System.currentTimeMillis();
+        long lastCount = scrollback.getWrittenCount();
+
+        while(exitTrigger.isExitTriggered() == false) {
+            try {
+                Thread.sleep(REFRESH_INTERVAL);
+            } catch (InterruptedException e) {
+                if(exitTrigger.isExitTriggered() == true) {
+                    return;
+                }
+            }
+
+            byte[] data;
+            boolean replaceText = redraw;
+            if(replaceText == true) {
+                redraw = false;
+                data = scrollback.readAll();
+            }else {
+                data = scrollback.readNew();
+            }
+            if((data.length > 0) || (replaceText == true)) {
+                post(format(data), replaceText);
+            }
+
+            long now = System.currentTimeMillis();
+            if((now - lastStatusTime) >= STATUS_INTERVAL) {
+                long count = scrollback.getWrittenCount();
+                postStatus("Received " + count + " bytes, " + ((count - lastCount) * 1000 / (now - lastStatusTime)) + 
+                        " bytes/second, " + scrollback.getDroppedCount() + " bytes not displayed");
+                lastCount = count;
+                lastStatusTime = now;
+            }
+        }
+    }
+
+    private String format(byte[] data) {
+        if(data.length == 0) {
+            return "";
+        }
+        if(displayInHex == true) {
+            return SerialComUtil.byteArrayToHexString(data, " ") + " ";
+        }
+        return new String(data);
+    }
+
+    private void post(String str, boolean replaceText) {
+        synchronized(lock) {
+            if(replaceText == true) {
+                pending.setLength(0);
+                replace = true;
+            }
+            pending.append(str);
+            if(pending.length() > MAX_DISPLAY_CHARS) {
+                // would be removed from text area anyway
+                pending.delete(0, pending.length() - MAX_DISPLAY_CHARS);
+                replace = true;
+            }
+            if(queued == false) {
+                queued = true;
+                SwingUtilities.invokeLater(flush);
+            }
+        }
+    }
+
+    private void postStatus(final String str) {
+        SwingUtilities.invokeLater(new Runnable() {
+            @Override
+            public void run() {
+                status.setText(str);
+            }
+        });
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package serialterminal;
+
+/*
+ * Keeps last received bytes so that they can be shown again (for ex; when display is switched 
+ * between text and hex). When full, oldest bytes are overwritten. Written by data listener thread 
+ * and read by display updater thread.
+ */
+public final class ScrollbackBuffer {
+
+    private final byte[] buffer;
+    private long written;      // total bytes written since creation
+    private long oldest;       // position of oldest byte still in buffer
+    private long readPosition; // position up to which display has taken data
+    private long dropped;      // bytes overwritten before display could take them
+
+    public ScrollbackBuffer(int capacity) {
+        buffer = new byte[capacity];
+    }
+
+    public synchronized void write(byte[] data) {
+        int length = data.length;
+        int offset = 0;
+        if(length > buffer.length) {
+            offset = length - buffer.length;
+            length = buffer.length;
+        }
+        int index = (int) ((written + offset) % buffer.length);
+        int first = Math.min(length, buffer.length - index);
+        System.arraycopy(data, offset, buffer, index, first);
+        if(first < length) {
+            System.arraycopy(data, offset + first, buffer, 0, length - first);
+        }
+        written = written + data.length;
+        if(written - oldest > buffer.length) {
+            oldest = written - buffer.length;
+        }
+        if(readPosition < oldest) {
+            dropped = dropped + (oldest - readPosition);
+            readPosition = oldest;
+        }
+    }
+
+    /* Bytes received since last call to readNew() or readAll() */
+    public synchronized byte[] readNew() {
+        byte[] data = copy(readPosition);
+        readPosition = written;
+        return data;
+    }
+
+    /* Every byte still in scrollback */
+    public synchronized byte[] readAll() {
+        byte[] data = copy(oldest);
+        readPosition = written;
+        return data;
+    }
+
+    public synchronized void clear() {
+        oldest = written;
+        readPosition = written;
+    }
+
+    public synchronized long getWrittenCount() {
+        return written;
+    }
+
+    public synchronized long getDroppedCount() {
+        return dropped;
+    }
+
+    private byte[] copy(long from) {
+        byte[] data = new byte[(int) (written - from)];
+        int index = (int) (from % buffer.length);
+        int first = Math.min(data.length, buffer.length - index);
+        System.arraycopy(buffer, index, data, 0, first);
+        if(first < data.length) {
+            System.arraycopy(buffer, 0, data, first, data.length - first);
+        }
+        return data;
+    }
+}
@@ -37,7 +37,9 @@ import javax.swing.JFrame;
 import javax.swing.JLabel;
 import javax.swing.JMenuBar;
 import javax.swing.JRadioButton;
+import javax.swing.JScrollPane;
 import javax.swing.JTabbedPane;
+import javax.swing.JTextArea;
 import javax.swing.JTextField;
 import javax.swing.SwingUtilities;
 import javax.swing.UIManager;
@@ -57,9 +59,13 @@ public class SerialTerminalApp extends JFrame {
 
     private static final long serialVersionUID = -3067979562931264507L;
 
+    private static final int SCROLLBACK_SIZE = 64 * 1024;
+
     private static SerialComManager scm;
-    private Thread mDataReceiverThread;
-    private DataPoller dataPoller;
+    private Thread mDisplayUpdaterThread;
+    private ScrollbackBuffer scrollback;
+    private DataReceiver dataReceiver;
+    private DisplayUpdater displayUpdater;
     private SignalExit exitTrigger;
 
     private static String[] comPortsFound;
@@ -79,7 +85,7 @@ public class SerialTerminalApp extends JFrame {
 
     // receive
     private JPanel rcvDataPanel;
-    private JTextField datarcvtextfield;
+    private JTextArea datarcvtextarea;
     private Checkbox hexDisplay;
     private boolean displayInHex;
     private JButton clrDataButton;
@@ -155,7 +161,7 @@ public class SerialTerminalApp extends JFrame {
         }
 
         frame = new JFrame();
-        frame.setSize(670, 520);
+        frame.setSize(670, 590);
         frame.setResizable(false);
         frame.setTitle("Serial terminal emulator");
         frame.getContentPane().setLayout(new BorderLayout(0,0));
@@ -183,18 +189,24 @@ public class SerialTerminalApp extends JFrame {
 
         /* ~~~ DATA RECEIVE BLOCK ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
         rcvDataPanel = new JPanel(new FlowLayout(FlowLayout.LEFT, 0, 15));
-        datarcvtextfield = new JTextField();
-        datarcvtextfield.setPreferredSize(new Dimension(520, 40));
-        datarcvtextfield.setBackground(Color.WHITE);
-        datarcvtextfield.setForeground(Color.BLACK);
-        datarcvtextfield.setEditable(false);
-        rcvDataPanel.add(datarcvtextfield);
+        datarcvtextarea = new JTextArea();
+        datarcvtextarea.setBackground(Color.WHITE);
+        datarcvtextarea.setForeground(Color.BLACK);
+        datarcvtextarea.setEditable(false);
+        datarcvtextarea.setLineWrap(true);
+        JScrollPane datarcvScrollPane = new JScrollPane(datarcvtextarea);
+        datarcvScrollPane.setPreferredSize(new Dimension(520, 110));
+        rcvDataPanel.add(datarcvScrollPane);
         rcvDataPanel.add(new JLabel("  "));
 
         clrDataButton = new JButton("Clear data");
         clrDataButton.addActionListener(new ActionListener() {
             public void actionPerformed(ActionEvent e) {
-                datarcvtextfield.setText("");
+                if(displayUpdater != null) {
+                    displayUpdater.clear();
+                }else {
+                    datarcvtextarea.setText("");
+                }
             }          
         });
         rcvDataPanel.add(clrDataButton);
@@ -205,13 +217,13 @@ public class SerialTerminalApp extends JFrame {
             public void itemStateChanged(ItemEvent e) {
                 if(e.getStateChange() == 1) {
                     displayInHex = true;
-                    if(dataPoller != null) {
-                        dataPoller.setDisplayInHex(true);
+                    if(displayUpdater != null) {
+                        displayUpdater.setDisplayInHex(true);
                     }
                 }else {
                     displayInHex = false;
-                    if(dataPoller != null) {
-                        dataPoller.setDisplayInHex(false);
+                    if(displayUpdater != null) {
+                        displayUpdater.setDisplayInHex(false);
                     }
                 }
             }
@@ -432,10 +444,14 @@ public class SerialTerminalApp extends JFrame {
                     }
                     scm.configureComPortControl(comPortHandle, flowcontrol, xon, xoff, false, false);
 
+                    // listener only stores data, display is updated at screen refresh rate by another thread
                     exitTrigger = new SignalExit(false);
-                    dataPoller = new DataPoller(scm, datarcvtextfield, comPortHandle, datarcvtextfield, displayInHex, exitTrigger);
-                    mDataReceiverThread = new Thread(dataPoller, "SCM DataPoller");
-                    mDataReceiverThread.start();
+                    scrollback = new ScrollbackBuffer(SCROLLBACK_SIZE);
+                    dataReceiver = new DataReceiver(scrollback, programStatusText);
+                    displayUpdater = new DisplayUpdater(scrollback, datarcvtextarea, programStatusText, displayInHex, exitTrigger);
+                    scm.registerDataListener(comPortHandle, dataReceiver);
+                    mDisplayUpdaterThread = new Thread(displayUpdater, "SCM DisplayUpdater");
+                    mDisplayUpdaterThread.start();
 
                     programStatusText.setText("");
                     programStatusText.setText("Port opened and configured. Reading data from port started !");
@@ -451,10 +467,7 @@ public class SerialTerminalApp extends JFrame {
             public void actionPerformed(ActionEvent e) {
                 try {
                     if(comPortHandle != -1) {
-                        if(mDataReceiverThread != null) {
-                            exitTrigger.setExitTrigger(true);
-                            mDataReceiverThread.interrupt();
-                        }
+                        stopReceiving();
                         scm.closeComPort(comPortHandle);
                         comPortHandle = -1;
                         programStatusText.setText("");
@@ -496,13 +509,23 @@ public class SerialTerminalApp extends JFrame {
         frame.setVisible(true);
     }
 
+    private void stopReceiving() throws SerialComException {
+        if(dataReceiver != null) {
+            scm.unregisterDataListener(comPortHandle, dataReceiver);
+            dataReceiver = null;
+        }
+        if(mDisplayUpdaterThread != null) {
+            exitTrigger.setExitTrigger(true);
+            mDisplayUpdaterThread.interrupt();
+            mDisplayUpdaterThread = null;
+            displayUpdater = null;
+        }
+    }
+
     public void triggerAppExit() {
         if(comPortHandle != -1) {
-            if(mDataReceiverThread != null) {
-                exitTrigger.setExitTrigger(true);
-                mDataReceiverThread.interrupt();
-            }
             try {
+                stopReceiving();
                 scm.closeComPort(comPortHandle);
             } catch (SerialComException e) {
                 e.printStackTrace();
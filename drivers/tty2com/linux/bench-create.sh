@@ -0,0 +1,50 @@
+#!/bin/bash
+#
+# This file is part of SerialPundit.
+# 
+# Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+#
+# The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+# General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+# license for commercial use of this software. 
+#
+# The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#################################################################################################
+
+# Creates N standard null modem pairs through /dev/ttyvs_card with udevd running and reports
+# time taken until udev has processed all add events. Run as root with ttyvs module loaded.
+# Compare with a RUN+ rule in /etc/udev/rules.d to see the cost of per device forks.
+# $ ./bench-create.sh 2000
+
+if [[ $EUID -ne 0 ]]; then
+   echo "This script must be run as root user !" 1>&2
+   exit 1
+fi
+
+if [ ! -c /dev/ttyvs_card ]; then
+   echo "Driver ttyvs is not loaded !" 1>&2
+   exit 1
+fi
+
+pairs=${1:-1000}
+delall="delnm#xxxxx#xxxxx#7-8,x,x,x#4-1,6,x,x#7-8,x,x,x#4-1,6,x,x#y#y"
+
+udevadm settle
+
+start=$(date +%s%N)
+for ((i = 0; i < pairs; i++)); do
+    # 2 byte write creates a standard null modem pair
+    printf 'nm' > /dev/ttyvs_card || break
+done
+created=$(date +%s%N)
+udevadm settle --timeout=600
+settled=$(date +%s%N)
+
+echo "pairs created  : $i"
+echo "create time    : $(( (created - start) / 1000000 )) ms"
+echo "udev settle    : $(( (settled - created) / 1000000 )) ms"
+echo "total          : $(( (settled - start) / 1000000 )) ms"
+
+printf '%s' "$delall" > /dev/ttyvs_card
+udevadm settle
@@ -0,0 +1,59 @@
+#!/bin/bash
+#
+# This file is part of SerialPundit.
+# 
+# Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+#
+# The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+# General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+# license for commercial use of this software. 
+#
+# The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#################################################################################################
+
+# Compares two result files written by run_tests.sh (mean of all runs per driver, test and metric)
+# and exits with status 1 if any metric became worse than threshold percent (default 5).
+# $ ./compare.sh results/1a2b3c4.jsonl results/5d6e7f8.jsonl 5
+
+if [ $# -lt 2 ]; then
+    echo "usage: compare.sh base.jsonl new.jsonl [threshold-percent]" 1>&2
+    exit 1
+fi
+
+awk -v threshold="${3:-5}" '
+function field(line, key,    r) {
+    if (match(line, "\"" key "\":\"?[^,\"}]*")) {
+        r = substr(line, RSTART, RLENGTH)
+        sub("\"" key "\":\"?", "", r)
+        return r
+    }
+    return ""
+}
+{
+    key = field($0, "driver") " " field($0, "test") " " field($0, "metric")
+    f = (FILENAME == ARGV[1]) ? 0 : 1
+    sum[f, key] += field($0, "value")
+    cnt[f, key]++
+    higher[key] = (field($0, "higher_is_better") == "true")
+    keys[key] = 1
+}
+END {
+    bad = 0
+    printf "%-40s %14s %14s %9s\n", "driver test metric", "base", "new", "change"
+    for (key in keys) {
+        if (cnt[0, key] == 0 || cnt[1, key] == 0)
+            continue
+        a = sum[0, key] / cnt[0, key]
+        b = sum[1, key] / cnt[1, key]
+        change = (a != 0) ? ((b - a) * 100 / a) : 0
+        worse = higher[key] ? -change : change
+        mark = ""
+        if (worse > threshold) {
+            mark = " REGRESSION"
+            bad = 1
+        }
+        printf "%-40s %14.3f %14.3f %+8.1f%%%s\n", key, a, b, change, mark
+    }
+    exit bad
+}' "$1" "$2"
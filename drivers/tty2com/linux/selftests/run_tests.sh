@@ -0,0 +1,63 @@
+#!/bin/bash
+#
+# This file is part of SerialPundit.
+# 
+# Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+#
+# The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+# General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+# license for commercial use of this software. 
+#
+# The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#################################################################################################
+
+# Loads tty2com and ttyvs modules built in parent directory one by one, runs vtty_perf on each
+# and unloads them. Meant to be run as root inside a virtual machine (see run_vm.sh) so that
+# numbers from different commits are comparable. Results are appended as JSON lines to the given
+# file.
+# $ ./run_tests.sh -r 5 -o results.jsonl -c $(git rev-parse --short HEAD)
+
+cd "$(dirname "$0")"
+
+repeats=3
+out=""
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+args=""
+
+while getopts "r:o:c:a:" opt; do
+    case $opt in
+        r) repeats=$OPTARG ;;
+        o) out=$OPTARG ;;
+        c) commit=$OPTARG ;;
+        a) args=$OPTARG ;;
+        *) echo "usage: run_tests.sh [-r repeats] [-o results.jsonl] [-c commit] [-a vtty_perf args]" 1>&2; exit 1 ;;
+    esac
+done
+
+if [[ $EUID -ne 0 ]]; then
+   echo "This script must be run as root user !" 1>&2
+   exit 4
+fi
+
+[ -x ./vtty_perf ] || make
+
+jsonarg=""
+[ -n "$out" ] && jsonarg="-j $out"
+
+rc=0
+for drv in tty2com ttyvs; do
+    rmmod $drv &>/dev/null
+    if ! insmod ../$drv.ko; then
+        echo "# can not load ../$drv.ko"
+        rc=1
+        continue
+    fi
+    for ((i = 1; i <= repeats; i++)); do
+        echo "# $drv run $i of $repeats"
+        ./vtty_perf -d $drv -c "$commit" $jsonarg $args || rc=1
+    done
+    rmmod $drv
+done
+
+exit $rc
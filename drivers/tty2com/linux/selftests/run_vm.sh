@@ -0,0 +1,69 @@
+#!/bin/bash
+#
+# This file is part of SerialPundit.
+# 
+# Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+#
+# The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+# General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+# license for commercial use of this software. 
+#
+# The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#################################################################################################
+
+# Boots the given kernel in a QEMU virtual machine through virtme-ng (vng), builds both drivers
+# against it and runs run_tests.sh inside. Host file system is shared read-only, results are written
+# to the output directory as <commit>.jsonl. Number of CPUs and memory are fixed so that runs on
+# different commits can be compared with compare.sh.
+# $ ./run_vm.sh -k ~/linux -r 5 -o results
+# $ ./compare.sh results/1a2b3c4.jsonl results/5d6e7f8.jsonl
+
+cd "$(dirname "$0")"
+set -e
+
+kdir=""
+repeats=3
+outdir="results"
+cpus=2
+memory=1G
+
+while getopts "k:r:o:p:m:" opt; do
+    case $opt in
+        k) kdir=$OPTARG ;;
+        r) repeats=$OPTARG ;;
+        o) outdir=$OPTARG ;;
+        p) cpus=$OPTARG ;;
+        m) memory=$OPTARG ;;
+        *) echo "usage: run_vm.sh -k kernel-build-dir [-r repeats] [-o outdir] [-p cpus] [-m memory]" 1>&2; exit 1 ;;
+    esac
+done
+
+if [ -z "$kdir" ]; then
+    echo "Kernel build directory (-k) is required !" 1>&2
+    exit 1
+fi
+
+if ! command -v vng &>/dev/null; then
+    echo "virtme-ng (vng) not found, install it with : pip install virtme-ng" 1>&2
+    exit 4
+fi
+
+commit=$(git rev-parse --short HEAD)
+if ! git diff --quiet HEAD -- ..; then
+    commit="$commit-dirty"
+fi
+
+make -C .. clean
+make -C .. KERNELDIR="$(realpath "$kdir")"
+make clean all
+
+mkdir -p "$outdir"
+outdir=$(realpath "$outdir")
+results="$outdir/$commit.jsonl"
+: > "$results"
+
+vng --run "$kdir" --cpus "$cpus" --memory "$memory" --user root --rwdir "$outdir" \
+    --exec "$PWD/run_tests.sh -r $repeats -o $results -c $commit"
+
+echo "Results : $results"
@@ -0,0 +1,542 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Performance tests for tty2com and ttyvs virtual tty drivers
+ *
+ * Copyright (c) 2020, Rishi Gupta <gupt21@gmail.com>
+ *
+ * Creates a standard null modem pair through driver's control node
+ * and runs throughput, round trip latency, modem line toggle, termios
+ * change and (ttyvs only) receive batching workloads on it. Result is printed in KTAP format
+ * and optionally appended as JSON lines (one object per metric) so
+ * that runs on different commits can be compared by compare.sh.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/utsname.h>
+
+#define KSFT_PASS	0
+#define KSFT_FAIL	1
+#define KSFT_SKIP	4
+
+#define CMD_LEN		61
+#define INFO_LEN	52
+#define CHUNK		4096
+#define PING_LEN	16
+#define IO_TIMEOUT_MS	5000
+#define BATCH_PACKET	64
+#define BATCH_FLUSH_US	2000
+#define BATCH_ROUNDS	200
+
+struct vtty_driver {
+	const char *name;
+	const char *control;
+	const char *prefix;
+};
+
+static const struct vtty_driver drivers[] = {
+	{ "tty2com", "/proc/sp_vmpscrdk", "/dev/tty2com" },
+	{ "ttyvs", "/dev/ttyvs_card", "/dev/ttyvs" },
+};
+
+static const struct vtty_driver *drv;
+static char node[2][64];
+static int fds[2] = { -1, -1 };
+static FILE *json;
+static const char *commit = "unknown";
+static struct utsname uts;
+static int test_num;
+static int failed;
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void result(const char *test, const char *metric, double value,
+		int higher_is_better)
+{
+	printf("# %s %s %.3f\n", test, metric, value);
+	if (json == NULL)
+		return;
+	fprintf(json, "{\"commit\":\"%s\",\"kernel\":\"%s\",\"driver\":\"%s\","
+		"\"test\":\"%s\",\"metric\":\"%s\",\"value\":%.3f,"
+		"\"higher_is_better\":%s}\n", commit, uts.release, drv->name,
+		test, metric, value, higher_is_better ? "true" : "false");
+}
+
+static void test_result(int ok, const char *test)
+{
+	test_num++;
+	printf("%s %d %s\n", ok ? "ok" : "not ok", test_num, test);
+	if (!ok)
+		failed = 1;
+}
+
+static int control_write(const char *cmd)
+{
+	int fd, ret = 0;
+
+	fd = open(drv->control, O_WRONLY);
+	if (fd < 0)
+		return -errno;
+	if (write(fd, cmd, CMD_LEN) != CMD_LEN)
+		ret = -errno;
+	close(fd);
+	return ret;
+}
+
+/*
+ * Free indexes are read from control node and then given explicitly
+ * in the create command so that we know which nodes were created.
+ */
+static int create_pair(int *a, int *b)
+{
+	char info[INFO_LEN + 1], cmd[CMD_LEN + 1];
+	int fd, ret;
+
+	fd = open(drv->control, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	ret = read(fd, info, INFO_LEN);
+	close(fd);
+	if (ret != INFO_LEN)
+		return -EIO;
+	info[INFO_LEN] = '\0';
+	*a = atoi(&info[18]);
+	*b = atoi(&info[24]);
+	if (*a < 0 || *b < 0)
+		return -ENOSPC;
+
+	snprintf(cmd, sizeof(cmd),
+		"gennm#%05d#%05d#7-8,x,x,x#4-1,6,x,x#7-8,x,x,x#4-1,6,x,x#y#y",
+		*a, *b);
+	return control_write(cmd);
+}
+
+static void delete_pair(int a)
+{
+	char cmd[CMD_LEN + 1];
+
+	memset(cmd, 'x', CMD_LEN);
+	cmd[CMD_LEN] = '\0';
+	snprintf(cmd, 10, "del#%05d", a);
+	cmd[9] = 'x';
+	control_write(cmd);
+}
+
+static int open_raw(const char *name, speed_t speed)
+{
+	struct termios tio;
+	int fd, i;
+
+	/* node may not exist yet if udev is still creating it */
+	for (i = 0; i < 500; i++) {
+		fd = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+		if (fd >= 0 || errno != ENOENT)
+			break;
+		usleep(10000);
+	}
+	if (fd < 0)
+		return -1;
+
+	tcgetattr(fd, &tio);
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	tcsetattr(fd, TCSANOW, &tio);
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+}
+
+static int wait_fd(int fd, short events)
+{
+	struct pollfd pfd = { .fd = fd, .events = events };
+
+	return poll(&pfd, 1, IO_TIMEOUT_MS);
+}
+
+static int xfer(int fd, unsigned char *buf, int len, int out)
+{
+	int done = 0;
+	ssize_t ret;
+
+	while (done < len) {
+		if (wait_fd(fd, out ? POLLOUT : POLLIN) <= 0)
+			return -1;
+		if (out)
+			ret = write(fd, buf + done, len - done);
+		else
+			ret = read(fd, buf + done, len - done);
+		if (ret > 0)
+			done += ret;
+		else if (ret < 0 && errno != EAGAIN && errno != EINTR)
+			return -1;
+	}
+	return 0;
+}
+
+struct worker {
+	int fd;
+	int count;
+	int len;
+	int pipefd;
+};
+
+static void *writer(void *arg)
+{
+	struct worker *w = arg;
+	unsigned char buf[CHUNK];
+	int sent, len;
+
+	memset(buf, 0x5a, sizeof(buf));
+	for (sent = 0; sent < w->count; sent += len) {
+		len = (w->count - sent) < CHUNK ? (w->count - sent) : CHUNK;
+		if (xfer(w->fd, buf, len, 1) < 0)
+			break;
+	}
+	return NULL;
+}
+
+static void *echo(void *arg)
+{
+	struct worker *w = arg;
+	unsigned char buf[PING_LEN];
+	int i;
+
+	for (i = 0; i < w->count; i++) {
+		if (xfer(w->fd, buf, w->len, 0) || xfer(w->fd, buf, w->len, 1))
+			break;
+	}
+	return NULL;
+}
+
+/* Waits for DSR change caused by peer's DTR and reports it on pipe. */
+static void *modem_waiter(void *arg)
+{
+	struct worker *w = arg;
+	char c = 1;
+	int i;
+
+	for (i = 0; i < w->count; i++) {
+		if (ioctl(w->fd, TIOCMIWAIT, TIOCM_DSR) < 0)
+			break;
+		if (write(w->pipefd, &c, 1) != 1)
+			break;
+	}
+	return NULL;
+}
+
+static void test_throughput(int bytes)
+{
+	struct worker w = { .fd = fds[0], .count = bytes };
+	unsigned char buf[CHUNK];
+	long long start, elapsed;
+	pthread_t tid;
+	int got = 0;
+	ssize_t ret;
+
+	start = now_ns();
+	pthread_create(&tid, NULL, writer, &w);
+	while (got < bytes) {
+		if (wait_fd(fds[1], POLLIN) <= 0)
+			break;
+		ret = read(fds[1], buf, sizeof(buf));
+		if (ret > 0)
+			got += ret;
+	}
+	elapsed = now_ns() - start;
+	pthread_join(tid, NULL);
+
+	if (got == bytes)
+		result("throughput", "MBps", (bytes / 1048576.0) / (elapsed / 1e9), 1);
+	else
+		printf("# received %d of %d bytes\n", got, bytes);
+	test_result(got == bytes, "throughput");
+}
+
+static void test_latency(int rounds)
+{
+	struct worker w = { .fd = fds[1], .count = rounds, .len = PING_LEN };
+	unsigned char ping[PING_LEN];
+	long long *rtt, start;
+	pthread_t tid;
+	int i;
+
+	rtt = calloc(rounds, sizeof(*rtt));
+	if (rtt == NULL) {
+		test_result(0, "latency");
+		return;
+	}
+	memset(ping, 0xa5, sizeof(ping));
+	pthread_create(&tid, NULL, echo, &w);
+	for (i = 0; i < rounds; i++) {
+		start = now_ns();
+		if (xfer(fds[0], ping, PING_LEN, 1) || xfer(fds[0], ping, PING_LEN, 0))
+			break;
+		rtt[i] = now_ns() - start;
+	}
+	pthread_join(tid, NULL);
+
+	if (i == rounds) {
+		qsort(rtt, rounds, sizeof(*rtt), cmp_ll);
+		result("latency", "rtt_p50_us", rtt[rounds / 2] / 1000.0, 0);
+		result("latency", "rtt_p99_us", rtt[(rounds * 99) / 100] / 1000.0, 0);
+	}
+	free(rtt);
+	test_result(i == rounds, "latency");
+}
+
+static void test_modem_toggle(int toggles)
+{
+	struct worker w = { .fd = fds[1], .count = toggles };
+	int pfd[2], bits = TIOCM_DTR, i;
+	long long *lat, start, total;
+	pthread_t tid;
+	char c;
+
+	lat = calloc(toggles, sizeof(*lat));
+	if (lat == NULL || pipe(pfd) < 0) {
+		free(lat);
+		test_result(0, "modem_toggle");
+		return;
+	}
+	w.pipefd = pfd[1];
+	pthread_create(&tid, NULL, modem_waiter, &w);
+	/* give waiter time to block in TIOCMIWAIT before first toggle */
+	usleep(10000);
+
+	total = now_ns();
+	for (i = 0; i < toggles; i++) {
+		start = now_ns();
+		if (ioctl(fds[0], (i & 1) ? TIOCMBIS : TIOCMBIC, &bits) < 0)
+			break;
+		if (wait_fd(pfd[0], POLLIN) <= 0 || read(pfd[0], &c, 1) != 1)
+			break;
+		lat[i] = now_ns() - start;
+	}
+	total = now_ns() - total;
+	if (i < toggles)
+		pthread_cancel(tid);
+	pthread_join(tid, NULL);
+	close(pfd[0]);
+	close(pfd[1]);
+
+	if (i == toggles) {
+		qsort(lat, toggles, sizeof(*lat), cmp_ll);
+		result("modem_toggle", "ops_per_s", toggles / (total / 1e9), 1);
+		result("modem_toggle", "p50_us", lat[toggles / 2] / 1000.0, 0);
+	}
+	free(lat);
+	test_result(i == toggles, "modem_toggle");
+}
+
+static void test_termios_change(int changes)
+{
+	static const speed_t speeds[] = { B9600, B115200, B460800, B921600 };
+	struct termios tio;
+	long long start;
+	int i, j;
+
+	start = now_ns();
+	for (i = 0; i < changes; i++) {
+		/* both ends changed, ttyvs drops data on mismatched settings */
+		for (j = 0; j < 2; j++) {
+			if (tcgetattr(fds[j], &tio) < 0)
+				break;
+			cfsetispeed(&tio, speeds[i & 3]);
+			cfsetospeed(&tio, speeds[i & 3]);
+			if (tcsetattr(fds[j], TCSANOW, &tio) < 0)
+				break;
+		}
+		if (j < 2)
+			break;
+	}
+
+	if (i == changes)
+		result("termios_change", "ops_per_s",
+			(changes * 2) / ((now_ns() - start) / 1e9), 1);
+	test_result(i == changes, "termios_change");
+}
+
+/* one way delivery time of len bytes from 1st to 2nd end, sorted */
+static int one_way(long long *lat, int rounds, int len)
+{
+	unsigned char buf[BATCH_PACKET];
+	long long start;
+	int i;
+
+	memset(buf, 0x5a, sizeof(buf));
+	for (i = 0; i < rounds; i++) {
+		start = now_ns();
+		if (xfer(fds[0], buf, len, 1) || xfer(fds[1], buf, len, 0))
+			return -1;
+		lat[i] = now_ns() - start;
+	}
+	qsort(lat, rounds, sizeof(*lat), cmp_ll);
+	return 0;
+}
+
+/*
+ * With receive batching set on 2nd end, a short message must wait for
+ * flush timer while a full packet must be delivered at once.
+ */
+static void test_rx_batch(void)
+{
+	long long short_lat[BATCH_ROUNDS], full_lat[BATCH_ROUNDS];
+	char path[128], cfg[32];
+	double short_p50, full_p50;
+	int fd, ok;
+
+	if (strcmp(drv->name, "ttyvs") != 0) {
+		printf("ok %d rx_batch # SKIP ttyvs only\n", ++test_num);
+		return;
+	}
+
+	snprintf(path, sizeof(path), "/sys/class/tty/%s/rxbatch",
+		strrchr(node[1], '/') + 1);
+	snprintf(cfg, sizeof(cfg), "%d %d", BATCH_PACKET, BATCH_FLUSH_US);
+	fd = open(path, O_WRONLY);
+	if (fd < 0 || write(fd, cfg, strlen(cfg)) < 0) {
+		printf("# can not set %s : %s\n", path, strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		test_result(0, "rx_batch");
+		return;
+	}
+
+	ok = !one_way(short_lat, BATCH_ROUNDS, 8)
+		&& !one_way(full_lat, BATCH_ROUNDS, BATCH_PACKET);
+
+	if (write(fd, "0 0", 3) < 0)
+		printf("# can not reset %s : %s\n", path, strerror(errno));
+	close(fd);
+
+	if (ok) {
+		short_p50 = short_lat[BATCH_ROUNDS / 2] / 1000.0;
+		full_p50 = full_lat[BATCH_ROUNDS / 2] / 1000.0;
+		result("rx_batch", "short_p50_us", short_p50, 0);
+		result("rx_batch", "full_p50_us", full_p50, 0);
+		ok = (short_p50 >= BATCH_FLUSH_US * 0.9) && (full_p50 < BATCH_FLUSH_US);
+	}
+	test_result(ok, "rx_batch");
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: vtty_perf -d tty2com|ttyvs [-b bytes] [-n rounds] [-m toggles]\n"
+		"                 [-t changes] [-j results.jsonl] [-c commit]\n");
+	exit(KSFT_FAIL);
+}
+
+int main(int argc, char *argv[])
+{
+	int bytes = 64 * 1024 * 1024, rounds = 20000, toggles = 20000;
+	int changes = 20000, opt, a = -1, b = -1, ret;
+	const char *json_file = NULL;
+	unsigned int i;
+
+	while ((opt = getopt(argc, argv, "d:b:n:m:t:j:c:")) != -1) {
+		switch (opt) {
+		case 'd':
+			for (i = 0; i < sizeof(drivers) / sizeof(drivers[0]); i++)
+				if (strcmp(optarg, drivers[i].name) == 0)
+					drv = &drivers[i];
+			break;
+		case 'b':
+			bytes = atoi(optarg);
+			break;
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		case 'm':
+			toggles = atoi(optarg);
+			break;
+		case 't':
+			changes = atoi(optarg);
+			break;
+		case 'j':
+			json_file = optarg;
+			break;
+		case 'c':
+			commit = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (drv == NULL || bytes <= 0 || rounds <= 0 || toggles <= 0 || changes <= 0)
+		usage();
+
+	uname(&uts);
+	printf("TAP version 13\n");
+
+	if (access(drv->control, W_OK) != 0) {
+		printf("1..0 # SKIP %s not loaded (%s)\n", drv->name, drv->control);
+		return KSFT_SKIP;
+	}
+	printf("1..5\n");
+
+	ret = create_pair(&a, &b);
+	if (ret < 0) {
+		printf("# can not create pair : %s\n", strerror(-ret));
+		printf("Bail out!\n");
+		return KSFT_FAIL;
+	}
+	snprintf(node[0], sizeof(node[0]), "%s%d", drv->prefix, a);
+	snprintf(node[1], sizeof(node[1]), "%s%d", drv->prefix, b);
+	printf("# driver %s pair %s %s kernel %s\n", drv->name, node[0], node[1], uts.release);
+
+	fds[0] = open_raw(node[0], B115200);
+	fds[1] = open_raw(node[1], B115200);
+	if (fds[0] < 0 || fds[1] < 0) {
+		printf("# can not open pair : %s\n", strerror(errno));
+		printf("Bail out!\n");
+		delete_pair(a);
+		return KSFT_FAIL;
+	}
+
+	if (json_file) {
+		json = fopen(json_file, "a");
+		if (json == NULL)
+			printf("# can not open %s : %s\n", json_file, strerror(errno));
+	}
+
+	test_throughput(bytes);
+	tcflush(fds[0], TCIOFLUSH);
+	tcflush(fds[1], TCIOFLUSH);
+	test_latency(rounds);
+	test_modem_toggle(toggles);
+	test_termios_change(changes);
+	test_rx_batch();
+
+	close(fds[0]);
+	close(fds[1]);
+	delete_pair(a);
+	if (json)
+		fclose(json);
+
+	printf("# Totals: pass:%d fail:%d\n", test_num - failed, failed);
+	return failed ? KSFT_FAIL : KSFT_PASS;
+}
@@ -35,6 +35,11 @@
 #include <linux/mutex.h>
 #include <linux/device.h>
 #include <linux/miscdevice.h>
+#include <linux/sysfs.h>
+#include <linux/uidgid.h>
+#include <linux/spinlock.h>
+#include <linux/hrtimer.h>
+#include <linux/uaccess.h>
 
 /*
  * By default 128 devices can be created. This number can be
@@ -81,6 +86,30 @@
 #define VS_SLB 0x0003
 #define VS_CLB 0x0004
 
+/*
+ * USB-UART adapter personalities. A device carrying a personality
+ * exposes USB like attributes (idVendor, idProduct, serial and
+ * latency_timer) and has receive batching set up like the adapter.
+ * CP210x personality also implements GPIO ioctls.
+ */
+#define VS_PERS_NONE   0
+#define VS_PERS_FTDI   1
+#define VS_PERS_CP210X 2
+
+/* Payload of one full speed bulk IN packet (FTDI uses 2 status bytes) */
+#define VS_FTDI_PACKET   62
+#define VS_CP210X_PACKET 64
+
+/* Default latency timer of ftdi_sio driver in milliseconds */
+#define VS_FTDI_LATENCY  16
+
+/* Largest receive batch, bulk IN packet size of high speed adapters */
+#define VS_RX_PACKET_MAX 512
+
+/* GPIO ioctls, same numbers as handled by sp_cp210x driver */
+#define VS_IOCTL_GPIOGET 0x8000
+#define VS_IOCTL_GPIOSET 0x8001
+
 /* Represents a virtual tty device in this virtual card */
 struct vs_dev {
 	/* index for this device in tty core */
@@ -112,6 +141,24 @@ struct vs_dev {
 	struct serial_struct serial;
 	struct async_icount icount;
 	struct device *device;
+	/* usb-uart personality and its attributes */
+	int personality;
+	u16 id_vendor;
+	u16 id_product;
+	char usb_serial[32];
+	u8 gpio_latch;
+	/*
+	 * Receive batching; received data is staged and handed over to
+	 * tty core when rx_packet bytes have collected or rx_flush_us
+	 * has elapsed since first staged byte. rx_packet 0 disables it.
+	 */
+	spinlock_t rx_lock;
+	unsigned int rx_packet;
+	unsigned int rx_flush_us;
+	unsigned int rx_staged;
+	struct tty_port *rx_port;
+	struct hrtimer rx_timer;
+	unsigned char rx_stage[VS_RX_PACKET_MAX];
 };
 
 /*
@@ -143,6 +190,10 @@ static int minor_begin;
 static ushort max_num_vs_dev = DEFAULT_VS_DEV_MAX;
 static ushort init_num_nm_pair;
 static ushort init_num_lb_dev;
+static ushort attr_mode = 0220;
+static uint attr_gid;
+static uint rx_batch_packet;
+static uint rx_batch_flush_us;
 
 static ushort total_nm_pair;
 static ushort total_lb_devs;
@@ -150,6 +201,135 @@ static int last_lbdev_idx   = -1;
 static int last_nmdev1_idx  = -1;
 static int last_nmdev2_idx  = -1;
 
+/* Number of bytes the emulated adapter sends to host in one packet */
+static unsigned int vs_packet_size(struct vs_dev *vsdev)
+{
+	if (vsdev->personality == VS_PERS_FTDI)
+		return VS_FTDI_PACKET;
+
+	return VS_CP210X_PACKET;
+}
+
+/*
+ * Hands data staged for the given device over to tty core. Caller
+ * holds rx_lock of the device.
+ */
+static void vs_rx_flush_staged(struct vs_dev *vsdev)
+{
+	if (vsdev->rx_staged && vsdev->rx_port) {
+		tty_insert_flip_string(vsdev->rx_port, vsdev->rx_stage,
+					vsdev->rx_staged);
+		tty_flip_buffer_push(vsdev->rx_port);
+	}
+	vsdev->rx_staged = 0;
+}
+
+/* Flush timer expired, deliver partially filled packet */
+static enum hrtimer_restart vs_rx_timer_expired(struct hrtimer *timer)
+{
+	unsigned long flags;
+	struct vs_dev *vsdev = container_of(timer, struct vs_dev, rx_timer);
+
+	spin_lock_irqsave(&vsdev->rx_lock, flags);
+	vs_rx_flush_staged(vsdev);
+	spin_unlock_irqrestore(&vsdev->rx_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Changes receive batching of the given device. Data staged under
+ * old settings is delivered first. Packet size 0 disables batching,
+ * otherwise flush time must be given.
+ */
+static int vs_set_rx_batching(struct vs_dev *vsdev,
+			unsigned int packet, unsigned int flush_us)
+{
+	unsigned long flags;
+
+	if ((packet > VS_RX_PACKET_MAX) || (packet && !flush_us))
+		return -EINVAL;
+
+	hrtimer_cancel(&vsdev->rx_timer);
+
+	spin_lock_irqsave(&vsdev->rx_lock, flags);
+	vs_rx_flush_staged(vsdev);
+	vsdev->rx_packet = packet;
+	vsdev->rx_flush_us = packet ? flush_us : 0;
+	spin_unlock_irqrestore(&vsdev->rx_lock, flags);
+
+	return 0;
+}
+
+/*
+ * Inserts received data in the tty buffer of receiving device and
+ * pushes it to line discipline. If receive batching is enabled data
+ * is staged and delivered a packet at a time, or when flush timer
+ * expires, as is the case with usb-uart adapters. The timer is armed
+ * by first byte of a packet and is not restarted by later bytes.
+ */
+static void vs_rx_chars(struct vs_dev *rx_vsdev, struct tty_port *port,
+			const unsigned char *data, int count)
+{
+	int n;
+	unsigned long flags;
+
+	if (!READ_ONCE(rx_vsdev->rx_packet)) {
+		tty_insert_flip_string(port, data, count);
+		tty_flip_buffer_push(port);
+		return;
+	}
+
+	spin_lock_irqsave(&rx_vsdev->rx_lock, flags);
+	rx_vsdev->rx_port = port;
+
+	while (count > 0) {
+		/* batching disabled while we were getting lock */
+		if (!rx_vsdev->rx_packet) {
+			tty_insert_flip_string(port, data, count);
+			tty_flip_buffer_push(port);
+			break;
+		}
+		n = min_t(int, rx_vsdev->rx_packet - rx_vsdev->rx_staged, count);
+		memcpy(rx_vsdev->rx_stage + rx_vsdev->rx_staged, data, n);
+		rx_vsdev->rx_staged += n;
+		data += n;
+		count -= n;
+		if (rx_vsdev->rx_staged >= rx_vsdev->rx_packet)
+			vs_rx_flush_staged(rx_vsdev);
+	}
+
+	/*
+	 * A running (not queued) callback may already have flushed, so
+	 * timer is armed again in that case too.
+	 */
+	if (rx_vsdev->rx_staged && !hrtimer_is_queued(&rx_vsdev->rx_timer))
+		hrtimer_start(&rx_vsdev->rx_timer,
+			ns_to_ktime((u64)rx_vsdev->rx_flush_us * NSEC_PER_USEC),
+			HRTIMER_MODE_REL_SOFT);
+
+	spin_unlock_irqrestore(&rx_vsdev->rx_lock, flags);
+}
+
+/*
+ * Inserts an error or break flag for the receiving device. Data still
+ * staged by receive batching was received before the flagged char, so
+ * it is delivered first to keep ordering seen by line discipline.
+ */
+static int vs_rx_flag(struct vs_dev *rx_vsdev, struct tty_port *port,
+			unsigned char ch, char flag)
+{
+	int ret;
+	unsigned long flags;
+
+	spin_lock_irqsave(&rx_vsdev->rx_lock, flags);
+	vs_rx_flush_staged(rx_vsdev);
+	ret = tty_insert_flip_char(port, ch, flag);
+	spin_unlock_irqrestore(&rx_vsdev->rx_lock, flags);
+
+	return ret;
+}
+
 /*
  * Notifies tty core that a framing/parity/overrun error has happend
  * while receiving data on serial port. When frame or parity error
@@ -204,19 +384,19 @@ static ssize_t event_store(struct device *dev,
 
 	switch (buf[0]) {
 	case '1':
-		ret = tty_insert_flip_char(tty_to_write->port, -7, TTY_FRAME);
+		ret = vs_rx_flag(local_vsdev, tty_to_write->port, -7, TTY_FRAME);
 		if (ret < 0)
 			goto fail;
 		local_vsdev->icount.frame++;
 		break;
 	case '2':
-		ret = tty_insert_flip_char(tty_to_write->port, -7, TTY_PARITY);
+		ret = vs_rx_flag(local_vsdev, tty_to_write->port, -7, TTY_PARITY);
 		if (ret < 0)
 			goto fail;
 		local_vsdev->icount.parity++;
 		break;
 	case '3':
-		ret = tty_insert_flip_char(tty_to_write->port, 0, TTY_OVERRUN);
+		ret = vs_rx_flag(local_vsdev, tty_to_write->port, 0, TTY_OVERRUN);
 		if (ret < 0)
 			goto fail;
 		local_vsdev->icount.overrun++;
@@ -232,7 +412,7 @@ static ssize_t event_store(struct device *dev,
 		push = -1;
 		break;
 	case '6':
-		ret = tty_insert_flip_char(tty_to_write->port, 0, TTY_BREAK);
+		ret = vs_rx_flag(local_vsdev, tty_to_write->port, 0, TTY_BREAK);
 		if (ret < 0)
 			goto fail;
 		local_vsdev->icount.brk++;
@@ -463,6 +643,231 @@ static ssize_t ostats_show(struct device *dev,
 }
 static DEVICE_ATTR_RO(ostats);
 
+/*
+ * Gives an usb-uart personality to the device so that vendor specific
+ * code paths can be exercised without hardware. Writing a personality
+ * also loads the default ids and latency timer of that adapter, this
+ * replaces receive batching given by module parameters. Writing none
+ * restores batching given by module parameters.
+ * $ echo "ftdi" > /sys/devices/virtual/tty/ttyVS0/personality
+ * $ echo "cp210x" > /sys/devices/virtual/tty/ttyVS0/personality
+ * $ echo "none" > /sys/devices/virtual/tty/ttyVS0/personality
+ */
+static ssize_t personality_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	switch (local_vsdev->personality) {
+	case VS_PERS_FTDI:
+		return sprintf(buf, "ftdi\n");
+	case VS_PERS_CP210X:
+		return sprintf(buf, "cp210x\n");
+	}
+
+	return sprintf(buf, "none\n");
+}
+
+static ssize_t personality_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	unsigned int packet = rx_batch_packet;
+	unsigned int flush_us = rx_batch_flush_us;
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	mutex_lock(&local_vsdev->lock);
+
+	if (sysfs_streq(buf, "ftdi")) {
+		local_vsdev->personality = VS_PERS_FTDI;
+		local_vsdev->id_vendor = 0x0403;
+		local_vsdev->id_product = 0x6001;
+		packet = VS_FTDI_PACKET;
+		flush_us = VS_FTDI_LATENCY * 1000;
+	} else if (sysfs_streq(buf, "cp210x")) {
+		local_vsdev->personality = VS_PERS_CP210X;
+		local_vsdev->id_vendor = 0x10c4;
+		local_vsdev->id_product = 0xea60;
+		packet = VS_CP210X_PACKET;
+		flush_us = VS_FTDI_LATENCY * 1000;
+		local_vsdev->gpio_latch = 0xff;
+	} else if (sysfs_streq(buf, "none")) {
+		local_vsdev->personality = VS_PERS_NONE;
+		local_vsdev->id_vendor = 0;
+		local_vsdev->id_product = 0;
+	} else {
+		mutex_unlock(&local_vsdev->lock);
+		return -EINVAL;
+	}
+	snprintf(local_vsdev->usb_serial, sizeof(local_vsdev->usb_serial),
+			"VS%06u", local_vsdev->own_index);
+
+	mutex_unlock(&local_vsdev->lock);
+
+	vs_set_rx_batching(local_vsdev, packet, flush_us);
+
+	return count;
+}
+static DEVICE_ATTR_RW(personality);
+
+/*
+ * USB vendor and product id of the emulated adapter in hex.
+ * $ echo "0403" > /sys/devices/virtual/tty/ttyVS0/idVendor
+ * $ cat /sys/devices/virtual/tty/ttyVS0/idProduct
+ */
+static ssize_t vs_store_id(struct device *dev, const char *buf,
+				size_t count, u16 *id)
+{
+	int ret;
+	u16 val;
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	if (local_vsdev->personality == VS_PERS_NONE)
+		return -ENODEV;
+
+	ret = kstrtou16(buf, 16, &val);
+	if (ret)
+		return ret;
+
+	*id = val;
+	return count;
+}
+
+static ssize_t idVendor_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%04x\n", local_vsdev->id_vendor);
+}
+
+static ssize_t idVendor_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	return vs_store_id(dev, buf, count, &local_vsdev->id_vendor);
+}
+static DEVICE_ATTR_RW(idVendor);
+
+static ssize_t idProduct_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%04x\n", local_vsdev->id_product);
+}
+
+static ssize_t idProduct_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	return vs_store_id(dev, buf, count, &local_vsdev->id_product);
+}
+static DEVICE_ATTR_RW(idProduct);
+
+/*
+ * USB serial number string of the emulated adapter. Defaults to
+ * VS followed by index of the device.
+ * $ echo "FT123456" > /sys/devices/virtual/tty/ttyVS0/serial
+ */
+static ssize_t serial_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%s\n", local_vsdev->usb_serial);
+}
+
+static ssize_t serial_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	size_t len = count;
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	if (local_vsdev->personality == VS_PERS_NONE)
+		return -ENODEV;
+
+	if (len && (buf[len - 1] == '\n'))
+		len--;
+	if ((len == 0) || (len >= sizeof(local_vsdev->usb_serial)))
+		return -EINVAL;
+
+	mutex_lock(&local_vsdev->lock);
+	memcpy(local_vsdev->usb_serial, buf, len);
+	local_vsdev->usb_serial[len] = '\0';
+	mutex_unlock(&local_vsdev->lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(serial);
+
+/*
+ * Latency timer in milliseconds (0 to 255) as exposed by ftdi_sio
+ * driver. It is the flush time of receive batching with packet size
+ * of the adapter. 0 delivers every write immediately.
+ * $ echo "1" > /sys/devices/virtual/tty/ttyVS0/latency_timer
+ */
+static ssize_t latency_timer_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", local_vsdev->rx_flush_us / 1000);
+}
+
+static ssize_t latency_timer_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	u8 val;
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	if (local_vsdev->personality == VS_PERS_NONE)
+		return -ENODEV;
+
+	ret = kstrtou8(buf, 10, &val);
+	if (ret)
+		return ret;
+
+	ret = vs_set_rx_batching(local_vsdev,
+				val ? vs_packet_size(local_vsdev) : 0, val * 1000);
+
+	return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(latency_timer);
+
+/*
+ * Receive batching as packet size in bytes (up to 512) and flush
+ * time in microseconds. Works with or without a personality.
+ * $ echo "64 2000" > /sys/devices/virtual/tty/ttyVS0/rxbatch
+ * $ echo "0 0" > /sys/devices/virtual/tty/ttyVS0/rxbatch
+ */
+static ssize_t rxbatch_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u %u\n", local_vsdev->rx_packet,
+			local_vsdev->rx_flush_us);
+}
+
+static ssize_t rxbatch_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned int packet, flush_us;
+	struct vs_dev *local_vsdev = dev_get_drvdata(dev);
+
+	if (sscanf(buf, "%u %u", &packet, &flush_us) != 2)
+		return -EINVAL;
+
+	ret = vs_set_rx_batching(local_vsdev, packet, flush_us);
+
+	return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(rxbatch);
+
 static struct attribute *vs_info_attrs[] = {
 	&dev_attr_event.attr,
 	&dev_attr_faultycable.attr,
@@ -476,13 +881,83 @@ static struct attribute *vs_info_attrs[] = {
 	&dev_attr_odtropn.attr,
 	&dev_attr_pdtropn.attr,
 	&dev_attr_ostats.attr,
+	&dev_attr_personality.attr,
+	&dev_attr_idVendor.attr,
+	&dev_attr_idProduct.attr,
+	&dev_attr_serial.attr,
+	&dev_attr_latency_timer.attr,
+	&dev_attr_rxbatch.attr,
 	NULL,
 };
 
+/*
+ * Permissions of the control attributes (event, faultycable) are
+ * decided here so that they are already correct when the uevent for
+ * the tty device is sent. This avoids udev having to fork a chmod for
+ * every device when thousands of devices are created in one go. Sysfs
+ * does not allow world writable attributes, so others bits are dropped.
+ */
+static umode_t vs_attr_is_visible(struct kobject *kobj,
+				struct attribute *attr, int n)
+{
+	if ((attr == &dev_attr_event.attr)
+			|| (attr == &dev_attr_faultycable.attr))
+		return (attr_mode & 0660) | 0200;
+
+	/* Personality attributes are readable by all like usb ones */
+	if ((attr == &dev_attr_personality.attr)
+			|| (attr == &dev_attr_idVendor.attr)
+			|| (attr == &dev_attr_idProduct.attr)
+			|| (attr == &dev_attr_serial.attr)
+			|| (attr == &dev_attr_latency_timer.attr)
+			|| (attr == &dev_attr_rxbatch.attr))
+		return (attr_mode & 0660) | 0644;
+
+	return attr->mode;
+}
+
 static const struct attribute_group vs_info_attr_group = {
 	.attrs = vs_info_attrs,
+	.is_visible = vs_attr_is_visible,
+};
+
+static const struct attribute_group *vs_info_attr_groups[] = {
+	&vs_info_attr_group,
+	NULL,
 };
 
+/*
+ * Registers tty device with the attribute group so that the attributes
+ * are created before the add uevent is sent. If attr_gid is given, the
+ * control attributes are handed over to that group. udev does not act
+ * on ownership of attributes, so no further uevent is needed.
+ */
+static struct device *vs_register_device(int index, struct vs_dev *vsdev)
+{
+	struct device *dev;
+
+	dev = tty_register_device_attr(ttyvs_driver, index, NULL,
+					vsdev, vs_info_attr_groups);
+	if (IS_ERR(dev))
+		return dev;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 8, 0)
+	if (attr_gid) {
+		int ret;
+
+		ret = sysfs_group_change_owner(&dev->kobj, &vs_info_attr_group,
+					GLOBAL_ROOT_UID,
+					make_kgid(&init_user_ns, attr_gid));
+		if (ret) {
+			tty_unregister_device(ttyvs_driver, index);
+			return ERR_PTR(ret);
+		}
+	}
+#endif
+
+	return dev;
+}
+
 /*
  * Checks if the given serial port has received its carrier detect
  * line raised or not. Return 1 if the carrier is raised otherwise 0.
@@ -698,6 +1173,19 @@ static int vs_install(struct tty_driver *drv, struct tty_struct *tty)
  */
 static void vs_cleanup(struct tty_struct *tty)
 {
+	unsigned long flags;
+	struct vs_dev *local_vsdev;
+
+	/* Flush timer must not push to a port which is going away */
+	if (db[tty->index].index != -1) {
+		local_vsdev = db[tty->index].vsdev;
+		hrtimer_cancel(&local_vsdev->rx_timer);
+		spin_lock_irqsave(&local_vsdev->rx_lock, flags);
+		local_vsdev->rx_port = NULL;
+		local_vsdev->rx_staged = 0;
+		spin_unlock_irqrestore(&local_vsdev->rx_lock, flags);
+	}
+
 	tty_port_put(tty->port);
 }
 
@@ -851,8 +1339,7 @@ static int vs_write(struct tty_struct *tty,
 			}
 		}
 
-		tty_insert_flip_string(tty_to_write->port, data, count);
-		tty_flip_buffer_push(tty_to_write->port);
+		vs_rx_chars(rx_vsdev, tty_to_write->port, data, count);
 		tx_vsdev->icount.tx++;
 		rx_vsdev->icount.rx++;
 
@@ -917,8 +1404,7 @@ static int vs_put_char(struct tty_struct *tty, unsigned char ch)
 		default:
 			data = ch;
 		}
-		tty_insert_flip_string(tty_to_write->port, &data, 1);
-		tty_flip_buffer_push(tty_to_write->port);
+		vs_rx_chars(rx_vsdev, tty_to_write->port, &data, 1);
 		tx_vsdev->icount.tx++;
 		rx_vsdev->icount.rx++;
 	} else {
@@ -1171,6 +1657,39 @@ static int vs_wait_change(struct tty_struct *tty, unsigned long mask)
 	return ret;
 }
 
+/*
+ * Emulates GPIO latch of CP2103/CP2104. For setting, low byte of the
+ * given value is the mask of pins to change and high byte their new
+ * state. Getting gives the latch as one byte.
+ */
+static int vs_gpio_ioctl(struct tty_struct *tty,
+				unsigned int cmd, unsigned long arg)
+{
+	u16 latch_buf = 0;
+	u8 mask, state;
+	struct vs_dev *local_vsdev = db[tty->index].vsdev;
+
+	if (local_vsdev->personality != VS_PERS_CP210X)
+		return -ENOIOCTLCMD;
+
+	if (cmd == VS_IOCTL_GPIOSET) {
+		if (copy_from_user(&latch_buf, (void __user *)arg, 2))
+			return -EFAULT;
+		mask = latch_buf & 0xff;
+		state = (latch_buf >> 8) & 0xff;
+		mutex_lock(&local_vsdev->lock);
+		local_vsdev->gpio_latch = (local_vsdev->gpio_latch & ~mask)
+						| (state & mask);
+		mutex_unlock(&local_vsdev->lock);
+		return 0;
+	}
+
+	if (copy_to_user((void __user *)arg, &local_vsdev->gpio_latch, 1))
+		return -EFAULT;
+
+	return 0;
+}
+
 /* Execute IOCTL commands */
 static int vs_ioctl(struct tty_struct *tty,
 				unsigned int cmd, unsigned long arg)
@@ -1180,6 +1699,9 @@ static int vs_ioctl(struct tty_struct *tty,
 		return vs_get_serinfo(tty, arg);
 	case TIOCMIWAIT:
 		return vs_wait_change(tty, arg);
+	case VS_IOCTL_GPIOGET:
+	case VS_IOCTL_GPIOSET:
+		return vs_gpio_ioctl(tty, cmd, arg);
 	}
 
 	return -ENOIOCTLCMD;
@@ -1348,7 +1870,7 @@ static int vs_break_ctl(struct tty_struct *tty, int break_state)
 
 		brk_tx_vsdev->is_break_on = 1;
 		if (tty_to_write != NULL) {
-			tty_insert_flip_char(tty_to_write->port, 0, TTY_BREAK);
+			vs_rx_flag(brk_rx_vsdev, tty_to_write->port, 0, TTY_BREAK);
 			tty_flip_buffer_push(tty_to_write->port);
 			brk_rx_vsdev->icount.brk++;
 		}
@@ -1483,8 +2005,8 @@ static int vs_extract_pin_mapping(char data[], int x)
 			break;
 		default:
 			return -EINVAL;
-		x++;
 		}
+		x++;
 	}
 
 	return mapping;
@@ -1530,6 +2052,7 @@ static ssize_t vs_card_write(struct file *file,
 	/* Initial sanitization */
 	if ((data[0] == 'g') && (data[1] == 'e') && (data[2] == 'n')) {
 		if ((data[3] == 'n') && (data[4] == 'm'))
+			is_loopback = 0;
 		else if ((data[3] == 'l') && (data[4] == 'b'))
 			is_loopback = 1;
 		else
@@ -1690,6 +2213,12 @@ static ssize_t vs_card_write(struct file *file,
 		db[i].index = i;
 		db[i].vsdev = vsdev1;
 		mutex_init(&vsdev1->lock);
+		spin_lock_init(&vsdev1->rx_lock);
+		hrtimer_init(&vsdev1->rx_timer, CLOCK_MONOTONIC,
+					HRTIMER_MODE_REL_SOFT);
+		vsdev1->rx_timer.function = vs_rx_timer_expired;
+		vsdev1->rx_packet = rx_batch_packet;
+		vsdev1->rx_flush_us = rx_batch_flush_us;
 
 		if (is_loopback != 1) {
 			y = -1;
@@ -1741,43 +2270,31 @@ static ssize_t vs_card_write(struct file *file,
 			db[y].index = y;
 			db[y].vsdev = vsdev2;
 			mutex_init(&vsdev2->lock);
+			spin_lock_init(&vsdev2->rx_lock);
+			hrtimer_init(&vsdev2->rx_timer, CLOCK_MONOTONIC,
+						HRTIMER_MODE_REL_SOFT);
+			vsdev2->rx_timer.function = vs_rx_timer_expired;
+			vsdev2->rx_packet = rx_batch_packet;
+			vsdev2->rx_flush_us = rx_batch_flush_us;
 		}
 
-		device1 = tty_register_device(ttyvs_driver, i, NULL);
-		if (device1 == NULL) {
-			ret = -ENOMEM;
+		device1 = vs_register_device(i, vsdev1);
+		if (IS_ERR(device1)) {
+			ret = PTR_ERR(device1);
 			mutex_unlock(&adaptlock);
 			goto fail_arg;
 		}
-
 		vsdev1->device = device1;
-		dev_set_drvdata(device1, vsdev1);
-
-		x = sysfs_create_group(&device1->kobj, &vs_info_attr_group);
-		if (x < 0) {
-			tty_unregister_device(ttyvs_driver, i);
-			mutex_unlock(&adaptlock);
-			goto fail_arg;
-		}
 
 		if (is_loopback != 1) {
-			device2 = tty_register_device(ttyvs_driver, y, NULL);
-			if (device2 == NULL) {
-				ret = -ENOMEM;
-				mutex_unlock(&adaptlock);
-				goto fail_register;
-			}
-
-			vsdev2->device = device2;
-			dev_set_drvdata(device2, vsdev2);
-
-			x = sysfs_create_group(&device2->kobj, &vs_info_attr_group);
-			if (x < 0) {
-				tty_unregister_device(ttyvs_driver, y);
+			device2 = vs_register_device(y, vsdev2);
+			if (IS_ERR(device2)) {
+				ret = PTR_ERR(device2);
 				db[y].index = -1;
 				mutex_unlock(&adaptlock);
 				goto fail_register;
 			}
+			vsdev2->device = device2;
 
 			last_nmdev1_idx = i;
 			last_nmdev2_idx = y;
@@ -1835,8 +2352,6 @@ static ssize_t vs_card_write(struct file *file,
 
 					vsdev1 = db[x].vsdev;
 					if (vsdev1 != NULL) {
-						sysfs_remove_group(&vsdev1->device->kobj,
-									&vs_info_attr_group);
 						if (vsdev1->own_tty && vsdev1->own_tty->port) {
 							tty = tty_port_tty_get(vsdev1->own_tty->port);
 							if (tty) {
@@ -1845,6 +2360,7 @@ static ssize_t vs_card_write(struct file *file,
 							}
 						}
 						tty_unregister_device(ttyvs_driver, db[x].index);
+						hrtimer_cancel(&vsdev1->rx_timer);
 						kfree(db[x].vsdev);
 					}
 					db[x].index = -1;
@@ -1880,7 +2396,6 @@ static ssize_t vs_card_write(struct file *file,
 
 				x = db[vdev1idx].index;
 				vsdev1 = db[x].vsdev;
-				sysfs_remove_group(&vsdev1->device->kobj, &vs_info_attr_group);
 				tty_unregister_device(ttyvs_driver, db[x].index);
 				if (vsdev1 && vsdev1->own_tty && vsdev1->own_tty->port) {
 					tty = tty_port_tty_get(vsdev1->own_tty->port);
@@ -1893,7 +2408,6 @@ static ssize_t vs_card_write(struct file *file,
 				if (vsdev1->own_index != vsdev1->peer_index) {
 					y = db[vsdev1->peer_index].index;
 					vsdev2 = db[y].vsdev;
-					sysfs_remove_group(&vsdev2->device->kobj, &vs_info_attr_group);
 					tty_unregister_device(ttyvs_driver, db[y].index);
 					if (vsdev2 && vsdev2->own_tty && vsdev2->own_tty->port) {
 						tty = tty_port_tty_get(vsdev2->own_tty->port);
@@ -1905,10 +2419,12 @@ static ssize_t vs_card_write(struct file *file,
 				}
 
 				if (x != -1) {
+					hrtimer_cancel(&db[x].vsdev->rx_timer);
 					kfree(db[x].vsdev);
 					db[x].index = -1;
 				}
 				if (y != -1) {
+					hrtimer_cancel(&db[y].vsdev->rx_timer);
 					kfree(db[y].vsdev);
 					db[y].index = -1;
 					--total_nm_pair;
@@ -1927,7 +2443,6 @@ static ssize_t vs_card_write(struct file *file,
 	return length;
 
 fail_register:
-	sysfs_remove_group(&device1->kobj, &vs_info_attr_group);
 	tty_unregister_device(ttyvs_driver, i);
 
 fail_arg:
@@ -2131,6 +2646,15 @@ static int __init ttyvs_init(void)
 	for (x = 0; x < max_num_vs_dev;  x++)
 		db[x].index = -1;
 
+	if ((rx_batch_packet > VS_RX_PACKET_MAX)
+			|| (rx_batch_packet && !rx_batch_flush_us)) {
+		pr_err("Invalid receive batching, disabled.\n");
+		rx_batch_packet = 0;
+		rx_batch_flush_us = 0;
+	}
+	if (!rx_batch_packet)
+		rx_batch_flush_us = 0;
+
 	/*
 	 * If module was loaded with parameters supplied, create null-modem
 	 * and loopback virtual tty devices as specified.
@@ -2181,8 +2705,6 @@ static void __exit ttyvs_exit(void)
 	for (x = 0; x < max_num_vs_dev; x++) {
 		if (db[x].index != -1) {
 			vsdev = db[x].vsdev;
-			sysfs_remove_group(&vsdev->device->kobj,
-						&vs_info_attr_group);
 			tty_unregister_device(ttyvs_driver, db[x].index);
 			if (vsdev && vsdev->own_tty && vsdev->own_tty->port) {
 				tty = tty_port_tty_get(vsdev->own_tty->port);
@@ -2190,6 +2712,7 @@ static void __exit ttyvs_exit(void)
 					tty_vhangup(tty);
 					tty_kref_put(tty);
 				}
+				hrtimer_cancel(&vsdev->rx_timer);
 				kfree(db[x].vsdev);
 			}
 		}
@@ -2239,6 +2762,41 @@ module_param(minor_begin, int, 0);
 MODULE_PARM_DESC(minor_begin,
 		"Starting minor number of device nodes");
 
+/*
+ * Permissions of the event and faultycable attributes of every device.
+ * Sysfs does not allow world writable attributes, so only owner and
+ * group bits are used. Default 0220 with root group is writable by root
+ * only; to let members of dialout group (gid 20 on most distributions)
+ * inject events use:
+ * $ insmod ./ttyvs.ko attr_gid=20
+ */
+module_param(attr_mode, ushort, 0444);
+MODULE_PARM_DESC(attr_mode,
+		"Mode of event and faultycable attributes (default 0220)");
+
+/*
+ * Group owning the event and faultycable attributes (kernel 5.8 and
+ * later), 0 keeps them owned by root.
+ */
+module_param(attr_gid, uint, 0444);
+MODULE_PARM_DESC(attr_gid,
+		"Group id owning event and faultycable attributes");
+
+/*
+ * Receive batching given to every device when it is created, so that
+ * all ports behave like usb-uart adapters. It is also restored when
+ * personality of a device is set to none. For ex; FTDI full speed
+ * adapter with default latency timer:
+ * $ insmod ./ttyvs.ko rx_batch_packet=62 rx_batch_flush_us=16000
+ */
+module_param(rx_batch_packet, uint, 0444);
+MODULE_PARM_DESC(rx_batch_packet,
+		"Receive batch size in bytes (1 to 512), 0 to disable batching");
+
+module_param(rx_batch_flush_us, uint, 0444);
+MODULE_PARM_DESC(rx_batch_flush_us,
+		"Time in microseconds after which partial receive batch is delivered");
+
 MODULE_AUTHOR("Rishi Gupta <gupt21@gmail.com>");
 MODULE_DESCRIPTION("Serial port null modem emulation driver");
 MODULE_LICENSE("GPL v2");
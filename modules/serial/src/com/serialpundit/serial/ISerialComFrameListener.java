@@ -0,0 +1,40 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial;
+
+/**
+ * <p>The interface ISerialComFrameListener should be implemented by class who wish to receive 
+ * complete frames delimited by inter-frame silent interval from SerialComFrameReceiver.</p>
+ * 
+ * @author Rishi Gupta
+ */
+public interface ISerialComFrameListener {
+
+    /**
+     * <p>This method is called whenever a silent interval on the line closes a frame. It gets called 
+     * from the receiver thread of SerialComFrameReceiver.</p>
+     * 
+     * @param frame bytes received between two silent intervals.
+     * @param timestamp value of System.nanoTime() when first bytes of this frame were received.
+     */
+    public abstract void onNewFrame(byte[] frame, long timestamp);
+
+    /**
+     * <p>This method is called when an error occurs while receiving frames. The receiver thread 
+     * exits after calling this method.</p>
+     * 
+     * @param e exception that caused receiver to stop.
+     */
+    public abstract void onFrameReceiverError(Exception e);
+}
@@ -0,0 +1,37 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial;
+
+/**
+ * <p>The interface ISerialComLineEdgeListener should be implemented by class who wish to receive 
+ * time stamped edges on serial port control lines in batches, for example for pulse counting on CTS 
+ * or GPS PPS on DCD where a line may toggle at high frequency.</p>
+ * 
+ * <p>When a listener implementing this interface is registered using registerLineEventListener() 
+ * method, edges are recorded in a pre-allocated ring of (timestamp, line state) records and no object 
+ * is allocated per edge. The onNewSerialEvent() method is not called for such a listener.</p>
+ * 
+ * @author Rishi Gupta
+ */
+public interface ISerialComLineEdgeListener extends ISerialComEventListener {
+
+    /**
+     * <p>This method is called from the looper thread with all the edges recorded since previous call. 
+     * Arrays of the edges object are reused for next call, so listener must copy whatever it needs to keep 
+     * before returning.</p>
+     * 
+     * @param edges batch of edges on serial port control lines.
+     */
+    public abstract void onNewLineEdges(SerialComLineEdges edges);
+}
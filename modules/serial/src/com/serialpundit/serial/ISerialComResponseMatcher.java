@@ -0,0 +1,35 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial;
+
+/**
+ * <p>The interface ISerialComResponseMatcher should be implemented by class who wish to tell 
+ * transact() method of SerialComManager when a complete response has been received.</p>
+ * 
+ * @author Rishi Gupta
+ */
+public interface ISerialComResponseMatcher {
+
+    /**
+     * <p>This method is called every time new bytes are appended to the response buffer while waiting 
+     * for response. It gets called from the thread which called transact() method.</p>
+     * 
+     * @param buffer bytes received so far, starting at index 0.
+     * @param length number of valid bytes in buffer.
+     * @return number of bytes from the start of buffer which form a complete response, or 0 if more 
+     *          bytes are needed. Negative values are invalid, transact() fails with SerialComException 
+     *          if one is returned.
+     */
+    public abstract int match(byte[] buffer, int length);
+}
@@ -0,0 +1,255 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial;
+
+import java.util.concurrent.ArrayBlockingQueue;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.locks.LockSupport;
+
+import com.serialpundit.core.SerialComException;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+
+/**
+ * <p>Receives data from serial port and splits it into frames using silent interval (inter-frame gap) on
+ * the line, as required for example by Modbus RTU where a frame ends when line is idle for 3.5 character
+ * times. The gap is given in microseconds so it is not limited by 100 millisecond granularity of termios
+ * VTIME.</p>
+ *
+ * <ul>
+ * <li>While line is idle, receiver thread is blocked in native layer waiting for data, no CPU is consumed.
+ * Once the first bytes of a frame arrive, the thread checks the port at a fraction of the gap interval and
+ * closes the frame as soon as no new byte has arrived for the gap interval.</li>
+ *
+ * <li><p>Bytes are time stamped when they are handed over by the driver. Drivers (especially USB-UART
+ * converters) deliver bytes in chunks, so the gap is measured between chunks and not between individual
+ * bytes. USB-UART latency timers should be set to a value smaller than the gap.</p></li>
+ *
+ * <li>Frames are delivered to the given ISerialComFrameListener, or if listener is null, they are queued
+ * and can be retrieved using readFrame() method. If the queue becomes full oldest frame is dropped.</li>
+ *
+ * <li><p>If the frame becomes longer than maximum frame length, bytes received so far are delivered as one
+ * frame and a new frame is started.</p></li>
+ * </ul>
+ *
+ * <p>No other thread should read from the port while this receiver exist. The close() method must be
+ * called before closing the serial port.</p>
+ *
+ * @author Rishi Gupta
+ */
+public final class SerialComFrameReceiver {
+
+    /** <p>Fixed inter-frame gap of 1750 microseconds recommended by Modbus specification for baud rates
+     * higher than 19200.</p>*/
+    public static final long MODBUS_FIXED_GAP = 1750;
+
+    private static final int MAX_QUEUED_FRAMES = 1024;
+    private static final long MIN_POLL_INTERVAL = 50000;
+
+    private final SerialComManager mSerialComManager;
+    private final long mHandle;
+    private final long mGapNanos;
+    private final long mPollNanos;
+    private final int mMaxFrameLength;
+    private final ISerialComFrameListener mFrameListener;
+    private final ArrayBlockingQueue<byte[]> mFrameQueue;
+    private final long mContext;
+    private final Thread mReceiverThread;
+    private volatile boolean mExit = false;
+
+    /**
+     * <p>Receiver thread; waits for start of frame in native layer and then watches for silent interval.</p>
+     */
+    private final class FrameReceiver implements Runnable {
+        @Override
+        public void run() {
+            byte[] buffer = new byte[mMaxFrameLength];
+            int length = 0;
+            int ret = 0;
+
+            while(mExit == false) {
+                try {
+                    // blocks until first bytes of frame arrive
+                    length = mSerialComManager.readBytes(mHandle, buffer, 0, readLength(0), mContext, null);
+                    if(length <= 0) {
+                        continue;
+                    }
+                    long frameStart = System.nanoTime();
+                    long lastByteTime = frameStart;
+
+                    while((length < mMaxFrameLength) && (mExit == false)) {
+                        long silence = System.nanoTime() - lastByteTime;
+                        if(silence >= mGapNanos) {
+                            break;
+                        }
+                        long remaining = mGapNanos - silence;
+                        LockSupport.parkNanos((remaining < mPollNanos) ? remaining : mPollNanos);
+
+                        ret = mSerialComManager.readBytes(mHandle, buffer, length, readLength(length), -1, null);
+                        if(ret > 0) {
+                            length = length + ret;
+                            lastByteTime = System.nanoTime();
+                        }
+                    }
+
+                    byte[] frame = new byte[length];
+                    System.arraycopy(buffer, 0, frame, 0, length);
+                    deliver(frame, frameStart);
+                } catch (SerialComException e) {
+                    if(mExit == true) {
+                        break;
+                    }
+                    if(mFrameListener != null) {
+                        mFrameListener.onFrameReceiverError(e);
+                    }
+                    break;
+                }
+            }
+        }
+
+        private int readLength(int length) {
+            int toRead = mMaxFrameLength - length;
+            return (toRead > 2048) ? 2048 : toRead;
+        }
+    }
+
+    /**
+     * <p>Allocates a new SerialComFrameReceiver object and starts receiving frames on the given port.</p>
+     *
+     * @param scm instance of SerialComManager with which port has been opened.
+     * @param handle of the opened serial port.
+     * @param gap silent interval in microseconds which marks end of frame (see calculateGap()).
+     * @param maxFrameLength maximum number of bytes in one frame.
+     * @param frameListener listener to which frames will be delivered or null if frames should be queued
+     *         for readFrame() method.
+     * @throws SerialComException if blocking I/O context can not be created.
+     * @throws IllegalArgumentException if scm is null, gap is zero or negative or maxFrameLength is zero or
+     *          negative.
+     */
+    public SerialComFrameReceiver(SerialComManager scm, long handle, long gap, int maxFrameLength,
+            ISerialComFrameListener frameListener) throws SerialComException {
+
+        if(scm == null) {
+            throw new IllegalArgumentException("Argument scm can not be null !");
+        }
+        if(gap <= 0) {
+            throw new IllegalArgumentException("Argument gap can not be zero or negative !");
+        }
+        if(maxFrameLength <= 0) {
+            throw new IllegalArgumentException("Argument maxFrameLength can not be zero or negative !");
+        }
+
+        mSerialComManager = scm;
+        mHandle = handle;
+        mGapNanos = gap * 1000;
+        mMaxFrameLength = maxFrameLength;
+        mFrameListener = frameListener;
+
+        // check 4 times within gap interval so that frame is closed at most gap + gap/4 after last byte
+        long poll = mGapNanos / 4;
+        mPollNanos = (poll < MIN_POLL_INTERVAL) ? MIN_POLL_INTERVAL : poll;
+
+        if(frameListener == null) {
+            mFrameQueue = new ArrayBlockingQueue<byte[]>(MAX_QUEUED_FRAMES);
+        }else {
+            mFrameQueue = null;
+        }
+
+        mContext = scm.createBlockingIOContext();
+        mReceiverThread = new Thread(new FrameReceiver(), "SerialPundit FrameReceiver for handle " + handle);
+        mReceiverThread.start();
+    }
+
+    /**
+     * <p>Calculates silent interval in microseconds equal to given number of character times for the given
+     * frame format. For Modbus RTU use 3.5 characters for baud rates up to 19200 and MODBUS_FIXED_GAP above it.</p>
+     *
+     * @param baudRate baud rate in bits per second.
+     * @param dataBits number of data bits in one character.
+     * @param parity parity of the character.
+     * @param stopBits number of stop bits in one character.
+     * @param characters number of character times (for example 3.5).
+     * @return silent interval in microseconds (rounded up).
+     * @throws IllegalArgumentException if baudRate or characters is zero or negative, or if dataBits or parity
+     *          or stopBits is null.
+     */
+    public static long calculateGap(int baudRate, DATABITS dataBits, PARITY parity, STOPBITS stopBits, double characters) {
+        if((baudRate <= 0) || (characters <= 0)) {
+            throw new IllegalArgumentException("Arguments baudRate and characters can not be zero or negative !");
+        }
+        if((dataBits == null) || (parity == null) || (stopBits == null)) {
+            throw new IllegalArgumentException("Arguments dataBits, parity and stopBits can not be null !");
+        }
+
+        double bits = 1 + dataBits.getValue(); // start bit + data bits
+        if(parity != PARITY.P_NONE) {
+            bits = bits + 1;
+        }
+        if(stopBits == STOPBITS.SB_1) {
+            bits = bits + 1;
+        }else if(stopBits == STOPBITS.SB_1_5) {
+            bits = bits + 1.5;
+        }else {
+            bits = bits + 2;
+        }
+
+        return (long) Math.ceil((bits * characters * 1000000.0) / baudRate);
+    }
+
+    /**
+     * <p>Gives next received frame. Applicable only when this receiver was created without frame listener.</p>
+     *
+     * @param timeOut time in milliseconds to wait for a frame, 0 to return immediately.
+     * @return frame bytes or null if no frame was received within time out.
+     * @throws IllegalStateException if this receiver delivers frames to a listener.
+     * @throws InterruptedException if interrupted while waiting.
+     */
+    public byte[] readFrame(long timeOut) throws InterruptedException {
+        if(mFrameQueue == null) {
+            throw new IllegalStateException("Frames are being delivered to frame listener !");
+        }
+        return mFrameQueue.poll(timeOut, TimeUnit.MILLISECONDS);
+    }
+
+    /**
+     * <p>Stops receiving frames and releases resources. Frames already queued remain readable.</p>
+     *
+     * @throws SerialComException if blocking I/O context can not be unblocked or destroyed.
+     */
+    public void close() throws SerialComException {
+        if(mExit == true) {
+            return;
+        }
+        mExit = true;
+        mSerialComManager.unblockBlockingIOOperation(mContext);
+        try {
+            mReceiverThread.join();
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+        }
+        mSerialComManager.destroyBlockingIOContext(mContext);
+    }
+
+    private void deliver(byte[] frame, long timestamp) {
+        if(mFrameListener != null) {
+            mFrameListener.onNewFrame(frame, timestamp);
+            return;
+        }
+        if(mFrameQueue.remainingCapacity() == 0) {
+            mFrameQueue.poll();
+        }
+        mFrameQueue.offer(frame);
+    }
+}
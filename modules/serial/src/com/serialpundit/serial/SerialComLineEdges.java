@@ -0,0 +1,110 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial;
+
+/**
+ * <p>Batch of edges on serial port control lines delivered to ISerialComLineEdgeListener. Each edge is 
+ * a time stamp (value of System.nanoTime() when the native layer reported the change) and the state of 
+ * lines after the change as bit mask of SerialComManager.CTS, DSR, DCD and RI filtered by events mask.</p>
+ * 
+ * <p>If edges are coalesced (see setLineEdgeCoalescingWindow() in SerialComManager), an edge that follows 
+ * the previous one within the coalescing window replaces its state but keeps its time stamp. If state is 
+ * then same as before the previous edge, both are merged away and counted as coalesced.</p>
+ * 
+ * @author Rishi Gupta
+ */
+public final class SerialComLineEdges {
+
+    private final long[] mTimestamps;
+    private final int[] mLineStates;
+    private final int mCount;
+    private final int mPreviousLineState;
+    private final int mDropped;
+    private final int mCoalesced;
+
+    /**
+     * <p>Allocates a new SerialComLineEdges object for a batch of edges. Arrays are not copied, the 
+     * looper fills them again for the next batch once listener has returned.</p>
+     * 
+     * @param timestamps time stamps of edges.
+     * @param lineStates state of lines after each edge.
+     * @param count number of valid entries in arrays.
+     * @param previousLineState state of lines before first edge.
+     * @param dropped number of dropped edges.
+     * @param coalesced number of coalesced edges.
+     */
+    public SerialComLineEdges(long[] timestamps, int[] lineStates, int count, int previousLineState, 
+            int dropped, int coalesced) {
+        mTimestamps = timestamps;
+        mLineStates = lineStates;
+        mCount = count;
+        mPreviousLineState = previousLineState;
+        mDropped = dropped;
+        mCoalesced = coalesced;
+    }
+
+    /**
+     * <p>Gives number of edges in this batch.</p>
+     * 
+     * @return number of valid entries in time stamp and line state arrays.
+     */
+    public int getCount() {
+        return mCount;
+    }
+
+    /**
+     * <p>Gives array of time stamps (System.nanoTime()) of edges. Only first getCount() entries are valid.</p>
+     * 
+     * @return time stamps array (not a copy).
+     */
+    public long[] getTimestamps() {
+        return mTimestamps;
+    }
+
+    /**
+     * <p>Gives array of line states after each edge. Only first getCount() entries are valid.</p>
+     * 
+     * @return line states array (not a copy).
+     */
+    public int[] getLineStates() {
+        return mLineStates;
+    }
+
+    /**
+     * <p>Gives state of lines before the first edge in this batch.</p>
+     * 
+     * @return bit mask of line state.
+     */
+    public int getPreviousLineState() {
+        return mPreviousLineState;
+    }
+
+    /**
+     * <p>Gives number of edges which were dropped since previous batch because ring was full.</p>
+     * 
+     * @return number of dropped edges.
+     */
+    public int getDroppedCount() {
+        return mDropped;
+    }
+
+    /**
+     * <p>Gives number of edges which were merged into previous edge since previous batch.</p>
+     * 
+     * @return number of coalesced edges.
+     */
+    public int getCoalescedCount() {
+        return mCoalesced;
+    }
+}
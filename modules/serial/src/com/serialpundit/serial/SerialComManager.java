@@ -20,11 +20,14 @@ import java.io.UnsupportedEncodingException;
 import java.nio.ByteBuffer;
 import java.nio.charset.Charset;
 import java.util.Map;
+import java.util.Timer;
+import java.util.TimerTask;
 import java.util.TreeMap;
 
 import com.serialpundit.core.SerialComPlatform;
 import com.serialpundit.core.SerialComSystemProperty;
 import com.serialpundit.core.SerialComException;
+import com.serialpundit.core.SerialComTimeOutException;
 import com.serialpundit.serial.comdb.SerialComDBRelease;
 import com.serialpundit.serial.ftp.ISerialComXmodemProgress;
 import com.serialpundit.serial.ftp.ISerialComYmodemProgress;
@@ -316,6 +319,7 @@ public final class SerialComManager {
     private final SerialComCompletionDispatcher mEventCompletionDispatcher;
     private final SerialComPortsList mSerialComPortsList;
     private final Object lockB = new Object();
+    private Timer mDeadlineTimer = null;
 
     private static final Object lockA = new Object();
     private static boolean nativeLibLoadAndInitAlready = false;
@@ -627,6 +631,52 @@ public final class SerialComManager {
         return handle;
     }
 
+    /**
+     * <p>Opens the given serial port and applies the given configuration to it. This is same as calling 
+     * openComPort() followed by applyComPortConfig(), except that if the configuration can not be applied 
+     * the port is closed before exception is thrown.</p>
+     * 
+     * <p>This method is thread safe.</p>
+     * 
+     * @param portName name of the port to be opened for communication.
+     * @param enableRead allows application to read bytes from this port.
+     * @param enableWrite allows application to write bytes to this port.
+     * @param exclusiveOwnerShip application wants to become exclusive owner of this port or not.
+     * @param config configuration to apply to the opened port.
+     * @return handle of the port successfully opened and configured.
+     * @throws IllegalStateException if trying to become exclusive owner when port is already opened.
+     * @throws IllegalArgumentException if portName or config is null or invalid length, or if both enableRead and 
+     *         enableWrite are set to false, if trying to open port in Windows without being exclusive owner.
+     * @throws SerialComException if the port can not be opened or configured for some reason.
+     */
+    public long openComPort(final String portName, boolean enableRead, boolean enableWrite, boolean exclusiveOwnerShip, 
+            final SerialComPortConfig config) throws SerialComException {
+
+        if(config == null) {
+            throw new IllegalArgumentException("Argument config can not be null !");
+        }
+
+        // Invalid settings are rejected before the port is opened (and possibly locked exclusively).
+        checkReadBehaviour(config);
+
+        long handle = openComPort(portName, enableRead, enableWrite, exclusiveOwnerShip);
+        boolean configured = false;
+        try {
+            applyComPortConfig(handle, config);
+            configured = true;
+        } finally {
+            if(configured == false) {
+                try {
+                    closeComPort(handle);
+                } catch (Exception e1) {
+                    // ignore, reporting configuration failure is more important
+                }
+            }
+        }
+
+        return handle;
+    }
+
     /**
      * <p>Close the serial port. Application should unregister listeners if it has registered any before 
      * calling this method.</p>
@@ -668,6 +718,11 @@ public final class SerialComManager {
                 throw new IllegalStateException("Output byte stream must be closed before closing the serial port !");
             }
 
+            if(handleInfo.getTransactContext() != -1) {
+                mComPortJNIBridge.destroyBlockingIOContext(handleInfo.getTransactContext());
+                handleInfo.setTransactContext(-1);
+            }
+
             int ret = mComPortJNIBridge.closeComPort(handle);
             if(ret < 0) {
                 throw new SerialComException("Could not close the given serial port. Please retry !");
@@ -1310,6 +1365,154 @@ public final class SerialComManager {
         return numberOfBytesRead;
     }
 
+    /**
+     * <p>Performs a request/response exchange; writes the given request and then waits until the given 
+     * matcher reports that a complete response has been received or the time out expires. This replaces 
+     * the write and then poll-read-sleep loops typically used for AT command and Modbus style exchanges.</p>
+     * 
+     * <ul>
+     * <li>While waiting, the calling thread is blocked in native layer (select/poll) on the serial port and a 
+     * blocking I/O context. No sleep is involved, so the response is processed as soon as the driver 
+     * delivers it. The blocking I/O context is created once per handle and destroyed when the port is 
+     * closed.</li>
+     * 
+     * <li><p>The time out covers the whole exchange (write and read). When it expires the blocked read is 
+     * unblocked and SerialComTimeOutException is thrown.</p></li>
+     * 
+     * <li>Bytes received after the end of the response (as reported by matcher) in the same read are 
+     * discarded.</li>
+     * 
+     * <li><p>Only one transaction should be in progress for a given handle at a time and no other thread should 
+     * read from this handle while transaction is in progress.</p></li>
+     * </ul>
+     * 
+     * @param handle of the opened port on which exchange will take place.
+     * @param request bytes to be sent.
+     * @param matcher decides when the response is complete.
+     * @param timeOut time in milliseconds within which whole exchange must complete.
+     * @return response bytes as reported by matcher.
+     * @throws SerialComTimeOutException if complete response is not received within time out.
+     * @throws SerialComException if invalid handle is passed, an I/O error occurs or matcher returns a 
+     *          negative value.
+     * @throws IllegalArgumentException if request is null or empty, matcher is null or timeOut is zero 
+     *          or negative.
+     */
+    public byte[] transact(long handle, final byte[] request, final ISerialComResponseMatcher matcher, 
+            long timeOut) throws SerialComException, SerialComTimeOutException {
+
+        if((request == null) || (request.length == 0)) {
+            throw new IllegalArgumentException("Argument request can not be null or empty !");
+        }
+        if(matcher == null) {
+            throw new IllegalArgumentException("Argument matcher can not be null !");
+        }
+        if(timeOut <= 0) {
+            throw new IllegalArgumentException("Argument timeOut can not be zero or negative !");
+        }
+
+        final SerialComPortHandleInfo handleInfo = mPortHandleInfo.get(handle);
+        if(handleInfo == null) {
+            throw new SerialComException("Given handle is alien to me !");
+        }
+
+        long context = handleInfo.getTransactContext();
+        if(context == -1) {
+            context = createBlockingIOContext();
+            handleInfo.setTransactContext(context);
+        }
+
+        final long deadline = System.currentTimeMillis() + timeOut;
+        final long ctx = context;
+        final boolean[] expired = new boolean[] { false, false }; // [0] task ran, [1] transaction done
+        TimerTask deadlineTask = new TimerTask() {
+            @Override
+            public void run() {
+                synchronized(expired) {
+                    if(expired[1] == false) {
+                        expired[0] = true;
+                        mComPortJNIBridge.unblockBlockingIOOperation(ctx);
+                    }
+                }
+            }
+        };
+
+        synchronized(lockB) {
+            if(mDeadlineTimer == null) {
+                mDeadlineTimer = new Timer("SerialPundit transact deadline", true);
+            }
+            mDeadlineTimer.schedule(deadlineTask, timeOut);
+        }
+
+        byte[] response = new byte[256];
+        int received = 0;
+        int complete = 0;
+
+        try {
+            int written = 0;
+            while(written < request.length) {
+                byte[] toWrite = request;
+                if(written != 0) {
+                    toWrite = new byte[request.length - written];
+                    System.arraycopy(request, written, toWrite, 0, toWrite.length);
+                }
+                written = written + writeBytes(handle, toWrite, 0);
+                if((written < request.length) && (System.currentTimeMillis() >= deadline)) {
+                    throw new SerialComTimeOutException("Could not send request within given time !");
+                }
+            }
+
+            while(complete == 0) {
+                if(received == response.length) {
+                    byte[] larger = new byte[response.length * 2];
+                    System.arraycopy(response, 0, larger, 0, received);
+                    response = larger;
+                }
+                int length = response.length - received;
+                if(length > 2048) {
+                    length = 2048;
+                }
+                int ret = 0;
+                try {
+                    ret = readBytes(handle, response, received, length, ctx, null);
+                } catch (SerialComException e) {
+                    synchronized(expired) {
+                        if(expired[0] == true) {
+                            throw new SerialComTimeOutException("Complete response not received within given time !");
+                        }
+                    }
+                    throw e;
+                }
+                if(ret > 0) {
+                    received = received + ret;
+                    complete = matcher.match(response, received);
+                    if(complete < 0) {
+                        throw new SerialComException("Response matcher " + matcher.getClass().getName() 
+                                + " returned invalid length " + complete + " !");
+                    }
+                    if(complete > received) {
+                        complete = received;
+                    }
+                }
+            }
+        } finally {
+            boolean stale = false;
+            synchronized(expired) {
+                expired[1] = true;
+                stale = expired[0];
+            }
+            deadlineTask.cancel();
+            if(stale == true) {
+                // context may still carry the unblock request, do not reuse it
+                handleInfo.setTransactContext(-1);
+                mComPortJNIBridge.destroyBlockingIOContext(ctx);
+            }
+        }
+
+        byte[] result = new byte[complete];
+        System.arraycopy(response, 0, result, 0, complete);
+        return result;
+    }
+
     /**
      * <p>This method configures the rate at which communication will occur and the format of UART frame.
      * This method must be called before configureComPortControl method.</p>
@@ -1360,9 +1563,11 @@ public final class SerialComManager {
             throw new IllegalArgumentException("Argument baudRate can not be null !");
         }
 
-        if(mPortHandleInfo.get(handle) == null) {
+        SerialComPortHandleInfo handleInfo = mPortHandleInfo.get(handle);
+        if(handleInfo == null) {
             throw new SerialComException("Given handle is alien to me !");
         }
+        handleInfo.setAppliedConfig(null);
 
         baudRateGiven = baudRate.getValue();
         if(baudRateGiven != 251) {
@@ -1417,9 +1622,11 @@ public final class SerialComManager {
             throw new IllegalArgumentException("Argument flowctrl can not be null !");
         }
 
-        if(mPortHandleInfo.get(handle) == null) {
+        SerialComPortHandleInfo handleInfo = mPortHandleInfo.get(handle);
+        if(handleInfo == null) {
             throw new SerialComException("Given handle is alien to me !");
         }
+        handleInfo.setAppliedConfig(null);
 
         int xonCh = (int) xon;
         int xoffCh = (int) xoff;
@@ -1433,6 +1640,116 @@ public final class SerialComManager {
         return true;
     }
 
+    /**
+     * <p>Applies the given configuration (frame format, flow control, read behaviour, RTS/DTR state) to the 
+     * opened serial port. This replaces the sequence configureComPortData(), configureComPortControl(), 
+     * fineTuneReadBehaviour(), setRTS(), setDTR() and clearPortIOBuffers() with a single call.</p>
+     * 
+     * <p>A copy of the last configuration applied through this method is remembered for the handle. When a 
+     * configuration is applied again, only the settings that differ from the remembered ones are passed to 
+     * the native layer. Every such call may result in a tcsetattr() on Linux which in turn may make the 
+     * driver talk to the USB-UART device, so skipping unchanged settings reduces time taken to bring a port 
+     * into ready state considerably. Calling any individual configuration method on the handle makes this 
+     * method apply all settings again next time.</p>
+     * 
+     * <p>Buffers are cleared (if asked in config) every time this method is called.</p>
+     * 
+     * @param handle of the opened port to which configuration is to be applied.
+     * @param config configuration to apply.
+     * @return true on success.
+     * @throws SerialComException if invalid handle is passed or an error occurs in configuring the port.
+     * @throws IllegalArgumentException if config is null or contains invalid read behaviour settings.
+     */
+    public boolean applyComPortConfig(long handle, final SerialComPortConfig config) throws SerialComException {
+
+        int ret = 0;
+
+        if(config == null) {
+            throw new IllegalArgumentException("Argument config can not be null !");
+        }
+
+        SerialComPortHandleInfo handleInfo = mPortHandleInfo.get(handle);
+        if(handleInfo == null) {
+            throw new SerialComException("Given handle is alien to me !");
+        }
+
+        SerialComPortConfig applied = handleInfo.getAppliedConfig();
+        SerialComPortConfig toApply = new SerialComPortConfig(config);
+
+        // Reject invalid settings before anything is changed on the port.
+        checkReadBehaviour(toApply);
+
+        // Invalidate remembered settings until new settings have been applied successfully.
+        handleInfo.setAppliedConfig(null);
+
+        if(!toApply.isDataFormatSame(applied)) {
+            ret = mComPortJNIBridge.configureComPortData(handle, toApply.getDataBits().getValue(), toApply.getStopBits().getValue(), 
+                    toApply.getParity().getValue(), toApply.getBaudRate().getValue(), toApply.getCustBaud());
+            if(ret < 0) {
+                throw new SerialComException("Could not configure the serial port. Please retry !");
+            }
+        }
+
+        if(!toApply.isFlowControlSame(applied)) {
+            ret = mComPortJNIBridge.configureComPortControl(handle, toApply.getFlowControl().getValue(), ((byte) toApply.getXon()), 
+                    ((byte) toApply.getXoff()), toApply.isParFraErrorChecked(), toApply.isOverFlowErrChecked());
+            if(ret < 0) {
+                throw new SerialComException("Could not configure serial port. Please retry !");
+            }
+        }
+
+        if(toApply.isReadBehaviourSet() && !toApply.isReadBehaviourSame(applied)) {
+            ret = mComPortJNIBridge.fineTuneRead(handle, toApply.getVmin(), toApply.getVtime(), toApply.getRit(), 
+                    toApply.getRttm(), toApply.getRttc());
+            if(ret < 0) {
+                throw new SerialComException("Could not set the given parameters. Please retry !");
+            }
+        }
+
+        if((applied == null) || (applied.getRTS() != toApply.getRTS())) {
+            ret = mComPortJNIBridge.setRTS(handle, toApply.getRTS());
+            if(ret < 0) {
+                throw new SerialComException("Could not set RTS line to desired state. Please retry !");
+            }
+        }
+
+        if((applied == null) || (applied.getDTR() != toApply.getDTR())) {
+            ret = mComPortJNIBridge.setDTR(handle, toApply.getDTR());
+            if(ret < 0) {
+                throw new SerialComException("Could not set DTR line to desired state. Please retry !");
+            }
+        }
+
+        if(toApply.isClearRxBuffer() || toApply.isClearTxBuffer()) {
+            ret = mComPortJNIBridge.clearPortIOBuffers(handle, toApply.isClearRxBuffer(), toApply.isClearTxBuffer());
+            if(ret < 0) {
+                throw new SerialComException("Could not clear serial port buffers. Please retry !");
+            }
+        }
+
+        handleInfo.setAppliedConfig(toApply);
+        return true;
+    }
+
+    /* Read behaviour is validated here as native layer does not check it. */
+    private void checkReadBehaviour(final SerialComPortConfig config) {
+        if(config.isReadBehaviourSet() == false) {
+            return;
+        }
+        if(osType == SerialComPlatform.OS_WINDOWS) {
+            if((config.getRit() < 0) || (config.getRttm() < 0) || (config.getRttc() < 0)) {
+                throw new IllegalArgumentException("Argument(s) rit, rttm and rttc can not be neagative !");
+            }
+        }else {
+            if((config.getVmin() == 0) && (config.getVtime() == 0)) {
+                throw new IllegalArgumentException("Both vmin and vtime can not be zero !");
+            }
+            if((config.getVmin() < 0) || (config.getVtime() < 0)) {
+                throw new IllegalArgumentException("The vmin and vtime can not be negative !");
+            }
+        }
+    }
+
     /**
      * <p>This method gives currently applicable settings associated with particular serial port.
      * The values are bit mask so that application can manipulate them to get required information.</p>
@@ -1502,6 +1819,10 @@ public final class SerialComManager {
      * @throws SerialComException if system is unable to complete requested operation.
      */
     public boolean setRTS(long handle, boolean enabled) throws SerialComException {
+        SerialComPortHandleInfo handleInfo = mPortHandleInfo.get(handle);
+        if(handleInfo != null) {
+            handleInfo.setAppliedConfig(null);
+        }
         int ret = mComPortJNIBridge.setRTS(handle, enabled);
         if(ret < 0) {
             throw new SerialComException("Could not set RTS line to desired state. Please retry !");
@@ -1533,6 +1854,10 @@ public final class SerialComManager {
      * @throws SerialComException if system is unable to complete requested operation.
      */
     public boolean setDTR(long handle, boolean enabled) throws SerialComException {
+        SerialComPortHandleInfo handleInfo = mPortHandleInfo.get(handle);
+        if(handleInfo != null) {
+            handleInfo.setAppliedConfig(null);
+        }
         int ret = mComPortJNIBridge.setDTR(handle, enabled);
         if(ret < 0) {
             throw new SerialComException("Could not set DTR line to desired state. Please retry !");
@@ -1622,6 +1947,11 @@ public final class SerialComManager {
      * them in java layers, to decide whether this should be sent to application or not (as per the mask set by
      * setEventsMask() method).</p>
      * 
+     * <p>If the listener implements ISerialComLineEdgeListener, no SerialComLineEvent object is allocated per change. 
+     * Edges are recorded with time stamp in a fixed size ring and delivered in batches through onNewLineEdges method. 
+     * This suits lines toggling at high rate like pulse counting on CTS or GPS PPS on DCD. See also 
+     * setLineEdgeCoalescingWindow() method.</p>
+     * 
      * <p>Before calling this method, make sure that port has been configured for hardware flow control using configureComPortControl
      * method. Application should not register event listener more than once for the same port otherwise it will lead to inconsistent 
      * state.</p>
@@ -1771,9 +2101,11 @@ public final class SerialComManager {
             }
         }
 
-        if(mPortHandleInfo.get(handle) == null) {
+        SerialComPortHandleInfo handleInfo = mPortHandleInfo.get(handle);
+        if(handleInfo == null) {
             throw new SerialComException("Given handle is alien to me !");
         }
+        handleInfo.setAppliedConfig(null);
 
         ret = mComPortJNIBridge.fineTuneRead(handle, vmin, vtime, rit, rttm, rttc);
         if(ret < 0) {
@@ -1859,6 +2191,50 @@ public final class SerialComManager {
         }
     }
 
+    /**
+     * <p>Sets the time window within which edges on control lines are merged into one edge. This is applicable 
+     * only to listener implementing ISerialComLineEdgeListener interface. When a line toggles faster than 
+     * application cares about (for example contact bounce), an edge arriving within window of the last edge 
+     * not yet delivered replaces its state and keeps its time stamp. If that brings lines back to the state 
+     * before that edge (a pulse shorter than window), the edge is removed altogether, so every delivered edge 
+     * is a real change. By default every edge is recorded.</p>
+     * 
+     * @param eventListener instance of class which implemented ISerialComLineEdgeListener interface.
+     * @param window coalescing window in nanoseconds, 0 to record every edge.
+     * @return true on success.
+     * @throws SerialComException if invalid listener is passed.
+     * @throws IllegalArgumentException if eventListener is null or window is negative.
+     */
+    public boolean setLineEdgeCoalescingWindow(final ISerialComLineEdgeListener eventListener, long window) throws SerialComException {
+
+        SerialComPortHandleInfo handleInfo = null;
+        SerialComLooper looper = null;
+
+        if(eventListener == null) {
+            throw new IllegalArgumentException("Argument eventListener can not be null !");
+        }
+        if(window < 0) {
+            throw new IllegalArgumentException("Argument window can not be negative !");
+        }
+
+        for (Map.Entry<Long, SerialComPortHandleInfo> entry : mPortHandleInfo.entrySet()) {
+            handleInfo = entry.getValue();
+            if(handleInfo != null) {
+                if(handleInfo.containsEventListener(eventListener)) {
+                    looper = handleInfo.getLooper();
+                    break;
+                }
+            }
+        }
+
+        if(looper != null) {
+            looper.setLineEdgeCoalescingWindow(window);
+            return true;
+        }else {
+            throw new SerialComException("This listener is not registered !");
+        }
+    }
+
     /**
      * <p>Discards data sent to port but not transmitted, or data received but not read. Some device/OS/driver might
      * not have support for this, but most of them may have.
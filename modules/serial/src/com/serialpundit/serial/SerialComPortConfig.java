@@ -0,0 +1,417 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial;
+
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.FLOWCONTROL;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+
+/**
+ * <p>Encapsulates complete configuration (frame format, flow control, read behaviour and modem
+ * control lines) of a serial port so that it can be applied in one go using applyComPortConfig()
+ * method of SerialComManager class.</p>
+ *
+ * <p>The settings are grouped. When a configuration is applied to a port which already has a
+ * configuration applied through this class, only the groups which differ are pushed to the driver.
+ * This avoids redundant termios changes (which for USB-UART converters are USB control transfers)
+ * when a port is re-opened or re-configured with the same settings.</p>
+ *
+ * <p>By default the frame is 8N1 at 9600 baud, no flow control, read behaviour is left untouched,
+ * RTS and DTR are asserted and no buffer is cleared.</p>
+ *
+ * @author Rishi Gupta
+ */
+public final class SerialComPortConfig {
+
+    private DATABITS mDataBits = DATABITS.DB_8;
+    private STOPBITS mStopBits = STOPBITS.SB_1;
+    private PARITY mParity = PARITY.P_NONE;
+    private BAUDRATE mBaudRate = BAUDRATE.B9600;
+    private int mCustBaud = 0;
+
+    private FLOWCONTROL mFlowControl = FLOWCONTROL.NONE;
+    private char mXon = 0x11;
+    private char mXoff = 0x13;
+    private boolean mParFraError = false;
+    private boolean mOverFlowErr = false;
+
+    private boolean mTuneRead = false;
+    private int mVmin = 0;
+    private int mVtime = 0;
+    private int mRit = 0;
+    private int mRttm = 0;
+    private int mRttc = 0;
+
+    private boolean mRTS = true;
+    private boolean mDTR = true;
+
+    private boolean mClearRxBuffer = false;
+    private boolean mClearTxBuffer = false;
+
+    /**
+     * <p>Allocates a new SerialComPortConfig object with default settings.</p>
+     */
+    public SerialComPortConfig() {
+    }
+
+    /**
+     * <p>Allocates a new SerialComPortConfig object which is copy of the given configuration.</p>
+     *
+     * @param config configuration to copy.
+     * @throws IllegalArgumentException if config is null.
+     */
+    public SerialComPortConfig(SerialComPortConfig config) {
+        if(config == null) {
+            throw new IllegalArgumentException("Argument config can not be null !");
+        }
+        mDataBits = config.mDataBits;
+        mStopBits = config.mStopBits;
+        mParity = config.mParity;
+        mBaudRate = config.mBaudRate;
+        mCustBaud = config.mCustBaud;
+        mFlowControl = config.mFlowControl;
+        mXon = config.mXon;
+        mXoff = config.mXoff;
+        mParFraError = config.mParFraError;
+        mOverFlowErr = config.mOverFlowErr;
+        mTuneRead = config.mTuneRead;
+        mVmin = config.mVmin;
+        mVtime = config.mVtime;
+        mRit = config.mRit;
+        mRttm = config.mRttm;
+        mRttc = config.mRttc;
+        mRTS = config.mRTS;
+        mDTR = config.mDTR;
+        mClearRxBuffer = config.mClearRxBuffer;
+        mClearTxBuffer = config.mClearTxBuffer;
+    }
+
+    /**
+     * <p>Set the rate and format of UART frame. Refer configureComPortData() method of SerialComManager
+     * class for details.</p>
+     *
+     * @param dataBits number of data bits in one frame.
+     * @param stopBits number of stop bits in one frame.
+     * @param parity of the frame.
+     * @param baudRate of the frame.
+     * @param custBaud custom baudrate if baudRate is BAUDRATE.BCUSTOM, ignored otherwise.
+     * @throws IllegalArgumentException if dataBits or stopBits or parity or baudRate is null, or if custom
+     *         baud rate is requested and custBaud is zero or negative.
+     */
+    public void setDataFormat(DATABITS dataBits, STOPBITS stopBits, PARITY parity, BAUDRATE baudRate, int custBaud) {
+        if((dataBits == null) || (stopBits == null) || (parity == null) || (baudRate == null)) {
+            throw new IllegalArgumentException("Arguments dataBits, stopBits, parity and baudRate can not be null !");
+        }
+        if(baudRate == BAUDRATE.BCUSTOM) {
+            if(custBaud <= 0) {
+                throw new IllegalArgumentException("Argument custBaud can not be negative or zero !");
+            }
+            mCustBaud = custBaud;
+        }else {
+            mCustBaud = 0;
+        }
+        mDataBits = dataBits;
+        mStopBits = stopBits;
+        mParity = parity;
+        mBaudRate = baudRate;
+    }
+
+    /**
+     * <p>Set flow control and error detection behaviour. Refer configureComPortControl() method of
+     * SerialComManager class for details.</p>
+     *
+     * @param flowctrl flow control to use.
+     * @param xon character representing on condition if software flow control is used.
+     * @param xoff character representing off condition if software flow control is used.
+     * @param ParFraError true if parity and frame errors are to be checked false otherwise.
+     * @param overFlowErr true if overflow error is to be detected false otherwise.
+     * @throws IllegalArgumentException if flowctrl is null.
+     */
+    public void setFlowControl(FLOWCONTROL flowctrl, char xon, char xoff, boolean ParFraError, boolean overFlowErr) {
+        if(flowctrl == null) {
+            throw new IllegalArgumentException("Argument flowctrl can not be null !");
+        }
+        mFlowControl = flowctrl;
+        mXon = xon;
+        mXoff = xoff;
+        mParFraError = ParFraError;
+        mOverFlowErr = overFlowErr;
+    }
+
+    /**
+     * <p>Set read behaviour. Refer fineTuneReadBehaviour() method of SerialComManager class for details.
+     * If this method is never called, read behaviour of the port is left as it is.</p>
+     *
+     * @param vmin c_cc[VMIN] field of termios structure (applicable for unix like OS only).
+     * @param vtime c_cc[VTIME] field of termios structure (applicable for unix like OS only).
+     * @param rit ReadIntervalTimeout field of COMMTIMEOUTS structure (applicable for windows OS only).
+     * @param rttm ReadTotalTimeoutMultiplier field of COMMTIMEOUTS structure (applicable for windows OS only).
+     * @param rttc ReadTotalTimeoutConstant field of COMMTIMEOUTS structure (applicable for windows OS only).
+     */
+    public void setReadBehaviour(int vmin, int vtime, int rit, int rttm, int rttc) {
+        mTuneRead = true;
+        mVmin = vmin;
+        mVtime = vtime;
+        mRit = rit;
+        mRttm = rttm;
+        mRttc = rttc;
+    }
+
+    /**
+     * <p>Set the state in which RTS and DTR lines should be once configuration is applied.</p>
+     *
+     * @param rts true if RTS should be asserted.
+     * @param dtr true if DTR should be asserted.
+     */
+    public void setModemLines(boolean rts, boolean dtr) {
+        mRTS = rts;
+        mDTR = dtr;
+    }
+
+    /**
+     * <p>Set which buffers should be cleared after configuration has been applied. This is an action
+     * rather than a setting and is therefore performed every time this configuration is applied.</p>
+     *
+     * @param clearRxBuffer if true receive buffer will be cleared.
+     * @param clearTxBuffer if true transmit buffer will be cleared.
+     */
+    public void setClearBuffers(boolean clearRxBuffer, boolean clearTxBuffer) {
+        mClearRxBuffer = clearRxBuffer;
+        mClearTxBuffer = clearTxBuffer;
+    }
+
+    /**
+     * @return number of data bits in one frame.
+     */
+    public DATABITS getDataBits() {
+        return mDataBits;
+    }
+
+    /**
+     * @return number of stop bits in one frame.
+     */
+    public STOPBITS getStopBits() {
+        return mStopBits;
+    }
+
+    /**
+     * @return parity of the frame.
+     */
+    public PARITY getParity() {
+        return mParity;
+    }
+
+    /**
+     * @return baud rate of the frame.
+     */
+    public BAUDRATE getBaudRate() {
+        return mBaudRate;
+    }
+
+    /**
+     * @return custom baud rate or 0 if standard baud rate is used.
+     */
+    public int getCustBaud() {
+        return mCustBaud;
+    }
+
+    /**
+     * @return flow control to use.
+     */
+    public FLOWCONTROL getFlowControl() {
+        return mFlowControl;
+    }
+
+    /**
+     * @return XON character for software flow control.
+     */
+    public char getXon() {
+        return mXon;
+    }
+
+    /**
+     * @return XOFF character for software flow control.
+     */
+    public char getXoff() {
+        return mXoff;
+    }
+
+    /**
+     * @return true if parity and frame errors are to be checked.
+     */
+    public boolean isParFraErrorChecked() {
+        return mParFraError;
+    }
+
+    /**
+     * @return true if overflow error is to be detected.
+     */
+    public boolean isOverFlowErrChecked() {
+        return mOverFlowErr;
+    }
+
+    /**
+     * @return true if read behaviour will be applied along with this configuration.
+     */
+    public boolean isReadBehaviourSet() {
+        return mTuneRead;
+    }
+
+    /**
+     * @return c_cc[VMIN] value.
+     */
+    public int getVmin() {
+        return mVmin;
+    }
+
+    /**
+     * @return c_cc[VTIME] value.
+     */
+    public int getVtime() {
+        return mVtime;
+    }
+
+    /**
+     * @return ReadIntervalTimeout value.
+     */
+    public int getRit() {
+        return mRit;
+    }
+
+    /**
+     * @return ReadTotalTimeoutMultiplier value.
+     */
+    public int getRttm() {
+        return mRttm;
+    }
+
+    /**
+     * @return ReadTotalTimeoutConstant value.
+     */
+    public int getRttc() {
+        return mRttc;
+    }
+
+    /**
+     * @return true if RTS will be asserted.
+     */
+    public boolean getRTS() {
+        return mRTS;
+    }
+
+    /**
+     * @return true if DTR will be asserted.
+     */
+    public boolean getDTR() {
+        return mDTR;
+    }
+
+    /**
+     * @return true if receive buffer will be cleared when applied.
+     */
+    public boolean isClearRxBuffer() {
+        return mClearRxBuffer;
+    }
+
+    /**
+     * @return true if transmit buffer will be cleared when applied.
+     */
+    public boolean isClearTxBuffer() {
+        return mClearTxBuffer;
+    }
+
+    /**
+     * <p>Tells whether frame format settings of this and given configuration are same or not.</p>
+     *
+     * @param config configuration to compare with, may be null.
+     * @return true if both have same data bits, stop bits, parity and baud rate.
+     */
+    public boolean isDataFormatSame(SerialComPortConfig config) {
+        if(config == null) {
+            return false;
+        }
+        return (mDataBits == config.mDataBits) && (mStopBits == config.mStopBits) && (mParity == config.mParity)
+                && (mBaudRate == config.mBaudRate) && (mCustBaud == config.mCustBaud);
+    }
+
+    /**
+     * <p>Tells whether flow control settings of this and given configuration are same or not.</p>
+     *
+     * @param config configuration to compare with, may be null.
+     * @return true if both have same flow control and error detection settings.
+     */
+    public boolean isFlowControlSame(SerialComPortConfig config) {
+        if(config == null) {
+            return false;
+        }
+        return (mFlowControl == config.mFlowControl) && (mXon == config.mXon) && (mXoff == config.mXoff)
+                && (mParFraError == config.mParFraError) && (mOverFlowErr == config.mOverFlowErr);
+    }
+
+    /**
+     * <p>Tells whether read behaviour settings of this and given configuration are same or not.</p>
+     *
+     * @param config configuration to compare with, may be null.
+     * @return true if both have same read behaviour settings.
+     */
+    public boolean isReadBehaviourSame(SerialComPortConfig config) {
+        if(config == null) {
+            return false;
+        }
+        return (mTuneRead == config.mTuneRead) && (mVmin == config.mVmin) && (mVtime == config.mVtime)
+                && (mRit == config.mRit) && (mRttm == config.mRttm) && (mRttc == config.mRttc);
+    }
+
+    /**
+     * <p>Two configurations are equal if applying one to a port configured with the other will not
+     * change any setting. Buffer clearing actions are not settings and are not compared.</p>
+     */
+    @Override
+    public boolean equals(Object obj) {
+        if(this == obj) {
+            return true;
+        }
+        if(!(obj instanceof SerialComPortConfig)) {
+            return false;
+        }
+        SerialComPortConfig config = (SerialComPortConfig) obj;
+        return isDataFormatSame(config) && isFlowControlSame(config) && isReadBehaviourSame(config)
+                && (mRTS == config.mRTS) && (mDTR == config.mDTR);
+    }
+
+    @Override
+    public int hashCode() {
+        int result = mDataBits.getValue();
+        result = (31 * result) + mStopBits.getValue();
+        result = (31 * result) + mParity.getValue();
+        result = (31 * result) + mBaudRate.getValue();
+        result = (31 * result) + mCustBaud;
+        result = (31 * result) + mFlowControl.getValue();
+        result = (31 * result) + mXon;
+        result = (31 * result) + mXoff;
+        result = (31 * result) + (mParFraError ? 1 : 0);
+        result = (31 * result) + (mOverFlowErr ? 1 : 0);
+        result = (31 * result) + (mTuneRead ? 1 : 0);
+        result = (31 * result) + mVmin;
+        result = (31 * result) + mVtime;
+        result = (31 * result) + mRit;
+        result = (31 * result) + mRttm;
+        result = (31 * result) + mRttc;
+        result = (31 * result) + (mRTS ? 1 : 0);
+        result = (31 * result) + (mDTR ? 1 : 0);
+        return result;
+    }
+}
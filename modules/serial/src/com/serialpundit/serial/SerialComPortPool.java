@@ -0,0 +1,382 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.Map;
+
+import com.serialpundit.core.SerialComException;
+import com.serialpundit.core.SerialComTimeOutException;
+
+/**
+ * <p>Keeps opened and configured serial port handles around so that applications which open a port,
+ * do one transaction and close it again do not pay the cost of opening the device and setting up the
+ * terminal every time.</p>
+ *
+ * <ul>
+ * <li>A port is lent to one borrower at a time. A second borrower of the same port waits until the
+ * handle is released or the given wait time expires.</li>
+ *
+ * <li><p>Before an idle handle is lent again, its health is checked by reading status of modem control
+ * lines. If this fails (for example USB-UART converter has been unplugged) the handle is closed and the
+ * port is opened again.</p></li>
+ *
+ * <li>The configuration requested by borrower is applied using applyComPortConfig() method of
+ * SerialComManager, which passes only the settings that differ from the ones already applied to
+ * native layer. Borrowing with the same configuration again therefore costs no termios change.</li>
+ *
+ * <li><p>Handles which have not been borrowed for the given idle time are closed by a background
+ * thread.</p></li>
+ * </ul>
+ *
+ * <p>Handles are opened with exclusive ownership, read and write access. Application must not close
+ * a lent handle itself; it should call invalidate() if it found the handle to be unusable. Listeners and
+ * byte streams registered on a lent handle must be unregistered/closed before it is released.</p>
+ *
+ * <p>This class is thread safe.</p>
+ *
+ * @author Rishi Gupta
+ */
+public final class SerialComPortPool {
+
+    /**
+     * <p>Represents a pooled port and its state.</p>
+     */
+    private static final class PooledPort {
+        private final String mPortName;
+        private long mHandle = -1;
+        private boolean mBusy = false;
+        private long mLastReleaseTime = 0;
+
+        PooledPort(String portName) {
+            mPortName = portName;
+        }
+    }
+
+    /**
+     * <p>Periodically closes handles which stayed idle for longer than idle time out.</p>
+     */
+    private final class IdleEvictor implements Runnable {
+        @Override
+        public void run() {
+            while(true) {
+                try {
+                    Thread.sleep(mEvictionInterval);
+                } catch (InterruptedException e) {
+                    if(mClosed == true) {
+                        break;
+                    }
+                }
+                if(mClosed == true) {
+                    break;
+                }
+                evictIdle();
+            }
+        }
+    }
+
+    private final SerialComManager mSerialComManager;
+    private final long mIdleTimeOut;
+    private final long mEvictionInterval;
+    private final HashMap<String, PooledPort> mPorts = new HashMap<String, PooledPort>();
+    private final HashMap<Long, PooledPort> mLentPorts = new HashMap<Long, PooledPort>();
+    private final Object mLock = new Object();
+    private Thread mEvictorThread = null;
+    private volatile boolean mClosed = false;
+
+    /**
+     * <p>Allocates a new SerialComPortPool object.</p>
+     *
+     * @param scm instance of SerialComManager used to open, configure and close ports.
+     * @param idleTimeOut time in milliseconds after which an idle handle will be closed, 0 if idle
+     *         handles should never be closed by pool itself.
+     * @throws IllegalArgumentException if scm is null or idleTimeOut is negative.
+     */
+    public SerialComPortPool(SerialComManager scm, long idleTimeOut) {
+        if(scm == null) {
+            throw new IllegalArgumentException("Argument scm can not be null !");
+        }
+        if(idleTimeOut < 0) {
+            throw new IllegalArgumentException("Argument idleTimeOut can not be negative !");
+        }
+
+        mSerialComManager = scm;
+        mIdleTimeOut = idleTimeOut;
+        mEvictionInterval = (idleTimeOut > 2) ? (idleTimeOut / 2) : 1;
+
+        if(idleTimeOut > 0) {
+            mEvictorThread = new Thread(new IdleEvictor(), "SerialPundit PortPool IdleEvictor");
+            mEvictorThread.setDaemon(true);
+            mEvictorThread.start();
+        }
+    }
+
+    /**
+     * <p>Lend a handle to the given port configured as per given configuration. The port is opened if
+     * it is not already in the pool or if its pooled handle failed health check.</p>
+     *
+     * @param portName name of the port to borrow.
+     * @param config configuration which the port should have when it is handed over.
+     * @param waitTime time in milliseconds to wait if port is currently lent to some other borrower, 0
+     *         to fail immediately.
+     * @return handle of the opened and configured port.
+     * @throws SerialComTimeOutException if the port did not become free within waitTime.
+     * @throws SerialComException if the port can not be opened or configured, or thread is interrupted
+     *         while waiting.
+     * @throws IllegalStateException if pool has been closed.
+     * @throws IllegalArgumentException if portName or config is null, or waitTime is negative.
+     */
+    public long acquire(final String portName, final SerialComPortConfig config, long waitTime) throws SerialComException,
+    SerialComTimeOutException {
+
+        PooledPort port = null;
+
+        if(portName == null) {
+            throw new IllegalArgumentException("Argument portName can not be null !");
+        }
+        if(config == null) {
+            throw new IllegalArgumentException("Argument config can not be null !");
+        }
+        if(waitTime < 0) {
+            throw new IllegalArgumentException("Argument waitTime can not be negative !");
+        }
+
+        String portNameVal = portName.trim();
+
+        synchronized(mLock) {
+            if(mClosed == true) {
+                throw new IllegalStateException("The port pool has been closed !");
+            }
+            port = mPorts.get(portNameVal);
+            if(port == null) {
+                port = new PooledPort(portNameVal);
+                mPorts.put(portNameVal, port);
+            }
+
+            long deadline = System.currentTimeMillis() + waitTime;
+            while(port.mBusy == true) {
+                long remaining = deadline - System.currentTimeMillis();
+                if(remaining <= 0) {
+                    throw new SerialComTimeOutException("The port " + portNameVal + " is lent to other borrower !");
+                }
+                try {
+                    mLock.wait(remaining);
+                } catch (InterruptedException e) {
+                    throw (SerialComException) new SerialComException("Interrupted while waiting for port !").initCause(e);
+                }
+                if(mClosed == true) {
+                    throw new IllegalStateException("The port pool has been closed !");
+                }
+            }
+            port.mBusy = true;
+        }
+
+        // Native calls are made without holding lock so that other ports can be lent in parallel. Port is
+        // given back on any failure including invalid configuration, otherwise it would stay busy for ever.
+        boolean lent = false;
+        try {
+            if((port.mHandle != -1) && (isHealthy(port.mHandle) == false)) {
+                if(closeQuietly(port) == false) {
+                    throw new SerialComException("Could not close stale handle of port " + port.mPortName + " !");
+                }
+            }
+            if(port.mHandle == -1) {
+                port.mHandle = mSerialComManager.openComPort(port.mPortName, true, true, true, config);
+            }else {
+                mSerialComManager.applyComPortConfig(port.mHandle, config);
+            }
+            synchronized(mLock) {
+                mLentPorts.put(port.mHandle, port);
+            }
+            lent = true;
+        } finally {
+            if(lent == false) {
+                synchronized(mLock) {
+                    port.mBusy = false;
+                    mLock.notifyAll();
+                }
+            }
+        }
+
+        return port.mHandle;
+    }
+
+    /**
+     * <p>Return the borrowed handle to pool. The port remains opened and configured. If the pool has been
+     * closed in the meantime, the port is closed.</p>
+     *
+     * @param handle handle obtained from acquire() method.
+     * @throws SerialComException if the given handle was not lent by this pool.
+     */
+    public void release(long handle) throws SerialComException {
+        PooledPort port = null;
+        boolean closeNow = false;
+
+        synchronized(mLock) {
+            port = mLentPorts.remove(handle);
+            if(port == null) {
+                throw new SerialComException("Given handle is alien to me !");
+            }
+            if(mClosed == true) {
+                closeNow = true;
+            }else {
+                port.mLastReleaseTime = System.currentTimeMillis();
+                port.mBusy = false;
+                mLock.notifyAll();
+            }
+        }
+
+        if(closeNow == true) {
+            closeQuietly(port);
+        }
+    }
+
+    /**
+     * <p>Return the borrowed handle to pool informing that it is not usable any more. The handle is closed and
+     * the port will be opened again when it is borrowed next time.</p>
+     *
+     * @param handle handle obtained from acquire() method.
+     * @throws SerialComException if the given handle was not lent by this pool.
+     */
+    public void invalidate(long handle) throws SerialComException {
+        PooledPort port = null;
+
+        synchronized(mLock) {
+            port = mLentPorts.remove(handle);
+            if(port == null) {
+                throw new SerialComException("Given handle is alien to me !");
+            }
+        }
+
+        closeQuietly(port);
+
+        synchronized(mLock) {
+            port.mBusy = false;
+            mLock.notifyAll();
+        }
+    }
+
+    /**
+     * <p>Close all idle handles which have not been borrowed for idle time out given when creating this pool.
+     * This is called periodically from background thread, but application may also call it explicitly.</p>
+     *
+     * @return number of handles closed.
+     */
+    public int evictIdle() {
+        ArrayList<PooledPort> toEvict = new ArrayList<PooledPort>();
+        long now = System.currentTimeMillis();
+
+        synchronized(mLock) {
+            for (Map.Entry<String, PooledPort> entry : mPorts.entrySet()) {
+                PooledPort port = entry.getValue();
+                if((port.mBusy == false) && (port.mHandle != -1) && ((now - port.mLastReleaseTime) >= mIdleTimeOut)) {
+                    // mark busy so that no one borrows it while we are closing it
+                    port.mBusy = true;
+                    toEvict.add(port);
+                }
+            }
+        }
+
+        int evicted = 0;
+        for(PooledPort port : toEvict) {
+            if(closeQuietly(port) == true) {
+                evicted++;
+            }
+        }
+
+        synchronized(mLock) {
+            for(PooledPort port : toEvict) {
+                port.mBusy = false;
+            }
+            if(toEvict.size() > 0) {
+                mLock.notifyAll();
+            }
+        }
+
+        return evicted;
+    }
+
+    /**
+     * <p>Gives number of ports currently opened by this pool (both idle and lent).</p>
+     *
+     * @return number of opened handles.
+     */
+    public int getOpenedPortCount() {
+        int count = 0;
+        synchronized(mLock) {
+            for (Map.Entry<String, PooledPort> entry : mPorts.entrySet()) {
+                if(entry.getValue().mHandle != -1) {
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+
+    /**
+     * <p>Close all idle handles and stop background eviction. Lent handles are closed when they are released
+     * or invalidated. Pool can not be used any more after this method returns.</p>
+     */
+    public void close() {
+        ArrayList<PooledPort> toClose = new ArrayList<PooledPort>();
+
+        synchronized(mLock) {
+            if(mClosed == true) {
+                return;
+            }
+            mClosed = true;
+            for (Map.Entry<String, PooledPort> entry : mPorts.entrySet()) {
+                PooledPort port = entry.getValue();
+                if((port.mBusy == false) && (port.mHandle != -1)) {
+                    port.mBusy = true;
+                    toClose.add(port);
+                }
+            }
+            mLock.notifyAll();
+        }
+
+        if(mEvictorThread != null) {
+            mEvictorThread.interrupt();
+        }
+
+        for(PooledPort port : toClose) {
+            closeQuietly(port);
+        }
+    }
+
+    /* Line status can be read only if device is still there and driver is responding. */
+    private boolean isHealthy(long handle) {
+        try {
+            mSerialComManager.getLinesStatus(handle);
+            return true;
+        } catch (Exception e) {
+            return false;
+        }
+    }
+
+    /* Handle is forgotten only if it really got closed, otherwise closing is tried again next time. */
+    private boolean closeQuietly(PooledPort port) {
+        if(port.mHandle == -1) {
+            return true;
+        }
+        try {
+            mSerialComManager.closeComPort(port.mHandle);
+        } catch (Exception e) {
+            return false;
+        }
+        port.mHandle = -1;
+        return true;
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial;
+
+/**
+ * <p>Ready to use response matcher for the two most common cases; response ends with a given 
+ * terminator (for example "\r\nOK\r\n" for AT commands) or response has a fixed length (for example 
+ * Modbus RTU reply to a read request).</p>
+ * 
+ * @author Rishi Gupta
+ */
+public final class SerialComResponseMatcher implements ISerialComResponseMatcher {
+
+    private final byte[] mTerminator;
+    private final int mLength;
+
+    /**
+     * <p>Allocates a new SerialComResponseMatcher object which considers response to be complete 
+     * when given number of bytes has been received.</p>
+     * 
+     * @param length number of bytes in response.
+     * @throws IllegalArgumentException if length is zero or negative.
+     */
+    public SerialComResponseMatcher(int length) {
+        if(length <= 0) {
+            throw new IllegalArgumentException("Argument length can not be zero or negative !");
+        }
+        mTerminator = null;
+        mLength = length;
+    }
+
+    /**
+     * <p>Allocates a new SerialComResponseMatcher object which considers response to be complete 
+     * when given terminator bytes have been received. The terminator is included in the response.</p>
+     * 
+     * @param terminator bytes that mark end of response.
+     * @throws IllegalArgumentException if terminator is null or empty.
+     */
+    public SerialComResponseMatcher(byte[] terminator) {
+        if((terminator == null) || (terminator.length == 0)) {
+            throw new IllegalArgumentException("Argument terminator can not be null or empty !");
+        }
+        mTerminator = terminator.clone();
+        mLength = 0;
+    }
+
+    @Override
+    public int match(byte[] buffer, int length) {
+        if(mTerminator == null) {
+            return (length >= mLength) ? mLength : 0;
+        }
+
+        int last = length - mTerminator.length;
+        for(int x = 0; x <= last; x++) {
+            int y = 0;
+            while((y < mTerminator.length) && (buffer[x + y] == mTerminator[y])) {
+                y++;
+            }
+            if(y == mTerminator.length) {
+                return x + y;
+            }
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,405 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial.ftp;
+
+import java.io.IOException;
+import java.io.InputStream;
+
+import com.serialpundit.core.SerialComException;
+
+/**
+ * <p>Streaming decoder for Intel HEX and Motorola S-record firmware images. Records are decoded one line
+ * at a time as the caller asks for data, so a flash loader can start programming as soon as the first
+ * block is available and memory used does not depend upon size of image.</p>
+ *
+ * <p>The readBlock() method copies data directly into the caller's buffer (for example the block buffer
+ * of a transfer engine) and stops at the end of an address-contiguous run, so every block returned can
+ * be written at getBlockAddress() with one write command.</p>
+ *
+ * <ul>
+ * <li>Checksum of every record is verified as it is read. A bad checksum, malformed record, unknown
+ * record type or missing end-of-file/termination record raises SerialComException carrying line number.
+ * Data of records before a bad record may already have been returned.</li>
+ *
+ * <li><p>Intel HEX record types 00 to 05 (data, end of file, extended segment/linear address, start
+ * segment/linear address) are supported. For S-records, S0 is skipped, S1/S2/S3 carry data, S5/S6 record
+ * count is verified and S7/S8/S9 give start address and terminate the image.</p></li>
+ * </ul>
+ *
+ * <p>This class is not thread safe and the caller is responsible for closing the input stream.</p>
+ *
+ * @author Rishi Gupta
+ */
+public final class SerialComHexDecoder {
+
+    /**
+     * <p>Format of the firmware image. AUTO detects format from the first record.</p>
+     */
+    public enum FORMAT {
+        AUTO, INTEL_HEX, SREC;
+    }
+
+    private static final int MAX_LINE_LENGTH = 600;
+
+    private final InputStream mInStream;
+    private FORMAT mFormat;
+    private final byte[] mInBuffer = new byte[4096];
+    private int mInPos = 0;
+    private int mInLen = 0;
+    private final byte[] mLine = new byte[MAX_LINE_LENGTH];
+    private int mLineNumber = 0;
+
+    private final byte[] mRecord = new byte[260];
+    private int mDataOffset = 0;
+    private int mDataLength = 0;
+    private int mDataPos = 0;
+    private long mDataAddress = 0;
+
+    private long mBaseAddress = 0;
+    private long mStartAddress = -1;
+    private long mBlockAddress = 0;
+    private int mDataRecordCount = 0;
+    private boolean mEndOfImage = false;
+
+    /**
+     * <p>Allocates a new SerialComHexDecoder object which will read records from the given stream.</p>
+     *
+     * @param in stream to read image from, need not be buffered.
+     * @param format format of the image or FORMAT.AUTO.
+     * @throws IllegalArgumentException if in or format is null.
+     */
+    public SerialComHexDecoder(InputStream in, FORMAT format) {
+        if(in == null) {
+            throw new IllegalArgumentException("Argument in can not be null !");
+        }
+        if(format == null) {
+            throw new IllegalArgumentException("Argument format can not be null !");
+        }
+        mInStream = in;
+        mFormat = format;
+    }
+
+    /**
+     * <p>Decodes records until the given buffer is full or the next data byte is not at the address following
+     * the last byte copied. Address of first byte copied is given by getBlockAddress().</p>
+     *
+     * @param buffer buffer in which data will be placed.
+     * @param offset position in buffer from where data will be placed.
+     * @param length maximum number of bytes to place.
+     * @return number of bytes placed in buffer or -1 if there is no more data in image.
+     * @throws SerialComException if image is malformed or a record checksum does not match.
+     * @throws IOException if reading from input stream fails.
+     * @throws IllegalArgumentException if buffer is null, or offset/length are not within buffer or length is 0.
+     */
+    public int readBlock(byte[] buffer, int offset, int length) throws IOException {
+        int count = 0;
+
+        if(buffer == null) {
+            throw new IllegalArgumentException("Argument buffer can not be null !");
+        }
+        if((offset < 0) || (length <= 0) || ((offset + length) > buffer.length)) {
+            throw new IllegalArgumentException("Arguments offset and length must define a non empty range within buffer !");
+        }
+
+        while(count < length) {
+            if(mDataPos == mDataLength) {
+                if(nextDataRecord() == false) {
+                    break;
+                }
+                if((count > 0) && (mDataAddress != (mBlockAddress + count))) {
+                    // record stays pending and starts next block
+                    break;
+                }
+            }
+            if(count == 0) {
+                mBlockAddress = mDataAddress + mDataPos;
+            }
+            int toCopy = mDataLength - mDataPos;
+            if(toCopy > (length - count)) {
+                toCopy = length - count;
+            }
+            System.arraycopy(mRecord, mDataOffset + mDataPos, buffer, offset + count, toCopy);
+            mDataPos += toCopy;
+            count += toCopy;
+        }
+
+        return (count == 0) ? -1 : count;
+    }
+
+    /**
+     * <p>Gives address at which the data returned by last readBlock() call starts.</p>
+     *
+     * @return absolute address of first byte of last block.
+     */
+    public long getBlockAddress() {
+        return mBlockAddress;
+    }
+
+    /**
+     * <p>Gives execution start address if image contained one (Intel HEX type 03/05 or S7/S8/S9 record). It is
+     * known only after the whole image has been read, i.e. after readBlock() returned -1. For type 03 record
+     * the linear address CS * 16 + IP is returned.</p>
+     *
+     * @return start address or -1 if not present in image.
+     */
+    public long getStartAddress() {
+        return mStartAddress;
+    }
+
+    /**
+     * <p>Gives the number of the line processed last, useful in diagnostics.</p>
+     *
+     * @return line number starting from 1.
+     */
+    public int getLineNumber() {
+        return mLineNumber;
+    }
+
+    /**
+     * <p>Gives format of image; once first record has been read, AUTO is replaced by the detected format.</p>
+     *
+     * @return format of the image.
+     */
+    public FORMAT getFormat() {
+        return mFormat;
+    }
+
+    /* Reads records until one with data is found, handling address and control records on the way. */
+    private boolean nextDataRecord() throws IOException {
+        while(mEndOfImage == false) {
+            int lineLength = readLine();
+            if(lineLength < 0) {
+                throw new SerialComException("Image ended without end of file record at line " + mLineNumber + " !");
+            }
+            if(lineLength == 0) {
+                continue;
+            }
+            if(mFormat == FORMAT.AUTO) {
+                if(mLine[0] == ':') {
+                    mFormat = FORMAT.INTEL_HEX;
+                }else if(mLine[0] == 'S') {
+                    mFormat = FORMAT.SREC;
+                }else {
+                    throw new SerialComException("Unknown image format at line " + mLineNumber + " !");
+                }
+            }
+
+            boolean hasData = (mFormat == FORMAT.INTEL_HEX) ? decodeIntelHex(lineLength) : decodeSrec(lineLength);
+            if((hasData == true) && (mDataLength > 0)) {
+                mDataPos = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    private boolean decodeIntelHex(int lineLength) throws SerialComException {
+        if(mLine[0] != ':') {
+            throw new SerialComException("Record does not start with ':' at line " + mLineNumber + " !");
+        }
+        int numBytes = decodeBytes(1, lineLength);
+        if((numBytes < 5) || (numBytes != ((mRecord[0] & 0xFF) + 5))) {
+            throw new SerialComException("Record length mismatch at line " + mLineNumber + " !");
+        }
+        int sum = 0;
+        for(int x=0; x<numBytes; x++) {
+            sum += mRecord[x];
+        }
+        if((sum & 0xFF) != 0) {
+            throw new SerialComException("Checksum mismatch at line " + mLineNumber + " !");
+        }
+
+        int dataLength = mRecord[0] & 0xFF;
+        int address = ((mRecord[1] & 0xFF) << 8) | (mRecord[2] & 0xFF);
+        int type = mRecord[3] & 0xFF;
+
+        switch(type) {
+        case 0x00:
+            mDataOffset = 4;
+            mDataLength = dataLength;
+            mDataAddress = mBaseAddress + address;
+            mDataRecordCount++;
+            return true;
+        case 0x01:
+            mEndOfImage = true;
+            return false;
+        case 0x02:
+            checkLength(dataLength, 2);
+            mBaseAddress = (long) getUnsigned(4, 2) << 4;
+            return false;
+        case 0x03:
+            checkLength(dataLength, 4);
+            mStartAddress = ((long) getUnsigned(4, 2) << 4) + getUnsigned(6, 2);
+            return false;
+        case 0x04:
+            checkLength(dataLength, 2);
+            mBaseAddress = (long) getUnsigned(4, 2) << 16;
+            return false;
+        case 0x05:
+            checkLength(dataLength, 4);
+            mStartAddress = getUnsigned(4, 4);
+            return false;
+        default:
+            throw new SerialComException("Unknown record type " + type + " at line " + mLineNumber + " !");
+        }
+    }
+
+    private boolean decodeSrec(int lineLength) throws SerialComException {
+        if((mLine[0] != 'S') || (lineLength < 2)) {
+            throw new SerialComException("Record does not start with 'S' at line " + mLineNumber + " !");
+        }
+        int type = mLine[1] - '0';
+        int numBytes = decodeBytes(2, lineLength);
+        if((numBytes < 3) || (numBytes != ((mRecord[0] & 0xFF) + 1))) {
+            throw new SerialComException("Record length mismatch at line " + mLineNumber + " !");
+        }
+        int sum = 0;
+        for(int x=0; x<numBytes; x++) {
+            sum += mRecord[x];
+        }
+        if((sum & 0xFF) != 0xFF) {
+            throw new SerialComException("Checksum mismatch at line " + mLineNumber + " !");
+        }
+
+        int addressLength;
+        switch(type) {
+        case 0:
+        case 1:
+        case 5:
+        case 9:
+            addressLength = 2;
+            break;
+        case 2:
+        case 6:
+        case 8:
+            addressLength = 3;
+            break;
+        case 3:
+        case 7:
+            addressLength = 4;
+            break;
+        default:
+            throw new SerialComException("Unknown record type S" + type + " at line " + mLineNumber + " !");
+        }
+        // count byte covers address, data and checksum
+        int dataLength = numBytes - 2 - addressLength;
+        if(dataLength < 0) {
+            throw new SerialComException("Record length mismatch at line " + mLineNumber + " !");
+        }
+        long address = getUnsigned(1, addressLength);
+
+        switch(type) {
+        case 0:
+            return false;
+        case 1:
+        case 2:
+        case 3:
+            mDataOffset = 1 + addressLength;
+            mDataLength = dataLength;
+            mDataAddress = address;
+            mDataRecordCount++;
+            return true;
+        case 5:
+        case 6:
+            if(address != mDataRecordCount) {
+                throw new SerialComException("Record count " + address + " does not match " + mDataRecordCount
+                        + " data records at line " + mLineNumber + " !");
+            }
+            return false;
+        default:
+            mStartAddress = address;
+            mEndOfImage = true;
+            return false;
+        }
+    }
+
+    private void checkLength(int dataLength, int expected) throws SerialComException {
+        if(dataLength != expected) {
+            throw new SerialComException("Record length mismatch at line " + mLineNumber + " !");
+        }
+    }
+
+    private long getUnsigned(int index, int length) {
+        long value = 0;
+        for(int x=0; x<length; x++) {
+            value = (value << 8) | (mRecord[index + x] & 0xFF);
+        }
+        return value;
+    }
+
+    /* Converts hex digit pairs in line starting at given index into mRecord, returns number of bytes. */
+    private int decodeBytes(int start, int lineLength) throws SerialComException {
+        if(((lineLength - start) & 1) != 0) {
+            throw new SerialComException("Odd number of hex digits at line " + mLineNumber + " !");
+        }
+        int numBytes = (lineLength - start) / 2;
+        if(numBytes > mRecord.length) {
+            throw new SerialComException("Record too long at line " + mLineNumber + " !");
+        }
+        for(int x=0; x<numBytes; x++) {
+            int hi = hexValue(mLine[start + (2 * x)]);
+            int lo = hexValue(mLine[start + (2 * x) + 1]);
+            mRecord[x] = (byte) ((hi << 4) | lo);
+        }
+        return numBytes;
+    }
+
+    private int hexValue(byte digit) throws SerialComException {
+        if((digit >= '0') && (digit <= '9')) {
+            return digit - '0';
+        }
+        if((digit >= 'A') && (digit <= 'F')) {
+            return digit - 'A' + 10;
+        }
+        if((digit >= 'a') && (digit <= 'f')) {
+            return digit - 'a' + 10;
+        }
+        throw new SerialComException("Invalid hex digit at line " + mLineNumber + " !");
+    }
+
+    /* Reads one line without trailing white space into mLine, returns its length or -1 at end of stream. */
+    private int readLine() throws IOException {
+        int length = 0;
+        boolean gotAny = false;
+
+        while(true) {
+            if(mInPos == mInLen) {
+                mInLen = mInStream.read(mInBuffer, 0, mInBuffer.length);
+                mInPos = 0;
+                if(mInLen <= 0) {
+                    mInLen = 0;
+                    if(gotAny == false) {
+                        return -1;
+                    }
+                    break;
+                }
+            }
+            byte b = mInBuffer[mInPos++];
+            gotAny = true;
+            if(b == '\n') {
+                break;
+            }
+            if((b == '\r') || (b == ' ') || (b == '\t')) {
+                continue;
+            }
+            if(length == MAX_LINE_LENGTH) {
+                throw new SerialComException("Line too long at line " + (mLineNumber + 1) + " !");
+            }
+            mLine[length++] = b;
+        }
+
+        mLineNumber++;
+        return length;
+    }
+}
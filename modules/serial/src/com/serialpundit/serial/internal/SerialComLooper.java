@@ -20,6 +20,8 @@ import java.util.concurrent.atomic.AtomicBoolean;
 import com.serialpundit.core.SerialComException;
 import com.serialpundit.serial.ISerialComDataListener;
 import com.serialpundit.serial.ISerialComEventListener;
+import com.serialpundit.serial.ISerialComLineEdgeListener;
+import com.serialpundit.serial.SerialComLineEdges;
 import com.serialpundit.serial.SerialComLineEvent;
 import com.serialpundit.serial.SerialComManager;
 
@@ -55,9 +57,27 @@ public final class SerialComLooper {
     private Thread mEventLooperThread = null;
     private AtomicBoolean exitEventThread = null;
 
-    private int appliedMask = SerialComManager.CTS | SerialComManager.DSR | SerialComManager.DCD | SerialComManager.RI;
+    private volatile int appliedMask = SerialComManager.CTS | SerialComManager.DSR | SerialComManager.DCD | SerialComManager.RI;
     private int oldLineState = 0;
     private int newLineState = 0;
+    private final Object mEventLock = new Object();
+
+    /* Edge ring; power of 2 size so that index is (counter & mask). Head and tail are free running 
+     * counters, (head - tail) is number of records yet to be delivered even after int wraps around. */
+    private static final int EDGE_RING_SIZE = 4096;
+    private static final int EDGE_RING_MASK = EDGE_RING_SIZE - 1;
+    private volatile ISerialComLineEdgeListener mEdgeListener = null;
+    private long[] mEdgeTimestamps = null;
+    private int[] mEdgeStates = null;
+    private long[] mBatchTimestamps = null;
+    private int[] mBatchStates = null;
+    private int mEdgeHead = 0;
+    private int mEdgeTail = 0;
+    private int mEdgeTailPrevState = 0;
+    private long mLastEdgeTimestamp = 0;
+    private int mDroppedEdges = 0;
+    private int mCoalescedEdges = 0;
+    private volatile long mCoalescingWindow = 0;
 
     /**
      * <p>This class runs in as a different thread context and keep looping over data queue, delivering 
@@ -139,6 +159,54 @@ public final class SerialComLooper {
         }
     }
 
+    /**
+     * <p>This class runs in as a different thread context and waits for edges to be recorded in edge ring. 
+     * All the edges recorded since last delivery are copied to batch and delivered in one call, so a slow 
+     * listener receives bigger batches instead of falling behind.</p>
+     */
+    class EdgeLooper implements Runnable {
+        @Override
+        public void run() {
+            int count = 0;
+            int index = 0;
+            SerialComLineEdges batch = null;
+            ISerialComLineEdgeListener listener = null;
+
+            while(exitEventThread.get() == false) {
+                synchronized(mEventLock) {
+                    try {
+                        while((mEdgeHead == mEdgeTail) && (exitEventThread.get() == false)) {
+                            mEventLock.wait();
+                        }
+                    } catch (InterruptedException e) {
+                        continue;
+                    }
+                    if(exitEventThread.get() == true) {
+                        break;
+                    }
+                    count = mEdgeHead - mEdgeTail;
+                    for(int x=0; x<count; x++) {
+                        index = (mEdgeTail + x) & EDGE_RING_MASK;
+                        mBatchTimestamps[x] = mEdgeTimestamps[index];
+                        mBatchStates[x] = mEdgeStates[index];
+                    }
+                    batch = new SerialComLineEdges(mBatchTimestamps, mBatchStates, count, mEdgeTailPrevState, 
+                            mDroppedEdges, mCoalescedEdges);
+                    listener = mEdgeListener;
+                    mEdgeTailPrevState = mBatchStates[count - 1];
+                    mEdgeTail = mEdgeHead;
+                    mDroppedEdges = 0;
+                    mCoalescedEdges = 0;
+                }
+                // listener runs without lock so that native thread can keep recording edges
+                if(listener != null) {
+                    listener.onNewLineEdges(batch);
+                }
+            }
+            exitEventThread.set(false); // Reset exit flag
+        }
+    }
+
     /**
      * <p>Allocates a new SerialComLooper object.</p>
      * 
@@ -184,15 +252,65 @@ public final class SerialComLooper {
      * @param newEvent bit mask representing event on serial port control lines.
      */
     public void insertInEventQueue(int newEvent) {
-        newLineState = newEvent & appliedMask;
-        if(mEventQueue.remainingCapacity() == 0) {
-            mEventQueue.poll();
+        if(mEdgeListener != null) {
+            insertInEdgeRing(newEvent);
+            return;
         }
-        try {
-            mEventQueue.offer(new SerialComLineEvent(oldLineState, newLineState));
-        } catch (Exception e) {
+        synchronized(mEventLock) {
+            newLineState = newEvent & appliedMask;
+            if(mEventQueue.remainingCapacity() == 0) {
+                mEventQueue.poll();
+            }
+            try {
+                mEventQueue.offer(new SerialComLineEvent(oldLineState, newLineState));
+            } catch (Exception e) {
+            }
+            oldLineState = newLineState;
+        }
+    }
+
+    /**
+     * <p>Records time stamped edge in edge ring without allocating any object. An edge within coalescing 
+     * window of the last undelivered edge replaces its state; if lines are then back in the state they were 
+     * in before that edge, there is no net change and the edge is removed. If the ring is full, oldest edge 
+     * is dropped.</p>
+     * 
+     * @param newEvent bit mask representing event on serial port control lines.
+     */
+    private void insertInEdgeRing(int newEvent) {
+        long now = System.nanoTime();
+        synchronized(mEventLock) {
+            int state = newEvent & appliedMask;
+            if(state == oldLineState) {
+                return; // change on a masked line
+            }
+            if((mEdgeHead != mEdgeTail) && ((now - mLastEdgeTimestamp) < mCoalescingWindow)) {
+                int prevState = ((mEdgeHead - 1) == mEdgeTail) ? mEdgeTailPrevState : mEdgeStates[(mEdgeHead - 2) & EDGE_RING_MASK];
+                if(state == prevState) {
+                    // pulse shorter than window, both edges are merged away
+                    mEdgeHead--;
+                    mCoalescedEdges += 2;
+                    if(mEdgeHead != mEdgeTail) {
+                        mLastEdgeTimestamp = mEdgeTimestamps[(mEdgeHead - 1) & EDGE_RING_MASK];
+                    }
+                }else {
+                    mEdgeStates[(mEdgeHead - 1) & EDGE_RING_MASK] = state;
+                    mCoalescedEdges++;
+                }
+            }else {
+                if((mEdgeHead - mEdgeTail) == EDGE_RING_SIZE) {
+                    mEdgeTailPrevState = mEdgeStates[mEdgeTail & EDGE_RING_MASK];
+                    mEdgeTail++;
+                    mDroppedEdges++;
+                }
+                mEdgeTimestamps[mEdgeHead & EDGE_RING_MASK] = now;
+                mEdgeStates[mEdgeHead & EDGE_RING_MASK] = state;
+                mEdgeHead++;
+                mLastEdgeTimestamp = now;
+            }
+            oldLineState = state;
+            mEventLock.notify();
         }
-        oldLineState = newLineState;
     }
 
     /**
@@ -224,7 +342,8 @@ public final class SerialComLooper {
     }
 
     /**
-     * <p>Get initial status of control lines and start Java worker thread.</p>
+     * <p>Get initial status of control lines and start Java worker thread. If the listener implements 
+     * ISerialComLineEdgeListener, edges are recorded in edge ring and delivered in batches.</p>
      * 
      * @param handle handle of the opened port for which event looper need to be started.
      * @param eventListener listener to which event will be delivered.
@@ -244,13 +363,32 @@ public final class SerialComLooper {
 
         // Bit mask CTS | DSR | DCD | RI
         state = linestate[0] | linestate[1] | linestate[2] | linestate[3];
-        oldLineState = state & appliedMask;
-
-        mEventQueue = new ArrayBlockingQueue<SerialComLineEvent>(MAX_NUM_EVENTS);
         exitEventThread = new AtomicBoolean(false);
         mEventListener = eventListener;
 
-        mEventLooperThread = new Thread(new EventLooper(), "SerialPundit EventLooper for handle " + handle + " and port " + portName);
+        if(eventListener instanceof ISerialComLineEdgeListener) {
+            synchronized(mEventLock) {
+                oldLineState = state & appliedMask;
+                mEdgeTimestamps = new long[EDGE_RING_SIZE];
+                mEdgeStates = new int[EDGE_RING_SIZE];
+                mBatchTimestamps = new long[EDGE_RING_SIZE];
+                mBatchStates = new int[EDGE_RING_SIZE];
+                mEdgeHead = 0;
+                mEdgeTail = 0;
+                mEdgeTailPrevState = oldLineState;
+                mDroppedEdges = 0;
+                mCoalescedEdges = 0;
+                mEdgeListener = (ISerialComLineEdgeListener) eventListener;
+            }
+            mEventLooperThread = new Thread(new EdgeLooper(), "SerialPundit EdgeLooper for handle " + handle + " and port " + portName);
+        }else {
+            synchronized(mEventLock) {
+                oldLineState = state & appliedMask;
+                mEventQueue = new ArrayBlockingQueue<SerialComLineEvent>(MAX_NUM_EVENTS);
+                mEdgeListener = null;
+            }
+            mEventLooperThread = new Thread(new EventLooper(), "SerialPundit EventLooper for handle " + handle + " and port " + portName);
+        }
         mEventLooperThread.start();
     }
 
@@ -292,6 +430,25 @@ public final class SerialComLooper {
         appliedMask = newMask;
     }
 
+    /**
+     * <p>Edges recorded within given time of the last undelivered edge are merged into it. Applicable only 
+     * when event listener implements ISerialComLineEdgeListener.</p>
+     * 
+     * @param window coalescing window in nanoseconds, 0 to record every edge.
+     */
+    public void setLineEdgeCoalescingWindow(long window) {
+        mCoalescingWindow = window;
+    }
+
+    /**
+     * <p>Gives the edge coalescing window currently active.</p>
+     * 
+     * @return coalescing window in nanoseconds.
+     */
+    public long getLineEdgeCoalescingWindow() {
+        return mCoalescingWindow;
+    }
+
     /**
      * <p>Gives the event mask currently active.</p>
      * 
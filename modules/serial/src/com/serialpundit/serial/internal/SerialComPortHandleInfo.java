@@ -17,6 +17,7 @@ import com.serialpundit.serial.ISerialComDataListener;
 import com.serialpundit.serial.ISerialComEventListener;
 import com.serialpundit.serial.SerialComInByteStream;
 import com.serialpundit.serial.SerialComOutByteStream;
+import com.serialpundit.serial.SerialComPortConfig;
 
 /**
  * <p>Encapsulates the information like port handle, looper object, event listener, 
@@ -33,6 +34,8 @@ public final class SerialComPortHandleInfo {
     private ISerialComDataListener mDataListener = null;
     private SerialComInByteStream mSerialComInByteStream = null;
     private SerialComOutByteStream mSerialComOutByteStream = null;
+    private SerialComPortConfig mAppliedConfig = null;
+    private long mTransactContext = -1;
 
     /**
      * <p>Allocates a new SerialComPortHandleInfo object.</p>
@@ -219,4 +222,37 @@ public final class SerialComPortHandleInfo {
     public void setSerialComOutByteStream(SerialComOutByteStream serialComOutByteStream) {
         this.mSerialComOutByteStream  = serialComOutByteStream;
     }
+
+    /** 
+     * <p>Return the configuration last applied to this port through SerialComPortConfig, or null if 
+     * no such configuration has been applied yet.</p>
+     * @return configuration currently applied to this port/handle
+     */
+    public SerialComPortConfig getAppliedConfig() {
+        return mAppliedConfig;
+    }
+
+    /** 
+     * <p>Set the configuration applied to this port/handle.</p>
+     * @param config copy of the configuration that has been applied successfully
+     */
+    public void setAppliedConfig(SerialComPortConfig config) {
+        this.mAppliedConfig = config;
+    }
+
+    /** 
+     * <p>Return the blocking I/O context used by transact() method for this handle.</p>
+     * @return blocking I/O context or -1 if it has not been created yet
+     */
+    public long getTransactContext() {
+        return mTransactContext;
+    }
+
+    /** 
+     * <p>Set the blocking I/O context used by transact() method for this handle.</p>
+     * @param context blocking I/O context or -1 if it has been destroyed
+     */
+    public void setTransactContext(long context) {
+        this.mTransactContext = context;
+    }
 }
@@ -0,0 +1,793 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial.stm32;
+
+import java.io.IOException;
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Timer;
+import java.util.TimerTask;
+
+import com.serialpundit.core.SerialComException;
+import com.serialpundit.core.SerialComTimeOutException;
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+import com.serialpundit.serial.ftp.SerialComHexDecoder;
+
+/**
+ * <p>Talks to the system memory bootloader of STM32 microcontrollers over UART (AN3155) to erase, write,
+ * verify and start firmware.</p>
+ *
+ * <ul>
+ * <li>Each WRITE MEMORY command is sent as one frame (command, address and data with precomputed checksums)
+ * and its three ACKs are collected later, so a write costs one round trip instead of three. With pipeline
+ * depth greater than 1 the next frames are sent before ACKs of previous ones arrive. Depth 1 is safe for
+ * every bootloader; larger depth needs a bootloader/UART bridge that does not lose bytes while flash is
+ * being programmed.</li>
+ *
+ * <li><p>Pages are erased with EXTENDED ERASE command, up to MAX_ERASE_BATCH pages per command.</p></li>
+ *
+ * <li>Verification compares CRC instead of bytes. If the bootloader lists GET CHECKSUM (0xA1) command, CRC is
+ * computed by target and only 4 bytes travel back; otherwise memory is read back and CRC is computed here.
+ * CRC is the one of STM32 CRC unit (polynomial 0x04C11DB7, initial value 0xFFFFFFFF, 32 bit little endian
+ * words, no reflection).</li>
+ *
+ * <li><p>connect() tries the given baud rates from first to last. At every rate the target is reset (if
+ * DTR is wired to reset), synchronized with 0x7F and probed with several GET/GET ID exchanges which must
+ * give identical answers. First rate which passes is used.</p></li>
+ * </ul>
+ *
+ * <p>Bootloader uses 8 data bits, even parity and 1 stop bit; connect() configures port accordingly.
+ * If any command fails with NACK or time out while writes are pipelined, target state is unknown and
+ * connect() should be called again. This class is not thread safe.</p>
+ *
+ * <p>Reads and writes block in native layer on blocking I/O contexts, which are unblocked when time out
+ * expires (same as SerialComManager.transact()), so waiting for a long erase does not consume CPU. Call
+ * close() to release these contexts before closing the port.</p>
+ *
+ * @author Rishi Gupta
+ */
+public final class SerialComSTM32Bootloader {
+
+    /** <p>Acknowledge byte sent by bootloader.</p>*/
+    public static final byte ACK = 0x79;
+
+    /** <p>Negative acknowledge byte sent by bootloader.</p>*/
+    public static final byte NACK = 0x1F;
+
+    /** <p>Byte sent by host for baud rate detection.</p>*/
+    public static final byte SYNC = 0x7F;
+
+    public static final int CMD_GET = 0x00;
+    public static final int CMD_GET_VERSION = 0x01;
+    public static final int CMD_GET_ID = 0x02;
+    public static final int CMD_READ_MEMORY = 0x11;
+    public static final int CMD_GO = 0x21;
+    public static final int CMD_WRITE_MEMORY = 0x31;
+    public static final int CMD_EXTENDED_ERASE = 0x44;
+    public static final int CMD_GET_CHECKSUM = 0xA1;
+
+    /** <p>Maximum number of bytes read or written by one command.</p>*/
+    public static final int MAX_BLOCK_SIZE = 256;
+
+    /** <p>Maximum number of pages erased by one EXTENDED ERASE command.</p>*/
+    public static final int MAX_ERASE_BATCH = 128;
+
+    /** <p>Polynomial of STM32 CRC unit.</p>*/
+    public static final int CRC_POLYNOMIAL = 0x04C11DB7;
+
+    /** <p>Initial value of STM32 CRC unit.</p>*/
+    public static final int CRC_INITIAL_VALUE = 0xFFFFFFFF;
+
+    private static final int[] CRC_TABLE = new int[256];
+    private static final long SYNC_RETRY_INTERVAL = 100;
+    private static final long MASS_ERASE_TIMEOUT = 30000;
+
+    static {
+        for(int x=0; x<256; x++) {
+            int crc = x << 24;
+            for(int y=0; y<8; y++) {
+                crc = ((crc & 0x80000000) != 0) ? ((crc << 1) ^ CRC_POLYNOMIAL) : (crc << 1);
+            }
+            CRC_TABLE[x] = crc;
+        }
+    }
+
+    private final SerialComManager mSerialComManager;
+    private final long mHandle;
+    private int mPipelineDepth = 1;
+    private long mTimeOut = 1000;
+    private long mEraseTimeOutPerPage = 100;
+    private BAUDRATE mBaudRate = null;
+    private byte[] mCommands = null;
+    private int mVersion = 0;
+    private int mProductId = 0;
+    private final byte[] mResponse = new byte[MAX_BLOCK_SIZE + 8];
+    private final byte[] mFullFrame = new byte[9 + MAX_BLOCK_SIZE];
+    private final byte[] mAddressFrame = new byte[5];
+    private long mReadContext = -1;
+    private long mWriteContext = -1;
+    private Timer mDeadlineTimer = null;
+
+    /* Unblocks read or write blocked on the given context when time out expires. */
+    private final class Deadline extends TimerTask {
+        private final long context;
+        private boolean expired = false;
+        private boolean done = false;
+
+        Deadline(long context, long timeOut) {
+            this.context = context;
+            if(mDeadlineTimer == null) {
+                mDeadlineTimer = new Timer("SerialPundit STM32 bootloader deadline", true);
+            }
+            mDeadlineTimer.schedule(this, timeOut);
+        }
+
+        @Override
+        public synchronized void run() {
+            if(done == false) {
+                expired = true;
+                try {
+                    mSerialComManager.unblockBlockingIOOperation(context);
+                } catch (SerialComException e) {
+                }
+            }
+        }
+
+        synchronized boolean hasExpired() {
+            return expired;
+        }
+
+        /* Returns true if time out expired; context may then still carry the unblock request. */
+        synchronized boolean finish() {
+            done = true;
+            cancel();
+            return expired;
+        }
+    }
+
+    /**
+     * <p>Allocates a new SerialComSTM32Bootloader object for the given port.</p>
+     *
+     * @param scm instance of SerialComManager with which port has been opened.
+     * @param handle of the opened serial port connected to target.
+     * @throws IllegalArgumentException if scm is null.
+     */
+    public SerialComSTM32Bootloader(SerialComManager scm, long handle) {
+        if(scm == null) {
+            throw new IllegalArgumentException("Argument scm can not be null !");
+        }
+        mSerialComManager = scm;
+        mHandle = handle;
+    }
+
+    /**
+     * <p>Sets how many WRITE MEMORY commands may be outstanding (sent but not acknowledged) at a time.</p>
+     *
+     * @param depth number of commands, 1 by default.
+     * @throws IllegalArgumentException if depth is less than 1.
+     */
+    public void setWritePipelineDepth(int depth) {
+        if(depth < 1) {
+            throw new IllegalArgumentException("Argument depth can not be less than 1 !");
+        }
+        mPipelineDepth = depth;
+    }
+
+    /**
+     * <p>Sets time to wait for a response from bootloader and additional time allowed per erased page.</p>
+     *
+     * @param timeOut time out in milliseconds for a response, 1000 by default.
+     * @param eraseTimeOutPerPage time in milliseconds added to time out per erased page, 100 by default.
+     * @throws IllegalArgumentException if timeOut is zero or negative or eraseTimeOutPerPage is negative.
+     */
+    public void setTimeOut(long timeOut, long eraseTimeOutPerPage) {
+        if(timeOut <= 0) {
+            throw new IllegalArgumentException("Argument timeOut can not be zero or negative !");
+        }
+        if(eraseTimeOutPerPage < 0) {
+            throw new IllegalArgumentException("Argument eraseTimeOutPerPage can not be negative !");
+        }
+        mTimeOut = timeOut;
+        mEraseTimeOutPerPage = eraseTimeOutPerPage;
+    }
+
+    /**
+     * <p>Establishes communication with bootloader at highest reliable baud rate among the given ones.</p>
+     *
+     * <p>Bootloader locks its baud rate when it receives first 0x7F after reset, so more than one baud rate
+     * can be tried only if target can be reset. When resetWithDTR is true, DTR is deasserted for 20 ms and then
+     * asserted again before each attempt; hardware should reset target on this edge with BOOT0 held high.</p>
+     *
+     * @param baudRates baud rates to try, highest first.
+     * @param resetWithDTR true if target should be reset using DTR before each attempt.
+     * @param probeRounds number of GET/GET ID exchanges which must succeed to accept a baud rate.
+     * @return baud rate at which communication has been established.
+     * @throws SerialComException if target does not respond reliably at any of the given baud rates.
+     * @throws IllegalArgumentException if baudRates is null or empty, or has more than one entry when
+     *          resetWithDTR is false, or probeRounds is less than 1.
+     */
+    public BAUDRATE connect(BAUDRATE[] baudRates, boolean resetWithDTR, int probeRounds) throws SerialComException {
+        if((baudRates == null) || (baudRates.length == 0)) {
+            throw new IllegalArgumentException("Argument baudRates can not be null or empty !");
+        }
+        if((resetWithDTR == false) && (baudRates.length > 1)) {
+            throw new IllegalArgumentException("Without reset only one baud rate can be tried !");
+        }
+        if(probeRounds < 1) {
+            throw new IllegalArgumentException("Argument probeRounds can not be less than 1 !");
+        }
+
+        mBaudRate = null;
+        for(int x=0; x<baudRates.length; x++) {
+            mSerialComManager.configureComPortData(mHandle, DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_EVEN, baudRates[x], 0);
+            if(resetWithDTR == true) {
+                resetTarget();
+            }
+            mSerialComManager.clearPortIOBuffers(mHandle, true, true);
+            try {
+                if(synchronize() == false) {
+                    continue;
+                }
+                byte[] commands = null;
+                int productId = 0;
+                for(int y=0; y<probeRounds; y++) {
+                    byte[] cmds = get();
+                    int pid = getId();
+                    if(((commands != null) && (Arrays.equals(commands, cmds) == false)) ||
+                            ((y > 0) && (pid != productId))) {
+                        throw new SerialComException("Inconsistent responses during probe !");
+                    }
+                    commands = cmds;
+                    productId = pid;
+                }
+            } catch (IOException e) {
+                // not reliable at this rate, try next one
+                continue;
+            }
+            mBaudRate = baudRates[x];
+            return mBaudRate;
+        }
+
+        throw new SerialComException("Bootloader could not be reached reliably at any of the given baud rates !");
+    }
+
+    /**
+     * <p>Releases blocking I/O contexts and deadline timer. Port itself is not closed. Object can still be 
+     * used afterwards, resources are then allocated again.</p>
+     *
+     * @throws SerialComException if a context could not be destroyed.
+     */
+    public void close() throws SerialComException {
+        if(mDeadlineTimer != null) {
+            mDeadlineTimer.cancel();
+            mDeadlineTimer = null;
+        }
+        if(mReadContext != -1) {
+            long context = mReadContext;
+            mReadContext = -1;
+            mSerialComManager.destroyBlockingIOContext(context);
+        }
+        if(mWriteContext != -1) {
+            long context = mWriteContext;
+            mWriteContext = -1;
+            mSerialComManager.destroyBlockingIOContext(context);
+        }
+    }
+
+    /**
+     * <p>Gives the baud rate found by last successful connect() call.</p>
+     *
+     * @return baud rate or null if not connected.
+     */
+    public BAUDRATE getBaudRate() {
+        return mBaudRate;
+    }
+
+    /**
+     * <p>Gives bootloader version (for example 0x31 for v3.1) as reported by GET command.</p>
+     *
+     * @return bootloader version.
+     */
+    public int getBootloaderVersion() {
+        return mVersion;
+    }
+
+    /**
+     * <p>Gives product ID as reported by GET ID command.</p>
+     *
+     * @return product ID (for example 0x0410).
+     */
+    public int getProductId() {
+        return mProductId;
+    }
+
+    /**
+     * <p>Tells whether bootloader listed the given command in response to GET command.</p>
+     *
+     * @param command command code (for example CMD_GET_CHECKSUM).
+     * @return true if command is supported.
+     */
+    public boolean isCommandSupported(int command) {
+        if(mCommands == null) {
+            return false;
+        }
+        for(int x=0; x<mCommands.length; x++) {
+            if((mCommands[x] & 0xFF) == command) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * <p>Reads memory of target.</p>
+     *
+     * @param address address of first byte to read.
+     * @param buffer buffer in which data will be placed.
+     * @param offset position in buffer from where data will be placed.
+     * @param length number of bytes to read.
+     * @throws SerialComException if bootloader rejects command (for example read protection is active).
+     * @throws SerialComTimeOutException if bootloader does not respond in time.
+     * @throws IllegalArgumentException if buffer is null or offset/length are not within buffer.
+     */
+    public void readMemory(long address, byte[] buffer, int offset, int length) throws SerialComException,
+    SerialComTimeOutException {
+        if(buffer == null) {
+            throw new IllegalArgumentException("Argument buffer can not be null !");
+        }
+        if((offset < 0) || (length < 0) || ((offset + length) > buffer.length)) {
+            throw new IllegalArgumentException("Arguments offset and length must be within buffer !");
+        }
+
+        int done = 0;
+        while(done < length) {
+            int n = (length - done) > MAX_BLOCK_SIZE ? MAX_BLOCK_SIZE : (length - done);
+            sendCommand(CMD_READ_MEMORY);
+            write(addressFrame(address + done));
+            expectAck(mTimeOut);
+            write(new byte[] { (byte) (n - 1), (byte) ~(n - 1) });
+            expectAck(mTimeOut);
+            readExactly(buffer, offset + done, n, mTimeOut);
+            done += n;
+        }
+    }
+
+    /**
+     * <p>Writes data to memory of target. Length is padded to multiple of 4 bytes with 0xFF.</p>
+     *
+     * @param address address at which data will be written, must be multiple of 4.
+     * @param data buffer containing data.
+     * @param offset position in buffer of first byte to write.
+     * @param length number of bytes to write.
+     * @throws SerialComException if bootloader rejects a command.
+     * @throws SerialComTimeOutException if bootloader does not respond in time.
+     * @throws IllegalArgumentException if data is null, address is not multiple of 4 or offset/length are not
+     *          within buffer.
+     */
+    public void writeMemory(long address, byte[] data, int offset, int length) throws SerialComException,
+    SerialComTimeOutException {
+        if(data == null) {
+            throw new IllegalArgumentException("Argument data can not be null !");
+        }
+        if((offset < 0) || (length < 0) || ((offset + length) > data.length)) {
+            throw new IllegalArgumentException("Arguments offset and length must be within buffer !");
+        }
+        if((address & 3) != 0) {
+            throw new IllegalArgumentException("Argument address must be multiple of 4 !");
+        }
+
+        // addresses of frames whose ACKs are still to be read, oldest first
+        ArrayDeque<Long> inFlight = new ArrayDeque<Long>(mPipelineDepth);
+        int done = 0;
+        while(done < length) {
+            int n = (length - done) > MAX_BLOCK_SIZE ? MAX_BLOCK_SIZE : (length - done);
+            write(writeFrame(address + done, data, offset + done, n));
+            inFlight.addLast(address + done);
+            done += n;
+            if(inFlight.size() == mPipelineDepth) {
+                collectWriteAcks(inFlight.removeFirst());
+            }
+        }
+        while(inFlight.isEmpty() == false) {
+            collectWriteAcks(inFlight.removeFirst());
+        }
+    }
+
+    /**
+     * <p>Streams firmware image from decoder to target. Image is never held in memory as a whole; every
+     * address-contiguous block is written as soon as it has been decoded. Pages must have been erased
+     * before. When verify is true, CRC of every contiguous region written is compared after writing.</p>
+     *
+     * @param decoder decoder delivering image.
+     * @param verify true if written regions should be verified.
+     * @return number of bytes written excluding padding.
+     * @throws SerialComException if image is malformed, a block is not word aligned, bootloader rejects a
+     *          command or verification fails.
+     * @throws IOException if image can not be read or bootloader does not respond in time.
+     * @throws IllegalArgumentException if decoder is null.
+     */
+    public long writeImage(SerialComHexDecoder decoder, boolean verify) throws IOException {
+        if(decoder == null) {
+            throw new IllegalArgumentException("Argument decoder can not be null !");
+        }
+
+        // each region : start address, length, crc
+        ArrayList<long[]> regions = new ArrayList<long[]>();
+        long[] region = null;
+        byte[] block = new byte[MAX_BLOCK_SIZE];
+        long total = 0;
+        int n;
+
+        while((n = decoder.readBlock(block, 0, MAX_BLOCK_SIZE)) > 0) {
+            long address = decoder.getBlockAddress();
+            if((address & 3) != 0) {
+                throw new SerialComException(String.format("Image block at 0x%08X is not word aligned !", address));
+            }
+            total += n;
+            while((n & 3) != 0) {
+                block[n++] = (byte) 0xFF;
+            }
+            writeMemory(address, block, 0, n);
+
+            if((region == null) || ((region[0] + region[1]) != address)) {
+                region = new long[] { address, 0, CRC_INITIAL_VALUE & 0xFFFFFFFFL };
+                regions.add(region);
+            }
+            region[1] += n;
+            region[2] = updateCRC((int) region[2], block, 0, n) & 0xFFFFFFFFL;
+        }
+
+        if(verify == true) {
+            for(long[] r : regions) {
+                if(calculateTargetCRC(r[0], (int) r[1]) != (int) r[2]) {
+                    throw new SerialComException(String.format("Verification failed for region at 0x%08X !", r[0]));
+                }
+            }
+        }
+        return total;
+    }
+
+    /**
+     * <p>Verifies that memory of target contains given data by comparing CRC.</p>
+     *
+     * @param address address of first byte, must be multiple of 4.
+     * @param data expected data.
+     * @param offset position in buffer of first byte.
+     * @param length number of bytes, must be multiple of 4.
+     * @return true if CRC of target memory matches.
+     * @throws SerialComException if bootloader rejects a command.
+     * @throws SerialComTimeOutException if bootloader does not respond in time.
+     * @throws IllegalArgumentException if data is null, address or length is not multiple of 4 or
+     *          offset/length are not within buffer.
+     */
+    public boolean verify(long address, byte[] data, int offset, int length) throws SerialComException,
+    SerialComTimeOutException {
+        if(data == null) {
+            throw new IllegalArgumentException("Argument data can not be null !");
+        }
+        if((offset < 0) || (length < 0) || ((offset + length) > data.length)) {
+            throw new IllegalArgumentException("Arguments offset and length must be within buffer !");
+        }
+        if(((address & 3) != 0) || ((length & 3) != 0)) {
+            throw new IllegalArgumentException("Arguments address and length must be multiple of 4 !");
+        }
+        return calculateTargetCRC(address, length) == updateCRC(CRC_INITIAL_VALUE, data, offset, length);
+    }
+
+    /**
+     * <p>Erases given pages using EXTENDED ERASE command, MAX_ERASE_BATCH pages per command.</p>
+     *
+     * @param firstPage number of first page to erase.
+     * @param count number of pages to erase.
+     * @throws SerialComException if bootloader rejects command (for example write protection is active).
+     * @throws SerialComTimeOutException if erase does not complete in time.
+     * @throws IllegalArgumentException if firstPage is negative or count is zero or negative or pages are
+     *          beyond 0xFFEF.
+     */
+    public void erasePages(int firstPage, int count) throws SerialComException, SerialComTimeOutException {
+        if((firstPage < 0) || (count <= 0) || ((firstPage + count) > 0xFFF0)) {
+            throw new IllegalArgumentException("Arguments firstPage and count must give pages in range 0 to 0xFFEF !");
+        }
+
+        int done = 0;
+        while(done < count) {
+            int n = (count - done) > MAX_ERASE_BATCH ? MAX_ERASE_BATCH : (count - done);
+            byte[] frame = new byte[3 + (2 * n)];
+            frame[0] = (byte) ((n - 1) >> 8);
+            frame[1] = (byte) (n - 1);
+            for(int x=0; x<n; x++) {
+                int page = firstPage + done + x;
+                frame[2 + (2 * x)] = (byte) (page >> 8);
+                frame[3 + (2 * x)] = (byte) page;
+            }
+            frame[frame.length - 1] = xor(frame, 0, frame.length - 1);
+            sendCommand(CMD_EXTENDED_ERASE);
+            write(frame);
+            expectAck(mTimeOut + (n * mEraseTimeOutPerPage));
+            done += n;
+        }
+    }
+
+    /**
+     * <p>Erases whole flash memory using special code 0xFFFF of EXTENDED ERASE command.</p>
+     *
+     * @throws SerialComException if bootloader rejects command.
+     * @throws SerialComTimeOutException if erase does not complete within 30 seconds.
+     */
+    public void massErase() throws SerialComException, SerialComTimeOutException {
+        sendCommand(CMD_EXTENDED_ERASE);
+        write(new byte[] { (byte) 0xFF, (byte) 0xFF, 0x00 });
+        expectAck(MASS_ERASE_TIMEOUT);
+    }
+
+    /**
+     * <p>Starts execution of firmware at given address (address of vector table for STM32 firmware).</p>
+     *
+     * @param address address to jump to.
+     * @throws SerialComException if bootloader rejects command.
+     * @throws SerialComTimeOutException if bootloader does not respond in time.
+     */
+    public void go(long address) throws SerialComException, SerialComTimeOutException {
+        sendCommand(CMD_GO);
+        write(addressFrame(address));
+        expectAck(mTimeOut);
+    }
+
+    /**
+     * <p>Calculates CRC in the same way as STM32 CRC unit, data is taken as 32 bit little endian words.</p>
+     *
+     * @param crc initial value (CRC_INITIAL_VALUE) or result of previous call to continue calculation.
+     * @param data buffer containing data.
+     * @param offset position in buffer of first byte.
+     * @param length number of bytes, must be multiple of 4.
+     * @return calculated CRC.
+     * @throws IllegalArgumentException if length is not multiple of 4.
+     */
+    public static int updateCRC(int crc, byte[] data, int offset, int length) {
+        if((length & 3) != 0) {
+            throw new IllegalArgumentException("Argument length must be multiple of 4 !");
+        }
+        for(int x=offset; x<(offset + length); x += 4) {
+            // most significant byte of the little endian word first
+            for(int y=3; y>=0; y--) {
+                crc = (crc << 8) ^ CRC_TABLE[((crc >>> 24) ^ data[x + y]) & 0xFF];
+            }
+        }
+        return crc;
+    }
+
+    /* Uses GET CHECKSUM command if available, otherwise reads memory back and calculates CRC locally. */
+    private int calculateTargetCRC(long address, int length) throws SerialComException, SerialComTimeOutException {
+        if(isCommandSupported(CMD_GET_CHECKSUM) == true) {
+            sendCommand(CMD_GET_CHECKSUM);
+            write(addressFrame(address));
+            expectAck(mTimeOut);
+            write(addressFrame(length));
+            expectAck(mTimeOut);
+            write(addressFrame(CRC_POLYNOMIAL & 0xFFFFFFFFL));
+            expectAck(mTimeOut);
+            write(addressFrame(CRC_INITIAL_VALUE & 0xFFFFFFFFL));
+            expectAck(mTimeOut);
+            // target computes CRC before acknowledging, allow as long as reading the region would take
+            expectAck(mTimeOut + (length / MAX_BLOCK_SIZE));
+            readExactly(mResponse, 0, 5, mTimeOut);
+            if(xor(mResponse, 0, 4) != mResponse[4]) {
+                throw new SerialComException("Checksum of CRC response does not match !");
+            }
+            return (int) getUnsigned(mResponse, 0, 4);
+        }
+
+        int crc = CRC_INITIAL_VALUE;
+        int done = 0;
+        while(done < length) {
+            int n = (length - done) > MAX_BLOCK_SIZE ? MAX_BLOCK_SIZE : (length - done);
+            readMemory(address + done, mResponse, 0, n);
+            crc = updateCRC(crc, mResponse, 0, n);
+            done += n;
+        }
+        return crc;
+    }
+
+    private boolean synchronize() throws SerialComException {
+        long deadline = System.currentTimeMillis() + mTimeOut;
+        byte[] sync = new byte[] { SYNC };
+        while(System.currentTimeMillis() < deadline) {
+            write(sync);
+            try {
+                readExactly(mResponse, 0, 1, SYNC_RETRY_INTERVAL);
+            } catch (SerialComTimeOutException e) {
+                continue;
+            }
+            // NACK means bootloader was already synchronized and took 0x7F as a command
+            return (mResponse[0] == ACK) || (mResponse[0] == NACK);
+        }
+        return false;
+    }
+
+    private byte[] get() throws SerialComException, SerialComTimeOutException {
+        sendCommand(CMD_GET);
+        readExactly(mResponse, 0, 1, mTimeOut);
+        int n = (mResponse[0] & 0xFF) + 1;
+        readExactly(mResponse, 0, n, mTimeOut);
+        expectAck(mTimeOut);
+        mVersion = mResponse[0] & 0xFF;
+        mCommands = new byte[n - 1];
+        System.arraycopy(mResponse, 1, mCommands, 0, n - 1);
+        return mCommands;
+    }
+
+    private int getId() throws SerialComException, SerialComTimeOutException {
+        sendCommand(CMD_GET_ID);
+        readExactly(mResponse, 0, 1, mTimeOut);
+        int n = (mResponse[0] & 0xFF) + 1;
+        readExactly(mResponse, 0, n, mTimeOut);
+        expectAck(mTimeOut);
+        mProductId = (int) getUnsigned(mResponse, 0, n);
+        return mProductId;
+    }
+
+    private void resetTarget() throws SerialComException {
+        mSerialComManager.setDTR(mHandle, false);
+        sleep(20);
+        mSerialComManager.setDTR(mHandle, true);
+        // give bootloader time to start
+        sleep(50);
+    }
+
+    /* Command, address frame, length, data and checksum in one frame; ACKs are collected separately. */
+    private byte[] writeFrame(long address, byte[] data, int offset, int length) {
+        int padded = (length + 3) & ~3;
+        byte[] frame = (padded == MAX_BLOCK_SIZE) ? mFullFrame : new byte[9 + padded];
+        frame[0] = (byte) CMD_WRITE_MEMORY;
+        frame[1] = (byte) ~CMD_WRITE_MEMORY;
+        System.arraycopy(addressFrame(address), 0, frame, 2, 5);
+        frame[7] = (byte) (padded - 1);
+        System.arraycopy(data, offset, frame, 8, length);
+        for(int x=length; x<padded; x++) {
+            frame[8 + x] = (byte) 0xFF;
+        }
+        frame[8 + padded] = xor(frame, 7, padded + 1);
+        return frame;
+    }
+
+    private void collectWriteAcks(long address) throws SerialComException, SerialComTimeOutException {
+        try {
+            expectAck(mTimeOut);
+            expectAck(mTimeOut);
+            expectAck(mTimeOut);
+        } catch (SerialComException e) {
+            throw new SerialComException(String.format("Write memory near 0x%08X failed : %s", address, e.getMessage()));
+        }
+    }
+
+    private void sendCommand(int command) throws SerialComException, SerialComTimeOutException {
+        write(new byte[] { (byte) command, (byte) ~command });
+        expectAck(mTimeOut);
+    }
+
+    private void expectAck(long timeOut) throws SerialComException, SerialComTimeOutException {
+        byte[] reply = new byte[1];
+        readExactly(reply, 0, 1, timeOut);
+        if(reply[0] == NACK) {
+            throw new SerialComException("Bootloader sent NACK !");
+        }
+        if(reply[0] != ACK) {
+            throw new SerialComException(String.format("Unexpected byte 0x%02X instead of ACK !", reply[0] & 0xFF));
+        }
+    }
+
+    private void readExactly(byte[] buffer, int offset, int length, long timeOut) throws SerialComException,
+    SerialComTimeOutException {
+        if(mReadContext == -1) {
+            mReadContext = mSerialComManager.createBlockingIOContext();
+        }
+        Deadline deadline = new Deadline(mReadContext, timeOut);
+        int done = 0;
+        try {
+            while(done < length) {
+                try {
+                    done += mSerialComManager.readBytes(mHandle, buffer, offset + done, length - done, mReadContext, null);
+                } catch (SerialComException e) {
+                    if(deadline.hasExpired() == false) {
+                        throw e;
+                    }
+                }
+                if((done < length) && (deadline.hasExpired() == true)) {
+                    throw new SerialComTimeOutException("Bootloader did not respond in time !");
+                }
+            }
+        } finally {
+            if(deadline.finish() == true) {
+                long context = mReadContext;
+                mReadContext = -1;
+                mSerialComManager.destroyBlockingIOContext(context);
+            }
+        }
+    }
+
+    /* A partially sent frame would desynchronise bootloader, so remaining bytes are sent until all are out. */
+    private void write(byte[] data) throws SerialComException {
+        if(mWriteContext == -1) {
+            mWriteContext = mSerialComManager.createBlockingIOContext();
+        }
+        Deadline deadline = new Deadline(mWriteContext, mTimeOut);
+        byte[] remaining = data;
+        try {
+            while(true) {
+                int ret = 0;
+                try {
+                    ret = mSerialComManager.writeBytesBlocking(mHandle, remaining, mWriteContext);
+                } catch (SerialComException e) {
+                    if(deadline.hasExpired() == false) {
+                        throw e;
+                    }
+                }
+                if(ret >= remaining.length) {
+                    return;
+                }
+                if(ret > 0) {
+                    remaining = Arrays.copyOfRange(remaining, ret, remaining.length);
+                }
+                if(deadline.hasExpired() == true) {
+                    throw new SerialComException("Could not write complete frame to bootloader, " + remaining.length
+                            + " of " + data.length + " bytes not sent !");
+                }
+            }
+        } finally {
+            if(deadline.finish() == true) {
+                long context = mWriteContext;
+                mWriteContext = -1;
+                mSerialComManager.destroyBlockingIOContext(context);
+            }
+        }
+    }
+
+    private byte[] addressFrame(long value) {
+        mAddressFrame[0] = (byte) (value >> 24);
+        mAddressFrame[1] = (byte) (value >> 16);
+        mAddressFrame[2] = (byte) (value >> 8);
+        mAddressFrame[3] = (byte) value;
+        mAddressFrame[4] = xor(mAddressFrame, 0, 4);
+        return mAddressFrame;
+    }
+
+    private static byte xor(byte[] data, int offset, int length) {
+        byte result = 0;
+        for(int x=offset; x<(offset + length); x++) {
+            result ^= data[x];
+        }
+        return result;
+    }
+
+    private static long getUnsigned(byte[] data, int offset, int length) {
+        long value = 0;
+        for(int x=0; x<length; x++) {
+            value = (value << 8) | (data[offset + x] & 0xFF);
+        }
+        return value;
+    }
+
+    private static void sleep(long millis) {
+        try {
+            Thread.sleep(millis);
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+        }
+    }
+}
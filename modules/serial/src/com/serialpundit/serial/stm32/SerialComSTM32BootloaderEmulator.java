@@ -0,0 +1,563 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.serial.stm32;
+
+import java.util.Arrays;
+import java.util.concurrent.locks.LockSupport;
+
+import com.serialpundit.core.SerialComException;
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+
+/**
+ * <p>Software model of STM32 UART bootloader, meant to run on one end of a ttyvs null modem pair so that
+ * SerialComSTM32Bootloader (or any other flashing tool) can be tested without hardware.</p>
+ *
+ * <ul>
+ * <li>Baud rate detection : ttyvs drops data when both ends of a pair have different baud rates. After reset
+ * the emulator therefore switches through its detectable baud rates until 0x7F arrives, then stays at that
+ * rate. Host DTR (seen as DSR here) going low resets the emulator.</li>
+ *
+ * <li><p>Commands GET, GET VERSION, GET ID, READ MEMORY, GO, WRITE MEMORY, EXTENDED ERASE and optionally GET
+ * CHECKSUM are implemented on a flash model at 0x08000000. Like real flash, writing can only clear bits, so
+ * writing without erase is caught by verification.</p></li>
+ *
+ * <li>GET CHECKSUM (0xA1) : after command ACK, host sends address, size in bytes, polynomial and initial
+ * value, each as 4 bytes MSB first followed by XOR checksum and acknowledged. Bootloader then sends ACK,
+ * 4 bytes CRC MSB first and XOR checksum of these 4 bytes.</li>
+ *
+ * <li><p>At baud rates equal to or higher than the marginal baud rate, every n-th byte sent by emulator is
+ * corrupted, emulating a link that is not reliable at that speed.</p></li>
+ * </ul>
+ *
+ * @author Rishi Gupta
+ */
+public final class SerialComSTM32BootloaderEmulator {
+
+    /** <p>Start address of emulated flash memory.</p>*/
+    public static final long FLASH_BASE = 0x08000000L;
+
+    private static final int VERSION = 0x31;
+    private static final int PRODUCT_ID = 0x0410;
+    private static final long BAUD_DWELL_TIME = 30;
+    private static final long POLL_INTERVAL = 100000;
+
+    private final SerialComManager mSerialComManager;
+    private final long mHandle;
+    private final BAUDRATE[] mBaudRates;
+    private final byte[] mFlash;
+    private final int mPageSize;
+    private final byte[] mReadBuffer = new byte[1024];
+    private int mReadPos = 0;
+    private int mReadLen = 0;
+
+    private volatile int mMarginalBaudRate = Integer.MAX_VALUE;
+    private volatile int mErrorInterval = 0;
+    private volatile long mWriteTime = 0;
+    private volatile long mEraseTimePerPage = 0;
+    private volatile boolean mChecksumSupported = true;
+    private volatile BAUDRATE mLockedBaudRate = null;
+    private volatile long mGoAddress = -1;
+    private volatile int mWriteCount = 0;
+    private volatile int mResetCount = 0;
+    private volatile SerialComException mError = null;
+    private int mSentCount = 0;
+    private int mLastDSR = -1;
+
+    private Thread mEmulatorThread = null;
+    private volatile boolean mExit = false;
+
+    /* Thrown from inside command handling when host resets target. */
+    private static final class ResetException extends Exception {
+        private static final long serialVersionUID = 1L;
+    }
+
+    private final class Emulator implements Runnable {
+        @Override
+        public void run() {
+            while(mExit == false) {
+                try {
+                    detectBaudRate();
+                    while(mExit == false) {
+                        handleCommand();
+                    }
+                } catch (ResetException e) {
+                    mResetCount++;
+                } catch (SerialComException e) {
+                    if(mExit == false) {
+                        mError = e;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    /**
+     * <p>Allocates a new SerialComSTM32BootloaderEmulator object with erased flash.</p>
+     *
+     * @param scm instance of SerialComManager with which port has been opened.
+     * @param handle of the opened port on which emulator will respond.
+     * @param baudRates baud rates which emulator can detect.
+     * @param flashSize size of flash memory in bytes.
+     * @param pageSize size of one flash page in bytes.
+     * @throws IllegalArgumentException if scm or baudRates is null or empty, or sizes are not positive or
+     *          flashSize is not multiple of pageSize.
+     */
+    public SerialComSTM32BootloaderEmulator(SerialComManager scm, long handle, BAUDRATE[] baudRates, int flashSize,
+            int pageSize) {
+        if(scm == null) {
+            throw new IllegalArgumentException("Argument scm can not be null !");
+        }
+        if((baudRates == null) || (baudRates.length == 0)) {
+            throw new IllegalArgumentException("Argument baudRates can not be null or empty !");
+        }
+        if((flashSize <= 0) || (pageSize <= 0) || ((flashSize % pageSize) != 0)) {
+            throw new IllegalArgumentException("Argument flashSize must be positive multiple of pageSize !");
+        }
+        mSerialComManager = scm;
+        mHandle = handle;
+        mBaudRates = baudRates.clone();
+        mFlash = new byte[flashSize];
+        mPageSize = pageSize;
+        Arrays.fill(mFlash, (byte) 0xFF);
+    }
+
+    /**
+     * <p>Makes link unreliable at and above given baud rate by corrupting every errorInterval-th byte sent.</p>
+     *
+     * @param baudRate lowest baud rate at which errors occur.
+     * @param errorInterval corrupt one of every errorInterval bytes, 0 to disable errors.
+     */
+    public void setMarginalBaudRate(int baudRate, int errorInterval) {
+        mMarginalBaudRate = baudRate;
+        mErrorInterval = errorInterval;
+    }
+
+    /**
+     * <p>Sets time taken to program one block and to erase one page.</p>
+     *
+     * @param writeTime time in microseconds per WRITE MEMORY command.
+     * @param eraseTimePerPage time in microseconds per erased page.
+     */
+    public void setProgrammingTime(long writeTime, long eraseTimePerPage) {
+        mWriteTime = writeTime;
+        mEraseTimePerPage = eraseTimePerPage;
+    }
+
+    /**
+     * <p>Selects whether GET CHECKSUM command is offered, true by default.</p>
+     *
+     * @param supported false to emulate older bootloaders.
+     */
+    public void setChecksumCommandSupported(boolean supported) {
+        mChecksumSupported = supported;
+    }
+
+    /**
+     * <p>Starts responding on the port.</p>
+     *
+     * @throws IllegalStateException if already started.
+     */
+    public synchronized void start() {
+        if(mEmulatorThread != null) {
+            throw new IllegalStateException("Emulator is already running !");
+        }
+        mExit = false;
+        mError = null;
+        mEmulatorThread = new Thread(new Emulator(), "SerialPundit STM32 bootloader emulator");
+        mEmulatorThread.start();
+    }
+
+    /**
+     * <p>Stops responding and waits for emulator thread to finish.</p>
+     */
+    public synchronized void stop() {
+        if(mEmulatorThread == null) {
+            return;
+        }
+        mExit = true;
+        try {
+            mEmulatorThread.join();
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+        }
+        mEmulatorThread = null;
+    }
+
+    /**
+     * <p>Gives a copy of emulated flash memory.</p>
+     *
+     * @return flash contents.
+     */
+    public byte[] getFlash() {
+        synchronized(mFlash) {
+            return mFlash.clone();
+        }
+    }
+
+    /**
+     * <p>Gives baud rate detected after last reset.</p>
+     *
+     * @return baud rate or null while still detecting.
+     */
+    public BAUDRATE getDetectedBaudRate() {
+        return mLockedBaudRate;
+    }
+
+    /**
+     * <p>Gives address given in last GO command.</p>
+     *
+     * @return address or -1 if GO has not been received.
+     */
+    public long getGoAddress() {
+        return mGoAddress;
+    }
+
+    /**
+     * <p>Gives number of WRITE MEMORY commands executed.</p>
+     *
+     * @return number of write commands.
+     */
+    public int getWriteCount() {
+        return mWriteCount;
+    }
+
+    /**
+     * <p>Gives number of resets seen (DSR going low).</p>
+     *
+     * @return number of resets.
+     */
+    public int getResetCount() {
+        return mResetCount;
+    }
+
+    /**
+     * <p>Gives the error because of which emulator stopped responding, if any.</p>
+     *
+     * @return error that stopped emulator or null if it is running or was stopped by stop() method.
+     */
+    public SerialComException getError() {
+        return mError;
+    }
+
+    private void detectBaudRate() throws SerialComException, ResetException {
+        int index = 0;
+        mLockedBaudRate = null;
+        mReadPos = mReadLen = 0;
+
+        while(mExit == false) {
+            configure(mBaudRates[index]);
+            mSerialComManager.clearPortIOBuffers(mHandle, true, true);
+            long switchTime = System.currentTimeMillis() + BAUD_DWELL_TIME;
+            while(System.currentTimeMillis() < switchTime) {
+                int b = poll();
+                if(b == SerialComSTM32Bootloader.SYNC) {
+                    mLockedBaudRate = mBaudRates[index];
+                    mSentCount = 0;
+                    send(SerialComSTM32Bootloader.ACK);
+                    return;
+                }
+                if(b < 0) {
+                    LockSupport.parkNanos(POLL_INTERVAL);
+                }
+            }
+            index = (index + 1) % mBaudRates.length;
+        }
+    }
+
+    private void handleCommand() throws SerialComException, ResetException {
+        int command = next();
+        int complement = next();
+        if((command ^ complement) != 0xFF) {
+            send(SerialComSTM32Bootloader.NACK);
+            return;
+        }
+
+        switch(command) {
+        case SerialComSTM32Bootloader.CMD_GET:
+            byte[] commands = mChecksumSupported ? new byte[] { 0x00, 0x01, 0x02, 0x11, 0x21, 0x31, 0x44, (byte) 0xA1 } :
+                new byte[] { 0x00, 0x01, 0x02, 0x11, 0x21, 0x31, 0x44 };
+            byte[] reply = new byte[commands.length + 4];
+            reply[0] = SerialComSTM32Bootloader.ACK;
+            reply[1] = (byte) commands.length;
+            reply[2] = VERSION;
+            System.arraycopy(commands, 0, reply, 3, commands.length);
+            reply[reply.length - 1] = SerialComSTM32Bootloader.ACK;
+            send(reply);
+            break;
+        case SerialComSTM32Bootloader.CMD_GET_VERSION:
+            send(new byte[] { SerialComSTM32Bootloader.ACK, VERSION, 0, 0, SerialComSTM32Bootloader.ACK });
+            break;
+        case SerialComSTM32Bootloader.CMD_GET_ID:
+            send(new byte[] { SerialComSTM32Bootloader.ACK, 1, (byte) (PRODUCT_ID >> 8), (byte) PRODUCT_ID,
+                    SerialComSTM32Bootloader.ACK });
+            break;
+        case SerialComSTM32Bootloader.CMD_READ_MEMORY:
+            handleRead();
+            break;
+        case SerialComSTM32Bootloader.CMD_GO:
+            send(SerialComSTM32Bootloader.ACK);
+            long address = nextWord();
+            if(address < 0) {
+                send(SerialComSTM32Bootloader.NACK);
+                break;
+            }
+            mGoAddress = address;
+            send(SerialComSTM32Bootloader.ACK);
+            break;
+        case SerialComSTM32Bootloader.CMD_WRITE_MEMORY:
+            handleWrite();
+            break;
+        case SerialComSTM32Bootloader.CMD_EXTENDED_ERASE:
+            handleErase();
+            break;
+        case SerialComSTM32Bootloader.CMD_GET_CHECKSUM:
+            if(mChecksumSupported == true) {
+                handleChecksum();
+            }else {
+                send(SerialComSTM32Bootloader.NACK);
+            }
+            break;
+        default:
+            send(SerialComSTM32Bootloader.NACK);
+        }
+    }
+
+    private void handleRead() throws SerialComException, ResetException {
+        send(SerialComSTM32Bootloader.ACK);
+        long address = nextWord();
+        if(address < 0) {
+            send(SerialComSTM32Bootloader.NACK);
+            return;
+        }
+        send(SerialComSTM32Bootloader.ACK);
+        int n = next();
+        int complement = next();
+        int offset = flashOffset(address, n + 1);
+        if(((n ^ complement) != 0xFF) || (offset < 0)) {
+            send(SerialComSTM32Bootloader.NACK);
+            return;
+        }
+        byte[] reply = new byte[n + 2];
+        reply[0] = SerialComSTM32Bootloader.ACK;
+        synchronized(mFlash) {
+            System.arraycopy(mFlash, offset, reply, 1, n + 1);
+        }
+        send(reply);
+    }
+
+    private void handleWrite() throws SerialComException, ResetException {
+        send(SerialComSTM32Bootloader.ACK);
+        long address = nextWord();
+        if(address < 0) {
+            send(SerialComSTM32Bootloader.NACK);
+            return;
+        }
+        send(SerialComSTM32Bootloader.ACK);
+        int n = next() + 1;
+        byte[] data = new byte[n];
+        int checksum = n - 1;
+        for(int x=0; x<n; x++) {
+            data[x] = (byte) next();
+            checksum ^= data[x] & 0xFF;
+        }
+        int offset = flashOffset(address, n);
+        if((next() != checksum) || (offset < 0) || ((n & 3) != 0)) {
+            send(SerialComSTM32Bootloader.NACK);
+            return;
+        }
+        synchronized(mFlash) {
+            for(int x=0; x<n; x++) {
+                mFlash[offset + x] &= data[x];
+            }
+        }
+        busy(mWriteTime);
+        mWriteCount++;
+        send(SerialComSTM32Bootloader.ACK);
+    }
+
+    private void handleErase() throws SerialComException, ResetException {
+        send(SerialComSTM32Bootloader.ACK);
+        int hi = next();
+        int lo = next();
+        int count = (hi << 8) | lo;
+
+        if(count >= 0xFFF0) {
+            // special erase : 0xFFFF mass erase, bank erase codes are treated as mass erase too
+            if(next() != (hi ^ lo)) {
+                send(SerialComSTM32Bootloader.NACK);
+                return;
+            }
+            synchronized(mFlash) {
+                Arrays.fill(mFlash, (byte) 0xFF);
+            }
+            busy(mEraseTimePerPage * (mFlash.length / mPageSize));
+            send(SerialComSTM32Bootloader.ACK);
+            return;
+        }
+
+        int n = count + 1;
+        int[] pages = new int[n];
+        int checksum = hi ^ lo;
+        for(int x=0; x<n; x++) {
+            int phi = next();
+            int plo = next();
+            pages[x] = (phi << 8) | plo;
+            checksum ^= phi ^ plo;
+        }
+        if(next() != checksum) {
+            send(SerialComSTM32Bootloader.NACK);
+            return;
+        }
+        for(int x=0; x<n; x++) {
+            if(((pages[x] + 1) * mPageSize) > mFlash.length) {
+                send(SerialComSTM32Bootloader.NACK);
+                return;
+            }
+        }
+        synchronized(mFlash) {
+            for(int x=0; x<n; x++) {
+                Arrays.fill(mFlash, pages[x] * mPageSize, (pages[x] + 1) * mPageSize, (byte) 0xFF);
+            }
+        }
+        busy(mEraseTimePerPage * n);
+        send(SerialComSTM32Bootloader.ACK);
+    }
+
+    private void handleChecksum() throws SerialComException, ResetException {
+        send(SerialComSTM32Bootloader.ACK);
+        long[] params = new long[4];
+        for(int x=0; x<4; x++) {
+            params[x] = nextWord();
+            if(params[x] < 0) {
+                send(SerialComSTM32Bootloader.NACK);
+                return;
+            }
+            send(SerialComSTM32Bootloader.ACK);
+        }
+        int length = (int) params[1];
+        int offset = flashOffset(params[0], length);
+        if((offset < 0) || ((length & 3) != 0)) {
+            send(SerialComSTM32Bootloader.NACK);
+            return;
+        }
+
+        // bitwise as host may ask for any polynomial
+        int polynomial = (int) params[2];
+        int crc = (int) params[3];
+        synchronized(mFlash) {
+            for(int x=offset; x<(offset + length); x += 4) {
+                int word = (mFlash[x] & 0xFF) | ((mFlash[x + 1] & 0xFF) << 8) | ((mFlash[x + 2] & 0xFF) << 16)
+                        | ((mFlash[x + 3] & 0xFF) << 24);
+                crc ^= word;
+                for(int y=0; y<32; y++) {
+                    crc = ((crc & 0x80000000) != 0) ? ((crc << 1) ^ polynomial) : (crc << 1);
+                }
+            }
+        }
+        byte[] reply = new byte[6];
+        reply[0] = SerialComSTM32Bootloader.ACK;
+        reply[1] = (byte) (crc >> 24);
+        reply[2] = (byte) (crc >> 16);
+        reply[3] = (byte) (crc >> 8);
+        reply[4] = (byte) crc;
+        reply[5] = (byte) (reply[1] ^ reply[2] ^ reply[3] ^ reply[4]);
+        send(reply);
+    }
+
+    /* Offset in flash array for given address range or -1 if range is outside flash. */
+    private int flashOffset(long address, int length) {
+        long offset = address - FLASH_BASE;
+        if((offset < 0) || ((offset + length) > mFlash.length)) {
+            return -1;
+        }
+        return (int) offset;
+    }
+
+    /* Reads 4 bytes address/value and its XOR checksum, gives -1 if checksum does not match. */
+    private long nextWord() throws SerialComException, ResetException {
+        long value = 0;
+        int checksum = 0;
+        for(int x=0; x<4; x++) {
+            int b = next();
+            value = (value << 8) | b;
+            checksum ^= b;
+        }
+        return (next() == checksum) ? value : -1;
+    }
+
+    /* Blocks until next byte arrives from host. */
+    private int next() throws SerialComException, ResetException {
+        while(mExit == false) {
+            int b = poll();
+            if(b >= 0) {
+                return b;
+            }
+            LockSupport.parkNanos(POLL_INTERVAL);
+        }
+        throw new ResetException();
+    }
+
+    /* Gives next received byte or -1 if none; checks for reset request from host every time. */
+    private int poll() throws SerialComException, ResetException {
+        int dsr = mSerialComManager.getLinesStatus(mHandle)[1];
+        if((mLastDSR == 1) && (dsr == 0)) {
+            mLastDSR = dsr;
+            throw new ResetException();
+        }
+        mLastDSR = dsr;
+
+        if(mReadPos == mReadLen) {
+            mReadPos = 0;
+            mReadLen = mSerialComManager.readBytes(mHandle, mReadBuffer, 0, mReadBuffer.length, -1, null);
+            if(mReadLen <= 0) {
+                mReadLen = 0;
+                return -1;
+            }
+        }
+        return mReadBuffer[mReadPos++] & 0xFF;
+    }
+
+    private void send(byte b) throws SerialComException {
+        send(new byte[] { b });
+    }
+
+    private void send(byte[] data) throws SerialComException {
+        BAUDRATE baud = mLockedBaudRate;
+        if((mErrorInterval > 0) && (baud != null) && (baud.getValue() >= mMarginalBaudRate)) {
+            for(int x=0; x<data.length; x++) {
+                mSentCount++;
+                if((mSentCount % mErrorInterval) == 0) {
+                    data[x] ^= 0x10;
+                }
+            }
+        }
+        mSerialComManager.writeBytes(mHandle, data, 0);
+    }
+
+    private void configure(BAUDRATE baudRate) throws SerialComException {
+        mSerialComManager.configureComPortData(mHandle, DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_EVEN, baudRate, 0);
+    }
+
+    /* Emulates time target is busy programming flash; host bytes keep queuing in the meantime. */
+    private static void busy(long micros) {
+        if(micros > 0) {
+            LockSupport.parkNanos(micros * 1000);
+        }
+    }
+}
@@ -0,0 +1,20 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/**
+ * <p>Encapsulates communication with the factory programmed UART bootloader of STM32 microcontrollers
+ * (ST application note AN3155) and a software emulator of this bootloader for testing on virtual ports.</p>
+ * 
+ * @author Rishi Gupta
+ */
+package com.serialpundit.serial.stm32;
@@ -0,0 +1,77 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.benchmark;
+
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.profile.GCProfiler;
+import org.openjdk.jmh.results.format.ResultFormatType;
+import org.openjdk.jmh.runner.Runner;
+import org.openjdk.jmh.runner.options.ChainedOptionsBuilder;
+import org.openjdk.jmh.runner.options.CommandLineOptions;
+import org.openjdk.jmh.runner.options.OptionsBuilder;
+
+/*
+ * Runs message benchmarks twice, for throughput (ops/s) and for latency percentiles (sample time
+ * in microseconds), and file transfer benchmarks once, all with gc profiler so that allocation rate
+ * per operation is reported. Results are saved as JSON (jmh-throughput.json, jmh-latency.json,
+ * jmh-filetransfer.json) which can be compared between builds. JMH command line options given to
+ * this program (for example -p size=256) are honoured. JMH adds includes of a builder to those of its
+ * parent, so default selection is used only when no benchmark regex is given. Benchmarks selected by a
+ * regex are run for throughput and latency only.
+ */
+public final class BenchmarkMain {
+
+	private static final String MESSAGE_BENCHMARKS = "(ReadWrite|DataListener|ByteStream)Benchmark";
+
+	public static void main(String[] args) throws Exception {
+
+		CommandLineOptions cmdOptions = new CommandLineOptions(args);
+		boolean defaultSelection = cmdOptions.getIncludes().isEmpty();
+
+		ChainedOptionsBuilder throughput = new OptionsBuilder().parent(cmdOptions)
+				.mode(Mode.Throughput)
+				.timeUnit(TimeUnit.SECONDS)
+				.addProfiler(GCProfiler.class)
+				.resultFormat(ResultFormatType.JSON)
+				.result("jmh-throughput.json");
+		if(defaultSelection == true) {
+			throughput.include(MESSAGE_BENCHMARKS);
+		}
+		new Runner(throughput.build()).run();
+
+		ChainedOptionsBuilder latency = new OptionsBuilder().parent(cmdOptions)
+				.mode(Mode.SampleTime)
+				.timeUnit(TimeUnit.MICROSECONDS)
+				.addProfiler(GCProfiler.class)
+				.resultFormat(ResultFormatType.JSON)
+				.result("jmh-latency.json");
+		if(defaultSelection == true) {
+			latency.include(MESSAGE_BENCHMARKS);
+		}
+		new Runner(latency.build()).run();
+
+		if(defaultSelection == false) {
+			return;
+		}
+
+		ChainedOptionsBuilder fileTransfer = new OptionsBuilder().parent(cmdOptions)
+				.include("FileTransferBenchmark")
+				.addProfiler(GCProfiler.class)
+				.resultFormat(ResultFormatType.JSON)
+				.result("jmh-filetransfer.json");
+		new Runner(fileTransfer.build()).run();
+	}
+}
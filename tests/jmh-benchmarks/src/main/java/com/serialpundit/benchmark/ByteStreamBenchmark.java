@@ -0,0 +1,69 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.benchmark;
+
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Warmup;
+
+import com.serialpundit.serial.SerialComInByteStream;
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComManager.SMODE;
+import com.serialpundit.serial.SerialComOutByteStream;
+
+/*
+ * Message exchange through SerialComOutByteStream on one end and SerialComInByteStream on other end.
+ */
+@BenchmarkMode(Mode.Throughput)
+@OutputTimeUnit(TimeUnit.SECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class ByteStreamBenchmark extends NullModemPair {
+
+	private SerialComOutByteStream out;
+	private SerialComInByteStream in;
+
+	@Override
+	protected void afterOpen() throws Exception {
+		out = (SerialComOutByteStream) scm.getIOStreamInstance(SerialComManager.OutputStream, tx, SMODE.BLOCKING);
+		in = (SerialComInByteStream) scm.getIOStreamInstance(SerialComManager.InputStream, rx, SMODE.BLOCKING);
+	}
+
+	@Override
+	protected void beforeClose() throws Exception {
+		out.close();
+		in.close();
+	}
+
+	@Benchmark
+	public int outStreamInStream() throws Exception {
+		int received = 0;
+		int ret = 0;
+		out.write(payload);
+		while(received < size) {
+			ret = in.read(rxBuffer, received, size - received);
+			if(ret > 0) {
+				received += ret;
+			}
+		}
+		return received;
+	}
+}
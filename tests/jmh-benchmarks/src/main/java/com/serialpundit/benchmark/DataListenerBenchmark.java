@@ -0,0 +1,76 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.benchmark;
+
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.locks.LockSupport;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Warmup;
+
+import com.serialpundit.serial.ISerialComDataListener;
+
+/*
+ * Time from writing a message on one end until data listener registered on other end has been given
+ * all of its bytes; covers native looper and delivery of data to Java listener.
+ */
+@BenchmarkMode(Mode.Throughput)
+@OutputTimeUnit(TimeUnit.SECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class DataListenerBenchmark extends NullModemPair implements ISerialComDataListener {
+
+	private final AtomicInteger received = new AtomicInteger();
+	private volatile Thread waiter;
+
+	@Override
+	protected void afterOpen() throws Exception {
+		scm.registerDataListener(rx, this);
+	}
+
+	@Override
+	protected void beforeClose() throws Exception {
+		scm.unregisterDataListener(rx, this);
+	}
+
+	@Override
+	public void onNewSerialDataAvailable(byte[] data) {
+		if(received.addAndGet(data.length) >= size) {
+			LockSupport.unpark(waiter);
+		}
+	}
+
+	@Override
+	public void onDataListenerError(int errorNum) {
+		System.out.println("data listener error : " + errorNum);
+	}
+
+	@Benchmark
+	public int writeBytesDataListener() throws Exception {
+		waiter = Thread.currentThread();
+		received.set(0);
+		scm.writeBytes(tx, payload);
+		while(received.get() < size) {
+			LockSupport.parkNanos(1000000);
+		}
+		return received.get();
+	}
+}
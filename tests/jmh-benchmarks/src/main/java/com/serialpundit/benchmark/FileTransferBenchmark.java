@@ -0,0 +1,145 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.benchmark;
+
+import java.io.File;
+import java.io.FileOutputStream;
+import java.util.Random;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComManager.FTPPROTO;
+import com.serialpundit.serial.SerialComManager.FTPVAR;
+import com.serialpundit.serial.nullmodem.SerialComNullModem;
+
+/*
+ * Complete XMODEM/YMODEM file transfer between the two ends of a null modem pair. Receiver runs in
+ * its own thread, sender in benchmark thread. One operation is one file.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MILLISECONDS)
+@Warmup(iterations = 2, batchSize = 1)
+@Measurement(iterations = 5, batchSize = 1)
+@Fork(1)
+public class FileTransferBenchmark {
+
+	@Param({"XMODEM_CRC", "XMODEM_1K", "YMODEM_1K"})
+	public String protocol;
+
+	@Param({"16384", "131072"})
+	public int fileSize;
+
+	private SerialComManager scm;
+	private SerialComNullModem scnm;
+	private long tx;
+	private long rx;
+	private FTPPROTO proto;
+	private FTPVAR variant;
+	private File[] toSend;
+	private File receiveTo;
+	private File workDir;
+	private ExecutorService receiver;
+
+	@Setup(Level.Trial)
+	public void setUp() throws Exception {
+		if(protocol.equals("XMODEM_CRC")) {
+			proto = FTPPROTO.XMODEM;
+			variant = FTPVAR.CRC;
+		}else if(protocol.equals("XMODEM_1K")) {
+			proto = FTPPROTO.XMODEM;
+			variant = FTPVAR.VAR1K;
+		}else {
+			proto = FTPPROTO.YMODEM;
+			variant = FTPVAR.VAR1K;
+		}
+
+		workDir = File.createTempFile("spjmh", "");
+		workDir.delete();
+		workDir.mkdir();
+
+		byte[] data = new byte[fileSize];
+		new Random(12345).nextBytes(data);
+		toSend = new File[] { new File(workDir, "send.bin") };
+		FileOutputStream fos = new FileOutputStream(toSend[0]);
+		fos.write(data);
+		fos.close();
+
+		// xmodem receives into a file, ymodem into a directory
+		if(proto == FTPPROTO.XMODEM) {
+			receiveTo = new File(workDir, "received.bin");
+			receiveTo.createNewFile();
+		}else {
+			receiveTo = new File(workDir, "received");
+			receiveTo.mkdir();
+		}
+
+		scm = new SerialComManager();
+		scnm = scm.getSerialComNullModemInstance();
+		scnm.initialize();
+		String[] ports = scnm.createStandardNullModemPair(-1, -1);
+		Thread.sleep(500);
+		tx = NullModemPair.open(scm, ports[0]);
+		rx = NullModemPair.open(scm, ports[4]);
+
+		receiver = Executors.newSingleThreadExecutor();
+	}
+
+	@TearDown(Level.Trial)
+	public void tearDown() throws Exception {
+		receiver.shutdownNow();
+		scm.closeComPort(tx);
+		scm.closeComPort(rx);
+		scnm.destroyAllCreatedVirtualDevices();
+		scnm.deinitialize();
+
+		File[] files = receiveTo.isDirectory() ? receiveTo.listFiles() : new File[0];
+		for(File f : files) {
+			f.delete();
+		}
+		receiveTo.delete();
+		toSend[0].delete();
+		workDir.delete();
+	}
+
+	@Benchmark
+	public boolean sendReceiveFile() throws Exception {
+		Future<Boolean> received = receiver.submit(new Callable<Boolean>() {
+			@Override
+			public Boolean call() throws Exception {
+				return scm.receiveFile(rx, receiveTo, proto, variant, false, null, null);
+			}
+		});
+		boolean sent = scm.sendFile(tx, toSend, proto, variant, false, null, null);
+		return sent && received.get(60, TimeUnit.SECONDS);
+	}
+}
@@ -0,0 +1,115 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.benchmark;
+
+import java.nio.ByteBuffer;
+
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+
+import com.serialpundit.core.SerialComException;
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.FLOWCONTROL;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+import com.serialpundit.serial.nullmodem.SerialComNullModem;
+
+/*
+ * Null modem pair created through SerialComNullModem for one benchmark run. 1st port (tx) sends, 2nd
+ * port (rx) receives. Buffers are allocated once so that allocation reported by gc profiler is the
+ * one done by SerialPundit itself.
+ */
+@State(Scope.Benchmark)
+public class NullModemPair {
+
+	/* maximum bytes native layer reads in one call */
+	public static final int MAX_READ = 2048;
+
+	@Param({"16", "256", "4096"})
+	public int size;
+
+	public SerialComManager scm;
+	public SerialComNullModem scnm;
+	public long tx;
+	public long rx;
+	public byte[] payload;
+	public byte[] rxBuffer;
+	public ByteBuffer txDirect;
+	public ByteBuffer rxDirect;
+
+	@Setup(Level.Trial)
+	public void setUpPair() throws Exception {
+		scm = new SerialComManager();
+		scnm = scm.getSerialComNullModemInstance();
+		scnm.initialize();
+
+		String[] ports = scnm.createStandardNullModemPair(-1, -1);
+		// let udev create device nodes
+		Thread.sleep(500);
+
+		tx = open(scm, ports[0]);
+		rx = open(scm, ports[4]);
+
+		payload = new byte[size];
+		for(int x=0; x<size; x++) {
+			payload[x] = (byte) x;
+		}
+		rxBuffer = new byte[size];
+		txDirect = ByteBuffer.allocateDirect(size);
+		txDirect.put(payload);
+		rxDirect = ByteBuffer.allocateDirect(size);
+
+		afterOpen();
+	}
+
+	@TearDown(Level.Trial)
+	public void tearDownPair() throws Exception {
+		beforeClose();
+		scm.closeComPort(tx);
+		scm.closeComPort(rx);
+		scnm.destroyAllCreatedVirtualDevices();
+		scnm.deinitialize();
+	}
+
+	/* Benchmark specific set up once ports have been opened. */
+	protected void afterOpen() throws Exception {
+	}
+
+	/* Benchmark specific clean up before ports are closed. */
+	protected void beforeClose() throws Exception {
+	}
+
+	static long open(SerialComManager scm, String port) throws SerialComException {
+		long handle = scm.openComPort(port, true, true, true);
+		scm.configureComPortData(handle, DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_NONE, BAUDRATE.B115200, 0);
+		scm.configureComPortControl(handle, FLOWCONTROL.NONE, 'x', 'x', false, false);
+		scm.clearPortIOBuffers(handle, true, true);
+		return handle;
+	}
+
+	/* Receives size bytes on rx port without allocating, spinning on non blocking read. */
+	public int receive() throws SerialComException {
+		int received = 0;
+		while(received < size) {
+			received += scm.readBytes(rx, rxBuffer, received, Math.min(MAX_READ, size - received), -1, null);
+		}
+		return received;
+	}
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.benchmark;
+
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Warmup;
+
+/*
+ * Write on one end and read the same bytes on other end of a null modem pair, through the different
+ * read/write methods of SerialComManager. One operation is one message of NullModemPair.size bytes.
+ */
+@BenchmarkMode(Mode.Throughput)
+@OutputTimeUnit(TimeUnit.SECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class ReadWriteBenchmark extends NullModemPair {
+
+	private long context;
+
+	@Override
+	protected void afterOpen() throws Exception {
+		context = scm.createBlockingIOContext();
+	}
+
+	@Override
+	protected void beforeClose() throws Exception {
+		scm.unblockBlockingIOOperation(context);
+		scm.destroyBlockingIOContext(context);
+	}
+
+	@Benchmark
+	public int writeBytesReadBytes() throws Exception {
+		scm.writeBytes(tx, payload);
+		return receive();
+	}
+
+	@Benchmark
+	public int writeBytesDirectReadBytesDirect() throws Exception {
+		int received = 0;
+		scm.writeBytesDirect(tx, txDirect, 0, size);
+		while(received < size) {
+			received += scm.readBytesDirect(rx, rxDirect, received, size - received);
+		}
+		return received;
+	}
+
+	@Benchmark
+	public int writeBytesReadBytesBlocking() throws Exception {
+		int received = 0;
+		byte[] data = null;
+		scm.writeBytes(tx, payload);
+		while(received < size) {
+			data = scm.readBytesBlocking(rx, Math.min(MAX_READ, size - received), context);
+			if(data != null) {
+				received += data.length;
+			}
+		}
+		return received;
+	}
+
+	/* readBytes variant which allocates a new array for every read */
+	@Benchmark
+	public int writeBytesReadBytesAllocating() throws Exception {
+		int received = 0;
+		byte[] data = null;
+		scm.writeBytes(tx, payload);
+		while(received < size) {
+			data = scm.readBytes(rx, Math.min(MAX_READ, size - received));
+			if(data != null) {
+				received += data.length;
+			}
+		}
+		return received;
+	}
+}
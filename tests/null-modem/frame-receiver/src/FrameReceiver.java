@@ -0,0 +1,109 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+import java.util.Arrays;
+import java.util.concurrent.locks.LockSupport;
+
+import com.serialpundit.serial.SerialComFrameReceiver;
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComPortConfig;
+import com.serialpundit.serial.nullmodem.SerialComNullModem;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.FLOWCONTROL;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+
+/*
+ * Frames split on inter-character gap by SerialComFrameReceiver on a ttyvs null modem pair, at 9600
+ * (3.5 character gap) and 115200 baud (Modbus fixed gap). Every frame is written in 3 chunks with a
+ * pause of quarter gap between them, which must not split the frame, and frames are separated by 4
+ * times the gap, which must. Prints number of frames received intact, merged and split.
+ */
+
+public final class FrameReceiver {
+
+	private static final int FRAMES = 50;
+	private static final int CHUNKS = 3;
+	private static final int CHUNK_SIZE = 8;
+
+	private static void run(SerialComManager scm, String sender, String receiver, BAUDRATE baud, long gap) throws Exception {
+
+		SerialComPortConfig config = new SerialComPortConfig();
+		config.setDataFormat(DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_NONE, baud, 0);
+		config.setFlowControl(FLOWCONTROL.NONE, 'x', 'x', false, false);
+
+		long txHandle = scm.openComPort(sender, true, true, true, config);
+		long rxHandle = scm.openComPort(receiver, true, true, true, config);
+		SerialComFrameReceiver frameReceiver = new SerialComFrameReceiver(scm, rxHandle, gap, 256, null);
+
+		int intact = 0;
+		int merged = 0;
+		int split = 0;
+		byte[] chunk = new byte[CHUNK_SIZE];
+		byte[] expected = new byte[CHUNKS * CHUNK_SIZE];
+
+		for(int x=0; x<FRAMES; x++) {
+			for(int y=0; y<CHUNKS; y++) {
+				Arrays.fill(chunk, (byte) (x + y));
+				System.arraycopy(chunk, 0, expected, y * CHUNK_SIZE, CHUNK_SIZE);
+				scm.writeBytes(txHandle, chunk);
+				if(y < (CHUNKS - 1)) {
+					LockSupport.parkNanos(gap * 1000 / 4);
+				}
+			}
+			LockSupport.parkNanos(gap * 1000 * 4);
+
+			byte[] frame = frameReceiver.readFrame(1000);
+			if(frame == null) {
+				continue;
+			}
+			if(Arrays.equals(frame, expected)) {
+				intact++;
+			}else if(frame.length > expected.length) {
+				merged++;
+			}else {
+				split++;
+				// rest of a split frame is still queued
+				while(frameReceiver.readFrame(0) != null) {
+				}
+			}
+		}
+
+		System.out.println(baud + " gap " + gap + " us : " + intact + " intact, " + merged + " merged, " + split + " split out of " + FRAMES);
+
+		frameReceiver.close();
+		scm.closeComPort(rxHandle);
+		scm.closeComPort(txHandle);
+	}
+
+	public static void main(String[] args) throws Exception {
+
+		SerialComManager scm = new SerialComManager();
+		SerialComNullModem scnm = scm.getSerialComNullModemInstance();
+		scnm.initialize();
+
+		try {
+			String[] ports = scnm.createStandardNullModemPair(-1, -1);
+			Thread.sleep(500);
+
+			run(scm, ports[0], ports[4], BAUDRATE.B9600,
+					SerialComFrameReceiver.calculateGap(9600, DATABITS.DB_8, PARITY.P_NONE, STOPBITS.SB_1, 3.5));
+			run(scm, ports[0], ports[4], BAUDRATE.B115200, SerialComFrameReceiver.MODBUS_FIXED_GAP);
+		}catch (Exception e) {
+			e.printStackTrace();
+		}finally {
+			scnm.destroyAllCreatedVirtualDevices();
+		}
+	}
+}
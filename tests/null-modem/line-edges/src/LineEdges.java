@@ -0,0 +1,111 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+import com.serialpundit.serial.ISerialComLineEdgeListener;
+import com.serialpundit.serial.SerialComLineEdges;
+import com.serialpundit.serial.SerialComLineEvent;
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.nullmodem.SerialComNullModem;
+
+/*
+ * Toggles RTS on 1st port of a standard ttyvs null modem pair (RTS connected to CTS of other end) and
+ * counts CTS edges received on 2nd port through ISerialComLineEdgeListener. Prints number of edges,
+ * batches, dropped and coalesced edges, edges without net change of state (must be 0) and the smallest 
+ * interval between two recorded edges.
+ */
+
+final class EdgeCounter implements ISerialComLineEdgeListener {
+
+	volatile long edges = 0;
+	volatile long batches = 0;
+	volatile long dropped = 0;
+	volatile long coalesced = 0;
+	volatile long unchanged = 0;
+	volatile long minInterval = Long.MAX_VALUE;
+	private long lastTimestamp = 0;
+
+	@Override
+	public void onNewLineEdges(SerialComLineEdges lineEdges) {
+		long[] timestamps = lineEdges.getTimestamps();
+		int[] states = lineEdges.getLineStates();
+		int prevState = lineEdges.getPreviousLineState();
+		for(int x=0; x<lineEdges.getCount(); x++) {
+			if(states[x] == prevState) {
+				unchanged++;
+			}
+			prevState = states[x];
+			if((lastTimestamp != 0) && ((timestamps[x] - lastTimestamp) < minInterval)) {
+				minInterval = timestamps[x] - lastTimestamp;
+			}
+			lastTimestamp = timestamps[x];
+		}
+		edges += lineEdges.getCount();
+		dropped += lineEdges.getDroppedCount();
+		coalesced += lineEdges.getCoalescedCount();
+		batches++;
+	}
+
+	@Override
+	public void onNewSerialEvent(SerialComLineEvent lineEvent) {
+		// not called for edge listener
+	}
+}
+
+public final class LineEdges {
+
+	private static final int TOGGLES = 100000;
+
+	public static void main(String[] args) throws Exception {
+
+		SerialComManager scm = new SerialComManager();
+		SerialComNullModem scnm = scm.getSerialComNullModemInstance();
+		scnm.initialize();
+
+		try {
+			String[] ports = scnm.createStandardNullModemPair(-1, -1);
+			Thread.sleep(500);
+
+			long handle = scm.openComPort(ports[0], true, true, true);
+			long handle1 = scm.openComPort(ports[4], true, true, true);
+
+			EdgeCounter counter = new EdgeCounter();
+			scm.registerLineEventListener(handle1, counter);
+			scm.setEventsMask(counter, SerialComManager.CTS);
+			if(args.length > 0) {
+				scm.setLineEdgeCoalescingWindow(counter, Long.parseLong(args[0]));
+			}
+
+			long start = System.nanoTime();
+			for(int x=0; x<TOGGLES; x++) {
+				scm.setRTS(handle, (x & 1) == 0);
+			}
+			long elapsed = System.nanoTime() - start;
+			Thread.sleep(1000);
+
+			System.out.println("toggles      : " + TOGGLES + " in " + (elapsed / 1000) + " us");
+			System.out.println("edges        : " + counter.edges + " in " + counter.batches + " batches");
+			System.out.println("dropped      : " + counter.dropped);
+			System.out.println("coalesced    : " + counter.coalesced);
+			System.out.println("unchanged    : " + counter.unchanged);
+			System.out.println("min interval : " + counter.minInterval + " ns");
+
+			scm.unregisterLineEventListener(handle1, counter);
+			scm.closeComPort(handle1);
+			scm.closeComPort(handle);
+		}catch (Exception e) {
+			e.printStackTrace();
+		}finally {
+			scnm.destroyAllCreatedVirtualDevices();
+		}
+	}
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComPortConfig;
+import com.serialpundit.serial.SerialComPortPool;
+import com.serialpundit.serial.nullmodem.SerialComNullModem;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.FLOWCONTROL;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+
+/*
+ * Transaction latency with and without SerialComPortPool on a ttyvs null modem pair. Each transaction
+ * gets a handle to 1st port, sends a request, waits for reply sent by responder on 2nd port and gives
+ * the handle back (close or release).
+ */
+
+public final class PortPool {
+
+	private static final int TRANSACTIONS = 1000;
+	private static final byte[] REQUEST = "REQ-0123".getBytes();
+	private static final byte[] REPLY = "REP-0123".getBytes();
+
+	private static void waitFor(SerialComManager scm, long handle, int length) throws Exception {
+		int received = 0;
+		while(received < length) {
+			byte[] data = scm.readBytes(handle, length - received);
+			if(data != null) {
+				received += data.length;
+			}
+		}
+	}
+
+	public static void main(String[] args) throws Exception {
+
+		SerialComManager scm = new SerialComManager();
+		SerialComNullModem scnm = scm.getSerialComNullModemInstance();
+		scnm.initialize();
+		long handle = 0;
+		long start = 0;
+
+		SerialComPortConfig config = new SerialComPortConfig();
+		config.setDataFormat(DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_NONE, BAUDRATE.B115200, 0);
+		config.setFlowControl(FLOWCONTROL.NONE, 'x', 'x', false, false);
+
+		try {
+			String[] ports = scnm.createStandardNullModemPair(-1, -1);
+			Thread.sleep(500);
+
+			long responder = scm.openComPort(ports[4], true, true, true, config);
+
+			// open-transact-close
+			start = System.nanoTime();
+			for(int x=0; x<TRANSACTIONS; x++) {
+				handle = scm.openComPort(ports[0], true, true, true, config);
+				scm.writeBytes(handle, REQUEST);
+				waitFor(scm, responder, REQUEST.length);
+				scm.writeBytes(responder, REPLY);
+				waitFor(scm, handle, REPLY.length);
+				scm.closeComPort(handle);
+			}
+			System.out.println("without pool : " + ((System.nanoTime() - start) / TRANSACTIONS / 1000) + " us per transaction");
+
+			// acquire-transact-release
+			SerialComPortPool pool = new SerialComPortPool(scm, 60000);
+			start = System.nanoTime();
+			for(int x=0; x<TRANSACTIONS; x++) {
+				handle = pool.acquire(ports[0], config, 1000);
+				scm.writeBytes(handle, REQUEST);
+				waitFor(scm, responder, REQUEST.length);
+				scm.writeBytes(responder, REPLY);
+				waitFor(scm, handle, REPLY.length);
+				pool.release(handle);
+			}
+			System.out.println("with pool    : " + ((System.nanoTime() - start) / TRANSACTIONS / 1000) + " us per transaction");
+
+			pool.close();
+			scm.closeComPort(responder);
+		}catch (Exception e) {
+			e.printStackTrace();
+		}finally {
+			scnm.destroyAllCreatedVirtualDevices();
+		}
+	}
+}
@@ -0,0 +1,131 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+import java.io.ByteArrayInputStream;
+import java.util.Arrays;
+import java.util.Random;
+
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComPortConfig;
+import com.serialpundit.serial.ftp.SerialComHexDecoder;
+import com.serialpundit.serial.ftp.SerialComHexDecoder.FORMAT;
+import com.serialpundit.serial.nullmodem.SerialComNullModem;
+import com.serialpundit.serial.stm32.SerialComSTM32Bootloader;
+import com.serialpundit.serial.stm32.SerialComSTM32BootloaderEmulator;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.FLOWCONTROL;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+
+/*
+ * Flashes a 64 KB Intel HEX image into STM32 bootloader emulator running on 2nd port of a ttyvs null
+ * modem pair. Emulator corrupts replies at 921600 so connect() should settle on 460800. Image is written
+ * with pipeline depth 1 and 4, and verified with GET CHECKSUM and with read back.
+ */
+
+public final class STM32Bootloader {
+
+	private static final int IMAGE_SIZE = 64 * 1024;
+	private static final int PAGE_SIZE = 2048;
+	private static final BAUDRATE[] RATES = { BAUDRATE.B921600, BAUDRATE.B460800, BAUDRATE.B230400, BAUDRATE.B115200 };
+
+	private static String toIntelHex(byte[] image) {
+		StringBuilder sb = new StringBuilder();
+		sb.append(":020000040800F2\n");
+		for(int x=0; x<image.length; x += 16) {
+			int sum = 16 + (x >> 8) + (x & 0xFF);
+			sb.append(String.format(":10%04X00", x & 0xFFFF));
+			for(int y=0; y<16; y++) {
+				sb.append(String.format("%02X", image[x + y] & 0xFF));
+				sum += image[x + y] & 0xFF;
+			}
+			sb.append(String.format("%02X\n", (-sum) & 0xFF));
+		}
+		sb.append(":00000001FF\n");
+		return sb.toString();
+	}
+
+	private static void flash(SerialComSTM32Bootloader loader, SerialComSTM32BootloaderEmulator emulator,
+			byte[] hex, byte[] image, int depth) throws Exception {
+		loader.erasePages(0, IMAGE_SIZE / PAGE_SIZE);
+		loader.setWritePipelineDepth(depth);
+		long start = System.nanoTime();
+		long written = loader.writeImage(new SerialComHexDecoder(new ByteArrayInputStream(hex), FORMAT.AUTO), false);
+		long writeTime = (System.nanoTime() - start) / 1000000;
+		start = System.nanoTime();
+		boolean ok = loader.verify(SerialComSTM32BootloaderEmulator.FLASH_BASE, image, 0, image.length);
+		long verifyTime = (System.nanoTime() - start) / 1000000;
+		boolean same = Arrays.equals(Arrays.copyOf(emulator.getFlash(), IMAGE_SIZE), image);
+		System.out.println("depth " + depth + " : " + written + " bytes in " + writeTime + " ms, verify " + ok
+				+ " in " + verifyTime + " ms, flash matches " + same);
+	}
+
+	public static void main(String[] args) throws Exception {
+
+		SerialComManager scm = new SerialComManager();
+		SerialComNullModem scnm = scm.getSerialComNullModemInstance();
+		scnm.initialize();
+
+		SerialComPortConfig config = new SerialComPortConfig();
+		config.setDataFormat(DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_EVEN, BAUDRATE.B115200, 0);
+		config.setFlowControl(FLOWCONTROL.NONE, 'x', 'x', false, false);
+
+		byte[] image = new byte[IMAGE_SIZE];
+		new Random(1).nextBytes(image);
+		byte[] hex = toIntelHex(image).getBytes();
+
+		try {
+			String[] ports = scnm.createStandardNullModemPair(-1, -1);
+			Thread.sleep(500);
+
+			long handle = scm.openComPort(ports[0], true, true, true, config);
+			long emulatorHandle = scm.openComPort(ports[4], true, true, true, config);
+
+			SerialComSTM32BootloaderEmulator emulator = new SerialComSTM32BootloaderEmulator(scm, emulatorHandle,
+					RATES, 128 * 1024, PAGE_SIZE);
+			emulator.setMarginalBaudRate(921600, 7);
+			emulator.setProgrammingTime(200, 1000);
+			emulator.start();
+
+			SerialComSTM32Bootloader loader = new SerialComSTM32Bootloader(scm, handle);
+			BAUDRATE baud = loader.connect(RATES, true, 3);
+			System.out.println("connected at " + baud + ", bootloader 0x" + Integer.toHexString(loader.getBootloaderVersion())
+					+ ", product id 0x" + Integer.toHexString(loader.getProductId()));
+
+			flash(loader, emulator, hex, image, 1);
+			flash(loader, emulator, hex, image, 4);
+
+			// older bootloader without GET CHECKSUM, verification reads memory back
+			emulator.setChecksumCommandSupported(false);
+			loader.connect(new BAUDRATE[] { baud }, true, 1);
+			flash(loader, emulator, hex, image, 4);
+
+			loader.go(SerialComSTM32BootloaderEmulator.FLASH_BASE);
+			System.out.println(String.format("GO to 0x%08X, %d write commands, %d resets", emulator.getGoAddress(),
+					emulator.getWriteCount(), emulator.getResetCount()));
+
+			loader.close();
+			emulator.stop();
+			if(emulator.getError() != null) {
+				System.out.println("emulator stopped with error : " + emulator.getError().getMessage());
+			}
+			scm.closeComPort(emulatorHandle);
+			scm.closeComPort(handle);
+		}catch (Exception e) {
+			e.printStackTrace();
+		}finally {
+			scnm.destroyAllCreatedVirtualDevices();
+		}
+	}
+}
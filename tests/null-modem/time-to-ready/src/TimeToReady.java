@@ -0,0 +1,97 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComPortConfig;
+import com.serialpundit.serial.nullmodem.SerialComNullModem;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.FLOWCONTROL;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+
+/*
+ * Measures time taken to bring a port into ready state (open + configure + lines + clear buffers)
+ * using individual calls and using SerialComPortConfig. Run it once on a ttyvs pair and once on a
+ * real USB-UART (pass port name as argument) as driver set_termios cost dominates there.
+ */
+
+public final class TimeToReady {
+
+	private static final int ITERATIONS = 1000;
+
+	public static void main(String[] args) throws Exception {
+
+		SerialComManager scm = new SerialComManager();
+		SerialComNullModem scnm = null;
+		String port = null;
+		long handle = 0;
+		long start = 0;
+
+		if(args.length > 0) {
+			port = args[0];
+		}else {
+			scnm = scm.getSerialComNullModemInstance();
+			scnm.initialize();
+			String[] ports = scnm.createStandardNullModemPair(-1, -1);
+			Thread.sleep(500);
+			port = ports[0];
+		}
+
+		SerialComPortConfig config = new SerialComPortConfig();
+		config.setDataFormat(DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_NONE, BAUDRATE.B115200, 0);
+		config.setFlowControl(FLOWCONTROL.NONE, 'x', 'x', false, false);
+		config.setReadBehaviour(1, 0, 0, 0, 0);
+		config.setModemLines(true, true);
+		config.setClearBuffers(true, true);
+
+		try {
+			// individual calls
+			start = System.nanoTime();
+			for(int x=0; x<ITERATIONS; x++) {
+				handle = scm.openComPort(port, true, true, true);
+				scm.configureComPortData(handle, DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_NONE, BAUDRATE.B115200, 0);
+				scm.configureComPortControl(handle, FLOWCONTROL.NONE, 'x', 'x', false, false);
+				scm.fineTuneReadBehaviour(handle, 1, 0, 0, 0, 0);
+				scm.setRTS(handle, true);
+				scm.setDTR(handle, true);
+				scm.clearPortIOBuffers(handle, true, true);
+				scm.closeComPort(handle);
+			}
+			System.out.println("individual calls     : " + ((System.nanoTime() - start) / ITERATIONS / 1000) + " us per open");
+
+			// one configuration object per open
+			start = System.nanoTime();
+			for(int x=0; x<ITERATIONS; x++) {
+				handle = scm.openComPort(port, true, true, true, config);
+				scm.closeComPort(handle);
+			}
+			System.out.println("SerialComPortConfig  : " + ((System.nanoTime() - start) / ITERATIONS / 1000) + " us per open");
+
+			// re-applying same configuration to already opened port
+			handle = scm.openComPort(port, true, true, true, config);
+			start = System.nanoTime();
+			for(int x=0; x<ITERATIONS; x++) {
+				scm.applyComPortConfig(handle, config);
+			}
+			System.out.println("re-apply same config : " + ((System.nanoTime() - start) / ITERATIONS / 1000) + " us per apply");
+			scm.closeComPort(handle);
+		}catch (Exception e) {
+			e.printStackTrace();
+		}finally {
+			if(scnm != null) {
+				scnm.destroyAllCreatedVirtualDevices();
+			}
+		}
+	}
+}
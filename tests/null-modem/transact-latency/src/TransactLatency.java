@@ -0,0 +1,119 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+import com.serialpundit.serial.ISerialComDataListener;
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComPortConfig;
+import com.serialpundit.serial.SerialComResponseMatcher;
+import com.serialpundit.serial.nullmodem.SerialComNullModem;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.FLOWCONTROL;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+
+/*
+ * AT command style exchange latency on a ttyvs null modem pair; write and poll with sleep versus
+ * SerialComManager.transact(). Responder on 2nd port replies "\r\nOK\r\n" to every request.
+ */
+
+final class Responder implements ISerialComDataListener {
+
+	private final SerialComManager scm;
+	private final long handle;
+	private static final byte[] REPLY = "\r\nOK\r\n".getBytes();
+
+	public Responder(SerialComManager scm, long handle) {
+		this.scm = scm;
+		this.handle = handle;
+	}
+
+	@Override
+	public void onNewSerialDataAvailable(byte[] data) {
+		if(data[data.length - 1] == '\r') {
+			try {
+				scm.writeBytes(handle, REPLY);
+			} catch (Exception e) {
+				e.printStackTrace();
+			}
+		}
+	}
+
+	@Override
+	public void onDataListenerError(int errorNum) {
+		System.out.println("responder error : " + errorNum);
+	}
+}
+
+public final class TransactLatency {
+
+	private static final int EXCHANGES = 1000;
+	private static final byte[] REQUEST = "AT+CSQ\r".getBytes();
+	private static final byte[] TERMINATOR = "OK\r\n".getBytes();
+
+	public static void main(String[] args) throws Exception {
+
+		SerialComManager scm = new SerialComManager();
+		SerialComNullModem scnm = scm.getSerialComNullModemInstance();
+		scnm.initialize();
+		long start = 0;
+
+		SerialComPortConfig config = new SerialComPortConfig();
+		config.setDataFormat(DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_NONE, BAUDRATE.B115200, 0);
+		config.setFlowControl(FLOWCONTROL.NONE, 'x', 'x', false, false);
+
+		try {
+			String[] ports = scnm.createStandardNullModemPair(-1, -1);
+			Thread.sleep(500);
+
+			long handle = scm.openComPort(ports[0], true, true, true, config);
+			long responderHandle = scm.openComPort(ports[4], true, true, true, config);
+			Responder responder = new Responder(scm, responderHandle);
+			scm.registerDataListener(responderHandle, responder);
+
+			// write and poll
+			SerialComResponseMatcher matcher = new SerialComResponseMatcher(TERMINATOR);
+			byte[] buffer = new byte[256];
+			start = System.nanoTime();
+			for(int x=0; x<EXCHANGES; x++) {
+				int received = 0;
+				scm.writeBytes(handle, REQUEST);
+				while(matcher.match(buffer, received) == 0) {
+					byte[] data = scm.readBytes(handle);
+					if(data != null) {
+						System.arraycopy(data, 0, buffer, received, data.length);
+						received += data.length;
+					}else {
+						Thread.sleep(1);
+					}
+				}
+			}
+			System.out.println("write and poll : " + ((System.nanoTime() - start) / EXCHANGES / 1000) + " us per exchange");
+
+			// transact
+			start = System.nanoTime();
+			for(int x=0; x<EXCHANGES; x++) {
+				scm.transact(handle, REQUEST, matcher, 1000);
+			}
+			System.out.println("transact       : " + ((System.nanoTime() - start) / EXCHANGES / 1000) + " us per exchange");
+
+			scm.unregisterDataListener(responderHandle, responder);
+			scm.closeComPort(responderHandle);
+			scm.closeComPort(handle);
+		}catch (Exception e) {
+			e.printStackTrace();
+		}finally {
+			scnm.destroyAllCreatedVirtualDevices();
+		}
+	}
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+import java.io.FileWriter;
+
+import com.serialpundit.ioctl.SerialComIOCTLExecutor;
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.nullmodem.SerialComNullModem;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.FLOWCONTROL;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+
+/*
+ * Gives usb-uart personality to receiving end of a ttyvs null modem pair. With ftdi personality
+ * time taken for a short message to arrive should follow latency timer, while a message of full
+ * packet size (62 bytes) arrives immediately. With cp210x personality GPIO latch is written and
+ * read back through the same ioctls as used with sp_cp210x driver.
+ */
+public final class UsbPersonality {
+
+	private static final int ROUNDS = 50;
+	private static final long IOCTL_GPIOGET = 0x8000;
+	private static final long IOCTL_GPIOSET = 0x8001;
+
+	private static void setAttribute(String port, String attribute, String value) throws Exception {
+		String name = port.substring(port.lastIndexOf('/') + 1);
+		FileWriter fw = new FileWriter("/sys/devices/virtual/tty/" + name + "/" + attribute);
+		fw.write(value);
+		fw.close();
+	}
+
+	/* average time in microseconds from write on tx till all bytes are read on rx */
+	private static long delivery(SerialComManager scm, long tx, long rx, int length) throws Exception {
+		byte[] data = new byte[length];
+		byte[] buffer = new byte[length];
+		long total = 0;
+		for(int x=0; x<ROUNDS; x++) {
+			int received = 0;
+			long start = System.nanoTime();
+			scm.writeBytes(tx, data);
+			while(received < length) {
+				received += scm.readBytes(rx, buffer, received, length - received, -1, null);
+			}
+			total += System.nanoTime() - start;
+		}
+		return total / ROUNDS / 1000;
+	}
+
+	public static void main(String[] args) throws Exception {
+
+		SerialComManager scm = new SerialComManager();
+		SerialComNullModem scnm = scm.getSerialComNullModemInstance();
+		scnm.initialize();
+
+		try {
+			String[] ports = scnm.createStandardNullModemPair(-1, -1);
+			Thread.sleep(500);
+
+			long tx = scm.openComPort(ports[0], true, true, true);
+			scm.configureComPortData(tx, DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_NONE, BAUDRATE.B115200, 0);
+			scm.configureComPortControl(tx, FLOWCONTROL.NONE, 'x', 'x', false, false);
+			long rx = scm.openComPort(ports[4], true, true, true);
+			scm.configureComPortData(rx, DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_NONE, BAUDRATE.B115200, 0);
+			scm.configureComPortControl(rx, FLOWCONTROL.NONE, 'x', 'x', false, false);
+
+			System.out.println("no personality    : 8 bytes " + delivery(scm, tx, rx, 8) + " us");
+
+			setAttribute(ports[4], "personality", "ftdi");
+			String[] timers = { "16", "4", "1", "0" };
+			for(String timer : timers) {
+				setAttribute(ports[4], "latency_timer", timer);
+				System.out.println("ftdi latency " + timer + " ms : 8 bytes " + delivery(scm, tx, rx, 8) + " us, 62 bytes "
+						+ delivery(scm, tx, rx, 62) + " us");
+			}
+
+			setAttribute(ports[4], "personality", "cp210x");
+			SerialComIOCTLExecutor ioctl = new SerialComIOCTLExecutor(null, null);
+			System.out.println("gpio latch at start   : " + Long.toHexString(ioctl.ioctlGetValue(rx, IOCTL_GPIOGET)));
+			// mask 0x0F, state 0x05
+			ioctl.ioctlSetValue(rx, IOCTL_GPIOSET, 0x050F);
+			System.out.println("gpio latch after set  : " + Long.toHexString(ioctl.ioctlGetValue(rx, IOCTL_GPIOGET)));
+
+			setAttribute(ports[4], "personality", "none");
+			scm.closeComPort(rx);
+			scm.closeComPort(tx);
+		}catch (Exception e) {
+			e.printStackTrace();
+		}finally {
+			scnm.destroyAllCreatedVirtualDevices();
+		}
+	}
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package test94;
+
+import java.io.ByteArrayInputStream;
+
+import com.serialpundit.core.SerialComException;
+import com.serialpundit.serial.ftp.SerialComHexDecoder;
+import com.serialpundit.serial.ftp.SerialComHexDecoder.FORMAT;
+
+public class Test94 {
+
+	static final String HEX = ":020000040800F2\r\n"
+			+ ":10000000000102030405060708090A0B0C0D0E0F78\r\n"
+			+ ":10001000101112131415161718191A1B1C1D1E1F68\r\n"
+			+ ":08010000A0A1A2A3A4A5A6A7DB\r\n"
+			+ ":0400000508000101ED\r\n"
+			+ ":00000001FF\r\n";
+
+	static final String SREC = "S00600004844521B\n"
+			+ "S31508000000000102030405060708090A0B0C0D0E0F6A\n"
+			+ "S31508000010101112131415161718191A1B1C1D1E1F5A\n"
+			+ "S30D08000100A0A1A2A3A4A5A6A7CD\n"
+			+ "S5030003F9\n"
+			+ "S70508000101F0\n";
+
+	static void decode(String image) throws Exception {
+		SerialComHexDecoder decoder = new SerialComHexDecoder(new ByteArrayInputStream(image.getBytes()), FORMAT.AUTO);
+		byte[] block = new byte[24];
+		int n;
+		while((n = decoder.readBlock(block, 0, block.length)) > 0) {
+			System.out.println(String.format("0x%08X : %d bytes, first 0x%02X", decoder.getBlockAddress(), n, block[0]));
+		}
+		System.out.println(String.format("%s start address 0x%08X", decoder.getFormat(), decoder.getStartAddress()));
+	}
+
+	public static void main(String[] args) {
+		try {
+			// 0x08000000 : 24 bytes, first 0x00
+			// 0x08000018 : 8 bytes, first 0x18
+			// 0x08000100 : 8 bytes, first 0xA0
+			// INTEL_HEX start address 0x08000101
+			decode(HEX);
+
+			// same blocks, SREC start address 0x08000101
+			decode(SREC);
+
+			// Checksum mismatch at line 3 !
+			try {
+				decode(HEX.replace("1F68", "1F69"));
+			}catch (SerialComException e) {
+				System.out.println(e.getMessage());
+			}
+
+			// same blocks, then: Image ended without end of file record at line 5 !
+			try {
+				decode(HEX.replace(":00000001FF\r\n", ""));
+			}catch (SerialComException e) {
+				System.out.println(e.getMessage());
+			}
+		}catch (Exception e) {
+			e.printStackTrace();
+		}
+	}
+}
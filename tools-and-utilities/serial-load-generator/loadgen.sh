@@ -0,0 +1,22 @@
+#!/bin/bash
+#
+# This file is part of SerialPundit.
+# 
+# Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+#
+# The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+# General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+# license for commercial use of this software. 
+#
+# The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#################################################################################################
+
+# Runs load generator with SerialPundit jars on class path, all arguments are passed to it.
+# ttyvs driver must be loaded. Example: ./loadgen.sh -n 16 -p stream -m blocking
+
+SP_JAR_DIR=${SP_JAR_DIR:-/home/a/Desktop/sp-jar}
+DIR=$(dirname "$0")
+
+exec java $JAVA_OPTS -cp "$DIR/target/sp-load-generator.jar:$SP_JAR_DIR/sp-core.jar:$SP_JAR_DIR/sp-tty.jar" \
+	com.serialpundit.loadgen.LoadGenerator "$@"
@@ -0,0 +1,302 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.loadgen;
+
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.PrintStream;
+import java.util.ArrayList;
+import java.util.Locale;
+
+import org.HdrHistogram.Histogram;
+import org.HdrHistogram.HistogramLogWriter;
+
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComManager.BAUDRATE;
+import com.serialpundit.serial.SerialComManager.DATABITS;
+import com.serialpundit.serial.SerialComManager.FLOWCONTROL;
+import com.serialpundit.serial.SerialComManager.PARITY;
+import com.serialpundit.serial.SerialComManager.STOPBITS;
+import com.serialpundit.serial.SerialComPortConfig;
+import com.serialpundit.serial.nullmodem.SerialComNullModem;
+
+/*
+ * Creates N ttyvs null modem pairs, runs the selected traffic pattern on all of them at the same time
+ * and reports per port and aggregate latency percentiles together with cpu usage and context switches
+ * of the process. Results of every run are also appended to summary.csv in output directory so that
+ * runs with increasing number of pairs can be compared.
+ */
+public final class LoadGenerator {
+
+	private static final String USAGE =
+			"usage: LoadGenerator [options]\n" +
+			"  -n pairs      number of null modem pairs (default 1)\n" +
+			"  -p pattern    reqresp, stream or burst (default reqresp)\n" +
+			"  -m mode       listener or blocking (default listener)\n" +
+			"  -b baud       baud rate (default 115200)\n" +
+			"  -f bytes      frame size, minimum " + PortLoad.HEADER_LENGTH + " (default 64)\n" +
+			"  -r rate       frames per second per port, 0 for line rate (stream, burst) or\n" +
+			"                back to back requests (reqresp) (default 0)\n" +
+			"  -k frames     frames per burst (default 16)\n" +
+			"  -t ms         reply time out for reqresp (default 1000)\n" +
+			"  -w seconds    warm up time (default 2)\n" +
+			"  -d seconds    measurement time (default 10)\n" +
+			"  -o dir        output directory (default loadgen-results)\n" +
+			"  -a path       async-profiler launcher (asprof or profiler.sh), records cpu flame\n" +
+			"                graph of measurement interval\n";
+
+	private int pairs = 1;
+	private PortLoad.Pattern pattern = PortLoad.Pattern.REQRESP;
+	private PortLoad.Mode mode = PortLoad.Mode.LISTENER;
+	private int baud = 115200;
+	private int frameSize = 64;
+	private int rate = 0;
+	private int burst = 16;
+	private long timeOut = 1000;
+	private int warmup = 2;
+	private int duration = 10;
+	private File outDir = new File("loadgen-results");
+	private String profiler = null;
+
+	public static void main(String[] args) throws Exception {
+		LoadGenerator generator = new LoadGenerator();
+		try {
+			generator.parse(args);
+		} catch (IllegalArgumentException e) {
+			System.err.println(e.getMessage());
+			System.err.print(USAGE);
+			System.exit(2);
+		}
+		generator.run();
+	}
+
+	private void parse(String[] args) {
+		for(int x=0; x<args.length; x++) {
+			String opt = args[x];
+			if(opt.equals("-h")) {
+				System.out.print(USAGE);
+				System.exit(0);
+			}
+			if(x + 1 >= args.length) {
+				throw new IllegalArgumentException("missing value for " + opt);
+			}
+			String val = args[++x];
+			switch(opt) {
+			case "-n": pairs = Integer.parseInt(val); break;
+			case "-p": pattern = PortLoad.Pattern.valueOf(val.toUpperCase(Locale.ENGLISH)); break;
+			case "-m": mode = PortLoad.Mode.valueOf(val.toUpperCase(Locale.ENGLISH)); break;
+			case "-b": baud = Integer.parseInt(val); break;
+			case "-f": frameSize = Integer.parseInt(val); break;
+			case "-r": rate = Integer.parseInt(val); break;
+			case "-k": burst = Integer.parseInt(val); break;
+			case "-t": timeOut = Long.parseLong(val); break;
+			case "-w": warmup = Integer.parseInt(val); break;
+			case "-d": duration = Integer.parseInt(val); break;
+			case "-o": outDir = new File(val); break;
+			case "-a": profiler = val; break;
+			default: throw new IllegalArgumentException("unknown option " + opt);
+			}
+		}
+		if((pairs < 1) || (baud < 1) || (frameSize < PortLoad.HEADER_LENGTH) || (rate < 0) || (burst < 1) || (duration < 1)) {
+			throw new IllegalArgumentException("invalid option value");
+		}
+	}
+
+	private SerialComPortConfig portConfig() {
+		BAUDRATE baudRate = BAUDRATE.BCUSTOM;
+		for(BAUDRATE b : BAUDRATE.values()) {
+			if((b != BAUDRATE.BCUSTOM) && (b.getValue() == baud)) {
+				baudRate = b;
+				break;
+			}
+		}
+		SerialComPortConfig config = new SerialComPortConfig();
+		config.setDataFormat(DATABITS.DB_8, STOPBITS.SB_1, PARITY.P_NONE, baudRate, (baudRate == BAUDRATE.BCUSTOM) ? baud : 0);
+		config.setFlowControl(FLOWCONTROL.NONE, 'x', 'x', false, false);
+		config.setClearBuffers(true, true);
+		return config;
+	}
+
+	/* Time between frames, bursts or requests in nanoseconds. 10 bits per byte on the line (8N1). */
+	private long interval() {
+		if((pattern == PortLoad.Pattern.REQRESP) && (rate == 0)) {
+			return 0;
+		}
+		double framesPerSecond = (rate > 0) ? rate : (baud / 10.0) / frameSize;
+		double perFrame = 1000000000.0 / framesPerSecond;
+		return (long) ((pattern == PortLoad.Pattern.BURST) ? (perFrame * burst) : perFrame);
+	}
+
+	private void run() throws Exception {
+		String tag = pattern.name().toLowerCase(Locale.ENGLISH) + "-" + mode.name().toLowerCase(Locale.ENGLISH)
+				+ "-n" + pairs + "-f" + frameSize + "-b" + baud;
+		if((outDir.isDirectory() == false) && (outDir.mkdirs() == false)) {
+			throw new IllegalStateException("can not create " + outDir);
+		}
+
+		SerialComManager scm = new SerialComManager();
+		SerialComNullModem scnm = scm.getSerialComNullModemInstance();
+		scnm.initialize();
+		ArrayList<PortLoad> loads = new ArrayList<PortLoad>();
+		ArrayList<PortLoad> running = new ArrayList<PortLoad>();
+
+		try {
+			SerialComPortConfig config = portConfig();
+			long interval = interval();
+			for(int x=0; x<pairs; x++) {
+				String[] ports = scnm.createStandardNullModemPair(-1, -1);
+				loads.add(new PortLoad(scm, ports[0], ports[4], config, pattern, mode, frameSize, interval, burst, timeOut));
+			}
+			// let udev create device nodes
+			Thread.sleep(500);
+
+			for(PortLoad load : loads) {
+				running.add(load);
+				load.start();
+			}
+
+			Thread.sleep(warmup * 1000L);
+
+			// discard warm up
+			long[] sentBefore = new long[pairs];
+			long[] receivedBefore = new long[pairs];
+			long[] timeoutsBefore = new long[pairs];
+			for(int x=0; x<pairs; x++) {
+				PortLoad load = loads.get(x);
+				load.takeLatency();
+				sentBefore[x] = load.getSent();
+				receivedBefore[x] = load.getReceived();
+				timeoutsBefore[x] = load.getTimeouts();
+			}
+
+			Process flame = startProfiler(tag);
+			ProcessStats before = ProcessStats.sample();
+			Thread.sleep(duration * 1000L);
+			ProcessStats after = ProcessStats.sample();
+
+			Histogram[] histograms = new Histogram[pairs];
+			long[] received = new long[pairs];
+			long[] timeouts = new long[pairs];
+			long[] sent = new long[pairs];
+			for(int x=0; x<pairs; x++) {
+				PortLoad load = loads.get(x);
+				histograms[x] = load.takeLatency();
+				histograms[x].setTag(load.getName());
+				sent[x] = load.getSent() - sentBefore[x];
+				received[x] = load.getReceived() - receivedBefore[x];
+				timeouts[x] = load.getTimeouts() - timeoutsBefore[x];
+			}
+
+			for(PortLoad load : loads) {
+				load.stop();
+			}
+			running.clear();
+			if(flame != null) {
+				flame.waitFor();
+			}
+
+			report(tag, loads, histograms, sent, received, timeouts, before, after);
+		} finally {
+			// a failed start or error during run must not leave sender and reader threads behind
+			for(PortLoad load : running) {
+				try {
+					load.stop();
+				} catch (Exception e) {
+					System.err.println("stop " + load.getName() + " : " + e.getMessage());
+				}
+			}
+			scnm.destroyAllCreatedVirtualDevices();
+			scnm.deinitialize();
+		}
+	}
+
+	private Process startProfiler(String tag) throws Exception {
+		if(profiler == null) {
+			return null;
+		}
+		String pid = new File("/proc/self").getCanonicalFile().getName();
+		File out = new File(outDir, "flame-" + tag + ".html");
+		ProcessBuilder pb = new ProcessBuilder(profiler, "-e", "cpu", "-d", Integer.toString(duration), "-f",
+				out.getAbsolutePath(), pid);
+		pb.redirectErrorStream(true);
+		pb.redirectOutput(new File(outDir, "flame-" + tag + ".log"));
+		return pb.start();
+	}
+
+	private void report(String tag, ArrayList<PortLoad> loads, Histogram[] histograms, long[] sent, long[] received,
+			long[] timeouts, ProcessStats before, ProcessStats after) throws Exception {
+
+		Histogram all = new Histogram(histograms[0].getHighestTrackableValue(), 3);
+		long totalSent = 0;
+		long totalReceived = 0;
+		long totalTimeouts = 0;
+		long totalErrors = 0;
+
+		System.out.println(tag + " : " + duration + " s, latency in microseconds");
+		System.out.printf("%-16s %10s %10s %8s %9s %9s %9s %9s %9s%n", "port", "sent", "received", "timeout",
+				"p50", "p90", "p99", "p99.9", "max");
+		for(int x=0; x<histograms.length; x++) {
+			Histogram h = histograms[x];
+			all.add(h);
+			totalSent += sent[x];
+			totalReceived += received[x];
+			totalTimeouts += timeouts[x];
+			totalErrors += loads.get(x).getErrors();
+			System.out.printf("%-16s %10d %10d %8d %9.1f %9.1f %9.1f %9.1f %9.1f%n", loads.get(x).getName(), sent[x],
+					received[x], timeouts[x], us(h, 50), us(h, 90), us(h, 99), us(h, 99.9), h.getMaxValue() / 1000.0);
+		}
+		System.out.printf("%-16s %10d %10d %8d %9.1f %9.1f %9.1f %9.1f %9.1f%n", "all", totalSent, totalReceived,
+				totalTimeouts, us(all, 50), us(all, 90), us(all, 99), us(all, 99.9), all.getMaxValue() / 1000.0);
+
+		double wall = (after.wallTime - before.wallTime) / 1000000000.0;
+		double user = (after.userTime - before.userTime) / 1e9 / wall * 100;
+		double sys = (after.systemTime - before.systemTime) / 1e9 / wall * 100;
+		double vcs = (after.voluntarySwitches - before.voluntarySwitches) / wall;
+		double ics = (after.involuntarySwitches - before.involuntarySwitches) / wall;
+		double scs = (after.systemSwitches - before.systemSwitches) / wall;
+		System.out.printf("cpu %.1f%% (user %.1f%%, sys %.1f%%) of one core, %d threads, context switches/s :"
+				+ " voluntary %.0f, involuntary %.0f, system %.0f, errors %d%n", user + sys, user, sys, after.threads,
+				vcs, ics, scs, totalErrors);
+
+		PrintStream hgrm = new PrintStream(new FileOutputStream(new File(outDir, tag + ".hgrm")));
+		all.outputPercentileDistribution(hgrm, 1000.0);
+		hgrm.close();
+
+		PrintStream hlog = new PrintStream(new FileOutputStream(new File(outDir, tag + ".hlog")));
+		HistogramLogWriter writer = new HistogramLogWriter(hlog);
+		writer.outputLogFormatVersion();
+		writer.outputLegend();
+		for(Histogram h : histograms) {
+			writer.outputIntervalHistogram(h);
+		}
+		hlog.close();
+
+		File csv = new File(outDir, "summary.csv");
+		boolean header = (csv.exists() == false);
+		PrintStream out = new PrintStream(new FileOutputStream(csv, true));
+		if(header == true) {
+			out.println("pattern,mode,pairs,baud,frame,rate,seconds,frames_per_s,timeouts,errors,p50_us,p90_us,p99_us,"
+					+ "p999_us,max_us,cpu_pct,user_pct,sys_pct,vol_cs_per_s,invol_cs_per_s,sys_cs_per_s,threads");
+		}
+		out.printf(Locale.ENGLISH, "%s,%s,%d,%d,%d,%d,%d,%.1f,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.0f,%.0f,%.0f,%d%n",
+				pattern.name().toLowerCase(Locale.ENGLISH), mode.name().toLowerCase(Locale.ENGLISH), pairs, baud,
+				frameSize, rate, duration, totalReceived / wall, totalTimeouts, totalErrors, us(all, 50), us(all, 90),
+				us(all, 99), us(all, 99.9), all.getMaxValue() / 1000.0, user + sys, user, sys, vcs, ics, scs, after.threads);
+		out.close();
+	}
+
+	private static double us(Histogram h, double percentile) {
+		return h.getValueAtPercentile(percentile) / 1000.0;
+	}
+}
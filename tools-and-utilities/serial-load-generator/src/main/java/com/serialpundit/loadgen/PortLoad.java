@@ -0,0 +1,377 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.loadgen;
+
+import java.util.concurrent.Semaphore;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.locks.LockSupport;
+
+import org.HdrHistogram.Histogram;
+import org.HdrHistogram.Recorder;
+
+import com.serialpundit.core.SerialComException;
+import com.serialpundit.serial.ISerialComDataListener;
+import com.serialpundit.serial.SerialComManager;
+import com.serialpundit.serial.SerialComPortConfig;
+
+/*
+ * Traffic on one null modem pair. Port A sends frames, port B receives them. For request/response
+ * port B echoes every frame back and the round trip time is recorded on port A, for streaming and
+ * bursty traffic one way latency is recorded on port B.
+ *
+ * Every frame carries time at which it should have been sent (first 8 bytes) and sequence number
+ * (next 4 bytes). Paced traffic is stamped with scheduled time and not actual write time so that
+ * a stalled sender shows up as latency instead of silently lowering the rate (coordinated omission).
+ */
+public final class PortLoad {
+
+	public enum Pattern {
+		REQRESP, STREAM, BURST
+	}
+
+	public enum Mode {
+		LISTENER, BLOCKING
+	}
+
+	/* minimum frame length; time stamp and sequence number */
+	public static final int HEADER_LENGTH = 12;
+
+	/* one minute in nanoseconds is more than enough for any latency we care about */
+	private static final long HIGHEST_LATENCY = 60000000000L;
+
+	private final SerialComManager scm;
+	private final String portA;
+	private final String portB;
+	private final SerialComPortConfig config;
+	private final Pattern pattern;
+	private final Mode mode;
+	private final int frameSize;
+	private final long interval;
+	private final int burst;
+	private final long timeOut;
+
+	private final Recorder latency = new Recorder(HIGHEST_LATENCY, 3);
+	private final AtomicLong sent = new AtomicLong();
+	private final AtomicLong received = new AtomicLong();
+	private final AtomicLong timeouts = new AtomicLong();
+	private final AtomicLong errors = new AtomicLong();
+	private final Semaphore response = new Semaphore(0);
+	private volatile int expectedSeq = -1;
+	private volatile boolean exit = false;
+
+	private long handleA = -1;
+	private long handleB = -1;
+	private Receiver receiverA;
+	private Receiver receiverB;
+	private Thread sender;
+
+	/*
+	 * Reassembles fixed size frames from the byte stream of one port, either from data listener
+	 * callbacks or from its own thread doing blocking reads.
+	 */
+	private final class Receiver implements ISerialComDataListener, Runnable {
+
+		private final long handle;
+		private final boolean echo;
+		private final byte[] frame = new byte[frameSize];
+		private int filled = 0;
+		private long context = -1;
+		private Thread thread;
+
+		Receiver(long handle, boolean echo) {
+			this.handle = handle;
+			this.echo = echo;
+		}
+
+		void start() throws SerialComException {
+			if(mode == Mode.LISTENER) {
+				scm.registerDataListener(handle, this);
+			}else {
+				context = scm.createBlockingIOContext();
+				thread = new Thread(this, "loadgen reader " + handle);
+				thread.start();
+			}
+		}
+
+		void stop() throws SerialComException {
+			if(mode == Mode.LISTENER) {
+				scm.unregisterDataListener(handle, this);
+				return;
+			}
+			scm.unblockBlockingIOOperation(context);
+			try {
+				thread.join();
+			} catch (InterruptedException e) {
+				Thread.currentThread().interrupt();
+			}
+			scm.destroyBlockingIOContext(context);
+		}
+
+		@Override
+		public void run() {
+			byte[] buffer = new byte[2048];
+			while(exit == false) {
+				try {
+					int ret = scm.readBytes(handle, buffer, 0, buffer.length, context, null);
+					if(ret > 0) {
+						feed(buffer, 0, ret);
+					}
+				} catch (SerialComException e) {
+					if(exit == false) {
+						errors.incrementAndGet();
+					}
+					break;
+				}
+			}
+		}
+
+		@Override
+		public void onNewSerialDataAvailable(byte[] data) {
+			feed(data, 0, data.length);
+		}
+
+		@Override
+		public void onDataListenerError(int errorNum) {
+			errors.incrementAndGet();
+		}
+
+		private void feed(byte[] data, int offset, int length) {
+			while(length > 0) {
+				int count = Math.min(frameSize - filled, length);
+				System.arraycopy(data, offset, frame, filled, count);
+				filled += count;
+				offset += count;
+				length -= count;
+				if(filled == frameSize) {
+					filled = 0;
+					onFrame(System.nanoTime());
+				}
+			}
+		}
+
+		private void onFrame(long now) {
+			if(echo == true) {
+				try {
+					scm.writeBytes(handle, frame);
+				} catch (SerialComException e) {
+					errors.incrementAndGet();
+				}
+				return;
+			}
+
+			received.incrementAndGet();
+			latency.recordValue(Math.max(0, now - getLong(frame, 0)));
+
+			if(pattern == Pattern.REQRESP) {
+				// late reply of a request which already timed out must not release next request
+				if(getInt(frame, 8) == expectedSeq) {
+					response.release();
+				}
+			}
+		}
+	}
+
+	/*
+	 * Writes frames on port A as per traffic pattern until stopped.
+	 */
+	private final class Sender implements Runnable {
+
+		private final byte[] frame = new byte[frameSize];
+		private int seq = 0;
+
+		Sender() {
+			for(int x=HEADER_LENGTH; x<frameSize; x++) {
+				frame[x] = (byte) x;
+			}
+		}
+
+		@Override
+		public void run() {
+			long next = System.nanoTime();
+			try {
+				while(exit == false) {
+					if(pattern == Pattern.REQRESP) {
+						// permit released by a reply which came after previous request timed out
+						expectedSeq = seq;
+						response.drainPermits();
+						write((interval > 0) ? next : System.nanoTime());
+						if(response.tryAcquire(timeOut, TimeUnit.MILLISECONDS) == false) {
+							timeouts.incrementAndGet();
+						}
+						if(interval > 0) {
+							next += interval;
+							pace(next);
+						}
+					}else if(pattern == Pattern.STREAM) {
+						write(next);
+						next += interval;
+						pace(next);
+					}else {
+						for(int x=0; x<burst; x++) {
+							write(next);
+						}
+						next += interval;
+						pace(next);
+					}
+				}
+			} catch (SerialComException e) {
+				if(exit == false) {
+					errors.incrementAndGet();
+				}
+			} catch (InterruptedException e) {
+				// stopped
+			}
+		}
+
+		private void write(long timestamp) throws SerialComException {
+			putLong(frame, 0, timestamp);
+			putInt(frame, 8, seq);
+			seq++;
+			scm.writeBytes(handleA, frame);
+			sent.incrementAndGet();
+		}
+
+		private void pace(long until) {
+			long wait;
+			while(((wait = until - System.nanoTime()) > 0) && (exit == false)) {
+				LockSupport.parkNanos(wait);
+			}
+		}
+	}
+
+	/*
+	 * interval : time in nanoseconds between two frames (streaming), two bursts (bursty) or two requests
+	 * (request/response, 0 for sending next request as soon as reply is received).
+	 * timeOut  : time in milliseconds to wait for reply in request/response pattern.
+	 */
+	public PortLoad(SerialComManager scm, String portA, String portB, SerialComPortConfig config, Pattern pattern,
+			Mode mode, int frameSize, long interval, int burst, long timeOut) {
+		if(frameSize < HEADER_LENGTH) {
+			throw new IllegalArgumentException("Argument frameSize can not be less than " + HEADER_LENGTH + " !");
+		}
+		this.scm = scm;
+		this.portA = portA;
+		this.portB = portB;
+		this.config = config;
+		this.pattern = pattern;
+		this.mode = mode;
+		this.frameSize = frameSize;
+		this.interval = interval;
+		this.burst = burst;
+		this.timeOut = timeOut;
+	}
+
+	public void start() throws SerialComException {
+		handleA = scm.openComPort(portA, true, true, true, config);
+		handleB = scm.openComPort(portB, true, true, true, config);
+
+		Receiver receiver = new Receiver(handleB, pattern == Pattern.REQRESP);
+		receiver.start();
+		receiverB = receiver;
+		if(pattern == Pattern.REQRESP) {
+			receiver = new Receiver(handleA, false);
+			receiver.start();
+			receiverA = receiver;
+		}
+
+		sender = new Thread(new Sender(), "loadgen sender " + portA);
+		sender.start();
+	}
+
+	/* Undoes whatever start() managed to do, so it can also be called after start() failed or twice. */
+	public void stop() throws SerialComException {
+		exit = true;
+		if(sender != null) {
+			sender.interrupt();
+			try {
+				sender.join();
+			} catch (InterruptedException e) {
+				Thread.currentThread().interrupt();
+			}
+			sender = null;
+		}
+		if(receiverA != null) {
+			receiverA.stop();
+			receiverA = null;
+		}
+		if(receiverB != null) {
+			receiverB.stop();
+			receiverB = null;
+		}
+		if(handleA != -1) {
+			scm.closeComPort(handleA);
+			handleA = -1;
+		}
+		if(handleB != -1) {
+			scm.closeComPort(handleB);
+			handleB = -1;
+		}
+	}
+
+	/* Latencies recorded since last call, in nanoseconds. */
+	public Histogram takeLatency() {
+		return latency.getIntervalHistogram();
+	}
+
+	public String getName() {
+		return portA;
+	}
+
+	public long getSent() {
+		return sent.get();
+	}
+
+	public long getReceived() {
+		return received.get();
+	}
+
+	public long getTimeouts() {
+		return timeouts.get();
+	}
+
+	public long getErrors() {
+		return errors.get();
+	}
+
+	private static void putLong(byte[] buf, int offset, long value) {
+		for(int x=7; x>=0; x--) {
+			buf[offset + x] = (byte) value;
+			value >>>= 8;
+		}
+	}
+
+	private static long getLong(byte[] buf, int offset) {
+		long value = 0;
+		for(int x=0; x<8; x++) {
+			value = (value << 8) | (buf[offset + x] & 0xFF);
+		}
+		return value;
+	}
+
+	private static void putInt(byte[] buf, int offset, int value) {
+		for(int x=3; x>=0; x--) {
+			buf[offset + x] = (byte) value;
+			value >>>= 8;
+		}
+	}
+
+	private static int getInt(byte[] buf, int offset) {
+		int value = 0;
+		for(int x=0; x<4; x++) {
+			value = (value << 8) | (buf[offset + x] & 0xFF);
+		}
+		return value;
+	}
+}
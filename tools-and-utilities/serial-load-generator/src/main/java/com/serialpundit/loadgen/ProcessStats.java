@@ -0,0 +1,117 @@
+/*
+ * This file is part of SerialPundit.
+ *
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial
+ * license for commercial use of this software.
+ *
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+package com.serialpundit.loadgen;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+import java.io.IOException;
+
+/*
+ * Snapshot of cpu time and context switches of this process and of the whole system, read from
+ * linux proc file system. Difference of two snapshots gives usage over the measurement interval.
+ */
+public final class ProcessStats {
+
+	/* USER_HZ is fixed at 100 in linux user space ABI */
+	private static final long NANOS_PER_TICK = 10000000L;
+
+	public final long wallTime;
+	public final long userTime;
+	public final long systemTime;
+	public final long voluntarySwitches;
+	public final long involuntarySwitches;
+	public final long systemSwitches;
+	public final int threads;
+
+	private ProcessStats(long wallTime, long userTime, long systemTime, long voluntarySwitches,
+			long involuntarySwitches, long systemSwitches, int threads) {
+		this.wallTime = wallTime;
+		this.userTime = userTime;
+		this.systemTime = systemTime;
+		this.voluntarySwitches = voluntarySwitches;
+		this.involuntarySwitches = involuntarySwitches;
+		this.systemSwitches = systemSwitches;
+		this.threads = threads;
+	}
+
+	public static ProcessStats sample() throws IOException {
+		long wall = System.nanoTime();
+
+		// fields after command name, which itself may contain spaces and brackets
+		String stat = readFirstLine("/proc/self/stat");
+		String[] fields = stat.substring(stat.lastIndexOf(')') + 2).split(" ");
+		long utime = Long.parseLong(fields[11]) * NANOS_PER_TICK;
+		long stime = Long.parseLong(fields[12]) * NANOS_PER_TICK;
+
+		// context switches are accounted per thread, threads which already exited are not included
+		long voluntary = 0;
+		long involuntary = 0;
+		int threads = 0;
+		File[] tasks = new File("/proc/self/task").listFiles();
+		if(tasks != null) {
+			for(File task : tasks) {
+				BufferedReader reader = null;
+				try {
+					reader = new BufferedReader(new FileReader(new File(task, "status")));
+					String line;
+					while((line = reader.readLine()) != null) {
+						if(line.startsWith("voluntary_ctxt_switches:")) {
+							voluntary += parseValue(line);
+						}else if(line.startsWith("nonvoluntary_ctxt_switches:")) {
+							involuntary += parseValue(line);
+						}
+					}
+					threads++;
+				} catch (IOException e) {
+					// thread exited while we were reading
+				} finally {
+					if(reader != null) {
+						reader.close();
+					}
+				}
+			}
+		}
+
+		long ctxt = 0;
+		BufferedReader reader = new BufferedReader(new FileReader("/proc/stat"));
+		try {
+			String line;
+			while((line = reader.readLine()) != null) {
+				if(line.startsWith("ctxt ")) {
+					ctxt = parseValue(line);
+					break;
+				}
+			}
+		} finally {
+			reader.close();
+		}
+
+		return new ProcessStats(wall, utime, stime, voluntary, involuntary, ctxt, threads);
+	}
+
+	private static String readFirstLine(String path) throws IOException {
+		BufferedReader reader = new BufferedReader(new FileReader(path));
+		try {
+			return reader.readLine();
+		} finally {
+			reader.close();
+		}
+	}
+
+	private static long parseValue(String line) {
+		String[] parts = line.trim().split("\\s+");
+		return Long.parseLong(parts[parts.length - 1]);
+	}
+}
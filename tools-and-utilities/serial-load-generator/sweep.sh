@@ -0,0 +1,33 @@
+#!/bin/bash
+#
+# This file is part of SerialPundit.
+# 
+# Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+#
+# The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+# General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+# license for commercial use of this software. 
+#
+# The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#################################################################################################
+
+# Runs the given traffic pattern with increasing number of null modem pairs in both listener and
+# blocking mode. Each run appends a line to <output dir>/summary.csv, the point where p99 latency or
+# timeouts start to grow is the number of ports this host can serve.
+#
+# Usage: ./sweep.sh [pattern] [max pairs] [extra load generator options]
+# Example: ./sweep.sh reqresp 64 -f 64 -b 115200 -d 20
+
+PATTERN=${1:-reqresp}
+MAX=${2:-64}
+shift 2 2>/dev/null || shift $#
+DIR=$(dirname "$0")
+
+for mode in listener blocking; do
+	n=1
+	while [ $n -le $MAX ]; do
+		"$DIR/loadgen.sh" -p "$PATTERN" -m $mode -n $n "$@" || exit 1
+		n=$((n * 2))
+	done
+done
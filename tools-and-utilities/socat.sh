@@ -13,6 +13,8 @@
 #################################################################################################
 
 # Creates pseudo terminal pair (/dev/pts/1 etc.), may need to run as root user.
+# Pseudo terminals do not support modem lines, break or line errors and every byte is copied by socat
+# process. When ttyvs driver is available, use ttyvs-pair/ttyvs-pair instead.
 
 set -e
 
@@ -19,6 +19,9 @@
 # It is a handy script for use in system integration when udev may not be available for example in 
 # embedded system environment or we may be not willing to use udev rules.
 
+# This script handles one device and runs once. To keep links of many devices up to date across
+# re-plugging, use usb-serial-symlinkd/spsymlinkd instead.
+
 # There are many ways in which this script can be modifed and integrated with udev rules. An example
 # of udev rule is given below based on bus number and device number.
 
@@ -0,0 +1,576 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/*
+ * Creates and deletes ttyvs virtual serial devices through driver's control node (/dev/ttyvs_card) and
+ * optionally measures throughput and round trip latency of a ttyvs null modem pair against a socat
+ * PTY pair. Unlike socat, ttyvs moves data inside kernel and supports modem lines, break and line errors
+ * so it can replace socat.sh in test scripts.
+ *
+ * Control node command (61 bytes) : gen|del, nm|lb, device indexes (5 digits or xxxxx), RTS and DTR
+ * pin mappings of each end (pins 8 CTS, 1 DCD, 6 DSR, 9 RI) and whether DTR is raised at open.
+ * Reading 52 bytes gives last created devices and next free indexes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define CARD_NODE        "/dev/ttyvs_card"
+#define CMD_LEN          61
+#define INFO_LEN         52
+#define CREATE_RETRIES   8
+
+#define BENCH_BYTES      (16 * 1024 * 1024)
+#define BENCH_CHUNK      4096
+#define BENCH_ROUNDS     10000
+#define BENCH_PING_LEN   16
+#define IO_TIMEOUT_MS    5000
+
+struct endpoint_pair {
+    char name[2][64];
+    pid_t socat;
+};
+
+struct echo_arg {
+    int fd;
+    int rounds;
+    int len;
+};
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: ttyvs-pair nm [-i idx] [-j idx] [-r pins] [-d pins] [-R pins] [-D pins] [-n] [-N]\n"
+        "       ttyvs-pair lb [-i idx] [-r pins] [-d pins] [-n]\n"
+        "       ttyvs-pair del <idx|all>\n"
+        "       ttyvs-pair bench [-b bytes] [-c rounds] [-s]\n"
+        "  -i -j  device indexes (default next free)\n"
+        "  -r -d  pins driven by RTS and DTR of 1st device, comma separated from 8 (CTS),\n"
+        "         1 (DCD), 6 (DSR), 9 (RI) (default -r 8 -d 1,6); -R -D for 2nd device\n"
+        "  -n -N  do not raise DTR when 1st/2nd device is opened\n"
+        "  -b     bytes moved in throughput test (default %d)\n"
+        "  -c     round trips in latency test (default %d)\n"
+        "  -s     skip socat pair\n", BENCH_BYTES, BENCH_ROUNDS);
+    exit(2);
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Converts "1,6" to 7 character mapping field "1,6,x,x". */
+static int pin_field(const char *pins, char *field) {
+    int n = 0;
+    const char *p;
+
+    memcpy(field, "x,x,x,x", 7);
+    if(pins == NULL || strcmp(pins, "x") == 0)
+        return 0;
+    for(p = pins; *p; p++) {
+        if(*p == ',')
+            continue;
+        if((*p != '8' && *p != '1' && *p != '6' && *p != '9') || n == 4)
+            return -1;
+        field[n * 2] = *p;
+        n++;
+    }
+    return 0;
+}
+
+static int card_command(const char *cmd) {
+    int fd, ret = 0;
+
+    fd = open(CARD_NODE, O_WRONLY);
+    if(fd < 0)
+        return -errno;
+    if(write(fd, cmd, CMD_LEN) != CMD_LEN)
+        ret = -errno;
+    close(fd);
+    return ret;
+}
+
+/* Gives next two free indexes as reported by driver. */
+static int card_free_indexes(int *first, int *second) {
+    char info[INFO_LEN + 1];
+    int fd;
+    ssize_t ret;
+
+    fd = open(CARD_NODE, O_RDONLY);
+    if(fd < 0)
+        return -errno;
+    ret = read(fd, info, INFO_LEN);
+    close(fd);
+    if(ret != INFO_LEN)
+        return -EIO;
+    info[INFO_LEN] = '\0';
+    *first = atoi(&info[18]);
+    *second = atoi(&info[24]);
+    return 0;
+}
+
+static void format_index(char *dst, int idx) {
+    char tmp[12];
+
+    if(idx < 0) {
+        memcpy(dst, "xxxxx", 5);
+    }else {
+        snprintf(tmp, sizeof(tmp), "%05d", idx);
+        memcpy(dst, tmp, 5);
+    }
+}
+
+/*
+ * Creates null modem pair or loopback device. When index is not given, free indexes are read first and
+ * given explicitly so that created nodes are known even if some other process creates devices at the
+ * same time; if someone took them in between, driver says EEXIST and we try again.
+ */
+static int create_devices(int loopback, int idx1, int idx2, const char *map[4], int dtr1, int dtr2,
+        int *out1, int *out2) {
+    char cmd[CMD_LEN + 1];
+    char rts1[7], dtrm1[7], rts2[7], dtrm2[7];
+    int first = -1, second = -1, try, ret, a, b;
+
+    if(pin_field(map[0], rts1) || pin_field(map[1], dtrm1) || pin_field(map[2], rts2)
+            || pin_field(map[3], dtrm2))
+        return -EINVAL;
+
+    for(try = 0; try < CREATE_RETRIES; try++) {
+        a = idx1;
+        b = idx2;
+        if(a < 0 || (!loopback && b < 0)) {
+            ret = card_free_indexes(&first, &second);
+            if(ret < 0)
+                return ret;
+            if(a < 0)
+                a = (b == first) ? second : first;
+            if(!loopback && b < 0)
+                b = (a == first) ? second : first;
+            if(a < 0 || (!loopback && b < 0))
+                return -ENOSPC;
+        }
+
+        memset(cmd, 0, sizeof(cmd));
+        memcpy(cmd, loopback ? "genlb#" : "gennm#", 6);
+        format_index(&cmd[6], a);
+        cmd[11] = '#';
+        format_index(&cmd[12], loopback ? -1 : b);
+        cmd[17] = '#';
+        memcpy(&cmd[18], "7-", 2);
+        memcpy(&cmd[20], rts1, 7);
+        memcpy(&cmd[27], "#4-", 3);
+        memcpy(&cmd[30], dtrm1, 7);
+        cmd[37] = '#';
+        if(loopback) {
+            memcpy(&cmd[38], "x-x,x,x,x#x-x,x,x,x", 19);
+        }else {
+            memcpy(&cmd[38], "7-", 2);
+            memcpy(&cmd[40], rts2, 7);
+            memcpy(&cmd[47], "#4-", 3);
+            memcpy(&cmd[50], dtrm2, 7);
+        }
+        cmd[57] = '#';
+        cmd[58] = dtr1 ? 'y' : 'n';
+        cmd[59] = '#';
+        cmd[60] = loopback ? 'x' : (dtr2 ? 'y' : 'n');
+
+        ret = card_command(cmd);
+        if(ret == -EEXIST && (idx1 < 0 || (!loopback && idx2 < 0)))
+            continue;
+        if(ret < 0)
+            return ret;
+        *out1 = a;
+        *out2 = loopback ? -1 : b;
+        return 0;
+    }
+    return -EEXIST;
+}
+
+static int delete_devices(int idx) {
+    char cmd[CMD_LEN + 1];
+
+    memset(cmd, 'x', CMD_LEN);
+    memcpy(cmd, "del#", 4);
+    if(idx >= 0)
+        format_index(&cmd[4], idx);
+    cmd[CMD_LEN] = '\0';
+    return card_command(cmd);
+}
+
+/* Waits until node appears (udev may still be processing add event). */
+static int wait_node(const char *name) {
+    int i;
+
+    for(i = 0; i < 500; i++) {
+        if(access(name, R_OK | W_OK) == 0)
+            return 0;
+        usleep(10000);
+    }
+    return -ENOENT;
+}
+
+static int open_raw(const char *name) {
+    struct termios tio;
+    int fd;
+
+    fd = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(fd < 0)
+        return -1;
+    /* ttyvs drops data if both ends do not have same settings, so configure both identically */
+    if(tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        cfsetispeed(&tio, B115200);
+        cfsetospeed(&tio, B115200);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static int wait_fd(int fd, short events) {
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    return poll(&pfd, 1, IO_TIMEOUT_MS);
+}
+
+static int write_all(int fd, const unsigned char *buf, int len) {
+    int done = 0;
+    ssize_t ret;
+
+    while(done < len) {
+        ret = write(fd, buf + done, len - done);
+        if(ret > 0) {
+            done += ret;
+        }else if(ret < 0 && errno != EAGAIN && errno != EINTR) {
+            return -1;
+        }else if(wait_fd(fd, POLLOUT) <= 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int read_all(int fd, unsigned char *buf, int len) {
+    int done = 0;
+    ssize_t ret;
+
+    while(done < len) {
+        if(wait_fd(fd, POLLIN) <= 0)
+            return -1;
+        ret = read(fd, buf + done, len - done);
+        if(ret > 0)
+            done += ret;
+        else if(ret < 0 && errno != EAGAIN && errno != EINTR)
+            return -1;
+    }
+    return 0;
+}
+
+static void *writer_thread(void *arg) {
+    struct echo_arg *wa = arg;
+    unsigned char buf[BENCH_CHUNK];
+    int sent = 0, len;
+
+    memset(buf, 0x55, sizeof(buf));
+    while(sent < wa->len) {
+        len = (wa->len - sent) < BENCH_CHUNK ? (wa->len - sent) : BENCH_CHUNK;
+        if(write_all(wa->fd, buf, len) < 0)
+            break;
+        sent += len;
+    }
+    return NULL;
+}
+
+static void *echo_thread(void *arg) {
+    struct echo_arg *ea = arg;
+    unsigned char buf[BENCH_PING_LEN];
+    int i;
+
+    for(i = 0; i < ea->rounds; i++) {
+        if(read_all(ea->fd, buf, ea->len) < 0 || write_all(ea->fd, buf, ea->len) < 0)
+            break;
+    }
+    return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Moves bytes from fd0 to fd1 and then measures round trip of small messages echoed by fd1. */
+static int measure(const char *label, const char *name, int fd0, int fd1, int bytes, int rounds) {
+    unsigned char buf[BENCH_CHUNK];
+    unsigned char ping[BENCH_PING_LEN];
+    struct echo_arg arg;
+    pthread_t tid;
+    long long start, elapsed, *rtt;
+    int got = 0, i, len;
+    ssize_t ret;
+
+    /* throughput, one direction */
+    arg.fd = fd0;
+    arg.len = bytes;
+    arg.rounds = 0;
+    start = now_ns();
+    pthread_create(&tid, NULL, writer_thread, &arg);
+    while(got < bytes) {
+        if(wait_fd(fd1, POLLIN) <= 0)
+            break;
+        ret = read(fd1, buf, sizeof(buf));
+        if(ret > 0)
+            got += ret;
+    }
+    elapsed = now_ns() - start;
+    pthread_join(tid, NULL);
+    if(got < bytes) {
+        fprintf(stderr, "%s : only %d of %d bytes received\n", label, got, bytes);
+        return -1;
+    }
+
+    /* round trip latency, 2nd end echoes */
+    rtt = malloc(sizeof(long long) * rounds);
+    if(rtt == NULL)
+        return -1;
+    tcflush(fd0, TCIOFLUSH);
+    tcflush(fd1, TCIOFLUSH);
+    memset(ping, 0xaa, sizeof(ping));
+    arg.fd = fd1;
+    arg.len = BENCH_PING_LEN;
+    arg.rounds = rounds;
+    pthread_create(&tid, NULL, echo_thread, &arg);
+    for(i = 0; i < rounds; i++) {
+        start = now_ns();
+        if(write_all(fd0, ping, BENCH_PING_LEN) < 0 || read_all(fd0, ping, BENCH_PING_LEN) < 0)
+            break;
+        rtt[i] = now_ns() - start;
+    }
+    len = i;
+    pthread_join(tid, NULL);
+
+    if(len < rounds) {
+        fprintf(stderr, "%s : only %d of %d round trips completed\n", label, len, rounds);
+        free(rtt);
+        return -1;
+    }
+
+    qsort(rtt, len, sizeof(long long), cmp_ll);
+    printf("%-6s %-20s %8.1f MB/s   rtt median %6lld us  p99 %6lld us  max %6lld us\n",
+        label, name, (bytes / 1048576.0) / (elapsed / 1e9),
+        rtt[len / 2] / 1000, rtt[(len * 99) / 100] / 1000, rtt[len - 1] / 1000);
+    free(rtt);
+    return 0;
+}
+
+static int run_bench(const char *label, struct endpoint_pair *pair, int bytes, int rounds) {
+    int fd0, fd1, ret = -1;
+
+    fd0 = open_raw(pair->name[0]);
+    fd1 = open_raw(pair->name[1]);
+    if(fd0 < 0 || fd1 < 0)
+        fprintf(stderr, "%s : can not open pair : %s\n", label, strerror(errno));
+    else
+        ret = measure(label, pair->name[0], fd0, fd1, bytes, rounds);
+
+    if(fd0 >= 0)
+        close(fd0);
+    if(fd1 >= 0)
+        close(fd1);
+    return ret;
+}
+
+/* Starts socat and takes PTY names from its notice messages ("PTY is /dev/pts/N"). */
+static int start_socat(struct endpoint_pair *pair) {
+    char line[256];
+    int pfd[2], found = 0;
+    FILE *fp;
+    char *p;
+
+    if(pipe(pfd) < 0)
+        return -1;
+    pair->socat = fork();
+    if(pair->socat < 0)
+        return -1;
+    if(pair->socat == 0) {
+        dup2(pfd[1], STDERR_FILENO);
+        close(pfd[0]);
+        close(pfd[1]);
+        execlp("socat", "socat", "-d", "-d", "pty,raw,echo=0", "pty,raw,echo=0", (char *)NULL);
+        _exit(127);
+    }
+    close(pfd[1]);
+    fp = fdopen(pfd[0], "r");
+    while(found < 2 && fp && fgets(line, sizeof(line), fp)) {
+        p = strstr(line, "PTY is ");
+        if(p == NULL)
+            continue;
+        p += 7;
+        p[strcspn(p, "\r\n")] = '\0';
+        snprintf(pair->name[found], sizeof(pair->name[found]), "%s", p);
+        found++;
+    }
+    if(fp)
+        fclose(fp);
+    if(found < 2) {
+        kill(pair->socat, SIGTERM);
+        waitpid(pair->socat, NULL, 0);
+        return -1;
+    }
+    return 0;
+}
+
+static int bench(int bytes, int rounds, int with_socat) {
+    const char *map[4] = { "8", "1,6", "8", "1,6" };
+    struct endpoint_pair pair;
+    int a, b, ret;
+
+    ret = create_devices(0, -1, -1, map, 1, 1, &a, &b);
+    if(ret < 0) {
+        fprintf(stderr, "can not create ttyvs pair : %s\n", strerror(-ret));
+    }else {
+        snprintf(pair.name[0], sizeof(pair.name[0]), "/dev/ttyvs%d", a);
+        snprintf(pair.name[1], sizeof(pair.name[1]), "/dev/ttyvs%d", b);
+        if(wait_node(pair.name[0]) == 0 && wait_node(pair.name[1]) == 0) {
+            ret = run_bench("ttyvs", &pair, bytes, rounds);
+        }else {
+            fprintf(stderr, "nodes %s %s did not appear\n", pair.name[0], pair.name[1]);
+            ret = -1;
+        }
+        delete_devices(a);
+    }
+
+    if(with_socat) {
+        if(start_socat(&pair) < 0) {
+            fprintf(stderr, "can not start socat, skipping PTY pair\n");
+            return ret < 0 ? 1 : 0;
+        }
+        if(run_bench("socat", &pair, bytes, rounds) < 0)
+            ret = -1;
+        kill(pair.socat, SIGTERM);
+        waitpid(pair.socat, NULL, 0);
+    }
+    return ret < 0 ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *map[4] = { "8", "1,6", "8", "1,6" };
+    int idx1 = -1, idx2 = -1, dtr1 = 1, dtr2 = 1;
+    int bytes = BENCH_BYTES, rounds = BENCH_ROUNDS, with_socat = 1;
+    int loopback, opt, ret, a, b;
+    const char *cmd;
+
+    if(argc < 2)
+        usage();
+    cmd = argv[1];
+    optind = 2;
+
+    if(strcmp(cmd, "del") == 0) {
+        if(argc != 3)
+            usage();
+        ret = delete_devices(strcmp(argv[2], "all") == 0 ? -1 : atoi(argv[2]));
+        if(ret < 0) {
+            fprintf(stderr, "can not delete : %s\n", strerror(-ret));
+            return 1;
+        }
+        return 0;
+    }
+
+    if(strcmp(cmd, "bench") == 0) {
+        while((opt = getopt(argc, argv, "b:c:s")) != -1) {
+            switch(opt) {
+            case 'b':
+                bytes = atoi(optarg);
+                break;
+            case 'c':
+                rounds = atoi(optarg);
+                break;
+            case 's':
+                with_socat = 0;
+                break;
+            default:
+                usage();
+            }
+        }
+        if(bytes <= 0 || rounds <= 0)
+            usage();
+        return bench(bytes, rounds, with_socat);
+    }
+
+    if(strcmp(cmd, "nm") == 0)
+        loopback = 0;
+    else if(strcmp(cmd, "lb") == 0)
+        loopback = 1;
+    else
+        usage();
+
+    while((opt = getopt(argc, argv, "i:j:r:d:R:D:nN")) != -1) {
+        switch(opt) {
+        case 'i':
+            idx1 = atoi(optarg);
+            break;
+        case 'j':
+            idx2 = atoi(optarg);
+            break;
+        case 'r':
+            map[0] = optarg;
+            break;
+        case 'd':
+            map[1] = optarg;
+            break;
+        case 'R':
+            map[2] = optarg;
+            break;
+        case 'D':
+            map[3] = optarg;
+            break;
+        case 'n':
+            dtr1 = 0;
+            break;
+        case 'N':
+            dtr2 = 0;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    ret = create_devices(loopback, idx1, idx2, map, dtr1, dtr2, &a, &b);
+    if(ret < 0) {
+        fprintf(stderr, "can not create : %s\n", strerror(-ret));
+        return 1;
+    }
+    if(loopback)
+        printf("/dev/ttyvs%d\n", a);
+    else
+        printf("/dev/ttyvs%d /dev/ttyvs%d\n", a, b);
+    return 0;
+}
@@ -28,6 +28,9 @@
 # file in text editor to see list of variables and their values.
 # env >> /tmp/spudevenv.txt
 
+# To set latency timer of every adapter on hotplug as per vid/pid/serial instead of letting each
+# application set it, use usb-serial-tuned/sptuned.
+
 # Input argument ($1) to this script is devpath for the device (udev rule %p).
 
 chmod 0666 "/sys$1/device/latency_timer"
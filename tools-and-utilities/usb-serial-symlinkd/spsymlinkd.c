@@ -0,0 +1,491 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/*
+ * Keeps stable symbolic links to usb-uart tty devices (ttyUSBx, ttyACMx) in a directory. Link name is made
+ * from vendor id, product id, serial number and interface number of the usb device, for example:
+ * usbtty-0403_6001_A50285BI-if00 -> /dev/ttyUSB3
+ *
+ * At start, sysfs is walked once to create links for devices already present and to remove stale links
+ * left from a previous run. After this only kernel uevents (tty and usb subsystems) are processed, so cost
+ * of an event does not depend upon how many adapters are connected. Links are replaced atomically (new
+ * link is created with temporary name and renamed over the old one), so readers never see a missing link.
+ *
+ * It does not need udev and is meant to replace symlink-usb-serial.sh in systems which do not want to or
+ * can not use udev rules. If kernel reports that uevents were dropped, sysfs is walked again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <dirent.h>
+#include <poll.h>
+#include <syslog.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#ifndef SYSFS_TTY
+#define SYSFS_TTY           "/sys/class/tty"
+#endif
+#define DEFAULT_LINK_DIR    "/dev/serial/by-usb"
+#define DEFAULT_PREFIX      "usbtty-"
+#define UEVENT_BUF_SIZE     8192
+#define NETLINK_RCVBUF      (8 * 1024 * 1024)
+#define MAX_NAME            256
+
+struct link_entry {
+    char devname[64];            /* ttyUSB0 */
+    char usbpath[PATH_MAX];      /* sysfs path of usb device, /sys/devices/.../1-1.4 */
+    char linkname[MAX_NAME];     /* usbtty-0403_6001_A50285BI-if00 */
+};
+
+static struct link_entry *entries;
+static int num_entries;
+static int max_entries;
+
+static const char *link_dir = DEFAULT_LINK_DIR;
+static const char *link_prefix = DEFAULT_PREFIX;
+static int foreground;
+static int verbose;
+static int clean_on_exit;
+static volatile sig_atomic_t stop;
+static volatile sig_atomic_t rescan_requested;
+
+static void logmsg(int prio, const char *fmt, ...) {
+    va_list ap;
+
+    if(prio == LOG_DEBUG && !verbose)
+        return;
+    va_start(ap, fmt);
+    if(foreground) {
+        vfprintf(stderr, fmt, ap);
+        fputc('\n', stderr);
+    }else {
+        vsyslog(prio, fmt, ap);
+    }
+    va_end(ap);
+}
+
+static void on_signal(int sig) {
+    if(sig == SIGHUP)
+        rescan_requested = 1;
+    else
+        stop = 1;
+}
+
+/* Reads first line of a sysfs attribute, returns 0 if it exists and is not empty. */
+static int read_attr(const char *dir, const char *attr, char *buf, size_t len) {
+    char path[PATH_MAX];
+    ssize_t ret;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return -1;
+    ret = read(fd, buf, len - 1);
+    close(fd);
+    if(ret <= 0)
+        return -1;
+    buf[ret] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    return buf[0] ? 0 : -1;
+}
+
+/* Serial numbers may contain anything, keep only characters safe in a file name. */
+static void sanitize(char *s) {
+    for(; *s; s++) {
+        if(!((*s >= '0' && *s <= '9') || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z')
+                || *s == '-' || *s == '.'))
+            *s = '_';
+    }
+}
+
+/*
+ * Builds link name for the given tty class device (/sys/class/tty/ttyUSB0). The usb interface is the
+ * first parent of the tty's device having bInterfaceNumber and the usb device is the interface's parent.
+ * Gives -1 if tty is not backed by a usb device. If the device has no serial number, usb port path (for
+ * example 1-1.4) is used instead as it is stable as long as the device stays in the same port.
+ */
+static int build_name(const char *ttydir, int use_port, char *usbpath, char *name, size_t len) {
+    char path[PATH_MAX], dev[PATH_MAX];
+    char ifnum[8], vid[8], pid[8], serial[128];
+    char *slash;
+    int depth;
+
+    snprintf(path, sizeof(path), "%s/device", ttydir);
+    if(realpath(path, dev) == NULL)
+        return -1;
+
+    for(depth = 0; depth < 4; depth++) {
+        if(read_attr(dev, "bInterfaceNumber", ifnum, sizeof(ifnum)) == 0)
+            break;
+        slash = strrchr(dev, '/');
+        if(slash == NULL || slash == dev)
+            return -1;
+        *slash = '\0';
+    }
+    if(depth == 4)
+        return -1;
+
+    slash = strrchr(dev, '/');
+    if(slash == NULL)
+        return -1;
+    *slash = '\0';
+    if(read_attr(dev, "idVendor", vid, sizeof(vid)) || read_attr(dev, "idProduct", pid, sizeof(pid)))
+        return -1;
+    snprintf(usbpath, PATH_MAX, "%s", dev);
+
+    if(use_port || read_attr(dev, "serial", serial, sizeof(serial)) != 0)
+        snprintf(serial, sizeof(serial), "port%s", strrchr(dev, '/') + 1);
+    sanitize(serial);
+
+    snprintf(name, len, "%s%s_%s_%s-if%s", link_prefix, vid, pid, serial, ifnum);
+    return 0;
+}
+
+static struct link_entry *find_by_devname(const char *devname) {
+    int i;
+
+    for(i = 0; i < num_entries; i++) {
+        if(strcmp(entries[i].devname, devname) == 0)
+            return &entries[i];
+    }
+    return NULL;
+}
+
+static struct link_entry *find_by_linkname(const char *linkname) {
+    int i;
+
+    for(i = 0; i < num_entries; i++) {
+        if(strcmp(entries[i].linkname, linkname) == 0)
+            return &entries[i];
+    }
+    return NULL;
+}
+
+/* Points link to /dev/devname; creates temporary link and renames it over existing one. */
+static int update_link(const char *linkname, const char *devname) {
+    char target[PATH_MAX], path[PATH_MAX], tmp[PATH_MAX], cur[PATH_MAX];
+    ssize_t ret;
+
+    snprintf(target, sizeof(target), "/dev/%s", devname);
+    snprintf(path, sizeof(path), "%s/%s", link_dir, linkname);
+
+    ret = readlink(path, cur, sizeof(cur) - 1);
+    if(ret > 0) {
+        cur[ret] = '\0';
+        if(strcmp(cur, target) == 0)
+            return 0;
+    }
+
+    snprintf(tmp, sizeof(tmp), "%s/.%s.tmp", link_dir, linkname);
+    unlink(tmp);
+    if(symlink(target, tmp) < 0 || rename(tmp, path) < 0) {
+        logmsg(LOG_ERR, "can not create link %s : %s", path, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+    logmsg(LOG_INFO, "%s -> %s", path, target);
+    return 0;
+}
+
+static void remove_entry(struct link_entry *e) {
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s/%s", link_dir, e->linkname);
+    if(unlink(path) == 0)
+        logmsg(LOG_INFO, "removed %s", path);
+    *e = entries[--num_entries];
+}
+
+static void add_device(const char *devname) {
+    char ttydir[PATH_MAX], path[PATH_MAX], name[MAX_NAME], usbpath[PATH_MAX];
+    struct link_entry *e, *other;
+    void *p;
+
+    snprintf(ttydir, sizeof(ttydir), SYSFS_TTY "/%s", devname);
+    if(build_name(ttydir, 0, usbpath, name, sizeof(name)) < 0) {
+        logmsg(LOG_DEBUG, "%s is not a usb device", devname);
+        return;
+    }
+
+    /*
+     * Two adapters having same serial number, fall back to port path for this one. If the other tty is
+     * gone (its remove uevent was lost), it is just a stale entry.
+     */
+    other = find_by_linkname(name);
+    if(other && strcmp(other->devname, devname) != 0) {
+        snprintf(path, sizeof(path), SYSFS_TTY "/%s", other->devname);
+        if(access(path, F_OK) != 0) {
+            remove_entry(other);
+            other = NULL;
+        }
+    }
+    if(other) {
+        if(build_name(ttydir, 1, usbpath, name, sizeof(name)) < 0)
+            return;
+        logmsg(LOG_WARNING, "%s has serial number of %s, using port path", devname, other->devname);
+    }
+
+    e = find_by_devname(devname);
+    if(e && strcmp(e->linkname, name) != 0)
+        remove_entry(e);
+    e = find_by_devname(devname);
+    if(e == NULL) {
+        if(num_entries == max_entries) {
+            p = realloc(entries, sizeof(*entries) * (max_entries ? max_entries * 2 : 64));
+            if(p == NULL)
+                return;
+            entries = p;
+            max_entries = max_entries ? max_entries * 2 : 64;
+        }
+        e = &entries[num_entries++];
+    }
+    snprintf(e->devname, sizeof(e->devname), "%s", devname);
+    snprintf(e->usbpath, sizeof(e->usbpath), "%s", usbpath);
+    snprintf(e->linkname, sizeof(e->linkname), "%s", name);
+    update_link(name, devname);
+}
+
+static void remove_device(const char *devname) {
+    struct link_entry *e = find_by_devname(devname);
+
+    if(e)
+        remove_entry(e);
+}
+
+/* The tty remove uevent may have been lost; usb device removal cleans all its links. */
+static void remove_usb_device(const char *usbpath) {
+    size_t len = strlen(usbpath);
+    int i;
+
+    for(i = num_entries - 1; i >= 0; i--) {
+        if(strncmp(entries[i].usbpath, usbpath, len) == 0
+                && (entries[i].usbpath[len] == '\0' || entries[i].usbpath[len] == '/'))
+            remove_entry(&entries[i]);
+    }
+}
+
+/*
+ * Creates links for all usb tty devices present in system and removes links (with our prefix) which do not
+ * belong to any of them.
+ */
+static void full_scan(void) {
+    char path[PATH_MAX];
+    struct dirent *d;
+    DIR *dir;
+    int i;
+
+    num_entries = 0;
+    dir = opendir(SYSFS_TTY);
+    if(dir == NULL) {
+        logmsg(LOG_ERR, "can not open " SYSFS_TTY " : %s", strerror(errno));
+        return;
+    }
+    while((d = readdir(dir)) != NULL) {
+        if(d->d_name[0] != '.')
+            add_device(d->d_name);
+    }
+    closedir(dir);
+
+    dir = opendir(link_dir);
+    if(dir == NULL)
+        return;
+    while((d = readdir(dir)) != NULL) {
+        if(strncmp(d->d_name, link_prefix, strlen(link_prefix)) != 0)
+            continue;
+        for(i = 0; i < num_entries; i++) {
+            if(strcmp(entries[i].linkname, d->d_name) == 0)
+                break;
+        }
+        if(i == num_entries) {
+            snprintf(path, sizeof(path), "%s/%s", link_dir, d->d_name);
+            unlink(path);
+            logmsg(LOG_INFO, "removed stale %s", path);
+        }
+    }
+    closedir(dir);
+}
+
+/* Uevent is "action@devpath\0KEY=value\0KEY=value..." */
+static void handle_uevent(char *buf, ssize_t len) {
+    const char *action = NULL, *devpath = NULL, *subsystem = NULL, *devname = NULL, *devtype = NULL;
+    char usbpath[PATH_MAX];
+    char *p = buf, *end = buf + len;
+
+    if(strncmp(buf, "libudev", 7) == 0 || strchr(buf, '@') == NULL)
+        return;
+
+    for(p += strlen(p) + 1; p < end; p += strlen(p) + 1) {
+        if(strncmp(p, "ACTION=", 7) == 0)
+            action = p + 7;
+        else if(strncmp(p, "DEVPATH=", 8) == 0)
+            devpath = p + 8;
+        else if(strncmp(p, "SUBSYSTEM=", 10) == 0)
+            subsystem = p + 10;
+        else if(strncmp(p, "DEVNAME=", 8) == 0)
+            devname = p + 8;
+        else if(strncmp(p, "DEVTYPE=", 8) == 0)
+            devtype = p + 8;
+    }
+    if(action == NULL || subsystem == NULL)
+        return;
+
+    if(strcmp(subsystem, "tty") == 0 && devname) {
+        if(strcmp(action, "add") == 0)
+            add_device(devname);
+        else if(strcmp(action, "remove") == 0)
+            remove_device(devname);
+    }else if(strcmp(subsystem, "usb") == 0 && devpath && devtype
+            && strcmp(devtype, "usb_device") == 0 && strcmp(action, "remove") == 0) {
+        snprintf(usbpath, sizeof(usbpath), "/sys%s", devpath);
+        remove_usb_device(usbpath);
+    }
+}
+
+static int open_uevent_socket(void) {
+    struct sockaddr_nl addr;
+    int fd, size = NETLINK_RCVBUF;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if(fd < 0)
+        return -1;
+    /* hundreds of adapters may come up at once (powered hub), do not lose events */
+    if(setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_pid = 0;
+    addr.nl_groups = 1; /* kernel uevents */
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: spsymlinkd [-d dir] [-p prefix] [-f] [-v] [-c] [-o]\n"
+        "  -d  directory for links (default %s)\n"
+        "  -p  link name prefix (default %s)\n"
+        "  -f  stay in foreground and log to stderr\n"
+        "  -v  verbose\n"
+        "  -c  remove links when stopped\n"
+        "  -o  scan once and exit\n", DEFAULT_LINK_DIR, DEFAULT_PREFIX);
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    char buf[UEVENT_BUF_SIZE];
+    struct sigaction sa;
+    struct pollfd pfd;
+    int opt, fd, once = 0;
+    ssize_t len;
+
+    while((opt = getopt(argc, argv, "d:p:fvco")) != -1) {
+        switch(opt) {
+        case 'd':
+            link_dir = optarg;
+            break;
+        case 'p':
+            link_prefix = optarg;
+            break;
+        case 'f':
+            foreground = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 'c':
+            clean_on_exit = 1;
+            break;
+        case 'o':
+            once = 1;
+            foreground = 1;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if(mkdir(link_dir, 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "can not create %s : %s\n", link_dir, strerror(errno));
+        return 1;
+    }
+
+    if(once) {
+        full_scan();
+        return 0;
+    }
+
+    /* socket is opened before scanning so that no device appearing during scan is missed */
+    fd = open_uevent_socket();
+    if(fd < 0) {
+        fprintf(stderr, "can not open uevent socket : %s\n", strerror(errno));
+        return 1;
+    }
+
+    if(!foreground) {
+        if(daemon(0, 0) < 0)
+            return 1;
+        openlog("spsymlinkd", LOG_PID, LOG_DAEMON);
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+
+    full_scan();
+    logmsg(LOG_INFO, "%d usb tty devices, watching uevents", num_entries);
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    while(!stop) {
+        if(rescan_requested) {
+            rescan_requested = 0;
+            full_scan();
+        }
+        if(poll(&pfd, 1, -1) <= 0)
+            continue;
+        len = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+        if(len < 0) {
+            if(errno == ENOBUFS) {
+                logmsg(LOG_WARNING, "uevents dropped by kernel, scanning sysfs again");
+                full_scan();
+            }
+            continue;
+        }
+        buf[len] = '\0';
+        handle_uevent(buf, len);
+    }
+
+    if(clean_on_exit) {
+        while(num_entries > 0)
+            remove_entry(&entries[num_entries - 1]);
+    }
+    close(fd);
+    free(entries);
+    return 0;
+}
@@ -0,0 +1,497 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/*
+ * Applies latency timer, low latency flag, usb autosuspend and other driver attributes to usb-uart
+ * devices as soon as their tty device appears, as per a profile file matched on vendor id, product id
+ * and serial number. Applications then get an adapter which is already tuned for throughput or latency
+ * and do not have to call SerialComUSB.setLatencyTimer() on every port.
+ *
+ * Profile file has one rule per line, '#' starts a comment:
+ *
+ *   # vid  pid   serial     settings
+ *   0403   *     *          latency_timer=16
+ *   0403   6001  A50285BI   latency_timer=1 low_latency=1 autosuspend=off
+ *   10c4   ea60  *          attr.cp210x_gpio_1=1
+ *
+ * All rules matching a device are applied in file order, so a later (more specific) rule overrides an
+ * earlier one. Settings:
+ *
+ *   latency_timer=N   latency timer of FTDI chips in ms (latency_timer attribute of ftdi_sio).
+ *   low_latency=0|1   ASYNC_LOW_LATENCY flag through TIOCSSERIAL; tty is opened without blocking.
+ *   autosuspend=on|off usb runtime power management (power/control of usb device); off avoids resume delay.
+ *   attr.NAME=VALUE   any other attribute of the tty's device directory exposed by its driver.
+ *
+ * Runs as daemon listening for kernel uevents, or once for one tty (-t) from a udev RUN rule.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <dirent.h>
+#include <poll.h>
+#include <syslog.h>
+#include <stdarg.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/serial.h>
+
+#ifndef SYSFS_TTY
+#define SYSFS_TTY           "/sys/class/tty"
+#endif
+#define DEFAULT_PROFILE     "/etc/sp-usb-serial.conf"
+#define UEVENT_BUF_SIZE     8192
+#define NETLINK_RCVBUF      (4 * 1024 * 1024)
+#define MAX_ATTRS           8
+
+struct settings {
+    int latency_timer;       /* -1 not given */
+    int low_latency;         /* -1 not given */
+    int autosuspend;         /* -1 not given, 0 off, 1 on */
+    int num_attrs;
+    char attr_name[MAX_ATTRS][64];
+    char attr_value[MAX_ATTRS][64];
+};
+
+struct rule {
+    char vid[8];
+    char pid[8];
+    char serial[128];
+    struct settings set;
+};
+
+static struct rule *rules;
+static int num_rules;
+
+static const char *profile = DEFAULT_PROFILE;
+static int foreground;
+static int verbose;
+static volatile sig_atomic_t stop;
+static volatile sig_atomic_t reload_requested;
+
+static void logmsg(int prio, const char *fmt, ...) {
+    va_list ap;
+
+    if(prio == LOG_DEBUG && !verbose)
+        return;
+    va_start(ap, fmt);
+    if(foreground) {
+        vfprintf(stderr, fmt, ap);
+        fputc('\n', stderr);
+    }else {
+        vsyslog(prio, fmt, ap);
+    }
+    va_end(ap);
+}
+
+static void on_signal(int sig) {
+    if(sig == SIGHUP)
+        reload_requested = 1;
+    else
+        stop = 1;
+}
+
+static void clear_settings(struct settings *s) {
+    memset(s, 0, sizeof(*s));
+    s->latency_timer = -1;
+    s->low_latency = -1;
+    s->autosuspend = -1;
+}
+
+static int parse_setting(struct settings *s, char *tok) {
+    char *val = strchr(tok, '=');
+
+    if(val == NULL)
+        return -1;
+    *val++ = '\0';
+
+    if(strcmp(tok, "latency_timer") == 0) {
+        s->latency_timer = atoi(val);
+        if(s->latency_timer < 1 || s->latency_timer > 255)
+            return -1;
+    }else if(strcmp(tok, "low_latency") == 0) {
+        s->low_latency = atoi(val) ? 1 : 0;
+    }else if(strcmp(tok, "autosuspend") == 0) {
+        if(strcmp(val, "on") == 0)
+            s->autosuspend = 1;
+        else if(strcmp(val, "off") == 0)
+            s->autosuspend = 0;
+        else
+            return -1;
+    }else if(strncmp(tok, "attr.", 5) == 0 && tok[5] && strchr(tok + 5, '/') == NULL) {
+        if(s->num_attrs == MAX_ATTRS)
+            return -1;
+        snprintf(s->attr_name[s->num_attrs], sizeof(s->attr_name[0]), "%s", tok + 5);
+        snprintf(s->attr_value[s->num_attrs], sizeof(s->attr_value[0]), "%s", val);
+        s->num_attrs++;
+    }else {
+        return -1;
+    }
+    return 0;
+}
+
+static int load_profile(void) {
+    char line[1024], *tok, *save, *hash;
+    struct rule *new_rules = NULL, *p, r;
+    int n = 0, lineno = 0;
+    FILE *fp;
+
+    fp = fopen(profile, "r");
+    if(fp == NULL) {
+        logmsg(LOG_ERR, "can not open %s : %s", profile, strerror(errno));
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), fp)) {
+        lineno++;
+        hash = strchr(line, '#');
+        if(hash)
+            *hash = '\0';
+        tok = strtok_r(line, " \t\r\n", &save);
+        if(tok == NULL)
+            continue;
+
+        memset(&r, 0, sizeof(r));
+        clear_settings(&r.set);
+        snprintf(r.vid, sizeof(r.vid), "%s", tok);
+        tok = strtok_r(NULL, " \t\r\n", &save);
+        if(tok)
+            snprintf(r.pid, sizeof(r.pid), "%s", tok);
+        tok = strtok_r(NULL, " \t\r\n", &save);
+        if(tok == NULL) {
+            logmsg(LOG_ERR, "%s:%d : expected vid pid serial settings", profile, lineno);
+            continue;
+        }
+        snprintf(r.serial, sizeof(r.serial), "%s", tok);
+        while((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+            if(parse_setting(&r.set, tok) < 0)
+                logmsg(LOG_ERR, "%s:%d : invalid setting %s", profile, lineno, tok);
+        }
+
+        p = realloc(new_rules, sizeof(*new_rules) * (n + 1));
+        if(p == NULL)
+            break;
+        new_rules = p;
+        new_rules[n++] = r;
+    }
+    fclose(fp);
+
+    free(rules);
+    rules = new_rules;
+    num_rules = n;
+    logmsg(LOG_INFO, "%d rules loaded from %s", n, profile);
+    return 0;
+}
+
+static int read_attr(const char *dir, const char *attr, char *buf, size_t len) {
+    char path[PATH_MAX + 80];
+    ssize_t ret;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return -1;
+    ret = read(fd, buf, len - 1);
+    close(fd);
+    if(ret <= 0)
+        return -1;
+    buf[ret] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    return buf[0] ? 0 : -1;
+}
+
+/* Writes attribute only if its current value differs, to avoid needless control transfers. */
+static int write_attr(const char *dir, const char *attr, const char *value) {
+    char path[PATH_MAX + 80], cur[64];
+    ssize_t ret;
+    int fd;
+
+    if(read_attr(dir, attr, cur, sizeof(cur)) == 0 && strcmp(cur, value) == 0)
+        return 0;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    fd = open(path, O_WRONLY | O_CLOEXEC);
+    if(fd < 0)
+        return -1;
+    ret = write(fd, value, strlen(value));
+    close(fd);
+    return (ret == (ssize_t)strlen(value)) ? 0 : -1;
+}
+
+static int set_low_latency(const char *devname, int on) {
+    struct serial_struct ss;
+    char path[PATH_MAX];
+    int fd, ret = -1;
+
+    snprintf(path, sizeof(path), "/dev/%s", devname);
+    fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if(fd < 0)
+        return -1;
+    if(ioctl(fd, TIOCGSERIAL, &ss) == 0) {
+        if(on)
+            ss.flags |= ASYNC_LOW_LATENCY;
+        else
+            ss.flags &= ~ASYNC_LOW_LATENCY;
+        ret = ioctl(fd, TIOCSSERIAL, &ss);
+    }
+    close(fd);
+    return ret;
+}
+
+static int id_matches(const char *pattern, const char *value) {
+    return strcmp(pattern, "*") == 0 || strcasecmp(pattern, value) == 0;
+}
+
+/*
+ * Finds usb device of the given tty (/sys/class/tty/ttyUSB0/device is the usb-serial port or the usb
+ * interface, usb device is parent of the interface) and applies all matching rules.
+ */
+static void tune_device(const char *devname) {
+    char path[PATH_MAX + 16], port[PATH_MAX], usbdev[PATH_MAX];
+    char ifnum[8], vid[8], pid[8], serial[128], value[16];
+    struct settings s;
+    char *slash;
+    int depth, i, matched = 0;
+
+    snprintf(path, sizeof(path), SYSFS_TTY "/%s/device", devname);
+    if(realpath(path, port) == NULL)
+        return;
+
+    snprintf(usbdev, sizeof(usbdev), "%s", port);
+    for(depth = 0; depth < 4; depth++) {
+        if(read_attr(usbdev, "bInterfaceNumber", ifnum, sizeof(ifnum)) == 0)
+            break;
+        slash = strrchr(usbdev, '/');
+        if(slash == NULL || slash == usbdev)
+            return;
+        *slash = '\0';
+    }
+    if(depth == 4)
+        return;
+    slash = strrchr(usbdev, '/');
+    if(slash == NULL)
+        return;
+    *slash = '\0';
+
+    if(read_attr(usbdev, "idVendor", vid, sizeof(vid)) || read_attr(usbdev, "idProduct", pid, sizeof(pid)))
+        return;
+    if(read_attr(usbdev, "serial", serial, sizeof(serial)) != 0)
+        serial[0] = '\0';
+
+    clear_settings(&s);
+    for(i = 0; i < num_rules; i++) {
+        if(!id_matches(rules[i].vid, vid) || !id_matches(rules[i].pid, pid)
+                || !id_matches(rules[i].serial, serial))
+            continue;
+        matched = 1;
+        if(rules[i].set.latency_timer != -1)
+            s.latency_timer = rules[i].set.latency_timer;
+        if(rules[i].set.low_latency != -1)
+            s.low_latency = rules[i].set.low_latency;
+        if(rules[i].set.autosuspend != -1)
+            s.autosuspend = rules[i].set.autosuspend;
+        for(depth = 0; depth < rules[i].set.num_attrs && s.num_attrs < MAX_ATTRS; depth++) {
+            memcpy(s.attr_name[s.num_attrs], rules[i].set.attr_name[depth], sizeof(s.attr_name[0]));
+            memcpy(s.attr_value[s.num_attrs], rules[i].set.attr_value[depth], sizeof(s.attr_value[0]));
+            s.num_attrs++;
+        }
+    }
+    if(!matched) {
+        logmsg(LOG_DEBUG, "%s (%s:%s %s) no matching rule", devname, vid, pid, serial);
+        return;
+    }
+
+    if(s.autosuspend != -1) {
+        snprintf(path, sizeof(path), "%s/power", usbdev);
+        if(write_attr(path, "control", s.autosuspend ? "auto" : "on") < 0)
+            logmsg(LOG_WARNING, "%s : can not set autosuspend : %s", devname, strerror(errno));
+    }
+    if(s.latency_timer != -1) {
+        snprintf(value, sizeof(value), "%d", s.latency_timer);
+        if(write_attr(port, "latency_timer", value) < 0)
+            logmsg(LOG_WARNING, "%s : can not set latency timer : %s", devname, strerror(errno));
+    }
+    for(i = 0; i < s.num_attrs; i++) {
+        if(write_attr(port, s.attr_name[i], s.attr_value[i]) < 0)
+            logmsg(LOG_WARNING, "%s : can not set %s : %s", devname, s.attr_name[i], strerror(errno));
+    }
+    /* low latency is applied last; ftdi_sio changes latency timer when this flag changes */
+    if(s.low_latency != -1 && set_low_latency(devname, s.low_latency) < 0)
+        logmsg(LOG_WARNING, "%s : can not set low latency : %s", devname, strerror(errno));
+
+    logmsg(LOG_INFO, "%s (%s:%s %s) tuned", devname, vid, pid, serial);
+}
+
+static void tune_all(void) {
+    struct dirent *d;
+    DIR *dir;
+
+    dir = opendir(SYSFS_TTY);
+    if(dir == NULL)
+        return;
+    while((d = readdir(dir)) != NULL) {
+        if(d->d_name[0] != '.')
+            tune_device(d->d_name);
+    }
+    closedir(dir);
+}
+
+static void handle_uevent(char *buf, ssize_t len) {
+    const char *action = NULL, *subsystem = NULL, *devname = NULL;
+    char *p = buf, *end = buf + len;
+
+    if(strncmp(buf, "libudev", 7) == 0 || strchr(buf, '@') == NULL)
+        return;
+
+    for(p += strlen(p) + 1; p < end; p += strlen(p) + 1) {
+        if(strncmp(p, "ACTION=", 7) == 0)
+            action = p + 7;
+        else if(strncmp(p, "SUBSYSTEM=", 10) == 0)
+            subsystem = p + 10;
+        else if(strncmp(p, "DEVNAME=", 8) == 0)
+            devname = p + 8;
+    }
+    if(action && subsystem && devname && strcmp(action, "add") == 0 && strcmp(subsystem, "tty") == 0)
+        tune_device(devname);
+}
+
+static int open_uevent_socket(void) {
+    struct sockaddr_nl addr;
+    int fd, size = NETLINK_RCVBUF;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if(fd < 0)
+        return -1;
+    if(setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; /* kernel uevents */
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: sptuned [-c profile] [-f] [-v] [-o] [-t tty]\n"
+        "  -c  profile file (default %s)\n"
+        "  -f  stay in foreground and log to stderr\n"
+        "  -v  verbose\n"
+        "  -o  tune all present devices once and exit\n"
+        "  -t  tune given tty (for example ttyUSB0) once and exit, for udev RUN rules\n",
+        DEFAULT_PROFILE);
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    char buf[UEVENT_BUF_SIZE];
+    const char *tty = NULL;
+    struct sigaction sa;
+    struct pollfd pfd;
+    int opt, fd, once = 0;
+    ssize_t len;
+
+    while((opt = getopt(argc, argv, "c:fvot:")) != -1) {
+        switch(opt) {
+        case 'c':
+            profile = optarg;
+            break;
+        case 'f':
+            foreground = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 'o':
+            once = 1;
+            foreground = 1;
+            break;
+        case 't':
+            tty = optarg;
+            foreground = 1;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if(load_profile() < 0)
+        return 1;
+
+    if(tty) {
+        tune_device(tty);
+        return 0;
+    }
+    if(once) {
+        tune_all();
+        return 0;
+    }
+
+    fd = open_uevent_socket();
+    if(fd < 0) {
+        fprintf(stderr, "can not open uevent socket : %s\n", strerror(errno));
+        return 1;
+    }
+
+    if(!foreground) {
+        if(daemon(0, 0) < 0)
+            return 1;
+        openlog("sptuned", LOG_PID, LOG_DAEMON);
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+
+    tune_all();
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    while(!stop) {
+        if(reload_requested) {
+            reload_requested = 0;
+            if(load_profile() == 0)
+                tune_all();
+        }
+        if(poll(&pfd, 1, -1) <= 0)
+            continue;
+        len = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+        if(len < 0) {
+            if(errno == ENOBUFS) {
+                logmsg(LOG_WARNING, "uevents dropped by kernel, tuning all devices again");
+                tune_all();
+            }
+            continue;
+        }
+        buf[len] = '\0';
+        handle_uevent(buf, len);
+    }
+
+    close(fd);
+    free(rules);
+    return 0;
+}
@@ -0,0 +1,380 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* Learns device layout from sysfs and decodes CP210x/FTDI vendor requests into readable text. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "spusbmon.h"
+
+#define SYSFS_USB "/sys/bus/usb/devices"
+#define MAX_DEVICES 32
+
+static struct sp_device devices[MAX_DEVICES];
+static struct sp_port ports[MAX_PORTS];
+
+/* CP210x requests, same codes as used by sp_cp210x.c */
+static const char *cp210x_names[] = {
+    "IFC_ENABLE", "SET_BAUDDIV", "GET_BAUDDIV", "SET_LINE_CTL", "GET_LINE_CTL", "SET_BREAK",
+    "IMM_CHAR", "SET_MHS", "GET_MDMSTS", "SET_XON", "SET_XOFF", "SET_EVENTMASK", "GET_EVENTMASK",
+    "SET_CHAR", "GET_CHARS", "GET_PROPS", "GET_COMM_STATUS", "RESET", "PURGE", "SET_FLOW", "GET_FLOW",
+    "EMBED_EVENTS", "GET_EVENTSTATE", NULL, NULL, "SET_CHARS", NULL, NULL, NULL, "GET_BAUDRATE",
+    "SET_BAUDRATE",
+};
+
+static const char *ftdi_names[] = {
+    "RESET", "MODEM_CTRL", "SET_FLOW_CTRL", "SET_BAUDRATE", "SET_DATA", "GET_MODEM_STATUS",
+    "SET_EVENT_CHAR", "SET_ERROR_CHAR", NULL, "SET_LATENCY_TIMER", "GET_LATENCY_TIMER", "SET_BITMODE",
+    "READ_PINS",
+};
+
+static const char *parity_names[] = { "none", "odd", "even", "mark", "space" };
+static const char *stop_names[] = { "1", "1.5", "2" };
+
+static int read_sysfs_int(const char *dir, const char *attr, int base) {
+    char path[512];
+    char buf[32];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    fp = fopen(path, "r");
+    if(fp == NULL) {
+        return -1;
+    }
+    if(fgets(buf, sizeof(buf), fp) == NULL) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    return (int) strtol(buf, NULL, base);
+}
+
+/* Endpoints of interface directory (for example 3-2:1.0) appear as ep_XX sub directories. */
+static void scan_interface(struct sp_device *dev, const char *ifdir) {
+    DIR *dp;
+    struct dirent *de;
+    int ifnum = read_sysfs_int(ifdir, "bInterfaceNumber", 16);
+
+    dp = opendir(ifdir);
+    if(dp == NULL) {
+        return;
+    }
+    while(((de = readdir(dp)) != NULL) && (dev->num_ep < MAX_ENDPOINTS)) {
+        if(strncmp(de->d_name, "ep_", 3) == 0) {
+            dev->ep_addr[dev->num_ep] = (unsigned char) strtol(de->d_name + 3, NULL, 16);
+            dev->ep_ifnum[dev->num_ep] = ifnum;
+            dev->num_ep++;
+        }
+    }
+    closedir(dp);
+}
+
+static void scan_device(struct sp_device *dev) {
+    DIR *dp;
+    struct dirent *de;
+    char path[512];
+    char name[256] = "";
+    int vid;
+
+    dp = opendir(SYSFS_USB);
+    if(dp == NULL) {
+        return;
+    }
+    while((de = readdir(dp)) != NULL) {
+        if((de->d_name[0] == '.') || (strchr(de->d_name, ':') != NULL)) {
+            continue;
+        }
+        snprintf(path, sizeof(path), SYSFS_USB "/%s", de->d_name);
+        if((read_sysfs_int(path, "busnum", 10) == dev->busnum) && (read_sysfs_int(path, "devnum", 10) == dev->devnum)) {
+            snprintf(name, sizeof(name), "%s", de->d_name);
+            vid = read_sysfs_int(path, "idVendor", 16);
+            dev->speed = read_sysfs_int(path, "speed", 10);
+            if(vid == 0x10c4) {
+                dev->chip = CHIP_CP210X;
+            }else if(vid == 0x0403) {
+                dev->chip = CHIP_FTDI;
+            }
+            break;
+        }
+    }
+    if(name[0] == '\0') {
+        closedir(dp);
+        return;
+    }
+
+    rewinddir(dp);
+    while((de = readdir(dp)) != NULL) {
+        /* interfaces of this device are named <name>:<config>.<interface> */
+        if((strncmp(de->d_name, name, strlen(name)) == 0) && (de->d_name[strlen(name)] == ':')) {
+            snprintf(path, sizeof(path), SYSFS_USB "/%s", de->d_name);
+            scan_interface(dev, path);
+        }
+    }
+    closedir(dp);
+}
+
+/* Device is looked up in sysfs once, when its first URB is seen. */
+struct sp_device *sp_lookup_device(int busnum, int devnum) {
+    int x;
+
+    for(x = 0; x < MAX_DEVICES; x++) {
+        if(devices[x].used && (devices[x].busnum == busnum) && (devices[x].devnum == devnum)) {
+            return &devices[x];
+        }
+    }
+    for(x = 0; x < MAX_DEVICES; x++) {
+        if(!devices[x].used) {
+            memset(&devices[x], 0, sizeof(devices[x]));
+            devices[x].used = 1;
+            devices[x].busnum = busnum;
+            devices[x].devnum = devnum;
+            scan_device(&devices[x]);
+            return &devices[x];
+        }
+    }
+    return NULL;
+}
+
+struct sp_port *sp_lookup_port(struct sp_device *dev, int ifnum) {
+    int x;
+
+    for(x = 0; x < MAX_PORTS; x++) {
+        if(ports[x].used && (ports[x].busnum == dev->busnum) && (ports[x].devnum == dev->devnum)
+                && (ports[x].ifnum == ifnum)) {
+            return &ports[x];
+        }
+    }
+    for(x = 0; x < MAX_PORTS; x++) {
+        if(!ports[x].used) {
+            memset(&ports[x], 0, sizeof(ports[x]));
+            ports[x].used = 1;
+            ports[x].busnum = dev->busnum;
+            ports[x].devnum = dev->devnum;
+            ports[x].ifnum = ifnum;
+            ports[x].chip = dev->chip;
+            ports[x].max_packet = (dev->speed >= 480) ? 512 : 64;
+            return &ports[x];
+        }
+    }
+    return NULL;
+}
+
+struct sp_port *sp_port_table(void) {
+    return ports;
+}
+
+int sp_endpoint_ifnum(const struct sp_device *dev, unsigned char epnum) {
+    int x;
+
+    for(x = 0; x < dev->num_ep; x++) {
+        if(dev->ep_addr[x] == epnum) {
+            return dev->ep_ifnum[x];
+        }
+    }
+    return 0;
+}
+
+static int multi_interface(const struct sp_device *dev) {
+    int x;
+
+    for(x = 0; x < dev->num_ep; x++) {
+        if(dev->ep_ifnum[x] != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* CP210x addresses interface in wIndex; FTDI uses wIndex low byte 1..4 for port A..D on multi port chips. */
+int sp_control_ifnum(const struct sp_device *dev, const unsigned char *setup) {
+    int windex = setup[4] | (setup[5] << 8);
+
+    if(dev->chip == CHIP_FTDI) {
+        if(!multi_interface(dev) || ((windex & 0xFF) == 0)) {
+            return 0;
+        }
+        return (windex & 0xFF) - 1;
+    }
+    return windex & 0xFF;
+}
+
+static unsigned int ftdi_baudrate(const struct sp_device *dev, int wvalue, int windex) {
+    static const unsigned int frac8[] = { 0, 4, 2, 1, 3, 5, 6, 7 };
+    unsigned int div = wvalue & 0x3FFF;
+    unsigned int frac;
+    unsigned int base = 3000000;
+
+    /* on multi port and H chips upper byte of wIndex carries fraction and clock bits */
+    if(multi_interface(dev) || (dev->speed >= 480)) {
+        windex >>= 8;
+    }
+    frac = ((wvalue >> 14) & 3) | ((windex & 1) << 2);
+    if(windex & 2) {
+        base = 12000000;
+    }
+    if((div == 0) && (frac == 0)) {
+        return base;
+    }
+    if((div == 1) && (frac == 0)) {
+        return (base * 2) / 3;
+    }
+    return (unsigned int) ((base * 8ULL) / ((div * 8ULL) + frac8[frac]));
+}
+
+static void decode_cp210x(FILE *out, const unsigned char *setup, const unsigned char *data, uint32_t len) {
+    int req = setup[1];
+    int wvalue = setup[2] | (setup[3] << 8);
+    const char *name = NULL;
+
+    if(req < (int) (sizeof(cp210x_names) / sizeof(cp210x_names[0]))) {
+        name = cp210x_names[req];
+    }else if(req == 0xFF) {
+        name = "VENDOR_SPECIFIC";
+    }
+    if(name == NULL) {
+        fprintf(out, "CP210X req 0x%02x wValue 0x%04x", req, wvalue);
+        return;
+    }
+    fprintf(out, "%s", name);
+
+    switch(req) {
+    case 0x00:
+        fprintf(out, " %s", wvalue ? "enable" : "disable");
+        break;
+    case 0x01:
+        if(wvalue) {
+            fprintf(out, " %u", 0x384000 / wvalue);
+        }
+        break;
+    case 0x03:
+        fprintf(out, " %d%c%s", (wvalue >> 8) & 0x0F,
+                (((wvalue >> 4) & 0x0F) < 5) ? parity_names[(wvalue >> 4) & 0x0F][0] : '?',
+                ((wvalue & 0x0F) < 3) ? stop_names[wvalue & 0x0F] : "?");
+        break;
+    case 0x05:
+        fprintf(out, " %s", wvalue ? "on" : "off");
+        break;
+    case 0x07:
+        if(wvalue & 0x0100) {
+            fprintf(out, " DTR=%d", wvalue & 1);
+        }
+        if(wvalue & 0x0200) {
+            fprintf(out, " RTS=%d", (wvalue >> 1) & 1);
+        }
+        break;
+    case 0x12:
+        fprintf(out, " 0x%04x", wvalue);
+        break;
+    case 0x1D:
+    case 0x1E:
+        if(len >= 4) {
+            fprintf(out, " %u", data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int) data[3] << 24));
+        }
+        break;
+    case 0xFF:
+        fprintf(out, " 0x%04x", wvalue);
+        break;
+    default:
+        if(len > 0) {
+            fprintf(out, " [%u bytes]", len);
+        }
+    }
+}
+
+static void decode_ftdi(FILE *out, const struct sp_device *dev, const unsigned char *setup, const unsigned char *data,
+        uint32_t len) {
+    int req = setup[1];
+    int wvalue = setup[2] | (setup[3] << 8);
+    int windex = setup[4] | (setup[5] << 8);
+
+    if((req >= (int) (sizeof(ftdi_names) / sizeof(ftdi_names[0]))) || (ftdi_names[req] == NULL)) {
+        fprintf(out, "FTDI req 0x%02x wValue 0x%04x", req, wvalue);
+        return;
+    }
+    fprintf(out, "%s", ftdi_names[req]);
+
+    switch(req) {
+    case 0:
+        fprintf(out, " %s", (wvalue == 0) ? "sio" : (wvalue == 1) ? "purge-rx" : "purge-tx");
+        break;
+    case 1:
+        if(wvalue & 0x0100) {
+            fprintf(out, " DTR=%d", wvalue & 1);
+        }
+        if(wvalue & 0x0200) {
+            fprintf(out, " RTS=%d", (wvalue >> 1) & 1);
+        }
+        break;
+    case 2:
+        fprintf(out, " %s", ((windex >> 8) & 1) ? "rts-cts" : ((windex >> 8) & 2) ? "dtr-dsr" :
+                ((windex >> 8) & 4) ? "xon-xoff" : "none");
+        break;
+    case 3:
+        fprintf(out, " %u", ftdi_baudrate(dev, wvalue, windex));
+        break;
+    case 4:
+        fprintf(out, " %d%c%s%s", wvalue & 0xFF,
+                (((wvalue >> 8) & 7) < 5) ? parity_names[(wvalue >> 8) & 7][0] : '?',
+                (((wvalue >> 11) & 3) < 3) ? stop_names[(wvalue >> 11) & 3] : "?",
+                (wvalue & 0x4000) ? " break" : "");
+        break;
+    case 9:
+        fprintf(out, " %d ms", wvalue & 0xFF);
+        break;
+    case 5:
+    case 10:
+        if(len > 0) {
+            fprintf(out, " -> 0x%02x", data[0]);
+        }
+        break;
+    default:
+        fprintf(out, " 0x%04x", wvalue);
+    }
+}
+
+void sp_decode_control(FILE *out, const struct sp_device *dev, const unsigned char *setup,
+        const unsigned char *data, uint32_t len) {
+    /* only vendor requests carry serial port settings */
+    if((setup[0] & 0x60) != 0x40) {
+        fprintf(out, "STD req 0x%02x", setup[1]);
+        return;
+    }
+    if(dev->chip == CHIP_FTDI) {
+        decode_ftdi(out, dev, setup, data, len);
+    }else {
+        decode_cp210x(out, setup, data, len);
+    }
+}
+
+/* FTDI bulk IN packets begin with modem status and line status bytes which are not serial data. */
+size_t sp_strip_ftdi_status(const struct sp_port *port, const unsigned char *in, size_t len, unsigned char *out) {
+    size_t pos = 0;
+    size_t n = 0;
+    size_t chunk;
+
+    while(pos < len) {
+        chunk = len - pos;
+        if(chunk > (size_t) port->max_packet) {
+            chunk = port->max_packet;
+        }
+        if(chunk > 2) {
+            memcpy(out + n, in + pos + 2, chunk - 2);
+            n += chunk - 2;
+        }
+        pos += chunk;
+    }
+    return n;
+}
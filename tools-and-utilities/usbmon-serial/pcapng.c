@@ -0,0 +1,100 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/* Minimal pcapng writer; packets are usbmon mmapped records (LINKTYPE_USB_LINUX_MMAPPED) as Wireshark reads them. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spusbmon.h"
+
+#define BLOCK_SHB  0x0A0D0D0A
+#define BLOCK_IDB  0x00000001
+#define BLOCK_EPB  0x00000006
+#define LINKTYPE_USB_LINUX_MMAPPED  220
+#define PCAPNG_BUFFER_SIZE  (1024 * 1024)
+
+static FILE *fp;
+static char *iobuf;
+
+static int put32(uint32_t v) {
+    return fwrite(&v, 4, 1, fp) == 1 ? 0 : -1;
+}
+
+int pcapng_open(const char *path, uint32_t snaplen) {
+    fp = fopen(path, "wb");
+    if(fp == NULL) {
+        return -1;
+    }
+    /* large buffer so that writing never stalls the capture loop on small writes */
+    iobuf = malloc(PCAPNG_BUFFER_SIZE);
+    if(iobuf != NULL) {
+        setvbuf(fp, iobuf, _IOFBF, PCAPNG_BUFFER_SIZE);
+    }
+
+    /* section header : byte order magic, version 1.0, unknown section length */
+    put32(BLOCK_SHB);
+    put32(28);
+    put32(0x1A2B3C4D);
+    put32(0x00000001);
+    put32(0xFFFFFFFF);
+    put32(0xFFFFFFFF);
+    put32(28);
+
+    /* interface description with if_tsresol = 6 (microseconds) */
+    put32(BLOCK_IDB);
+    put32(32);
+    put32(LINKTYPE_USB_LINUX_MMAPPED);
+    put32(snaplen);
+    put32(0x00010009);
+    put32(0x00000006);
+    put32(0x00000000);
+    return put32(32);
+}
+
+int pcapng_write(const struct usbmon_packet *hdr, const unsigned char *data, uint32_t len) {
+    static const unsigned char pad[4] = { 0 };
+    uint32_t caplen = USBMON_HDR_LEN + len;
+    uint32_t padlen = (4 - (caplen & 3)) & 3;
+    uint32_t total = 32 + caplen + padlen;
+    uint64_t ts = ((uint64_t) hdr->ts_sec * 1000000) + (uint64_t) hdr->ts_usec;
+
+    if(fp == NULL) {
+        return -1;
+    }
+    put32(BLOCK_EPB);
+    put32(total);
+    put32(0);
+    put32((uint32_t) (ts >> 32));
+    put32((uint32_t) ts);
+    put32(caplen);
+    put32(USBMON_HDR_LEN + hdr->length);
+    fwrite(hdr, USBMON_HDR_LEN, 1, fp);
+    if(len > 0) {
+        fwrite(data, len, 1, fp);
+    }
+    if(padlen > 0) {
+        fwrite(pad, padlen, 1, fp);
+    }
+    return put32(total);
+}
+
+void pcapng_close(void) {
+    if(fp != NULL) {
+        fclose(fp);
+        fp = NULL;
+    }
+    free(iobuf);
+    iobuf = NULL;
+}
@@ -0,0 +1,396 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+/*
+ * Captures USB-UART traffic through binary usbmon interface (/dev/usbmonN) and prints it as serial port
+ * time line : settings changed through vendor control requests, bytes sent/received per port and how
+ * long every bulk URB took from submission to completion. Optionally saves the records as pcapng.
+ *
+ * Events are taken from the kernel's mmapped ring in batches with MON_IOCX_MFETCH so no copy per event
+ * and one system call per batch are needed. Drops reported by the kernel are printed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "spusbmon.h"
+
+/* mon_bin accepts ring sizes up to BUFF_MAX (1200 KB), largest one is used by default */
+#define MAX_RING_SIZE      (1200 * 1024)
+#define DEFAULT_RING_SIZE  MAX_RING_SIZE
+#define MAX_FETCH          1024
+#define URB_TABLE_SIZE     65536
+#define MAX_FILTER_DEVS    16
+#define HEX_DUMP_LEN       32
+
+/* Submission time and setup packet of pending URBs, direct mapped by URB id. */
+struct urb_entry {
+    uint64_t id;
+    uint64_t ts_us;
+    unsigned char setup[8];
+};
+
+static struct urb_entry urbs[URB_TABLE_SIZE];
+static volatile sig_atomic_t stop;
+static int filter_devs[MAX_FILTER_DEVS];
+static int num_filter_devs;
+static int all_devices;
+static int quiet;
+static int hexdump;
+static int write_pcap;
+static uint64_t start_us;
+static unsigned char strip_buf[65536];
+
+static void on_signal(int sig) {
+    (void) sig;
+    stop = 1;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: spusbmon [-i bus] [-d devnum]... [-a] [-w file.pcapng] [-q] [-x] [-s ringsize]\n"
+            "  -i bus   usbmon interface, 0 for all buses (default 0)\n"
+            "  -d dev   capture only given device number, may be repeated\n"
+            "  -a       capture all devices, not only CP210x/FTDI\n"
+            "  -w file  save captured records in pcapng format\n"
+            "  -q       print only per port summary at exit\n"
+            "  -x       hex dump first %d payload bytes\n"
+            "  -s size  kernel ring size in bytes (default and maximum %d)\n", HEX_DUMP_LEN, DEFAULT_RING_SIZE);
+    exit(1);
+}
+
+static struct urb_entry *urb_slot(uint64_t id) {
+    return &urbs[(id >> 4) & (URB_TABLE_SIZE - 1)];
+}
+
+static int device_wanted(const struct usbmon_packet *hdr, const struct sp_device *dev) {
+    int x;
+
+    if(num_filter_devs > 0) {
+        for(x = 0; x < num_filter_devs; x++) {
+            if(filter_devs[x] == hdr->devnum) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+    return all_devices || (dev->chip != CHIP_UNKNOWN);
+}
+
+static void print_prefix(uint64_t ts_us, const struct sp_port *port) {
+    uint64_t rel = ts_us - start_us;
+    printf("%4llu.%06llu %d-%d:%d ", (unsigned long long) (rel / 1000000), (unsigned long long) (rel % 1000000),
+            port->busnum, port->devnum, port->ifnum);
+}
+
+static void print_payload(const unsigned char *data, size_t len) {
+    size_t x;
+    size_t n = (len < HEX_DUMP_LEN) ? len : HEX_DUMP_LEN;
+
+    printf(" |");
+    for(x = 0; x < n; x++) {
+        printf(" %02x", data[x]);
+    }
+    printf((len > n) ? " ..\n" : "\n");
+}
+
+static void handle_control(const struct usbmon_packet *hdr, const unsigned char *data, struct sp_device *dev,
+        uint64_t ts_us) {
+    struct urb_entry *e = urb_slot(hdr->id);
+    const unsigned char *setup;
+    struct sp_port *port;
+    int in;
+
+    if(hdr->type == 'S') {
+        e->id = hdr->id;
+        e->ts_us = ts_us;
+        memcpy(e->setup, hdr->setup, 8);
+        /* OUT requests carry their data on submission, decode them right away */
+        if((hdr->setup[0] & 0x80) || (hdr->flag_setup != 0)) {
+            return;
+        }
+        setup = hdr->setup;
+        in = 0;
+    }else {
+        if(e->id != hdr->id) {
+            return;
+        }
+        e->id = 0;
+        setup = e->setup;
+        in = setup[0] & 0x80;
+        if(!in) {
+            return;
+        }
+    }
+
+    port = sp_lookup_port(dev, sp_control_ifnum(dev, setup));
+    if((port == NULL) || quiet) {
+        return;
+    }
+    print_prefix(ts_us, port);
+    printf("CTRL ");
+    sp_decode_control(stdout, dev, setup, data, hdr->len_cap);
+    if(hdr->type != 'S') {
+        printf(" (%llu us)", (unsigned long long) (ts_us - e->ts_us));
+    }
+    if(hdr->status != 0 && hdr->type != 'S') {
+        printf(" status %d", hdr->status);
+    }
+    printf("\n");
+}
+
+static void handle_bulk(const struct usbmon_packet *hdr, const unsigned char *data, struct sp_device *dev,
+        uint64_t ts_us) {
+    struct urb_entry *e = urb_slot(hdr->id);
+    struct sp_port *port;
+    int in = hdr->epnum & 0x80;
+    uint64_t latency;
+    size_t len;
+
+    if(hdr->type == 'S') {
+        e->id = hdr->id;
+        e->ts_us = ts_us;
+        return;
+    }
+    if(e->id != hdr->id) {
+        /* submitted before capture started */
+        return;
+    }
+    e->id = 0;
+    latency = ts_us - e->ts_us;
+
+    port = sp_lookup_port(dev, sp_endpoint_ifnum(dev, hdr->epnum));
+    if(port == NULL) {
+        return;
+    }
+    if(port->first_us == 0) {
+        port->first_us = ts_us;
+    }
+    port->last_us = ts_us;
+    port->lat_count++;
+    port->lat_sum_us += latency;
+    if(latency > port->lat_max_us) {
+        port->lat_max_us = latency;
+    }
+
+    /* completion of IN carries received data, completion of OUT carries actual length sent */
+    len = hdr->length;
+    if(in) {
+        if((port->chip == CHIP_FTDI) && (hdr->len_cap <= sizeof(strip_buf))) {
+            len = sp_strip_ftdi_status(port, data, hdr->len_cap, strip_buf);
+            data = strip_buf;
+        }else {
+            len = hdr->len_cap;
+        }
+        if(len == 0) {
+            /* FTDI sends status only packets every latency timer period, not interesting */
+            return;
+        }
+        port->rx_bytes += len;
+        port->rx_urbs++;
+    }else {
+        port->tx_bytes += len;
+        port->tx_urbs++;
+    }
+
+    if(quiet) {
+        return;
+    }
+    print_prefix(ts_us, port);
+    printf("%s %5zu bytes urb %6llu us", in ? "RX" : "TX", len, (unsigned long long) latency);
+    if(hdr->status != 0) {
+        printf(" status %d", hdr->status);
+    }
+    if(hexdump && in) {
+        print_payload(data, len);
+    }else {
+        printf("\n");
+    }
+}
+
+static void handle_event(const struct usbmon_packet *hdr) {
+    const unsigned char *data = (const unsigned char *) hdr + USBMON_HDR_LEN + (hdr->ndesc * USBMON_ISO_DESC);
+    uint64_t ts_us = ((uint64_t) hdr->ts_sec * 1000000) + (uint64_t) hdr->ts_usec;
+    struct sp_device *dev;
+
+    dev = sp_lookup_device(hdr->busnum, hdr->devnum);
+    if((dev == NULL) || !device_wanted(hdr, dev)) {
+        return;
+    }
+    if(start_us == 0) {
+        start_us = ts_us;
+    }
+    if(write_pcap) {
+        pcapng_write(hdr, (const unsigned char *) hdr + USBMON_HDR_LEN, hdr->len_cap + (hdr->ndesc * USBMON_ISO_DESC));
+    }
+
+    if(hdr->xfer_type == XFER_CONTROL) {
+        handle_control(hdr, data, dev, ts_us);
+    }else if(hdr->xfer_type == XFER_BULK) {
+        handle_bulk(hdr, data, dev, ts_us);
+    }
+}
+
+static void print_summary(void) {
+    struct sp_port *ports = sp_port_table();
+    double secs;
+    int x;
+
+    printf("\nport       rx bytes   rx MB/s   tx bytes   tx MB/s   urbs   avg urb us   max urb us\n");
+    for(x = 0; x < MAX_PORTS; x++) {
+        if(!ports[x].used || (ports[x].lat_count == 0)) {
+            continue;
+        }
+        secs = (ports[x].last_us > ports[x].first_us) ? (ports[x].last_us - ports[x].first_us) / 1e6 : 1e-6;
+        printf("%d-%d:%-4d %10llu %9.3f %10llu %9.3f %6llu %12llu %12llu\n", ports[x].busnum, ports[x].devnum,
+                ports[x].ifnum, (unsigned long long) ports[x].rx_bytes, ports[x].rx_bytes / secs / 1e6,
+                (unsigned long long) ports[x].tx_bytes, ports[x].tx_bytes / secs / 1e6,
+                (unsigned long long) ports[x].lat_count,
+                (unsigned long long) (ports[x].lat_sum_us / ports[x].lat_count),
+                (unsigned long long) ports[x].lat_max_us);
+    }
+}
+
+int main(int argc, char **argv) {
+    struct mon_bin_mfetch fetch;
+    struct mon_bin_stats stats;
+    struct sigaction sa;
+    uint32_t offvec[MAX_FETCH];
+    uint32_t nflush = 0;
+    uint64_t dropped = 0;
+    struct timespec now;
+    time_t last_check = 0;
+    unsigned char *ring;
+    char path[64];
+    long ring_size = DEFAULT_RING_SIZE;
+    const char *pcap_path = NULL;
+    int bus = 0;
+    int fd, opt;
+    uint32_t x;
+
+    while((opt = getopt(argc, argv, "i:d:aw:qxs:")) != -1) {
+        switch(opt) {
+        case 'i': bus = atoi(optarg); break;
+        case 'd':
+            if(num_filter_devs < MAX_FILTER_DEVS) {
+                filter_devs[num_filter_devs++] = atoi(optarg);
+            }
+            break;
+        case 'a': all_devices = 1; break;
+        case 'w': pcap_path = optarg; break;
+        case 'q': quiet = 1; break;
+        case 'x': hexdump = 1; break;
+        case 's': ring_size = atol(optarg); break;
+        default: usage();
+        }
+    }
+
+    snprintf(path, sizeof(path), "/dev/usbmon%d", bus);
+    fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        fprintf(stderr, "open %s failed with error code : %d (modprobe usbmon, run as root)\n", path, errno);
+        return -1;
+    }
+
+    if(ring_size > MAX_RING_SIZE) {
+        fprintf(stderr, "ring size %ld is more than kernel maximum, using %d\n", ring_size, MAX_RING_SIZE);
+        ring_size = MAX_RING_SIZE;
+    }
+
+    /* kernel limits ring size, fall back to whatever it currently has */
+    if(ioctl(fd, MON_IOCT_RING_SIZE, ring_size) < 0) {
+        fprintf(stderr, "ring size %ld not accepted (error %d), using default\n", ring_size, errno);
+    }
+    ring_size = ioctl(fd, MON_IOCQ_RING_SIZE);
+    if(ring_size <= 0) {
+        fprintf(stderr, "ring size query failed with error code : %d\n", errno);
+        close(fd);
+        return -1;
+    }
+    ring = mmap(NULL, ring_size, PROT_READ, MAP_SHARED, fd, 0);
+    if(ring == MAP_FAILED) {
+        fprintf(stderr, "mmap failed with error code : %d\n", errno);
+        close(fd);
+        return -1;
+    }
+
+    if(pcap_path != NULL) {
+        if(pcapng_open(pcap_path, 65535) < 0) {
+            fprintf(stderr, "could not create %s\n", pcap_path);
+            return -1;
+        }
+        write_pcap = 1;
+    }
+
+    /* no SA_RESTART, blocked MFETCH must return on ctrl+c */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    fprintf(stderr, "capturing on %s, ring %ld bytes\n", path, ring_size);
+
+    while(!stop) {
+        fetch.offvec = offvec;
+        fetch.nfetch = MAX_FETCH;
+        fetch.nflush = nflush;
+        if(ioctl(fd, MON_IOCX_MFETCH, &fetch) < 0) {
+            if(errno == EINTR) {
+                nflush = 0;
+                continue;
+            }
+            fprintf(stderr, "fetch failed with error code : %d\n", errno);
+            break;
+        }
+        for(x = 0; x < fetch.nfetch; x++) {
+            const struct usbmon_packet *hdr = (const struct usbmon_packet *) (ring + offvec[x]);
+            if(hdr->type != '@') {
+                handle_event(hdr);
+            }
+        }
+        /* records are given back to kernel with next fetch */
+        nflush = fetch.nfetch;
+
+        /* kernel clears its drop counter on every read, check once a second */
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if((now.tv_sec != last_check) && (ioctl(fd, MON_IOCG_STATS, &stats) == 0)) {
+            last_check = now.tv_sec;
+            if(stats.dropped > 0) {
+                fprintf(stderr, "kernel dropped %u events, increase ring size (-s) or use -q\n", stats.dropped);
+                dropped += stats.dropped;
+            }
+        }
+    }
+
+    if(nflush > 0) {
+        ioctl(fd, MON_IOCH_MFLUSH, nflush);
+    }
+    print_summary();
+    if(ioctl(fd, MON_IOCG_STATS, &stats) == 0) {
+        dropped += stats.dropped;
+    }
+    printf("kernel dropped events : %llu\n", (unsigned long long) dropped);
+    if(write_pcap) {
+        pcapng_close();
+    }
+    munmap(ring, ring_size);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/************************************************************************************************
+ * This file is part of SerialPundit.
+ * 
+ * Copyright (C) 2014-2020, Rishi Gupta. All rights reserved.
+ *
+ * The SerialPundit is DUAL LICENSED. It is made available under the terms of the GNU Affero 
+ * General Public License (AGPL) v3.0 for non-commercial use and under the terms of a commercial 
+ * license for commercial use of this software. 
+ * 
+ * The SerialPundit is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; 
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ ************************************************************************************************/
+
+#ifndef SP_USBMON_H_
+#define SP_USBMON_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Binary usbmon interface, see Documentation/usb/usbmon.rst in kernel sources. There is no uapi header. */
+struct usbmon_packet {
+    uint64_t id;             /* URB id, same for submission and completion */
+    unsigned char type;      /* 'S' submit, 'C' complete, 'E' error, '@' filler in mmap ring */
+    unsigned char xfer_type; /* 0 iso, 1 interrupt, 2 control, 3 bulk */
+    unsigned char epnum;     /* endpoint address, bit 7 set for IN */
+    unsigned char devnum;
+    uint16_t busnum;
+    char flag_setup;
+    char flag_data;
+    int64_t ts_sec;
+    int32_t ts_usec;
+    int32_t status;
+    uint32_t length;         /* submitted or actual length */
+    uint32_t len_cap;        /* bytes captured after this header */
+    unsigned char setup[8];  /* iso error count/numdesc for iso transfers */
+    int32_t interval;
+    int32_t start_frame;
+    uint32_t xfer_flags;
+    uint32_t ndesc;          /* iso descriptors (16 bytes each) preceding data */
+};
+
+struct mon_bin_stats {
+    uint32_t queued;
+    uint32_t dropped;
+};
+
+struct mon_bin_mfetch {
+    uint32_t *offvec;
+    uint32_t nfetch;
+    uint32_t nflush;
+};
+
+#define MON_IOC_MAGIC       0x92
+#define MON_IOCG_STATS      _IOR(MON_IOC_MAGIC, 3, struct mon_bin_stats)
+#define MON_IOCT_RING_SIZE  _IO(MON_IOC_MAGIC, 4)
+#define MON_IOCQ_RING_SIZE  _IO(MON_IOC_MAGIC, 5)
+#define MON_IOCX_MFETCH     _IOWR(MON_IOC_MAGIC, 7, struct mon_bin_mfetch)
+#define MON_IOCH_MFLUSH     _IO(MON_IOC_MAGIC, 8)
+
+#define USBMON_HDR_LEN   64
+#define USBMON_ISO_DESC  16
+
+#define XFER_CONTROL  2
+#define XFER_BULK     3
+
+enum sp_chip {
+    CHIP_UNKNOWN = 0,
+    CHIP_CP210X,
+    CHIP_FTDI,
+};
+
+#define MAX_PORTS      64
+#define MAX_ENDPOINTS  32
+
+/* One serial port, i.e. one interface of a USB-UART device. */
+struct sp_port {
+    int used;
+    int busnum;
+    int devnum;
+    int ifnum;
+    enum sp_chip chip;
+    int max_packet;           /* bulk IN packet size, FTDI inserts 2 status bytes per packet */
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+    uint64_t rx_urbs;
+    uint64_t tx_urbs;
+    uint64_t lat_count;
+    uint64_t lat_sum_us;
+    uint64_t lat_max_us;
+    uint64_t first_us;
+    uint64_t last_us;
+};
+
+/* Endpoint of a device and the interface (port) it belongs to, learnt from sysfs. */
+struct sp_device {
+    int used;
+    int busnum;
+    int devnum;
+    enum sp_chip chip;
+    int speed;                /* Mbit/s as given by sysfs */
+    int num_ep;
+    unsigned char ep_addr[MAX_ENDPOINTS];
+    int ep_ifnum[MAX_ENDPOINTS];
+};
+
+/* decode.c */
+struct sp_device *sp_lookup_device(int busnum, int devnum);
+struct sp_port *sp_lookup_port(struct sp_device *dev, int ifnum);
+int sp_endpoint_ifnum(const struct sp_device *dev, unsigned char epnum);
+int sp_control_ifnum(const struct sp_device *dev, const unsigned char *setup);
+void sp_decode_control(FILE *out, const struct sp_device *dev, const unsigned char *setup,
+        const unsigned char *data, uint32_t len);
+size_t sp_strip_ftdi_status(const struct sp_port *port, const unsigned char *in, size_t len, unsigned char *out);
+struct sp_port *sp_port_table(void);
+
+/* pcapng.c */
+int pcapng_open(const char *path, uint32_t snaplen);
+int pcapng_write(const struct usbmon_packet *hdr, const unsigned char *data, uint32_t len);
+void pcapng_close(void);
+
+#endif /* SP_USBMON_H_ */